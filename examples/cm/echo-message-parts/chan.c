@@ -57,12 +57,14 @@ enum
 {
   PROP_SMS = 1,
   PROP_SMS_FLASH,
+  PROP_CHAT_STATES_SENT,
   N_PROPS
 };
 
 struct _ExampleEcho2ChannelPrivate
 {
   gboolean sms;
+  guint chat_states_sent;
 };
 
 static void
@@ -182,6 +184,10 @@ send_chat_state (GObject *object,
     TpChannelChatState state,
     GError **error)
 {
+  ExampleEcho2Channel *self = EXAMPLE_ECHO_2_CHANNEL (object);
+
+  /* A real protocol would send @state to the contact here */
+  self->priv->chat_states_sent++;
   return TRUE;
 }
 
@@ -309,6 +315,9 @@ get_property (GObject *object,
       case PROP_SMS_FLASH:
         g_value_set_boolean (value, TRUE);
         break;
+      case PROP_CHAT_STATES_SENT:
+        g_value_set_uint (value, self->priv->chat_states_sent);
+        break;
       default:
         G_OBJECT_WARN_INVALID_PROPERTY_ID (object, property_id, pspec);
         break;
@@ -353,6 +362,13 @@ example_echo_2_channel_class_init (ExampleEcho2ChannelClass *klass)
       G_PARAM_READABLE | G_PARAM_STATIC_STRINGS);
   g_object_class_install_property (object_class, PROP_SMS_FLASH, param_spec);
 
+  param_spec = g_param_spec_uint ("chat-states-sent", "Chat states sent",
+      "The number of times our chat state was sent to the contact",
+      0, G_MAXUINT, 0,
+      G_PARAM_READABLE | G_PARAM_STATIC_STRINGS);
+  g_object_class_install_property (object_class, PROP_CHAT_STATES_SENT,
+      param_spec);
+
   tp_dbus_properties_mixin_implement_interface (object_class,
       TP_IFACE_QUARK_CHANNEL_INTERFACE_SMS,
       tp_dbus_properties_mixin_getter_gobject_properties, NULL,
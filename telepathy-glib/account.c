@@ -40,6 +40,7 @@
 #include "telepathy-glib/debug-internal.h"
 #include "telepathy-glib/proxy-internal.h"
 #include "telepathy-glib/simple-client-factory-internal.h"
+#include "telepathy-glib/timer-internal.h"
 #include "telepathy-glib/util-internal.h"
 #include "telepathy-glib/variant-util-internal.h"
 
@@ -141,6 +142,15 @@ struct _TpAccountPrivate {
   GStrv uri_schemes;
 
   gboolean connection_prepared;
+
+  /* PROP_BIT()s of properties whose change notification has not been
+   * emitted yet */
+  guint64 pending_notify;
+  /* the connection status before the pending changes */
+  TpConnectionStatus pending_old_status;
+  /* 0 if change notification is not coalesced */
+  guint coalesce_ms;
+  TpTimer *coalesce_timer;
 };
 
 G_DEFINE_TYPE (TpAccount, tp_account, TP_TYPE_PROXY)
@@ -194,6 +204,10 @@ enum {
   N_PROPS
 };
 
+static GParamSpec *account_props[N_PROPS] = { NULL };
+
+static void account_emit_pending (TpAccount *self);
+
 static void tp_account_prepare_connection_async (TpProxy *proxy,
     const TpProxyFeature *feature,
     GAsyncReadyCallback callback,
@@ -398,6 +412,9 @@ _tp_account_invalidated_cb (TpAccount *self,
 {
   TpAccountPrivate *priv = self->priv;
 
+  /* Don't let coalesced changes arrive after the disconnection below */
+  account_emit_pending (self);
+
   /* The connection will get disconnected as a result of account deletion,
    * but by then we will no longer be telling the API user about changes -
    * so claim the disconnection already happened (see fd.o#25149) */
@@ -622,374 +639,581 @@ tp_account_prepare_storage_async (TpProxy *proxy,
       _tp_account_got_all_storage_cb, result, g_object_unref, G_OBJECT (self));
 }
 
+/* Updates to the Account interface's properties are applied by looking up
+ * each property in the update in account_fields, rather than by probing the
+ * update for every property we know about. Each handler stores the new
+ * value and, if it differs from the old one, sets the bit for the
+ * corresponding property in AccountUpdate.changed; change notification is
+ * emitted once for the whole update by account_emit_pending(), or later if
+ * tp_account_set_change_coalescing() has been called. */
+
+#define PROP_BIT(prop) (G_GUINT64_CONSTANT (1) << (prop))
+
+G_STATIC_ASSERT (N_PROPS <= 64);
+
+/* These are notified as groups, since they are documented to be
+ * consistent with each other */
+#define STATUS_PROPS \
+  (PROP_BIT (PROP_CONNECTION_STATUS) | \
+   PROP_BIT (PROP_CONNECTION_STATUS_REASON) | \
+   PROP_BIT (PROP_CONNECTION_ERROR) | \
+   PROP_BIT (PROP_CONNECTION_ERROR_DETAILS))
+#define CURRENT_PRESENCE_PROPS \
+  (PROP_BIT (PROP_CURRENT_PRESENCE_TYPE) | \
+   PROP_BIT (PROP_CURRENT_STATUS) | \
+   PROP_BIT (PROP_CURRENT_STATUS_MESSAGE))
+#define REQUESTED_PRESENCE_PROPS \
+  (PROP_BIT (PROP_REQUESTED_PRESENCE_TYPE) | \
+   PROP_BIT (PROP_REQUESTED_STATUS) | \
+   PROP_BIT (PROP_REQUESTED_STATUS_MESSAGE))
+#define AUTOMATIC_PRESENCE_PROPS \
+  (PROP_BIT (PROP_AUTOMATIC_PRESENCE_TYPE) | \
+   PROP_BIT (PROP_AUTOMATIC_STATUS) | \
+   PROP_BIT (PROP_AUTOMATIC_STATUS_MESSAGE))
+
+typedef struct {
+    /* PROP_BIT()s of the properties changed by this update */
+    guint64 changed;
+    /* TRUE if the update included Connection */
+    gboolean have_connection;
+    /* borrowed from the update; may be NULL if it was the wrong type */
+    const gchar *connection_path;
+} AccountUpdate;
+
+typedef void (*AccountFieldFunc) (TpAccount *self,
+    const GValue *value,
+    glong offset,
+    guint prop_id,
+    AccountUpdate *update);
+
+typedef struct {
+    const gchar *name;
+    AccountFieldFunc func;
+    /* offset into TpAccountPrivate, for handlers that are shared between
+     * several fields of the same type */
+    glong offset;
+    guint prop_id;
+} AccountField;
+
 static void
-_tp_account_update (TpAccount *account,
-    GHashTable *properties)
+update_interfaces (TpAccount *self,
+    const GValue *value,
+    glong offset G_GNUC_UNUSED,
+    guint prop_id G_GNUC_UNUSED,
+    AccountUpdate *update G_GNUC_UNUSED)
 {
-  TpProxy *proxy = TP_PROXY (account);
-  TpAccountPrivate *priv = account->priv;
-  GValueArray *arr;
-  TpConnectionStatus old_s = priv->connection_status;
-  gboolean status_changed = FALSE;
-  gboolean presence_changed = FALSE;
-  const gchar *status;
-  const gchar *message;
+  if (G_VALUE_HOLDS (value, G_TYPE_STRV))
+    tp_proxy_add_interfaces ((TpProxy *) self, g_value_get_boxed (value));
+}
+
+static void
+update_connection_status (TpAccount *self,
+    const GValue *value,
+    glong offset G_GNUC_UNUSED,
+    guint prop_id,
+    AccountUpdate *update)
+{
+  TpConnectionStatus status = 0;
 
-  tp_proxy_add_interfaces (proxy, tp_asv_get_strv (properties, "Interfaces"));
+  if (G_VALUE_HOLDS_UINT (value))
+    status = g_value_get_uint (value);
 
-  if (g_hash_table_lookup (properties, "ConnectionStatus") != NULL)
+  if (self->priv->connection_status != status)
     {
-      priv->connection_status =
-        tp_asv_get_uint32 (properties, "ConnectionStatus", NULL);
-
-      if (old_s != priv->connection_status)
-        status_changed = TRUE;
+      self->priv->connection_status = status;
+      update->changed |= PROP_BIT (prop_id);
     }
+}
 
-  if (g_hash_table_lookup (properties, "ConnectionStatusReason") != NULL)
-    {
-      TpConnectionStatusReason old = priv->reason;
+static void
+update_connection_status_reason (TpAccount *self,
+    const GValue *value,
+    glong offset G_GNUC_UNUSED,
+    guint prop_id,
+    AccountUpdate *update)
+{
+  TpConnectionStatusReason reason = 0;
 
-      priv->reason =
-        tp_asv_get_uint32 (properties, "ConnectionStatusReason", NULL);
+  if (G_VALUE_HOLDS_UINT (value))
+    reason = g_value_get_uint (value);
 
-      if (old != priv->reason)
-        status_changed = TRUE;
+  if (self->priv->reason != reason)
+    {
+      self->priv->reason = reason;
+      update->changed |= PROP_BIT (prop_id);
     }
+}
 
-  if (g_hash_table_lookup (properties, "ConnectionError") != NULL)
-    {
-      const gchar *new_error = tp_asv_get_string (properties,
-          "ConnectionError");
+static void
+update_connection_error (TpAccount *self,
+    const GValue *value,
+    glong offset G_GNUC_UNUSED,
+    guint prop_id,
+    AccountUpdate *update)
+{
+  const gchar *new_error = NULL;
 
-      if (tp_str_empty (new_error))
-        new_error = NULL;
+  if (G_VALUE_HOLDS_STRING (value))
+    new_error = g_value_get_string (value);
 
-      if (tp_strdiff (new_error, priv->error))
-        {
-          tp_clear_pointer (&priv->error, g_free);
-          priv->error = g_strdup (new_error);
-          status_changed = TRUE;
-        }
-    }
+  if (tp_str_empty (new_error))
+    new_error = NULL;
 
-  if (g_hash_table_lookup (properties, "ConnectionErrorDetails") != NULL)
+  if (tp_strdiff (new_error, self->priv->error))
     {
-      const GHashTable *details = tp_asv_get_boxed (properties,
-          "ConnectionErrorDetails", TP_HASH_TYPE_STRING_VARIANT_MAP);
-
-      if ((details != NULL && tp_asv_size (details) > 0) ||
-          tp_asv_size (priv->error_details) > 0)
-        {
-          g_hash_table_remove_all (priv->error_details);
+      g_free (self->priv->error);
+      self->priv->error = g_strdup (new_error);
+      update->changed |= PROP_BIT (prop_id);
+    }
+}
 
-          if (details != NULL)
-            tp_g_hash_table_update (priv->error_details,
-                (GHashTable *) details,
-                (GBoxedCopyFunc) g_strdup,
-                (GBoxedCopyFunc) tp_g_value_slice_dup);
+static void
+update_connection_error_details (TpAccount *self,
+    const GValue *value,
+    glong offset G_GNUC_UNUSED,
+    guint prop_id,
+    AccountUpdate *update)
+{
+  GHashTable *details = NULL;
 
-          status_changed = TRUE;
-        }
-    }
+  if (G_VALUE_HOLDS (value, TP_HASH_TYPE_STRING_VARIANT_MAP))
+    details = g_value_get_boxed (value);
 
-  if (status_changed)
+  if ((details != NULL && tp_asv_size (details) > 0) ||
+      tp_asv_size (self->priv->error_details) > 0)
     {
-      if (priv->connection_status == TP_CONNECTION_STATUS_CONNECTED)
-        {
-          /* our connection status is CONNECTED - clear any error we may
-           * have recorded previously */
-          g_hash_table_remove_all (priv->error_details);
-          tp_clear_pointer (&priv->error, g_free);
-        }
-      else if (priv->error == NULL)
-        {
-          /* our connection status is worse than CONNECTED but the
-           * AccountManager didn't tell us why, so attempt to guess
-           * a detailed error from the status reason */
-          const gchar *guessed = NULL;
+      g_hash_table_remove_all (self->priv->error_details);
 
-          _tp_connection_status_reason_to_gerror (priv->reason,
-              old_s, &guessed, NULL);
+      if (details != NULL)
+        tp_g_hash_table_update (self->priv->error_details, details,
+            (GBoxedCopyFunc) g_strdup,
+            (GBoxedCopyFunc) tp_g_value_slice_dup);
 
-          if (guessed == NULL)
-            guessed = TP_ERROR_STR_DISCONNECTED;
-
-          priv->error = g_strdup (guessed);
-        }
+      update->changed |= PROP_BIT (prop_id);
     }
+}
 
-  if (g_hash_table_lookup (properties, "CurrentPresence") != NULL)
-    {
-      presence_changed = TRUE;
-      arr = tp_asv_get_boxed (properties, "CurrentPresence",
-          TP_STRUCT_TYPE_SIMPLE_PRESENCE);
-
-      tp_value_array_unpack (arr, 3,
-          &priv->cur_presence,
-          &status,
-          &message);
-      g_free (priv->cur_status);
-      priv->cur_status = g_strdup (status);
-      g_free (priv->cur_message);
-      priv->cur_message = g_strdup (message);
-    }
+static gboolean
+update_presence (const GValue *value,
+    TpConnectionPresenceType *presence,
+    gchar **status,
+    gchar **message)
+{
+  TpConnectionPresenceType new_presence;
+  const gchar *new_status;
+  const gchar *new_message;
 
-  if (g_hash_table_lookup (properties, "RequestedPresence") != NULL)
-    {
-      arr = tp_asv_get_boxed (properties, "RequestedPresence",
-          TP_STRUCT_TYPE_SIMPLE_PRESENCE);
-
-      tp_value_array_unpack (arr, 3,
-          &priv->requested_presence,
-          &status,
-          &message);
-      g_free (priv->requested_status);
-      priv->requested_status = g_strdup (status);
-      g_free (priv->requested_message);
-      priv->requested_message = g_strdup (message);
-
-      g_object_notify (G_OBJECT (account), "requested-presence-type");
-      g_object_notify (G_OBJECT (account), "requested-status");
-      g_object_notify (G_OBJECT (account), "requested-status-message");
-    }
+  if (!G_VALUE_HOLDS (value, TP_STRUCT_TYPE_SIMPLE_PRESENCE) ||
+      g_value_get_boxed (value) == NULL)
+    return FALSE;
 
-  if (g_hash_table_lookup (properties, "AutomaticPresence") != NULL)
-    {
-      arr = tp_asv_get_boxed (properties, "AutomaticPresence",
-          TP_STRUCT_TYPE_SIMPLE_PRESENCE);
-
-      tp_value_array_unpack (arr, 3,
-          &priv->auto_presence,
-          &status,
-          &message);
-      g_free (priv->auto_status);
-      priv->auto_status = g_strdup (status);
-      g_free (priv->auto_message);
-      priv->auto_message = g_strdup (message);
-
-      g_object_notify (G_OBJECT (account), "automatic-presence-type");
-      g_object_notify (G_OBJECT (account), "automatic-status");
-      g_object_notify (G_OBJECT (account), "automatic-status-message");
-    }
+  tp_value_array_unpack (g_value_get_boxed (value), 3,
+      &new_presence,
+      &new_status,
+      &new_message);
 
-  if (g_hash_table_lookup (properties, "DisplayName") != NULL)
-    {
-      gchar *old = priv->display_name;
+  if (*presence == new_presence &&
+      !tp_strdiff (*status, new_status) &&
+      !tp_strdiff (*message, new_message))
+    return FALSE;
 
-      priv->display_name =
-        g_strdup (tp_asv_get_string (properties, "DisplayName"));
+  *presence = new_presence;
+  g_free (*status);
+  *status = g_strdup (new_status);
+  g_free (*message);
+  *message = g_strdup (new_message);
+  return TRUE;
+}
 
-      if (tp_strdiff (old, priv->display_name))
-        g_object_notify (G_OBJECT (account), "display-name");
+static void
+update_current_presence (TpAccount *self,
+    const GValue *value,
+    glong offset G_GNUC_UNUSED,
+    guint prop_id G_GNUC_UNUSED,
+    AccountUpdate *update)
+{
+  TpAccountPrivate *priv = self->priv;
 
-      g_free (old);
-    }
+  if (update_presence (value, &priv->cur_presence, &priv->cur_status,
+        &priv->cur_message))
+    update->changed |= CURRENT_PRESENCE_PROPS;
+}
 
-  if (g_hash_table_lookup (properties, "Nickname") != NULL)
-    {
-      gchar *old = priv->nickname;
+static void
+update_requested_presence (TpAccount *self,
+    const GValue *value,
+    glong offset G_GNUC_UNUSED,
+    guint prop_id G_GNUC_UNUSED,
+    AccountUpdate *update)
+{
+  TpAccountPrivate *priv = self->priv;
 
-      priv->nickname = g_strdup (tp_asv_get_string (properties, "Nickname"));
+  if (update_presence (value, &priv->requested_presence,
+        &priv->requested_status, &priv->requested_message))
+    update->changed |= REQUESTED_PRESENCE_PROPS;
+}
+
+static void
+update_automatic_presence (TpAccount *self,
+    const GValue *value,
+    glong offset G_GNUC_UNUSED,
+    guint prop_id G_GNUC_UNUSED,
+    AccountUpdate *update)
+{
+  TpAccountPrivate *priv = self->priv;
 
-      if (tp_strdiff (old, priv->nickname))
-        g_object_notify (G_OBJECT (account), "nickname");
+  if (update_presence (value, &priv->auto_presence, &priv->auto_status,
+        &priv->auto_message))
+    update->changed |= AUTOMATIC_PRESENCE_PROPS;
+}
 
-      g_free (old);
+static void
+update_string_field (TpAccount *self,
+    gchar **field,
+    const gchar *new_value,
+    guint prop_id,
+    AccountUpdate *update)
+{
+  if (tp_strdiff (*field, new_value))
+    {
+      g_free (*field);
+      *field = g_strdup (new_value);
+      update->changed |= PROP_BIT (prop_id);
     }
+}
 
-  if (g_hash_table_lookup (properties, "Supersedes") != NULL)
-    {
-      GStrv old = priv->supersedes;
-      GPtrArray *new_arr = tp_asv_get_boxed (properties, "Supersedes",
-          TP_ARRAY_TYPE_OBJECT_PATH_LIST);
-      gboolean changed = FALSE;
-      guint i;
+static void
+update_string (TpAccount *self,
+    const GValue *value,
+    glong offset,
+    guint prop_id,
+    AccountUpdate *update)
+{
+  const gchar *s = NULL;
 
-      if (new_arr == NULL)
-        {
-          priv->supersedes = g_new0 (gchar *, 1);
-        }
-      else
-        {
-          priv->supersedes = g_new0 (gchar *, new_arr->len + 1);
+  if (G_VALUE_HOLDS_STRING (value))
+    s = g_value_get_string (value);
 
-          for (i = 0; i < new_arr->len; i++)
-            priv->supersedes[i] = g_strdup (g_ptr_array_index (new_arr, i));
-        }
+  update_string_field (self, &G_STRUCT_MEMBER (gchar *, self->priv, offset),
+      s, prop_id, update);
+}
 
-      if (new_arr == NULL || new_arr->len == 0)
-        {
-          changed = (old != NULL && *old != NULL);
-        }
-      else if (old == NULL || *old == NULL ||
-          g_strv_length (old) != new_arr->len)
-        {
-          changed = TRUE;
-        }
-      else
-        {
-          for (i = 0; i < new_arr->len; i++)
-            {
-              if (tp_strdiff (old[i], priv->supersedes[i]))
-                {
-                  changed = TRUE;
-                  break;
-                }
-            }
-        }
+static void
+update_icon (TpAccount *self,
+    const GValue *value,
+    glong offset G_GNUC_UNUSED,
+    guint prop_id,
+    AccountUpdate *update)
+{
+  const gchar *icon_name = NULL;
+  gchar *default_icon_name = NULL;
 
-      if (changed)
-        g_object_notify (G_OBJECT (account), "supersedes");
+  if (G_VALUE_HOLDS_STRING (value))
+    icon_name = g_value_get_string (value);
 
-      g_strfreev (old);
+  if (tp_str_empty (icon_name))
+    {
+      default_icon_name = g_strdup_printf ("im-%s", self->priv->proto_name);
+      icon_name = default_icon_name;
     }
 
-  if (g_hash_table_lookup (properties, "NormalizedName") != NULL)
-    {
-      gchar *old = priv->normalized_name;
+  update_string_field (self, &self->priv->icon_name, icon_name, prop_id,
+      update);
+  g_free (default_icon_name);
+}
 
-      priv->normalized_name = g_strdup (tp_asv_get_string (properties,
-            "NormalizedName"));
+static void
+update_service (TpAccount *self,
+    const GValue *value,
+    glong offset G_GNUC_UNUSED,
+    guint prop_id,
+    AccountUpdate *update)
+{
+  const gchar *service = NULL;
 
-      if (tp_strdiff (old, priv->normalized_name))
-        g_object_notify (G_OBJECT (account), "normalized-name");
+  if (G_VALUE_HOLDS_STRING (value))
+    service = g_value_get_string (value);
 
-      g_free (old);
-    }
+  if (tp_str_empty (service))
+    service = self->priv->proto_name;
 
-  if (g_hash_table_lookup (properties, "Icon") != NULL)
-    {
-      const gchar *icon_name;
-      gchar *old = priv->icon_name;
+  update_string_field (self, &self->priv->service, service, prop_id, update);
+}
 
-      icon_name = tp_asv_get_string (properties, "Icon");
+static void
+update_supersedes (TpAccount *self,
+    const GValue *value,
+    glong offset G_GNUC_UNUSED,
+    guint prop_id,
+    AccountUpdate *update)
+{
+  TpAccountPrivate *priv = self->priv;
+  GPtrArray *new_arr = NULL;
+  guint old_len = 0;
+  guint new_len = 0;
+  guint i;
 
-      if (tp_str_empty (icon_name))
-        priv->icon_name = g_strdup_printf ("im-%s", priv->proto_name);
-      else
-        priv->icon_name = g_strdup (icon_name);
+  if (G_VALUE_HOLDS (value, TP_ARRAY_TYPE_OBJECT_PATH_LIST))
+    new_arr = g_value_get_boxed (value);
 
-      if (tp_strdiff (old, priv->icon_name))
-        g_object_notify (G_OBJECT (account), "icon-name");
+  if (priv->supersedes != NULL)
+    old_len = g_strv_length (priv->supersedes);
 
-      g_free (old);
-    }
+  if (new_arr != NULL)
+    new_len = new_arr->len;
 
-  if (g_hash_table_lookup (properties, "Enabled") != NULL)
+  if (old_len == new_len)
     {
-      gboolean enabled = tp_asv_get_boolean (properties, "Enabled", NULL);
-      if (priv->enabled != enabled)
+      for (i = 0; i < new_len; i++)
         {
-          priv->enabled = enabled;
-          g_object_notify (G_OBJECT (account), "enabled");
+          if (tp_strdiff (priv->supersedes[i],
+                g_ptr_array_index (new_arr, i)))
+            break;
         }
+
+      if (i == new_len)
+        return;
     }
 
-  if (g_hash_table_lookup (properties, "Service") != NULL)
-    {
-      const gchar *service;
-      gchar *old = priv->service;
+  g_strfreev (priv->supersedes);
+  priv->supersedes = g_new0 (gchar *, new_len + 1);
 
-      service = tp_asv_get_string (properties, "Service");
+  for (i = 0; i < new_len; i++)
+    priv->supersedes[i] = g_strdup (g_ptr_array_index (new_arr, i));
 
-      if (tp_str_empty (service))
-        priv->service = g_strdup (priv->proto_name);
-      else
-        priv->service = g_strdup (service);
+  update->changed |= PROP_BIT (prop_id);
+}
 
-      if (tp_strdiff (old, priv->service))
-        g_object_notify (G_OBJECT (account), "service");
+static void
+update_boolean (TpAccount *self,
+    const GValue *value,
+    glong offset,
+    guint prop_id,
+    AccountUpdate *update)
+{
+  gboolean *field = &G_STRUCT_MEMBER (gboolean, self->priv, offset);
+  gboolean b = FALSE;
 
-      g_free (old);
-    }
+  if (G_VALUE_HOLDS_BOOLEAN (value))
+    b = g_value_get_boolean (value);
 
-  if (g_hash_table_lookup (properties, "Valid") != NULL)
+  if (*field != b)
     {
-      gboolean old = priv->valid;
+      *field = b;
+      update->changed |= PROP_BIT (prop_id);
+    }
+}
+
+static void
+update_parameters (TpAccount *self,
+    const GValue *value,
+    glong offset G_GNUC_UNUSED,
+    guint prop_id G_GNUC_UNUSED,
+    AccountUpdate *update G_GNUC_UNUSED)
+{
+  GHashTable *parameters = NULL;
 
-      priv->valid = tp_asv_get_boolean (properties, "Valid", NULL);
+  if (G_VALUE_HOLDS (value, TP_HASH_TYPE_STRING_VARIANT_MAP))
+    parameters = g_value_get_boxed (value);
 
-      if (old != priv->valid)
-        g_object_notify (G_OBJECT (account), "valid");
-    }
+  tp_clear_pointer (&self->priv->parameters, g_hash_table_unref);
+  self->priv->parameters = g_boxed_copy (TP_HASH_TYPE_STRING_VARIANT_MAP,
+      parameters);
+  /* this isn't a property, so we don't notify */
+}
 
-  if (g_hash_table_lookup (properties, "Parameters") != NULL)
+static void
+update_connection (TpAccount *self,
+    const GValue *value,
+    glong offset G_GNUC_UNUSED,
+    guint prop_id G_GNUC_UNUSED,
+    AccountUpdate *update)
+{
+  /* _tp_account_set_connection() does its own change notification, after
+   * everything else has been applied */
+  update->have_connection = TRUE;
+
+  if (G_VALUE_HOLDS (value, DBUS_TYPE_G_OBJECT_PATH))
+    update->connection_path = g_value_get_boxed (value);
+}
+
+#define PRIV_OFFSET(field) G_STRUCT_OFFSET (TpAccountPrivate, field)
+
+static const AccountField account_fields[] = {
+      { "Interfaces", update_interfaces, 0, 0 },
+      { "ConnectionStatus", update_connection_status, 0,
+        PROP_CONNECTION_STATUS },
+      { "ConnectionStatusReason", update_connection_status_reason, 0,
+        PROP_CONNECTION_STATUS_REASON },
+      { "ConnectionError", update_connection_error, 0,
+        PROP_CONNECTION_ERROR },
+      { "ConnectionErrorDetails", update_connection_error_details, 0,
+        PROP_CONNECTION_ERROR_DETAILS },
+      { "CurrentPresence", update_current_presence, 0, 0 },
+      { "RequestedPresence", update_requested_presence, 0, 0 },
+      { "AutomaticPresence", update_automatic_presence, 0, 0 },
+      { "DisplayName", update_string, PRIV_OFFSET (display_name),
+        PROP_DISPLAY_NAME },
+      { "Nickname", update_string, PRIV_OFFSET (nickname), PROP_NICKNAME },
+      { "NormalizedName", update_string, PRIV_OFFSET (normalized_name),
+        PROP_NORMALIZED_NAME },
+      { "Supersedes", update_supersedes, 0, PROP_SUPERSEDES },
+      { "Icon", update_icon, 0, PROP_ICON_NAME },
+      { "Service", update_service, 0, PROP_SERVICE },
+      { "Enabled", update_boolean, PRIV_OFFSET (enabled), PROP_ENABLED },
+      { "Valid", update_boolean, PRIV_OFFSET (valid), PROP_VALID },
+      { "ChangingPresence", update_boolean, PRIV_OFFSET (changing_presence),
+        PROP_CHANGING_PRESENCE },
+      { "ConnectAutomatically", update_boolean,
+        PRIV_OFFSET (connect_automatically), PROP_CONNECT_AUTOMATICALLY },
+      { "HasBeenOnline", update_boolean, PRIV_OFFSET (has_been_online),
+        PROP_HAS_BEEN_ONLINE },
+      { "Parameters", update_parameters, 0, 0 },
+      { "Connection", update_connection, 0, 0 },
+      { NULL }
+};
+
+#undef PRIV_OFFSET
+
+/* name => borrowed AccountField */
+static GHashTable *
+account_fields_get_index (void)
+{
+  static gsize once = 0;
+  static GHashTable *by_name = NULL;
+
+  if (g_once_init_enter (&once))
     {
-      GHashTable *parameters;
+      const AccountField *field;
 
-      parameters = tp_asv_get_boxed (properties, "Parameters",
-          TP_HASH_TYPE_STRING_VARIANT_MAP);
+      by_name = g_hash_table_new (g_str_hash, g_str_equal);
 
-      if (priv->parameters != NULL)
-        g_hash_table_unref (priv->parameters);
+      for (field = account_fields; field->name != NULL; field++)
+        g_hash_table_insert (by_name, (gchar *) field->name, (gpointer) field);
 
-      priv->parameters = g_boxed_copy (TP_HASH_TYPE_STRING_VARIANT_MAP,
-          parameters);
-      /* this isn't a property, so we don't notify */
+      g_once_init_leave (&once, 1);
     }
 
-  if (status_changed)
+  return by_name;
+}
+
+static void
+account_emit_pending (TpAccount *self)
+{
+  TpAccountPrivate *priv = self->priv;
+  guint64 pending = priv->pending_notify;
+  guint i;
+
+  if (priv->coalesce_timer != NULL)
     {
-      g_signal_emit (account, signals[STATUS_CHANGED], 0,
-          old_s, priv->connection_status, priv->reason, priv->error,
-          priv->error_details);
-
-      g_object_notify (G_OBJECT (account), "connection-status");
-      g_object_notify (G_OBJECT (account), "connection-status-reason");
-      g_object_notify (G_OBJECT (account), "connection-error");
-      g_object_notify (G_OBJECT (account), "connection-error-details");
+      _tp_timer_cancel (priv->coalesce_timer);
+      priv->coalesce_timer = NULL;
     }
 
-  if (presence_changed)
+  if (pending == 0)
+    return;
+
+  priv->pending_notify = 0;
+
+  /* a signal handler might drop the last ref */
+  g_object_ref (self);
+
+  if ((pending & STATUS_PROPS) != 0)
     {
-      g_signal_emit (account, signals[PRESENCE_CHANGED], 0,
-          priv->cur_presence, priv->cur_status, priv->cur_message);
-      g_object_notify (G_OBJECT (account), "current-presence-type");
-      g_object_notify (G_OBJECT (account), "current-status");
-      g_object_notify (G_OBJECT (account), "current-status-message");
+      g_signal_emit (self, signals[STATUS_CHANGED], 0,
+          priv->pending_old_status, priv->connection_status, priv->reason,
+          priv->error, priv->error_details);
+      pending |= STATUS_PROPS;
     }
 
-  if (g_hash_table_lookup (properties, "Connection") != NULL)
-    {
-      const gchar *path = tp_asv_get_object_path (properties, "Connection");
+  if ((pending & CURRENT_PRESENCE_PROPS) != 0)
+    g_signal_emit (self, signals[PRESENCE_CHANGED], 0,
+        priv->cur_presence, priv->cur_status, priv->cur_message);
 
-      _tp_account_set_connection (account, path);
+  for (i = 1; i < N_PROPS; i++)
+    {
+      if ((pending & PROP_BIT (i)) != 0)
+        g_object_notify_by_pspec ((GObject *) self, account_props[i]);
     }
 
-  if (g_hash_table_lookup (properties, "ChangingPresence") != NULL)
-    {
-      gboolean old = priv->changing_presence;
+  g_object_unref (self);
+}
 
-      priv->changing_presence =
-        tp_asv_get_boolean (properties, "ChangingPresence", NULL);
+static void
+account_coalesce_timer_cb (gpointer user_data)
+{
+  TpAccount *self = user_data;
 
-      if (old != priv->changing_presence)
-        g_object_notify (G_OBJECT (account), "changing-presence");
-    }
+  self->priv->coalesce_timer = NULL;
+  account_emit_pending (self);
+}
 
-  if (g_hash_table_lookup (properties, "ConnectAutomatically") != NULL)
-    {
-      gboolean old = priv->connect_automatically;
+static void
+_tp_account_update (TpAccount *account,
+    GHashTable *properties)
+{
+  TpProxy *proxy = TP_PROXY (account);
+  TpAccountPrivate *priv = account->priv;
+  GHashTable *fields = account_fields_get_index ();
+  TpConnectionStatus old_s = priv->connection_status;
+  AccountUpdate update = { 0, FALSE, NULL };
+  GHashTableIter iter;
+  gpointer k, v;
 
-      priv->connect_automatically =
-        tp_asv_get_boolean (properties, "ConnectAutomatically", NULL);
+  g_hash_table_iter_init (&iter, properties);
 
-      if (old != priv->connect_automatically)
-        g_object_notify (G_OBJECT (account), "connect-automatically");
+  while (g_hash_table_iter_next (&iter, &k, &v))
+    {
+      const AccountField *field = g_hash_table_lookup (fields, k);
+
+      if (field != NULL)
+        field->func (account, v, field->offset, field->prop_id, &update);
     }
 
-  if (g_hash_table_lookup (properties, "HasBeenOnline") != NULL)
+  if ((update.changed & STATUS_PROPS) != 0)
     {
-      gboolean old = priv->has_been_online;
+      if (priv->connection_status == TP_CONNECTION_STATUS_CONNECTED)
+        {
+          /* our connection status is CONNECTED - clear any error we may
+           * have recorded previously */
+          g_hash_table_remove_all (priv->error_details);
+          tp_clear_pointer (&priv->error, g_free);
+        }
+      else if (priv->error == NULL)
+        {
+          /* our connection status is worse than CONNECTED but the
+           * AccountManager didn't tell us why, so attempt to guess
+           * a detailed error from the status reason */
+          const gchar *guessed = NULL;
+
+          _tp_connection_status_reason_to_gerror (priv->reason,
+              old_s, &guessed, NULL);
+
+          if (guessed == NULL)
+            guessed = TP_ERROR_STR_DISCONNECTED;
 
-      priv->has_been_online =
-        tp_asv_get_boolean (properties, "HasBeenOnline", NULL);
+          priv->error = g_strdup (guessed);
+        }
 
-      if (old != priv->has_been_online)
-        g_object_notify (G_OBJECT (account), "has-been-online");
+      /* status-changed reports the status before the first of the
+       * changes that are being coalesced */
+      if ((priv->pending_notify & STATUS_PROPS) == 0)
+        priv->pending_old_status = old_s;
     }
 
+  priv->pending_notify |= update.changed;
+
+  /* The initial GetAll is never delayed */
+  if (priv->coalesce_ms == 0 ||
+      !tp_proxy_is_prepared (account, TP_ACCOUNT_FEATURE_CORE))
+    account_emit_pending (account);
+  else if (priv->pending_notify != 0 && priv->coalesce_timer == NULL)
+    priv->coalesce_timer = _tp_timer_add (priv->coalesce_ms,
+        priv->coalesce_ms, account_coalesce_timer_cb, account);
+
+  if (update.have_connection)
+    _tp_account_set_connection (account, update.connection_path);
+
   _tp_proxy_set_feature_prepared (proxy, TP_ACCOUNT_FEATURE_CORE, TRUE);
 }
 
@@ -1259,6 +1483,10 @@ _tp_account_dispose (GObject *object)
 
   priv->dispose_has_run = TRUE;
 
+  /* nobody can be listening for coalesced changes any more */
+  tp_clear_pointer (&priv->coalesce_timer, _tp_timer_cancel);
+  priv->pending_notify = 0;
+
   _tp_account_set_connection (self, "/");
 
   /* release any references held by the object here */
@@ -1309,6 +1537,8 @@ tp_account_class_init (TpAccountClass *klass)
 {
   TpProxyClass *proxy_class = (TpProxyClass *) klass;
   GObjectClass *object_class = (GObjectClass *) klass;
+  GParamSpec **pspecs;
+  guint n_pspecs, i;
 
   g_type_class_add_private (klass, sizeof (TpAccountPrivate));
 
@@ -2183,6 +2413,16 @@ tp_account_class_init (TpAccountClass *klass)
   proxy_class->interface = TP_IFACE_QUARK_ACCOUNT;
   proxy_class->list_features = _tp_account_list_features;
   tp_account_init_known_interfaces ();
+
+  pspecs = g_object_class_list_properties (object_class, &n_pspecs);
+
+  for (i = 0; i < n_pspecs; i++)
+    {
+      if (pspecs[i]->owner_type == G_OBJECT_CLASS_TYPE (klass))
+        account_props[pspecs[i]->param_id] = pspecs[i];
+    }
+
+  g_free (pspecs);
 }
 
 /**
@@ -3283,6 +3523,59 @@ tp_account_get_changing_presence (TpAccount *self)
   return self->priv->changing_presence;
 }
 
+/**
+ * tp_account_set_change_coalescing:
+ * @self: an account
+ * @interval_ms: how long to wait before emitting change notification, in
+ *  milliseconds, or 0 to emit it as soon as each change is received
+ *
+ * Coalesce change notification for @self's properties. If @interval_ms is
+ * non-zero, changes received from the account manager are applied
+ * immediately, but #TpAccount::status-changed,
+ * #TpAccount::presence-changed and #GObject::notify are only emitted once,
+ * between @interval_ms and twice that time after the first change,
+ * for all the changes received in the meantime. Change notifications for
+ * several accounts with the same @interval_ms are emitted together.
+ *
+ * This is intended for account managers with many accounts that might
+ * all change their status at once, such as when the network connection
+ * comes back. #TpAccount:connection is never delayed.
+ *
+ * Setting @interval_ms to 0, which is the default, emits any pending
+ * change notification immediately.
+ *
+ * Since: 0.UNRELEASED
+ */
+void
+tp_account_set_change_coalescing (TpAccount *self,
+    guint interval_ms)
+{
+  g_return_if_fail (TP_IS_ACCOUNT (self));
+
+  self->priv->coalesce_ms = interval_ms;
+
+  if (interval_ms == 0)
+    account_emit_pending (self);
+}
+
+/**
+ * tp_account_get_change_coalescing:
+ * @self: an account
+ *
+ * <!-- -->
+ *
+ * Returns: the interval set by tp_account_set_change_coalescing(), or 0
+ *
+ * Since: 0.UNRELEASED
+ */
+guint
+tp_account_get_change_coalescing (TpAccount *self)
+{
+  g_return_val_if_fail (TP_IS_ACCOUNT (self), 0);
+
+  return self->priv->coalesce_ms;
+}
+
 /**
  * tp_account_get_connect_automatically:
  * @account: a #TpAccount
@@ -281,6 +281,12 @@ gboolean tp_account_set_avatar_finish (TpAccount *self,
 
 gboolean tp_account_get_changing_presence (TpAccount *self);
 
+_TP_AVAILABLE_IN_UNRELEASED
+void tp_account_set_change_coalescing (TpAccount *self,
+    guint interval_ms);
+_TP_AVAILABLE_IN_UNRELEASED
+guint tp_account_get_change_coalescing (TpAccount *self);
+
 const gchar *tp_account_get_storage_provider (TpAccount *self);
 const GValue *tp_account_get_storage_identifier (TpAccount *self);
 GVariant *tp_account_dup_storage_identifier_variant (TpAccount *self);
@@ -55,6 +55,7 @@
 
 #define DEBUG_FLAG TP_DEBUG_CLIENT
 #include "telepathy-glib/debug-internal.h"
+#include "telepathy-glib/proxy-internal.h"
 #include "telepathy-glib/util-internal.h"
 
 struct _TpAddDispatchOperationContextClass {
@@ -564,14 +565,14 @@ context_prepare (TpAddDispatchOperationContext *self,
 
   self->priv->num_pending = 3;
 
-  tp_proxy_prepare_async (self->account, account_features,
+  _tp_proxy_prepare_shared_async (self->account, account_features,
       account_prepare_cb, g_object_ref (self));
 
-  tp_proxy_prepare_async (self->connection, connection_features,
+  _tp_proxy_prepare_shared_async (self->connection, connection_features,
       conn_prepare_cb, g_object_ref (self));
 
-  tp_proxy_prepare_async (self->dispatch_operation, cdo_features,
-      cdo_prepare_cb, g_object_ref (self));
+  _tp_proxy_prepare_shared_async (self->dispatch_operation,
+      cdo_features, cdo_prepare_cb, g_object_ref (self));
 
   for (i = 0; i < self->channels->len; i++)
     {
@@ -579,7 +580,7 @@ context_prepare (TpAddDispatchOperationContext *self,
 
       self->priv->num_pending++;
 
-      tp_proxy_prepare_async (channel, channel_features,
+      _tp_proxy_prepare_shared_async (channel, channel_features,
           adoc_channel_prepare_cb, g_object_ref (self));
     }
 }
@@ -112,6 +112,17 @@ GHashTable *_tp_call_content_media_description_dup_properties (
 void _tp_call_stream_endpoint_set_stream (TpCallStreamEndpoint *self,
     TpBaseMediaCallStream *stream);
 
+typedef struct _TpCallCandidateList TpCallCandidateList;
+
+TpCallCandidateList *_tp_call_candidate_list_new (void);
+void _tp_call_candidate_list_free (TpCallCandidateList *self);
+GPtrArray *_tp_call_candidate_list_get_candidates (TpCallCandidateList *self);
+GPtrArray *_tp_call_candidate_list_add (TpCallCandidateList *self,
+    const GPtrArray *candidates);
+GValueArray *_tp_call_candidate_list_take (TpCallCandidateList *self,
+    GValueArray *candidate);
+void _tp_call_candidate_list_clear (TpCallCandidateList *self);
+
 /* Implemented in dtmf.c */
 
 typedef enum
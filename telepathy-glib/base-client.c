@@ -187,6 +187,7 @@
 #include <telepathy-glib/add-dispatch-operation-context-internal.h>
 #include <telepathy-glib/automatic-proxy-factory.h>
 #include <telepathy-glib/channel-dispatch-operation-internal.h>
+#include <telepathy-glib/channel-filter-index-internal.h>
 #include <telepathy-glib/channel-dispatcher.h>
 #include <telepathy-glib/channel-request.h>
 #include <telepathy-glib/channel.h>
@@ -203,6 +204,7 @@
 #include "telepathy-glib/connection-internal.h"
 #include "telepathy-glib/debug-internal.h"
 #include "telepathy-glib/deprecated-internal.h"
+#include "telepathy-glib/proxy-internal.h"
 #include "telepathy-glib/simple-client-factory-internal.h"
 #include "telepathy-glib/util-internal.h"
 #include "telepathy-glib/variant-util-internal.h"
@@ -235,6 +237,8 @@ enum {
 enum {
   SIGNAL_REQUEST_ADDED,
   SIGNAL_REQUEST_REMOVED,
+  SIGNAL_HANDLED_CHANNEL_ADDED,
+  SIGNAL_HANDLED_CHANNEL_REMOVED,
   N_SIGNALS
 };
 
@@ -242,6 +246,26 @@ static guint signals[N_SIGNALS] = { 0 };
 
 static dbus_int32_t clients_slot = -1;
 
+/* Attached to a DBusConnection: the channels handled by any of the
+ * registered Handlers sharing that connection, and hence that unique name,
+ * which is what HandledChannels is meant to contain. It is updated
+ * whenever a Handler's own set of channels changes, so reading it doesn't
+ * need to merge every Handler's set. */
+typedef struct {
+    /* borrowed client object path => borrowed TpBaseClient, for each
+     * registered Handler */
+    GHashTable *clients;
+    /* owned channel object path => owned HandledChannel */
+    GHashTable *channels;
+} HandlerRegistry;
+
+typedef struct {
+    /* reffed; the proxy most recently given to any Handler */
+    TpChannel *channel;
+    /* number of registered Handlers handling this channel */
+    guint refcount;
+} HandledChannel;
+
 typedef enum {
     CLIENT_IS_OBSERVER = 1 << 0,
     CLIENT_IS_APPROVER = 1 << 1,
@@ -269,6 +293,10 @@ struct _TpBaseClientPrivate
   GPtrArray *approver_filters;
   /* array of TP_HASH_TYPE_CHANNEL_CLASS */
   GPtrArray *handler_filters;
+  /* the same filters, compiled for local matching */
+  TpChannelFilterIndex *observer_index;
+  TpChannelFilterIndex *approver_index;
+  TpChannelFilterIndex *handler_index;
   /* array of g_strdup(token), plus NULL included in length */
   GPtrArray *handler_caps;
 
@@ -276,6 +304,8 @@ struct _TpBaseClientPrivate
   /* Channels actually handled by THIS observer.
    * borrowed path (gchar *) => reffed TpChannel */
   GHashTable *my_chans;
+  /* borrowed from libdbus; non-NULL while registered as a Handler */
+  HandlerRegistry *registry;
 
   gchar *bus_name;
   gchar *object_path;
@@ -294,6 +324,146 @@ struct _TpBaseClientPrivate
   GDestroyNotify delegated_channels_destroy;
 };
 
+static void
+handled_channel_free (gpointer p)
+{
+  HandledChannel *hc = p;
+
+  g_object_unref (hc->channel);
+  g_slice_free (HandledChannel, hc);
+}
+
+static HandlerRegistry *
+handler_registry_new (void)
+{
+  HandlerRegistry *registry = g_slice_new0 (HandlerRegistry);
+
+  registry->clients = g_hash_table_new (g_str_hash, g_str_equal);
+  registry->channels = g_hash_table_new_full (g_str_hash, g_str_equal,
+      g_free, handled_channel_free);
+  return registry;
+}
+
+static void
+handler_registry_free (gpointer p)
+{
+  HandlerRegistry *registry = p;
+
+  g_hash_table_unref (registry->clients);
+  g_hash_table_unref (registry->channels);
+  g_slice_free (HandlerRegistry, registry);
+}
+
+static void
+handler_registry_emit (HandlerRegistry *registry,
+    guint signal_id,
+    TpChannel *channel)
+{
+  GList *clients, *l;
+
+  /* the handlers might unregister or go away in response */
+  clients = g_hash_table_get_values (registry->clients);
+  g_list_foreach (clients, (GFunc) g_object_ref, NULL);
+  g_object_ref (channel);
+
+  for (l = clients; l != NULL; l = l->next)
+    g_signal_emit (l->data, signals[signal_id], 0, channel);
+
+  g_object_unref (channel);
+  g_list_free_full (clients, g_object_unref);
+}
+
+static void
+handler_registry_ref_channel (HandlerRegistry *registry,
+    TpChannel *channel)
+{
+  const gchar *path = tp_proxy_get_object_path (channel);
+  HandledChannel *hc = g_hash_table_lookup (registry->channels, path);
+
+  if (hc != NULL)
+    {
+      hc->refcount++;
+      g_object_ref (channel);
+      g_object_unref (hc->channel);
+      hc->channel = channel;
+      return;
+    }
+
+  hc = g_slice_new0 (HandledChannel);
+  hc->channel = g_object_ref (channel);
+  hc->refcount = 1;
+  g_hash_table_insert (registry->channels, g_strdup (path), hc);
+
+  handler_registry_emit (registry, SIGNAL_HANDLED_CHANNEL_ADDED, channel);
+}
+
+static void
+handler_registry_unref_channel (HandlerRegistry *registry,
+    TpChannel *channel)
+{
+  const gchar *path = tp_proxy_get_object_path (channel);
+  HandledChannel *hc = g_hash_table_lookup (registry->channels, path);
+
+  g_return_if_fail (hc != NULL);
+
+  if (--hc->refcount > 0)
+    return;
+
+  g_object_ref (channel);
+  g_hash_table_remove (registry->channels, path);
+  handler_registry_emit (registry, SIGNAL_HANDLED_CHANNEL_REMOVED, channel);
+  g_object_unref (channel);
+}
+
+static void
+my_chans_add (TpBaseClient *self,
+    TpChannel *channel)
+{
+  const gchar *path = tp_proxy_get_object_path (channel);
+  gboolean new_path = !g_hash_table_contains (self->priv->my_chans, path);
+
+  g_hash_table_replace (self->priv->my_chans, (gchar *) path,
+      g_object_ref (channel));
+
+  if (self->priv->registry == NULL)
+    return;
+
+  if (new_path)
+    {
+      handler_registry_ref_channel (self->priv->registry, channel);
+    }
+  else
+    {
+      /* we already counted this channel; just make sure the registry has
+       * the newest proxy for it, as it would have done before */
+      HandledChannel *hc = g_hash_table_lookup (self->priv->registry->channels,
+          path);
+
+      g_object_ref (channel);
+      g_object_unref (hc->channel);
+      hc->channel = channel;
+    }
+}
+
+static void
+my_chans_remove (TpBaseClient *self,
+    const gchar *path)
+{
+  TpChannel *channel = g_hash_table_lookup (self->priv->my_chans, path);
+
+  if (channel == NULL)
+    return;
+
+  /* @path probably belongs to @channel */
+  g_object_ref (channel);
+  g_hash_table_remove (self->priv->my_chans, path);
+
+  if (self->priv->registry != NULL)
+    handler_registry_unref_channel (self->priv->registry, channel);
+
+  g_object_unref (channel);
+}
+
 /*
  * _tp_base_client_set_only_for_account:
  *
@@ -406,6 +576,7 @@ tp_base_client_take_observer_filter (TpBaseClient *self,
   g_return_if_fail (cls->observe_channels != NULL);
 
   self->priv->flags |= CLIENT_IS_OBSERVER;
+  _tp_channel_filter_index_add (self->priv->observer_index, filter);
   g_ptr_array_add (self->priv->observer_filters, filter);
 }
 
@@ -589,6 +760,7 @@ tp_base_client_take_approver_filter (TpBaseClient *self,
   g_return_if_fail (cls->add_dispatch_operation != NULL);
 
   self->priv->flags |= CLIENT_IS_APPROVER;
+  _tp_channel_filter_index_add (self->priv->approver_index, filter);
   g_ptr_array_add (self->priv->approver_filters, filter);
 }
 
@@ -706,6 +878,7 @@ tp_base_client_take_handler_filter (TpBaseClient *self,
   g_return_if_fail (cls->handle_channels != NULL);
 
   self->priv->flags |= CLIENT_IS_HANDLER;
+  _tp_channel_filter_index_add (self->priv->handler_index, filter);
   g_ptr_array_add (self->priv->handler_filters, filter);
 }
 
@@ -919,6 +1092,105 @@ tp_base_client_add_handler_capabilities_varargs (TpBaseClient *self,
   va_end (ap);
 }
 
+static gboolean
+filter_index_matches (TpChannelFilterIndex *index,
+    GVariant *properties)
+{
+  GHashTable *asv;
+  gboolean ret;
+
+  g_variant_ref_sink (properties);
+  asv = _tp_asv_from_vardict (properties);
+  ret = _tp_channel_filter_index_matches (index, asv);
+  g_hash_table_unref (asv);
+  g_variant_unref (properties);
+  return ret;
+}
+
+/**
+ * tp_base_client_observer_filters_match:
+ * @self: a #TpBaseClient
+ * @properties: (transfer none): a variant of type %G_VARIANT_TYPE_VARDICT
+ *  containing a channel's immutable properties
+ *
+ * Check whether a channel with the given immutable properties matches any
+ * of the filters added with tp_base_client_add_observer_filter() and
+ * similar functions, in the sense used by the channel dispatcher: every
+ * property in the filter must be present in @properties, with the same
+ * value. Integer properties compare equal if their numeric values are
+ * equal, whatever their D-Bus types.
+ *
+ * The filters are grouped by channel type and target handle type when they
+ * are added, so only the filters for the channel's types are examined, one
+ * after the other. This is intended for code that routes channels between
+ * clients in the same process, such as test harnesses.
+ *
+ * If the variant is floating (see g_variant_ref_sink()), ownership
+ * will be taken.
+ *
+ * Returns: %TRUE if @self would observe a channel with @properties
+ * Since: 0.UNRELEASED
+ */
+gboolean
+tp_base_client_observer_filters_match (TpBaseClient *self,
+    GVariant *properties)
+{
+  g_return_val_if_fail (TP_IS_BASE_CLIENT (self), FALSE);
+  g_return_val_if_fail (g_variant_is_of_type (properties,
+        G_VARIANT_TYPE_VARDICT), FALSE);
+
+  return filter_index_matches (self->priv->observer_index, properties);
+}
+
+/**
+ * tp_base_client_approver_filters_match:
+ * @self: a #TpBaseClient
+ * @properties: (transfer none): a variant of type %G_VARIANT_TYPE_VARDICT
+ *  containing a channel's immutable properties
+ *
+ * The same as tp_base_client_observer_filters_match(), but for the
+ * filters added with tp_base_client_add_approver_filter() and similar
+ * functions.
+ *
+ * Returns: %TRUE if @self would be asked to approve a channel with
+ *  @properties
+ * Since: 0.UNRELEASED
+ */
+gboolean
+tp_base_client_approver_filters_match (TpBaseClient *self,
+    GVariant *properties)
+{
+  g_return_val_if_fail (TP_IS_BASE_CLIENT (self), FALSE);
+  g_return_val_if_fail (g_variant_is_of_type (properties,
+        G_VARIANT_TYPE_VARDICT), FALSE);
+
+  return filter_index_matches (self->priv->approver_index, properties);
+}
+
+/**
+ * tp_base_client_handler_filters_match:
+ * @self: a #TpBaseClient
+ * @properties: (transfer none): a variant of type %G_VARIANT_TYPE_VARDICT
+ *  containing a channel's immutable properties
+ *
+ * The same as tp_base_client_observer_filters_match(), but for the
+ * filters added with tp_base_client_add_handler_filter() and similar
+ * functions.
+ *
+ * Returns: %TRUE if @self could handle a channel with @properties
+ * Since: 0.UNRELEASED
+ */
+gboolean
+tp_base_client_handler_filters_match (TpBaseClient *self,
+    GVariant *properties)
+{
+  g_return_val_if_fail (TP_IS_BASE_CLIENT (self), FALSE);
+  g_return_val_if_fail (g_variant_is_of_type (properties,
+        G_VARIANT_TYPE_VARDICT), FALSE);
+
+  return filter_index_matches (self->priv->handler_index, properties);
+}
+
 /**
  * tp_base_client_register:
  * @self: a #TpBaseClient, which must not have been registered with
@@ -940,7 +1212,9 @@ gboolean
 tp_base_client_register (TpBaseClient *self,
     GError **error)
 {
-  GHashTable *clients;
+  HandlerRegistry *registry;
+  GHashTableIter iter;
+  gpointer v;
 
   g_return_val_if_fail (TP_IS_BASE_CLIENT (self), FALSE);
   g_return_val_if_fail (!self->priv->registered, FALSE);
@@ -974,21 +1248,23 @@ tp_base_client_register (TpBaseClient *self,
   if (!dbus_connection_allocate_data_slot (&clients_slot))
     ERROR ("Out of memory");
 
-  clients = dbus_connection_get_data (self->priv->libdbus, clients_slot);
+  registry = dbus_connection_get_data (self->priv->libdbus, clients_slot);
 
-  if (clients == NULL)
+  if (registry == NULL)
     {
-      /* Map DBusConnection to the self->priv->my_chans hash table owned by
-       * the client using this DBusConnection.
+      registry = handler_registry_new ();
+      dbus_connection_set_data (self->priv->libdbus, clients_slot, registry,
+          handler_registry_free);
+    }
 
-       * borrowed client path => borrowed (GHashTable *) */
-      clients = g_hash_table_new (g_str_hash, g_str_equal);
+  g_hash_table_insert (registry->clients, self->priv->object_path, self);
+  self->priv->registry = registry;
 
-      dbus_connection_set_data (self->priv->libdbus, clients_slot, clients,
-          (DBusFreeFunction) g_hash_table_unref);
-    }
+  /* we might already have been told about some channels */
+  g_hash_table_iter_init (&iter, self->priv->my_chans);
 
-  g_hash_table_insert (clients, self->priv->object_path, self->priv->my_chans);
+  while (g_hash_table_iter_next (&iter, NULL, &v))
+    handler_registry_ref_channel (registry, v);
 
   return TRUE;
 }
@@ -1034,31 +1310,23 @@ GList *
 tp_base_client_get_handled_channels (TpBaseClient *self)
 {
   GList *result = NULL;
-  GHashTable *clients;
   GHashTableIter iter;
   gpointer value;
-  GHashTable *set;
 
   g_return_val_if_fail (self->priv->flags & CLIENT_IS_HANDLER, NULL);
 
-  if (clients_slot == -1)
-    return NULL;
-
-  set = g_hash_table_new (g_str_hash, g_str_equal);
+  if (self->priv->registry == NULL)
+    return g_hash_table_get_values (self->priv->my_chans);
 
-  clients = dbus_connection_get_data (self->priv->libdbus, clients_slot);
+  g_hash_table_iter_init (&iter, self->priv->registry->channels);
 
-  g_hash_table_iter_init (&iter, clients);
   while (g_hash_table_iter_next (&iter, NULL, &value))
     {
-      GHashTable *chans = value;
+      HandledChannel *hc = value;
 
-      tp_g_hash_table_update (set, chans, NULL, NULL);
+      result = g_list_prepend (result, hc->channel);
     }
 
-  result = g_hash_table_get_values (set);
-  g_hash_table_unref (set);
-
   return result;
 }
 
@@ -1122,6 +1390,9 @@ tp_base_client_init (TpBaseClient *self)
       (GDestroyNotify) g_hash_table_unref);
   self->priv->handler_filters = g_ptr_array_new_with_free_func (
       (GDestroyNotify) g_hash_table_unref);
+  self->priv->observer_index = _tp_channel_filter_index_new ();
+  self->priv->approver_index = _tp_channel_filter_index_new ();
+  self->priv->handler_index = _tp_channel_filter_index_new ();
   self->priv->handler_caps = g_ptr_array_new_with_free_func (g_free);
   g_ptr_array_add (self->priv->handler_caps, NULL);
 
@@ -1181,6 +1452,9 @@ tp_base_client_finalize (GObject *object)
   g_ptr_array_unref (self->priv->observer_filters);
   g_ptr_array_unref (self->priv->approver_filters);
   g_ptr_array_unref (self->priv->handler_filters);
+  _tp_channel_filter_index_free (self->priv->observer_index);
+  _tp_channel_filter_index_free (self->priv->approver_index);
+  _tp_channel_filter_index_free (self->priv->handler_index);
   g_ptr_array_unref (self->priv->handler_caps);
 
   g_free (self->priv->bus_name);
@@ -1428,16 +1702,18 @@ tp_base_client_get_dbus_properties (GObject *object,
 
     case DP_HANDLED_CHANNELS:
         {
-          GList *channels = tp_base_client_dup_handled_channels (self);
-          GList *iter;
-          GPtrArray *arr = g_ptr_array_sized_new (g_list_length (channels));
+          GHashTable *chans = (self->priv->registry != NULL ?
+              self->priv->registry->channels : self->priv->my_chans);
+          GPtrArray *arr = g_ptr_array_sized_new (g_hash_table_size (chans));
+          GHashTableIter iter;
+          gpointer k;
+
+          g_hash_table_iter_init (&iter, chans);
 
-          for (iter = channels; iter != NULL; iter = iter->next)
-            g_ptr_array_add (arr,
-                g_strdup (tp_proxy_get_object_path (iter->data)));
+          while (g_hash_table_iter_next (&iter, &k, NULL))
+            g_ptr_array_add (arr, g_strdup (k));
 
           g_value_take_boxed (value, arr);
-          g_list_free_full (channels, g_object_unref);
         }
       break;
 
@@ -1687,6 +1963,50 @@ tp_base_client_class_init (TpBaseClientClass *cls)
       G_TYPE_NONE, 3,
       TP_TYPE_CHANNEL_REQUEST, G_TYPE_STRING, G_TYPE_STRING);
 
+  /**
+   * TpBaseClient::handled-channel-added:
+   * @self: a #TpBaseClient
+   * @channel: the #TpChannel which is now being handled
+   *
+   * Emitted when @channel is added to the set of channels returned by
+   * tp_base_client_dup_handled_channels(); that is, when @self or another
+   * registered #TpBaseClient sharing its unique name starts handling a
+   * channel that none of them was already handling.
+   *
+   * This signal is only emitted while @self is registered as a Handler.
+   *
+   * Since: 0.UNRELEASED
+   */
+  signals[SIGNAL_HANDLED_CHANNEL_ADDED] = g_signal_new (
+      "handled-channel-added", G_OBJECT_CLASS_TYPE (cls),
+      G_SIGNAL_RUN_LAST,
+      0,
+      NULL, NULL, NULL,
+      G_TYPE_NONE, 1,
+      TP_TYPE_CHANNEL);
+
+  /**
+   * TpBaseClient::handled-channel-removed:
+   * @self: a #TpBaseClient
+   * @channel: the #TpChannel which is no longer being handled
+   *
+   * Emitted when @channel is removed from the set of channels returned by
+   * tp_base_client_dup_handled_channels(), for instance because it was
+   * closed or delegated, or because the last registered #TpBaseClient
+   * handling it was unregistered.
+   *
+   * This signal is only emitted while @self is registered as a Handler.
+   *
+   * Since: 0.UNRELEASED
+   */
+  signals[SIGNAL_HANDLED_CHANNEL_REMOVED] = g_signal_new (
+      "handled-channel-removed", G_OBJECT_CLASS_TYPE (cls),
+      G_SIGNAL_RUN_LAST,
+      0,
+      NULL, NULL, NULL,
+      G_TYPE_NONE, 1,
+      TP_TYPE_CHANNEL);
+
   cls->dbus_properties_class.interfaces = prop_ifaces;
   tp_dbus_properties_mixin_class_init (object_class,
       G_STRUCT_OFFSET (TpBaseClientClass, dbus_properties_class));
@@ -2211,10 +2531,7 @@ chan_invalidated_cb (TpChannel *channel,
       channel, tp_proxy_get_object_path (channel), message);
 
   if (!(domain == TP_DBUS_ERRORS && code == TP_DBUS_ERROR_PROXY_UNREFERENCED))
-    {
-      g_hash_table_remove (self->priv->my_chans, tp_proxy_get_object_path (
-          channel));
-    }
+    my_chans_remove (self, tp_proxy_get_object_path (channel));
 }
 
 static void
@@ -2231,9 +2548,7 @@ add_handled_channels (TpBaseClient *self,
         {
           DEBUG ("Inserting Channel (%p) %s",
             channel, tp_proxy_get_object_path (channel));
-          g_hash_table_replace (self->priv->my_chans,
-              (gchar *) tp_proxy_get_object_path (channel),
-              g_object_ref (channel));
+          my_chans_add (self, channel);
 
           tp_g_signal_connect_object (channel, "invalidated",
               G_CALLBACK (chan_invalidated_cb), self, 0);
@@ -2639,7 +2954,7 @@ _tp_base_client_add_request (TpSvcClientInterfaceRequests *iface,
 
   account_features = dup_features_for_account (self, account);
 
-  tp_proxy_prepare_async (account,
+  _tp_proxy_prepare_shared_async (account,
       (GQuark *) account_features->data,
       channel_request_account_prepare_cb, ctx);
 
@@ -2919,11 +3234,19 @@ tp_base_client_unregister (TpBaseClient *self)
 
   if (self->priv->flags & CLIENT_IS_HANDLER)
     {
-      GHashTable *clients;
+      HandlerRegistry *registry = self->priv->registry;
+      GHashTableIter iter;
+      gpointer v;
+
+      /* our channels are no longer handled by us, so other Handlers on
+       * this connection might need to be told */
+      g_hash_table_remove (registry->clients, self->priv->object_path);
+      self->priv->registry = NULL;
+
+      g_hash_table_iter_init (&iter, self->priv->my_chans);
 
-      clients = dbus_connection_get_data (self->priv->libdbus, clients_slot);
-      if (clients != NULL)
-        g_hash_table_remove (clients, self->priv->object_path);
+      while (g_hash_table_iter_next (&iter, NULL, &v))
+        handler_registry_unref_channel (registry, v);
 
       dbus_connection_unref (self->priv->libdbus);
       self->priv->libdbus = NULL;
@@ -3169,24 +3492,17 @@ gboolean
 tp_base_client_is_handling_channel (TpBaseClient *self,
     TpChannel *channel)
 {
-  GList *channels, *l;
-  gboolean found = FALSE;
+  GHashTable *chans;
 
   g_return_val_if_fail (TP_IS_BASE_CLIENT (self), FALSE);
   g_return_val_if_fail (self->priv->flags & CLIENT_IS_HANDLER, FALSE);
 
-  channels = tp_base_client_dup_handled_channels (self);
-  for (l = channels; l != NULL && !found; l = g_list_next (l))
-    {
-      TpChannel *chan = l->data;
-
-      if (!tp_strdiff (tp_proxy_get_object_path (channel),
-            tp_proxy_get_object_path (chan)))
-        found = TRUE;
-    }
+  if (self->priv->registry != NULL)
+    chans = self->priv->registry->channels;
+  else
+    chans = self->priv->my_chans;
 
-  g_list_free_full (channels, g_object_unref);
-  return found;
+  return g_hash_table_contains (chans, tp_proxy_get_object_path (channel));
 }
 
 void
@@ -3297,7 +3613,7 @@ delegate_channels_cb (TpChannelDispatcher *cd,
           if (path_is_in_array (delegated, path))
             {
               /* We are no longer handling this channel */
-              g_hash_table_remove (self->priv->my_chans, path);
+              my_chans_remove (self, path);
 
               g_ptr_array_add (ctx->delegated, g_object_ref (channel));
               continue;
@@ -151,6 +151,16 @@ void tp_base_client_add_handler_capabilities (TpBaseClient *self,
 void tp_base_client_add_handler_capabilities_varargs (TpBaseClient *self,
     const gchar *first_token, ...) G_GNUC_NULL_TERMINATED;
 
+_TP_AVAILABLE_IN_UNRELEASED
+gboolean tp_base_client_observer_filters_match (TpBaseClient *self,
+    GVariant *properties);
+_TP_AVAILABLE_IN_UNRELEASED
+gboolean tp_base_client_approver_filters_match (TpBaseClient *self,
+    GVariant *properties);
+_TP_AVAILABLE_IN_UNRELEASED
+gboolean tp_base_client_handler_filters_match (TpBaseClient *self,
+    GVariant *properties);
+
 #ifndef TP_DISABLE_DEPRECATED
 _TP_DEPRECATED_IN_0_16_FOR (tp_simple_client_factory_add_account_features)
 void tp_base_client_add_account_features (TpBaseClient *self,
@@ -308,6 +308,7 @@ enum
 static guint signals[N_SIGNALS] = {0};
 
 typedef struct _ChannelRequest ChannelRequest;
+typedef struct _ChannelRequestTarget ChannelRequestTarget;
 
 typedef enum {
     METHOD_REQUEST_CHANNEL,
@@ -332,8 +333,56 @@ struct _ChannelRequest
    * satisfied by that channel has a different method.
    */
   unsigned yours : 1;
+
+  /* borrowed from priv->channel_requests_by_target, and our link in its
+   * queue; both NULL if handle_type is NONE */
+  ChannelRequestTarget *target;
+  GList *target_link;
+};
+
+/* All the outstanding requests for a particular (channel type, handle type,
+ * handle), which are the ones that a channel with those properties can
+ * satisfy. */
+struct _ChannelRequestTarget
+{
+  gchar *channel_type;
+  guint handle_type;
+  guint handle;
+  /* (ChannelRequest *), in the order they were made */
+  GQueue requests;
 };
 
+static guint
+channel_request_target_hash (gconstpointer p)
+{
+  const ChannelRequestTarget *target = p;
+
+  return g_str_hash (target->channel_type) ^ (target->handle_type << 24) ^
+      target->handle;
+}
+
+static gboolean
+channel_request_target_equal (gconstpointer a,
+    gconstpointer b)
+{
+  const ChannelRequestTarget *left = a;
+  const ChannelRequestTarget *right = b;
+
+  return (left->handle == right->handle &&
+      left->handle_type == right->handle_type &&
+      !tp_strdiff (left->channel_type, right->channel_type));
+}
+
+static void
+channel_request_target_free (gpointer p)
+{
+  ChannelRequestTarget *target = p;
+
+  g_queue_clear (&target->requests);
+  g_free (target->channel_type);
+  g_slice_free (ChannelRequestTarget, target);
+}
+
 static ChannelRequest *
 channel_request_new (DBusGMethodInvocation *context,
                      ChannelRequestMethod method,
@@ -403,8 +452,16 @@ struct _TpBaseConnectionPrivate
   GPtrArray *channel_factories;
   /* array of (TpChannelManager *) */
   GPtrArray *channel_managers;
-  /* array of (ChannelRequest *) */
-  GPtrArray *channel_requests;
+  /* (ChannelRequest *) => itself, for every outstanding request */
+  GHashTable *channel_requests;
+  /* ChannelRequestTarget => itself; requests with handle_type NONE are
+   * anonymous, can only be satisfied by the channel created for them, and
+   * so are not in here */
+  GHashTable *channel_requests_by_target;
+  /* dup'd object path => Channel_Details (GValueArray), or NULL if nobody
+   * has asked for the Channels property yet. Kept up to date as
+   * NewChannels and ChannelClosed are emitted. */
+  GHashTable *channel_details;
 
   TpHandleRepoIface *handles[TP_NUM_HANDLE_TYPES];
 
@@ -621,11 +678,14 @@ tp_base_connection_dispose (GObject *object)
 
   if (priv->channel_requests)
     {
-      g_assert (priv->channel_requests->len == 0);
-      g_ptr_array_unref (priv->channel_requests);
+      g_assert (g_hash_table_size (priv->channel_requests) == 0);
+      g_hash_table_unref (priv->channel_requests);
       priv->channel_requests = NULL;
     }
 
+  tp_clear_pointer (&priv->channel_requests_by_target, g_hash_table_unref);
+  tp_clear_pointer (&priv->channel_details, g_hash_table_unref);
+
   for (i = 0; i < TP_NUM_HANDLE_TYPES; i++)
     tp_clear_object (priv->handles + i);
 
@@ -787,6 +847,90 @@ get_channel_details (GObject *obj)
   return structure;
 }
 
+/* Takes ownership of @details, which has just been announced in
+ * NewChannels. */
+static void
+channel_details_take (TpBaseConnection *self,
+    GValueArray *details)
+{
+  if (self->priv->channel_details == NULL)
+    {
+      tp_value_array_free (details);
+      return;
+    }
+
+  g_hash_table_insert (self->priv->channel_details,
+      g_value_dup_boxed (details->values + 0), details);
+}
+
+static void
+channel_details_remove (TpBaseConnection *self,
+    const gchar *object_path)
+{
+  if (self->priv->channel_details != NULL)
+    g_hash_table_remove (self->priv->channel_details, object_path);
+}
+
+
+static void
+channel_requests_add (TpBaseConnection *self,
+    ChannelRequest *request)
+{
+  TpBaseConnectionPrivate *priv = self->priv;
+
+  g_hash_table_add (priv->channel_requests, request);
+
+  if (request->handle_type != TP_HANDLE_TYPE_NONE)
+    {
+      ChannelRequestTarget key = { request->channel_type,
+          request->handle_type, request->handle };
+      ChannelRequestTarget *target = g_hash_table_lookup (
+          priv->channel_requests_by_target, &key);
+
+      if (target == NULL)
+        {
+          target = g_slice_new0 (ChannelRequestTarget);
+          target->channel_type = g_strdup (request->channel_type);
+          target->handle_type = request->handle_type;
+          target->handle = request->handle;
+          g_queue_init (&target->requests);
+          g_hash_table_add (priv->channel_requests_by_target, target);
+        }
+
+      g_queue_push_tail (&target->requests, request);
+      request->target = target;
+      request->target_link = target->requests.tail;
+    }
+}
+
+static void
+channel_requests_remove (TpBaseConnection *self,
+    ChannelRequest *request)
+{
+  TpBaseConnectionPrivate *priv = self->priv;
+
+  if (!g_hash_table_remove (priv->channel_requests, request))
+    return;
+
+  if (request->target != NULL)
+    {
+      ChannelRequestTarget *target = request->target;
+
+      g_queue_delete_link (&target->requests, request->target_link);
+      request->target = NULL;
+      request->target_link = NULL;
+
+      if (g_queue_is_empty (&target->requests))
+        g_hash_table_remove (priv->channel_requests_by_target, target);
+    }
+}
+
+static gboolean
+channel_requests_contains (TpBaseConnection *self,
+    ChannelRequest *request)
+{
+  return g_hash_table_contains (self->priv->channel_requests, request);
+}
 
 static GPtrArray *
 find_matching_channel_requests (TpBaseConnection *conn,
@@ -797,8 +941,10 @@ find_matching_channel_requests (TpBaseConnection *conn,
                                 gboolean *suppress_handler)
 {
   TpBaseConnectionPrivate *priv = conn->priv;
+  ChannelRequestTarget key = { (gchar *) channel_type, handle_type, handle };
+  ChannelRequestTarget *target;
   GPtrArray *requests;
-  guint i;
+  GList *iter;
 
   requests = g_ptr_array_sized_new (1);
 
@@ -810,7 +956,7 @@ find_matching_channel_requests (TpBaseConnection *conn,
        */
       g_assert (handle == 0);
       g_assert (channel_request == NULL ||
-          tp_g_ptr_array_contains (priv->channel_requests, channel_request));
+          channel_requests_contains (conn, channel_request));
 
       if (channel_request)
         {
@@ -827,18 +973,13 @@ find_matching_channel_requests (TpBaseConnection *conn,
   /* for identifiable channels (those which are to a particular handle),
    * satisfy any queued requests.
    */
-  for (i = 0; i < priv->channel_requests->len; i++)
-    {
-      ChannelRequest *request = g_ptr_array_index (priv->channel_requests, i);
+  target = g_hash_table_lookup (priv->channel_requests_by_target, &key);
 
-      if (tp_strdiff (request->channel_type, channel_type))
-        continue;
-
-      if (handle_type != request->handle_type)
-        continue;
-
-      if (handle != request->handle)
-        continue;
+  for (iter = (target == NULL ? NULL : target->requests.head);
+      iter != NULL;
+      iter = iter->next)
+    {
+      ChannelRequest *request = iter->data;
 
       if (request->suppress_handler && suppress_handler)
         *suppress_handler = TRUE;
@@ -862,8 +1003,6 @@ satisfy_request (TpBaseConnection *conn,
                  GObject *channel,
                  const gchar *object_path)
 {
-  TpBaseConnectionPrivate *priv = conn->priv;
-
   DEBUG ("completing queued request %p with success, "
       "channel_type=%s, handle_type=%u, "
       "handle=%u, suppress_handler=%u", request, request->channel_type,
@@ -909,7 +1048,7 @@ satisfy_request (TpBaseConnection *conn,
     }
   request->context = NULL;
 
-  g_ptr_array_remove (priv->channel_requests, request);
+  channel_requests_remove (conn, request);
 
   channel_request_free (request);
 }
@@ -951,7 +1090,7 @@ factory_satisfy_requests (TpBaseConnection *conn,
 
       g_ptr_array_add (array, get_channel_details (G_OBJECT (chan)));
       tp_svc_connection_interface_requests_emit_new_channels (conn, array);
-      tp_value_array_free (g_ptr_array_index (array, 0));
+      channel_details_take (conn, g_ptr_array_index (array, 0));
       g_ptr_array_unref (array);
 
       tp_svc_connection_emit_new_channel (conn, object_path, channel_type,
@@ -970,8 +1109,6 @@ fail_channel_request (TpBaseConnection *conn,
                       ChannelRequest *request,
                       GError *error)
 {
-  TpBaseConnectionPrivate *priv = conn->priv;
-
   DEBUG ("completing queued request %p with error, channel_type=%s, "
       "handle_type=%u, handle=%u, suppress_handler=%u",
       request, request->channel_type,
@@ -980,7 +1117,7 @@ fail_channel_request (TpBaseConnection *conn,
   dbus_g_method_return_error (request->context, error);
   request->context = NULL;
 
-  g_ptr_array_remove (priv->channel_requests, request);
+  channel_requests_remove (conn, request);
 
   channel_request_free (request);
 }
@@ -1000,6 +1137,7 @@ factory_channel_closed_cb (GObject *channel,
 
   tp_svc_connection_interface_requests_emit_channel_closed (conn,
       object_path);
+  channel_details_remove (conn, object_path);
 
   g_free (object_path);
 }
@@ -1165,6 +1303,7 @@ manager_new_channels_cb (TpChannelManager *manager,
   ManagerNewChannelContext context = { self, g_hash_table_new (NULL, NULL) };
   GHashTableIter iter;
   gpointer key, value;
+  guint i;
 
   g_assert (TP_IS_CHANNEL_MANAGER (manager));
   g_assert (TP_IS_BASE_CONNECTION (self));
@@ -1186,7 +1325,9 @@ manager_new_channels_cb (TpChannelManager *manager,
   tp_svc_connection_interface_requests_emit_new_channels (self,
       array);
 
-  g_ptr_array_foreach (array, (GFunc) tp_value_array_free, NULL);
+  for (i = 0; i < array->len; i++)
+    channel_details_take (self, g_ptr_array_index (array, i));
+
   g_ptr_array_unref (array);
 
   /* Emit NewChannel */
@@ -1263,6 +1404,7 @@ manager_channel_closed_cb (TpChannelManager *manager,
   g_assert (TP_IS_BASE_CONNECTION (self));
 
   tp_svc_connection_interface_requests_emit_channel_closed (self, path);
+  channel_details_remove (self, path);
 }
 
 /*
@@ -1427,36 +1569,60 @@ manager_get_channel_details_foreach (TpExportableChannel *chan,
 }
 
 
+/* Returns a new array of Channel_Details borrowed from priv->channel_details,
+ * which is filled in from the channel managers and factories the first time
+ * and maintained incrementally afterwards. */
 static GPtrArray *
 conn_requests_get_channel_details (TpBaseConnection *self)
 {
   TpBaseConnectionPrivate *priv = self->priv;
-  /* guess that each ChannelManager and each ChannelFactory has two
-   * channels, on average */
-  GPtrArray *details = g_ptr_array_sized_new (priv->channel_managers->len * 2
-      + priv->channel_factories->len * 2);
+  GPtrArray *details;
+  GHashTableIter iter;
+  gpointer value;
   guint i;
 
-  G_GNUC_BEGIN_IGNORE_DEPRECATIONS
-  for (i = 0; i < priv->channel_factories->len; i++)
+  if (priv->channel_details == NULL)
     {
-      TpChannelFactoryIface *factory = TP_CHANNEL_FACTORY_IFACE (
-          g_ptr_array_index (priv->channel_factories, i));
+      priv->channel_details = g_hash_table_new_full (g_str_hash, g_str_equal,
+          g_free, (GDestroyNotify) tp_value_array_free);
 
-      tp_channel_factory_iface_foreach (factory,
-          factory_get_channel_details_foreach, details);
-    }
-  G_GNUC_END_IGNORE_DEPRECATIONS
+      /* guess that each ChannelManager and each ChannelFactory has two
+       * channels, on average */
+      details = g_ptr_array_sized_new (priv->channel_managers->len * 2
+          + priv->channel_factories->len * 2);
 
-  for (i = 0; i < priv->channel_managers->len; i++)
-    {
-      TpChannelManager *manager = TP_CHANNEL_MANAGER (
-          g_ptr_array_index (priv->channel_managers, i));
+      G_GNUC_BEGIN_IGNORE_DEPRECATIONS
+      for (i = 0; i < priv->channel_factories->len; i++)
+        {
+          TpChannelFactoryIface *factory = TP_CHANNEL_FACTORY_IFACE (
+              g_ptr_array_index (priv->channel_factories, i));
 
-      tp_channel_manager_foreach_channel (manager,
-          manager_get_channel_details_foreach, details);
+          tp_channel_factory_iface_foreach (factory,
+              factory_get_channel_details_foreach, details);
+        }
+      G_GNUC_END_IGNORE_DEPRECATIONS
+
+      for (i = 0; i < priv->channel_managers->len; i++)
+        {
+          TpChannelManager *manager = TP_CHANNEL_MANAGER (
+              g_ptr_array_index (priv->channel_managers, i));
+
+          tp_channel_manager_foreach_channel (manager,
+              manager_get_channel_details_foreach, details);
+        }
+
+      for (i = 0; i < details->len; i++)
+        channel_details_take (self, g_ptr_array_index (details, i));
+
+      g_ptr_array_unref (details);
     }
 
+  details = g_ptr_array_sized_new (g_hash_table_size (priv->channel_details));
+  g_hash_table_iter_init (&iter, priv->channel_details);
+
+  while (g_hash_table_iter_next (&iter, NULL, &value))
+    g_ptr_array_add (details, value);
+
   return details;
 }
 
@@ -1510,7 +1676,11 @@ conn_requests_get_dbus_property (GObject *object,
 
   if (name == g_quark_from_static_string ("Channels"))
     {
-      g_value_take_boxed (value, conn_requests_get_channel_details (self));
+      GPtrArray *details = conn_requests_get_channel_details (self);
+
+      /* the elements are borrowed, so this has to be a deep copy */
+      g_value_set_boxed (value, details);
+      g_ptr_array_unref (details);
     }
   else if (name == g_quark_from_static_string ("RequestableChannelClasses"))
     {
@@ -1794,7 +1964,10 @@ tp_base_connection_init (TpBaseConnection *self)
       priv->handles[i] = NULL;
     }
 
-  priv->channel_requests = g_ptr_array_new ();
+  priv->channel_requests = g_hash_table_new (NULL, NULL);
+  priv->channel_requests_by_target = g_hash_table_new_full (
+      channel_request_target_hash, channel_request_target_equal,
+      channel_request_target_free, NULL);
   priv->client_interests = g_hash_table_new_full (NULL, NULL, NULL,
       (GDestroyNotify) g_hash_table_unref);
   priv->interested_clients = g_hash_table_new_full (g_str_hash, g_str_equal,
@@ -2511,7 +2684,7 @@ tp_base_connection_request_channel (TpSvcConnection *iface,
 
   request = channel_request_new (context, METHOD_REQUEST_CHANNEL,
       type, handle_type, handle, suppress_handler);
-  g_ptr_array_add (priv->channel_requests, request);
+  channel_requests_add (self, request);
 
   /* First try the channel managers */
 
@@ -2569,16 +2742,14 @@ tp_base_connection_request_channel (TpSvcConnection *iface,
             g_assert (NULL != chan);
             factory_satisfy_requests (self, factory, chan, request, FALSE);
             /* factory_satisfy_requests should remove the request */
-            g_assert (!tp_g_ptr_array_contains (priv->channel_requests,
-                  request));
+            g_assert (!channel_requests_contains (self, request));
             return;
           }
         case TP_CHANNEL_FACTORY_REQUEST_STATUS_CREATED:
           g_assert (NULL != chan);
           /* the signal handler should have completed the queued request
            * and freed the ChannelRequest already */
-          g_assert (!tp_g_ptr_array_contains (priv->channel_requests,
-                request));
+          g_assert (!channel_requests_contains (self, request));
           return;
         case TP_CHANNEL_FACTORY_REQUEST_STATUS_QUEUED:
           DEBUG ("queued request, channel_type=%s, handle_type=%u, "
@@ -2633,7 +2804,7 @@ ERROR:
   request->context = NULL;
   g_error_free (error);
 
-  g_ptr_array_remove (priv->channel_requests, request);
+  channel_requests_remove (self, request);
   channel_request_free (request);
 }
 
@@ -3207,14 +3378,24 @@ tp_base_connection_change_status (TpBaseConnection *self,
       /* cancel all queued channel requests that weren't already cancelled by
        * the channel managers.
        */
-      if (priv->channel_requests->len > 0)
+      if (g_hash_table_size (priv->channel_requests) > 0)
         {
-          g_ptr_array_foreach (priv->channel_requests, (GFunc)
-            channel_request_cancel, NULL);
-          g_ptr_array_remove_range (priv->channel_requests, 0,
-            priv->channel_requests->len);
+          GHashTableIter iter;
+          gpointer request;
+
+          g_hash_table_remove_all (priv->channel_requests_by_target);
+          g_hash_table_iter_init (&iter, priv->channel_requests);
+
+          while (g_hash_table_iter_next (&iter, &request, NULL))
+            {
+              g_hash_table_iter_steal (&iter);
+              channel_request_cancel (request, NULL);
+            }
         }
 
+      /* channels are going away; if anyone asks again, start afresh */
+      tp_clear_pointer (&priv->channel_details, g_hash_table_unref);
+
       if (prev_status != TP_INTERNAL_CONNECTION_STATUS_NEW)
         {
           if (klass->disconnected)
@@ -3864,7 +4045,7 @@ conn_requests_offer_request (TpBaseConnection *self,
 
   request = channel_request_new (context, method,
       type, target_handle_type, target_handle, suppress_handler);
-  g_ptr_array_add (priv->channel_requests, request);
+  channel_requests_add (self, request);
 
   for (i = 0; i < priv->channel_managers->len; i++)
     {
@@ -3879,7 +4060,7 @@ conn_requests_offer_request (TpBaseConnection *self,
   tp_dbus_g_method_return_not_implemented (context);
   request->context = NULL;
 
-  g_ptr_array_remove (priv->channel_requests, request);
+  channel_requests_remove (self, request);
   channel_request_free (request);
 }
 
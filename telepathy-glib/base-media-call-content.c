@@ -70,6 +70,7 @@
 #include "telepathy-glib/interfaces.h"
 #include "telepathy-glib/svc-call.h"
 #include "telepathy-glib/svc-properties-interface.h"
+#include "telepathy-glib/timer-internal.h"
 #include "telepathy-glib/util.h"
 #include "telepathy-glib/util-internal.h"
 
@@ -127,7 +128,8 @@ struct _TpBaseMediaCallContentPrivate
   gchar *deferred_tones;
   gboolean multiple_tones;
   gboolean tones_cancelled;
-  guint tones_pause_timeout_id;
+  /* borrowed: freed by the scheduler when it fires, or NULL */
+  TpTimer *tones_pause_timer;
   gulong channel_state_changed_id;
 
   /* GQueue of GSimpleAsyncResult with a TpCallContentMediaDescription
@@ -191,9 +193,9 @@ tp_base_media_call_content_dispose (GObject *object)
   tp_clear_pointer (&self->priv->local_media_descriptions, g_hash_table_unref);
   tp_clear_pointer (&self->priv->remote_media_descriptions, g_hash_table_unref);
 
-  if (self->priv->tones_pause_timeout_id != 0)
-    g_source_remove (self->priv->tones_pause_timeout_id);
-  self->priv->tones_pause_timeout_id = 0;
+  if (self->priv->tones_pause_timer != NULL)
+    _tp_timer_cancel (self->priv->tones_pause_timer);
+  self->priv->tones_pause_timer = NULL;
 
   if (self->priv->channel_state_changed_id != 0)
     {
@@ -1027,16 +1029,14 @@ tp_base_media_call_content_multiple_tones (TpBaseCallContent *bcc,
   return TRUE;
 }
 
-static gboolean
+static void
 dtmf_pause_timeout_func (gpointer data)
 {
   TpBaseMediaCallContent *self = data;
 
-  self->priv->tones_pause_timeout_id = 0;
+  self->priv->tones_pause_timer = NULL;
 
   tp_base_media_call_content_dtmf_next (self);
-
-  return FALSE;
 }
 
 static void
@@ -1095,7 +1095,7 @@ tp_base_media_call_content_dtmf_next (TpBaseMediaCallContent *self)
             TP_BASE_CALL_CONTENT (self));
 
         /* Waiting for timeout */
-        if (self->priv->tones_pause_timeout_id != 0)
+        if (self->priv->tones_pause_timer != NULL)
           return;
 
         if (channel &&
@@ -1123,8 +1123,8 @@ tp_base_media_call_content_dtmf_next (TpBaseMediaCallContent *self)
                     self->priv->current_dtmf_state);
                 break;
               case DTMF_CHAR_CLASS_PAUSE:
-                self->priv->tones_pause_timeout_id = g_timeout_add (
-                    DTMF_PAUSE_MS, dtmf_pause_timeout_func, self);
+                self->priv->tones_pause_timer = _tp_timer_add (
+                    DTMF_PAUSE_MS, 0, dtmf_pause_timeout_func, self);
                 tp_svc_call_content_interface_dtmf_emit_sending_tones (self,
                     self->priv->currently_sending_tones);
                 break;
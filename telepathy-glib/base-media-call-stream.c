@@ -195,8 +195,7 @@ struct _TpBaseMediaCallStreamPrivate
   TpStreamFlowState sending_state;
   TpStreamFlowState receiving_state;
   TpStreamTransportType transport;
-  /* GPtrArray of owned GValueArray (dbus struct) */
-  GPtrArray *local_candidates;
+  TpCallCandidateList *local_candidates;
   gchar *username;
   gchar *password;
   /* GPtrArray of owned GValueArray (dbus struct) */
@@ -234,8 +233,7 @@ tp_base_media_call_stream_init (TpBaseMediaCallStream *self)
   self->priv = G_TYPE_INSTANCE_GET_PRIVATE (self,
       TP_TYPE_BASE_MEDIA_CALL_STREAM, TpBaseMediaCallStreamPrivate);
 
-  self->priv->local_candidates = g_ptr_array_new_with_free_func (
-      (GDestroyNotify) tp_value_array_free);
+  self->priv->local_candidates = _tp_call_candidate_list_new ();
   self->priv->username = g_strdup ("");
   self->priv->password = g_strdup ("");
   self->priv->receiving_requests = tp_intset_new ();
@@ -266,7 +264,8 @@ tp_base_media_call_stream_finalize (GObject *object)
 {
   TpBaseMediaCallStream *self = TP_BASE_MEDIA_CALL_STREAM (object);
 
-  tp_clear_pointer (&self->priv->local_candidates, g_ptr_array_unref);
+  tp_clear_pointer (&self->priv->local_candidates,
+      _tp_call_candidate_list_free);
   tp_clear_pointer (&self->priv->stun_servers, g_ptr_array_unref);
   tp_clear_pointer (&self->priv->relay_info, g_ptr_array_unref);
   tp_clear_pointer (&self->priv->username, g_free);
@@ -296,7 +295,9 @@ tp_base_media_call_stream_get_property (GObject *object,
         g_value_set_uint (value, self->priv->transport);
         break;
       case PROP_LOCAL_CANDIDATES:
-        g_value_set_boxed (value, self->priv->local_candidates);
+        g_value_set_boxed (value,
+            _tp_call_candidate_list_get_candidates (
+                self->priv->local_candidates));
         break;
       case PROP_LOCAL_CREDENTIALS:
         {
@@ -1084,7 +1085,8 @@ tp_base_media_call_stream_get_local_candidates (TpBaseMediaCallStream *self)
 {
   g_return_val_if_fail (TP_IS_BASE_MEDIA_CALL_STREAM (self), NULL);
 
-  return self->priv->local_candidates;
+  return _tp_call_candidate_list_get_candidates (
+      self->priv->local_candidates);
 }
 
 
@@ -1390,9 +1392,7 @@ tp_base_media_call_stream_set_credentials (TpSvcCallStreamInterfaceMedia *iface,
   self->priv->username = g_strdup (username);
   self->priv->password = g_strdup (password);
 
-  tp_clear_pointer (&self->priv->local_candidates, g_ptr_array_unref);
-  self->priv->local_candidates = g_ptr_array_new_with_free_func (
-      (GDestroyNotify) tp_value_array_free);
+  _tp_call_candidate_list_clear (self->priv->local_candidates);
 
   g_object_notify (G_OBJECT (self), "local-candidates");
   g_object_notify (G_OBJECT (self), "local-credentials");
@@ -1412,7 +1412,7 @@ tp_base_media_call_stream_add_candidates (TpSvcCallStreamInterfaceMedia *iface,
   TpBaseMediaCallStreamClass *klass =
       TP_BASE_MEDIA_CALL_STREAM_GET_CLASS (self);
   GPtrArray *accepted_candidates = NULL;
-  guint i;
+  GPtrArray *added;
   GError *error = NULL;
 
   if (klass->add_local_candidates == NULL)
@@ -1435,21 +1435,15 @@ tp_base_media_call_stream_add_candidates (TpSvcCallStreamInterfaceMedia *iface,
       return;
     }
 
-  for (i = 0; i < accepted_candidates->len; i++)
-    {
-      GValueArray *c = g_ptr_array_index (accepted_candidates, i);
-
-      G_GNUC_BEGIN_IGNORE_DEPRECATIONS
-      g_ptr_array_add (self->priv->local_candidates,
-          g_value_array_copy (c));
-      G_GNUC_END_IGNORE_DEPRECATIONS
-    }
+  added = _tp_call_candidate_list_add (self->priv->local_candidates,
+      accepted_candidates);
+  g_ptr_array_unref (accepted_candidates);
 
   tp_svc_call_stream_interface_media_emit_local_candidates_added (self,
-      accepted_candidates);
-  tp_svc_call_stream_interface_media_return_from_add_candidates (context);
+      added);
+  g_ptr_array_unref (added);
 
-  g_ptr_array_unref (accepted_candidates);
+  tp_svc_call_stream_interface_media_return_from_add_candidates (context);
 }
 
 static void
@@ -111,8 +111,7 @@ struct _TpCallStreamEndpointPrivate
 
   gchar *username;
   gchar *password;
-  /* GPtrArray of owned #GValueArray (dbus struct) */
-  GPtrArray *remote_candidates;
+  TpCallCandidateList *remote_candidates;
   /* GPtrArray of owned #GValueArray (dbus struct) */
   GPtrArray *selected_candidate_pairs;
   /* TpStreamComponent -> TpStreamEndpointState map */
@@ -133,8 +132,7 @@ tp_call_stream_endpoint_init (TpCallStreamEndpoint *self)
 
   self->priv->username = g_strdup ("");
   self->priv->password = g_strdup ("");
-  self->priv->remote_candidates = g_ptr_array_new_with_free_func (
-      (GDestroyNotify) tp_value_array_free);
+  self->priv->remote_candidates = _tp_call_candidate_list_new ();
   self->priv->selected_candidate_pairs = g_ptr_array_new_with_free_func (
       (GDestroyNotify) tp_value_array_free);
   self->priv->endpoint_state = g_hash_table_new (NULL, NULL);
@@ -175,7 +173,8 @@ tp_call_stream_endpoint_finalize (GObject *object)
   tp_clear_pointer (&self->priv->object_path, g_free);
   tp_clear_pointer (&self->priv->username, g_free);
   tp_clear_pointer (&self->priv->password, g_free);
-  tp_clear_pointer (&self->priv->remote_candidates, g_ptr_array_unref);
+  tp_clear_pointer (&self->priv->remote_candidates,
+      _tp_call_candidate_list_free);
   tp_clear_pointer (&self->priv->selected_candidate_pairs, g_ptr_array_unref);
   tp_clear_pointer (&self->priv->endpoint_state, g_hash_table_unref);
 
@@ -210,7 +209,9 @@ tp_call_stream_endpoint_get_property (GObject *object,
           break;
         }
       case PROP_REMOTE_CANDIDATES:
-        g_value_set_boxed (value, self->priv->remote_candidates);
+        g_value_set_boxed (value,
+            _tp_call_candidate_list_get_candidates (
+                self->priv->remote_candidates));
         break;
       case PROP_SELECTED_CANDIDATE_PAIRS:
         g_value_set_boxed (value, self->priv->selected_candidate_pairs);
@@ -569,7 +570,7 @@ void
 tp_call_stream_endpoint_add_new_candidates (TpCallStreamEndpoint *self,
     const GPtrArray *candidates)
 {
-  guint i;
+  GPtrArray *added;
 
   g_return_if_fail (TP_IS_CALL_STREAM_ENDPOINT (self));
 
@@ -579,18 +580,10 @@ tp_call_stream_endpoint_add_new_candidates (TpCallStreamEndpoint *self,
   DEBUG ("Add %d candidates to endpoint %s",
       candidates->len, self->priv->object_path);
 
-  for (i = 0; i < candidates->len; i++)
-    {
-      GValueArray *c = g_ptr_array_index (candidates, i);
-
-      G_GNUC_BEGIN_IGNORE_DEPRECATIONS
-      g_ptr_array_add (self->priv->remote_candidates,
-          g_value_array_copy (c));
-      G_GNUC_END_IGNORE_DEPRECATIONS
-    }
-
-  tp_svc_call_stream_endpoint_emit_remote_candidates_added (self,
+  added = _tp_call_candidate_list_add (self->priv->remote_candidates,
       candidates);
+  tp_svc_call_stream_endpoint_emit_remote_candidates_added (self, added);
+  g_ptr_array_unref (added);
 }
 
 /**
@@ -613,8 +606,8 @@ tp_call_stream_endpoint_add_new_candidate (TpCallStreamEndpoint *self,
     guint port,
     const GHashTable *info_hash)
 {
-  GPtrArray *candidates;
   GValueArray *c;
+  GPtrArray *added;
 
   g_return_if_fail (TP_IS_CALL_STREAM_ENDPOINT (self));
   g_return_if_fail (address != NULL);
@@ -630,13 +623,13 @@ tp_call_stream_endpoint_add_new_candidate (TpCallStreamEndpoint *self,
       TP_HASH_TYPE_CANDIDATE_INFO, info_hash,
       G_TYPE_INVALID);
 
-  g_ptr_array_add (self->priv->remote_candidates, c);
+  /* @c is already a copy, so the list can have it */
+  added = g_ptr_array_sized_new (1);
+  g_ptr_array_add (added,
+      _tp_call_candidate_list_take (self->priv->remote_candidates, c));
 
-  candidates = g_ptr_array_new ();
-  g_ptr_array_add (candidates, c);
-  tp_svc_call_stream_endpoint_emit_remote_candidates_added (self,
-      candidates);
-  g_ptr_array_unref (candidates);
+  tp_svc_call_stream_endpoint_emit_remote_candidates_added (self, added);
+  g_ptr_array_unref (added);
 }
 
 /**
@@ -963,3 +956,187 @@ _tp_call_stream_endpoint_set_stream (TpCallStreamEndpoint *self,
 
   self->priv->stream = stream;
 }
+
+/*
+ * TpCallCandidateList:
+ *
+ * The candidates of a #TpBaseMediaCallStream (local) or of a
+ * #TpCallStreamEndpoint (remote). Each candidate is copied at most once, when
+ * it is added; the same #GValueArray is then used for the property value and
+ * for the CandidatesAdded signal. Candidates with the same component,
+ * protocol, address and port as one we already have are redundant (RFC 5245
+ * §4.1.3) and are not stored again, so that a peer trickling the same
+ * candidates again doesn't make the list grow without bound. They replace
+ * the one we had, in place, since their other details such as the
+ * credentials may have changed, and are still signalled, as they always
+ * were.
+ */
+struct _TpCallCandidateList
+{
+  /* owned GValueArray (dbus struct) */
+  GPtrArray *candidates;
+  /* owned gchar * key => GUINT_TO_POINTER (1 + index in @candidates) */
+  GHashTable *index;
+};
+
+TpCallCandidateList *
+_tp_call_candidate_list_new (void)
+{
+  TpCallCandidateList *self = g_slice_new0 (TpCallCandidateList);
+
+  self->candidates = g_ptr_array_new_with_free_func (
+      (GDestroyNotify) tp_value_array_free);
+  self->index = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
+
+  return self;
+}
+
+void
+_tp_call_candidate_list_free (TpCallCandidateList *self)
+{
+  g_ptr_array_unref (self->candidates);
+  g_hash_table_unref (self->index);
+  g_slice_free (TpCallCandidateList, self);
+}
+
+/* Returns: (transfer none): the candidates, suitable for use as the value of
+ * the LocalCandidates or RemoteCandidates property */
+GPtrArray *
+_tp_call_candidate_list_get_candidates (TpCallCandidateList *self)
+{
+  return self->candidates;
+}
+
+void
+_tp_call_candidate_list_clear (TpCallCandidateList *self)
+{
+  if (self->candidates->len == 0)
+    return;
+
+  g_hash_table_remove_all (self->index);
+  g_ptr_array_set_size (self->candidates, 0);
+}
+
+/* Returns: (transfer full): a key identifying @candidate, or %NULL if it
+ * doesn't have the expected (u, s, u, a{sv}) shape, in which case it is
+ * never considered to be redundant */
+static gchar *
+dup_candidate_key (const GValueArray *candidate)
+{
+  const GValue *component, *address, *port, *info;
+  const gchar *protocol = NULL;
+
+  if (candidate->n_values != 4)
+    return NULL;
+
+  G_GNUC_BEGIN_IGNORE_DEPRECATIONS
+  component = g_value_array_get_nth ((GValueArray *) candidate, 0);
+  address = g_value_array_get_nth ((GValueArray *) candidate, 1);
+  port = g_value_array_get_nth ((GValueArray *) candidate, 2);
+  info = g_value_array_get_nth ((GValueArray *) candidate, 3);
+  G_GNUC_END_IGNORE_DEPRECATIONS
+
+  if (!G_VALUE_HOLDS_UINT (component) ||
+      !G_VALUE_HOLDS_STRING (address) ||
+      !G_VALUE_HOLDS_UINT (port))
+    return NULL;
+
+  if (G_VALUE_HOLDS (info, TP_HASH_TYPE_CANDIDATE_INFO) &&
+      g_value_get_boxed (info) != NULL)
+    protocol = tp_asv_get_string (g_value_get_boxed (info), "protocol");
+
+  return g_strdup_printf ("%u/%s/%s/%u", g_value_get_uint (component),
+      protocol != NULL ? protocol : "", g_value_get_string (address),
+      g_value_get_uint (port));
+}
+
+/*
+ * _tp_call_candidate_list_take:
+ * @self: the list
+ * @candidate: (transfer full): a #GValueArray
+ *
+ * Add @candidate to @self without copying it. If it is redundant, it
+ * replaces the equivalent candidate that @self already had, which is freed.
+ *
+ * Returns: (transfer none): @candidate
+ */
+GValueArray *
+_tp_call_candidate_list_take (TpCallCandidateList *self,
+    GValueArray *candidate)
+{
+  gchar *key = dup_candidate_key (candidate);
+  guint pos;
+
+  if (key != NULL)
+    {
+      pos = GPOINTER_TO_UINT (g_hash_table_lookup (self->index, key));
+
+      if (pos != 0)
+        {
+          DEBUG ("replacing redundant candidate %s", key);
+          g_free (key);
+          tp_value_array_free (g_ptr_array_index (self->candidates, pos - 1));
+          g_ptr_array_index (self->candidates, pos - 1) = candidate;
+          return candidate;
+        }
+
+      g_hash_table_insert (self->index, key,
+          GUINT_TO_POINTER (self->candidates->len + 1));
+    }
+
+  g_ptr_array_add (self->candidates, candidate);
+  return candidate;
+}
+
+/*
+ * _tp_call_candidate_list_add:
+ * @self: the list
+ * @candidates: #GPtrArray of #GValueArray, which are borrowed
+ *
+ * Copy the candidates from @candidates into @self, replacing the ones which
+ * they make redundant.
+ *
+ * Returns: (transfer container): a #GPtrArray with the same length as
+ *  @candidates, containing a copy of each of them borrowed from @self,
+ *  suitable for emitting in the CandidatesAdded signal
+ */
+GPtrArray *
+_tp_call_candidate_list_add (TpCallCandidateList *self,
+    const GPtrArray *candidates)
+{
+  GPtrArray *added = g_ptr_array_sized_new (candidates->len);
+  guint i, j;
+
+  for (i = 0; i < candidates->len; i++)
+    {
+      GValueArray *c = g_ptr_array_index (candidates, i);
+      gchar *key = dup_candidate_key (c);
+      GValueArray *replaced = NULL;
+      guint pos = 0;
+
+      if (key != NULL)
+        pos = GPOINTER_TO_UINT (g_hash_table_lookup (self->index, key));
+
+      g_free (key);
+
+      if (pos != 0)
+        replaced = g_ptr_array_index (self->candidates, pos - 1);
+
+      G_GNUC_BEGIN_IGNORE_DEPRECATIONS
+      c = g_value_array_copy (c);
+      G_GNUC_END_IGNORE_DEPRECATIONS
+
+      c = _tp_call_candidate_list_take (self, c);
+
+      /* an earlier candidate of the same batch may just have been freed */
+      for (j = 0; replaced != NULL && j < added->len; j++)
+        {
+          if (g_ptr_array_index (added, j) == replaced)
+            g_ptr_array_index (added, j) = c;
+        }
+
+      g_ptr_array_add (added, c);
+    }
+
+  return added;
+}
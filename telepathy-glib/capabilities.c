@@ -72,12 +72,83 @@ enum {
     N_PROPS
 };
 
+typedef enum {
+    CAP_FLAG_TEXT_CHATS = (1<<0),
+    CAP_FLAG_TEXT_CHATROOMS = (1<<1),
+    CAP_FLAG_SMS = (1<<2),
+    CAP_FLAG_ROOM_LIST = (1<<3),
+    CAP_FLAG_ROOM_LIST_WITH_SERVER = (1<<4),
+    CAP_FLAG_CONTACT_SEARCH = (1<<5),
+    CAP_FLAG_CONTACT_SEARCH_WITH_LIMIT = (1<<6),
+    CAP_FLAG_CONTACT_SEARCH_WITH_SERVER = (1<<7)
+} CapFlags;
+
+typedef enum {
+    CALL_CAP_FLAG_AUDIO = (1<<0),
+    CALL_CAP_FLAG_AUDIO_VIDEO = (1<<1)
+} CallCapFlags;
+
+typedef enum {
+    TUBE_TYPE_STREAM,
+    TUBE_TYPE_DBUS,
+    N_TUBE_TYPES
+} TubeType;
+
+typedef struct {
+    /* TRUE if there is a class with only ChannelType and TargetHandleType */
+    gboolean any_service;
+    /* owned service name => itself, or NULL; only filled in for
+     * contact-specific capabilities, from classes which also fix the service */
+    GHashTable *services;
+} TubeClasses;
+
 struct _TpCapabilitiesPrivate {
     GPtrArray *classes;
     gboolean contact_specific;
+    /* @classes serialized; built when first needed, unless
+     * _tp_capabilities_new() already had it */
     GVariant *classes_variant;
+
+    /* The answers to all the tp_capabilities_supports_*() questions,
+     * computed from @classes once, in constructed */
+    CapFlags flags;
+    /* TpHandleType => CallCapFlags */
+    guint8 call_flags[TP_NUM_HANDLE_TYPES];
+    /* bit N is set if supports_file_transfer (N) would succeed */
+    guint16 ft_queries;
+    /* [TubeType][0 for contacts, 1 for rooms] */
+    TubeClasses tubes[N_TUBE_TYPES][2];
+
+    /* if not NULL, we are in capabilities_cache under this key */
+    GBytes *cache_key;
 };
 
+/* Channel types we care about, so that each class' type is only compared
+ * once, as a quark */
+static GQuark text_quark = 0;
+static GQuark call_quark = 0;
+static GQuark ft_quark = 0;
+static GQuark stream_tube_quark = 0;
+static GQuark dbus_tube_quark = 0;
+static GQuark contact_search_quark = 0;
+static GQuark room_list_quark = 0;
+
+/* { non-contact-specific, contact-specific } caches of
+ * owned GBytes (serialized a(a{sv}as)) => borrowed TpCapabilities */
+static GHashTable *capabilities_cache[2] = { NULL, NULL };
+G_LOCK_DEFINE_STATIC (capabilities_cache);
+
+static GVariant *
+get_classes_variant (TpCapabilities *self)
+{
+  if (self->priv->classes_variant == NULL)
+    self->priv->classes_variant = _tp_boxed_to_variant (
+        TP_ARRAY_TYPE_REQUESTABLE_CHANNEL_CLASS_LIST, "a(a{sv}as)",
+        self->priv->classes);
+
+  return self->priv->classes_variant;
+}
+
 /**
  * tp_capabilities_get_channel_classes:
  * @self: a #TpCapabilities object
@@ -115,6 +186,235 @@ tp_capabilities_is_specific_to_contact (TpCapabilities *self)
   return self->priv->contact_specific;
 }
 
+typedef enum {
+    FT_CAP_FLAGS_NONE = 0,
+    FT_CAP_FLAG_URI = (1<<0),
+    FT_CAP_FLAG_OFFSET = (1<<1),
+    FT_CAP_FLAG_DATE = (1<<2),
+    FT_CAP_FLAG_DESCRIPTION = (1<<3),
+    FT_CAP_FLAGS_ALL = (1<<4) - 1
+} FTCapFlags;
+
+static gboolean
+call_class_matches (GHashTable *fixed,
+    const gchar * const *allowed,
+    gboolean expected_initial_video)
+{
+  guint nb_fixed_props = 2;
+
+  /* We want audio, INITIAL_AUDIO must be in either fixed or allowed */
+  if (tp_asv_get_boolean (fixed, TP_PROP_CHANNEL_TYPE_CALL_INITIAL_AUDIO,
+          NULL))
+    nb_fixed_props++;
+  else if (!tp_strv_contains (allowed,
+          TP_PROP_CHANNEL_TYPE_CALL_INITIAL_AUDIO))
+    return FALSE;
+
+  if (expected_initial_video)
+    {
+      /* We want video, INITIAL_VIDEO must be in either fixed or allowed */
+      if (tp_asv_get_boolean (fixed, TP_PROP_CHANNEL_TYPE_CALL_INITIAL_VIDEO,
+              NULL))
+        nb_fixed_props++;
+      else if (!tp_strv_contains (allowed,
+              TP_PROP_CHANNEL_TYPE_CALL_INITIAL_VIDEO))
+        return FALSE;
+    }
+
+  return (g_hash_table_size (fixed) == nb_fixed_props);
+}
+
+static void
+compile_tube_class (TpCapabilities *self,
+    TubeType tube_type,
+    GHashTable *fixed,
+    TpHandleType handle_type,
+    const gchar *service_prop)
+{
+  TubeClasses *tubes;
+  const gchar *service;
+
+  if (handle_type == TP_HANDLE_TYPE_CONTACT)
+    tubes = &self->priv->tubes[tube_type][0];
+  else if (handle_type == TP_HANDLE_TYPE_ROOM)
+    tubes = &self->priv->tubes[tube_type][1];
+  else
+    return;
+
+  if (g_hash_table_size (fixed) == 2)
+    {
+      tubes->any_service = TRUE;
+      return;
+    }
+
+  if (!self->priv->contact_specific || g_hash_table_size (fixed) != 3)
+    return;
+
+  service = tp_asv_get_string (fixed, service_prop);
+
+  if (service == NULL)
+    return;
+
+  if (tubes->services == NULL)
+    tubes->services = g_hash_table_new_full (g_str_hash, g_str_equal,
+        g_free, NULL);
+
+  g_hash_table_add (tubes->services, g_strdup (service));
+}
+
+/*
+ * Work out the answer to every tp_capabilities_supports_*() question,
+ * so that answering them doesn't involve looking at the classes again.
+ * The logic for each question is described in the corresponding function.
+ */
+static void
+compile_classes (TpCapabilities *self)
+{
+  guint i;
+
+  for (i = 0; i < self->priv->classes->len; i++)
+    {
+      GValueArray *arr = g_ptr_array_index (self->priv->classes, i);
+      GHashTable *fixed;
+      const gchar * const *allowed;
+      GQuark chan_type;
+      TpHandleType handle_type;
+      gboolean valid;
+      guint n_fixed;
+
+      tp_value_array_unpack (arr, 2,
+          &fixed,
+          &allowed);
+
+      n_fixed = g_hash_table_size (fixed);
+      chan_type = g_quark_try_string (tp_asv_get_string (fixed,
+            TP_PROP_CHANNEL_CHANNEL_TYPE));
+      handle_type = tp_asv_get_uint32 (fixed,
+          TP_PROP_CHANNEL_TARGET_HANDLE_TYPE, &valid);
+
+      if (chan_type == 0)
+        continue;
+
+      /* ContactSearch channel should have ChannelType and TargetHandleType=NONE
+       * but CM implementations are wrong and omitted TargetHandleType,
+       * so it's set in stone now.  */
+      if (chan_type == contact_search_quark)
+        {
+          if (n_fixed != 1)
+            continue;
+
+          self->priv->flags |= CAP_FLAG_CONTACT_SEARCH;
+
+          if (tp_strv_contains (allowed,
+                TP_PROP_CHANNEL_TYPE_CONTACT_SEARCH_LIMIT))
+            self->priv->flags |= CAP_FLAG_CONTACT_SEARCH_WITH_LIMIT;
+
+          if (tp_strv_contains (allowed,
+                TP_PROP_CHANNEL_TYPE_CONTACT_SEARCH_SERVER))
+            self->priv->flags |= CAP_FLAG_CONTACT_SEARCH_WITH_SERVER;
+
+          continue;
+        }
+
+      if (!valid)
+        continue;
+
+      if (chan_type == text_quark)
+        {
+          if (n_fixed == 2 && handle_type == TP_HANDLE_TYPE_CONTACT)
+            self->priv->flags |= CAP_FLAG_TEXT_CHATS;
+          else if (n_fixed == 2 && handle_type == TP_HANDLE_TYPE_ROOM)
+            self->priv->flags |= CAP_FLAG_TEXT_CHATROOMS;
+
+          if (handle_type != TP_HANDLE_TYPE_CONTACT)
+            continue;
+
+          /* SMSChannel be either in fixed (in which case it must be the
+           * only extra fixed property) or allowed properties */
+          if (tp_asv_get_boolean (fixed,
+                TP_PROP_CHANNEL_INTERFACE_SMS_SMS_CHANNEL, NULL))
+            {
+              if (n_fixed == 3)
+                self->priv->flags |= CAP_FLAG_SMS;
+            }
+          else if (n_fixed == 2 && tp_strv_contains (allowed,
+                TP_PROP_CHANNEL_INTERFACE_SMS_SMS_CHANNEL))
+            {
+              self->priv->flags |= CAP_FLAG_SMS;
+            }
+        }
+      else if (chan_type == call_quark)
+        {
+          if (handle_type >= TP_NUM_HANDLE_TYPES)
+            continue;
+
+          if (call_class_matches (fixed, allowed, FALSE))
+            self->priv->call_flags[handle_type] |= CALL_CAP_FLAG_AUDIO;
+
+          if (call_class_matches (fixed, allowed, TRUE))
+            self->priv->call_flags[handle_type] |= CALL_CAP_FLAG_AUDIO_VIDEO;
+        }
+      else if (chan_type == ft_quark)
+        {
+          FTCapFlags allowed_flags = FT_CAP_FLAGS_NONE;
+          guint query;
+
+          if (handle_type != TP_HANDLE_TYPE_CONTACT || n_fixed != 2)
+            continue;
+
+          /* ContentType, Filename, Size are mandatory. In principle we could
+           * check that the CM allows them, but not allowing them would be
+           * ridiculous, so we don't. The optional properties make no sense
+           * as fixed properties, so we assume the CM won't be ridiculous
+           * and only look for them in allowed. */
+          if (tp_strv_contains (allowed,
+                TP_PROP_CHANNEL_TYPE_FILE_TRANSFER_DESCRIPTION))
+            allowed_flags |= FT_CAP_FLAG_DESCRIPTION;
+
+          if (tp_strv_contains (allowed,
+                TP_PROP_CHANNEL_TYPE_FILE_TRANSFER_DATE))
+            allowed_flags |= FT_CAP_FLAG_DATE;
+
+          if (tp_strv_contains (allowed,
+                TP_PROP_CHANNEL_TYPE_FILE_TRANSFER_URI))
+            allowed_flags |= FT_CAP_FLAG_URI;
+
+          if (tp_strv_contains (allowed,
+                TP_PROP_CHANNEL_TYPE_FILE_TRANSFER_INITIAL_OFFSET))
+            allowed_flags |= FT_CAP_FLAG_OFFSET;
+
+          for (query = 0; query <= FT_CAP_FLAGS_ALL; query++)
+            {
+              if ((query & allowed_flags) == query)
+                self->priv->ft_queries |= (1 << query);
+            }
+        }
+      else if (chan_type == stream_tube_quark)
+        {
+          compile_tube_class (self, TUBE_TYPE_STREAM, fixed, handle_type,
+              TP_PROP_CHANNEL_TYPE_STREAM_TUBE_SERVICE);
+        }
+      else if (chan_type == dbus_tube_quark)
+        {
+          compile_tube_class (self, TUBE_TYPE_DBUS, fixed, handle_type,
+              TP_PROP_CHANNEL_TYPE_DBUS_TUBE_SERVICE_NAME);
+        }
+      else if (chan_type == room_list_quark)
+        {
+          /* only the first suitable class counts */
+          if (n_fixed != 2 || handle_type != TP_HANDLE_TYPE_NONE ||
+              (self->priv->flags & CAP_FLAG_ROOM_LIST) != 0)
+            continue;
+
+          self->priv->flags |= CAP_FLAG_ROOM_LIST;
+
+          if (tp_strv_contains (allowed,
+                TP_PROP_CHANNEL_TYPE_ROOM_LIST_SERVER))
+            self->priv->flags |= CAP_FLAG_ROOM_LIST_WITH_SERVER;
+        }
+    }
+}
+
 static void
 tp_capabilities_constructed (GObject *object)
 {
@@ -126,6 +426,8 @@ tp_capabilities_constructed (GObject *object)
 
   if (chain_up != NULL)
     chain_up (object);
+
+  compile_classes (self);
 }
 
 static void
@@ -133,6 +435,38 @@ tp_capabilities_dispose (GObject *object)
 {
   TpCapabilities *self = TP_CAPABILITIES (object);
 
+  /* Another thread may find us in the cache and take a new reference
+   * before we get the lock, so this must leave @self usable: everything
+   * else is freed in finalize. */
+  G_LOCK (capabilities_cache);
+
+  if (self->priv->cache_key != NULL)
+    {
+      g_hash_table_remove (
+          capabilities_cache[self->priv->contact_specific ? 1 : 0],
+          self->priv->cache_key);
+      tp_clear_pointer (&self->priv->cache_key, g_bytes_unref);
+    }
+
+  G_UNLOCK (capabilities_cache);
+
+  ((GObjectClass *) tp_capabilities_parent_class)->dispose (object);
+}
+
+static void
+tp_capabilities_finalize (GObject *object)
+{
+  TpCapabilities *self = TP_CAPABILITIES (object);
+  guint i;
+
+  for (i = 0; i < N_TUBE_TYPES; i++)
+    {
+      tp_clear_pointer (&self->priv->tubes[i][0].services,
+          g_hash_table_unref);
+      tp_clear_pointer (&self->priv->tubes[i][1].services,
+          g_hash_table_unref);
+    }
+
   if (self->priv->classes != NULL)
     {
       g_boxed_free (TP_ARRAY_TYPE_REQUESTABLE_CHANNEL_CLASS_LIST,
@@ -142,7 +476,7 @@ tp_capabilities_dispose (GObject *object)
 
   tp_clear_pointer (&self->priv->classes_variant, g_variant_unref);
 
-  ((GObjectClass *) tp_capabilities_parent_class)->dispose (object);
+  ((GObjectClass *) tp_capabilities_parent_class)->finalize (object);
 }
 
 static void
@@ -164,7 +498,7 @@ tp_capabilities_get_property (GObject *object,
       break;
 
     case PROP_CHANNEL_CLASSES_VARIANT:
-      g_value_set_variant (value, self->priv->classes_variant);
+      g_value_set_variant (value, get_classes_variant (self));
       break;
 
     default:
@@ -185,9 +519,6 @@ tp_capabilities_set_property (GObject *object,
     {
     case PROP_CHANNEL_CLASSES:
       self->priv->classes = g_value_dup_boxed (value);
-      self->priv->classes_variant = _tp_boxed_to_variant (
-          TP_ARRAY_TYPE_REQUESTABLE_CHANNEL_CLASS_LIST, "a(a{sv}as)",
-          self->priv->classes);
       break;
 
     case PROP_CONTACT_SPECIFIC:
@@ -211,6 +542,20 @@ tp_capabilities_class_init (TpCapabilitiesClass *klass)
   object_class->set_property = tp_capabilities_set_property;
   object_class->constructed = tp_capabilities_constructed;
   object_class->dispose = tp_capabilities_dispose;
+  object_class->finalize = tp_capabilities_finalize;
+
+  text_quark = g_quark_from_static_string (TP_IFACE_CHANNEL_TYPE_TEXT);
+  call_quark = g_quark_from_static_string (TP_IFACE_CHANNEL_TYPE_CALL);
+  ft_quark = g_quark_from_static_string (
+      TP_IFACE_CHANNEL_TYPE_FILE_TRANSFER);
+  stream_tube_quark = g_quark_from_static_string (
+      TP_IFACE_CHANNEL_TYPE_STREAM_TUBE);
+  dbus_tube_quark = g_quark_from_static_string (
+      TP_IFACE_CHANNEL_TYPE_DBUS_TUBE);
+  contact_search_quark = g_quark_from_static_string (
+      TP_IFACE_CHANNEL_TYPE_CONTACT_SEARCH);
+  room_list_quark = g_quark_from_static_string (
+      TP_IFACE_CHANNEL_TYPE_ROOM_LIST);
 
   /**
    * TpCapabilities:channel-classes:
@@ -284,13 +629,27 @@ tp_capabilities_init (TpCapabilities *self)
       TpCapabilitiesPrivate);
 }
 
-/* NULL-safe for @classes */
+/*
+ * _tp_capabilities_new:
+ * @classes: (allow-none): the requestable channel classes
+ * @contact_specific: the value of #TpCapabilities:contact-specific
+ *
+ * Return a #TpCapabilities for @classes. Contacts very often have exactly
+ * the same capabilities as each other, so if there is already a
+ * #TpCapabilities with the same classes, a new reference to it is returned
+ * instead of a new object.
+ *
+ * Returns: (transfer full): a #TpCapabilities
+ */
 TpCapabilities *
 _tp_capabilities_new (const GPtrArray *classes,
     gboolean contact_specific)
 {
   GPtrArray *empty = NULL;
   TpCapabilities *self;
+  GHashTable **cache = &capabilities_cache[contact_specific ? 1 : 0];
+  GVariant *variant;
+  GBytes *key;
 
   if (classes == NULL)
     {
@@ -298,55 +657,50 @@ _tp_capabilities_new (const GPtrArray *classes,
       classes = empty;
     }
 
-  self = g_object_new (TP_TYPE_CAPABILITIES,
-      "channel-classes", classes,
-      "contact-specific", contact_specific,
-      NULL);
-
-  if (empty != NULL)
-    g_ptr_array_unref (empty);
+  variant = _tp_boxed_to_variant (TP_ARRAY_TYPE_REQUESTABLE_CHANNEL_CLASS_LIST,
+      "a(a{sv}as)", (gpointer) classes);
+  key = g_variant_get_data_as_bytes (variant);
 
-  return self;
-}
+  G_LOCK (capabilities_cache);
 
-static gboolean
-supports_simple_channel (TpCapabilities *self,
-    const gchar *expected_chan_type,
-    TpHandleType expected_handle_type)
-{
-  guint i;
+  if (*cache != NULL)
+    {
+      self = g_hash_table_lookup (*cache, key);
 
-  g_return_val_if_fail (TP_IS_CAPABILITIES (self), FALSE);
+      if (self != NULL)
+        {
+          g_object_ref (self);
+          G_UNLOCK (capabilities_cache);
 
-  for (i = 0; i < self->priv->classes->len; i++)
+          g_bytes_unref (key);
+          g_variant_unref (variant);
+          tp_clear_pointer (&empty, g_ptr_array_unref);
+          return self;
+        }
+    }
+  else
     {
-      GValueArray *arr = g_ptr_array_index (self->priv->classes, i);
-      GHashTable *fixed;
-      const gchar * const *allowed;
-      const gchar *chan_type;
-      TpHandleType handle_type;
-      gboolean valid;
-
-      tp_value_array_unpack (arr, 2,
-          &fixed,
-          &allowed);
+      *cache = g_hash_table_new_full (g_bytes_hash, g_bytes_equal,
+          (GDestroyNotify) g_bytes_unref, NULL);
+    }
 
-      if (g_hash_table_size (fixed) != 2)
-        continue;
+  self = g_object_new (TP_TYPE_CAPABILITIES,
+      "channel-classes", classes,
+      "contact-specific", contact_specific,
+      NULL);
 
-      chan_type = tp_asv_get_string (fixed, TP_PROP_CHANNEL_CHANNEL_TYPE);
-      handle_type = tp_asv_get_uint32 (fixed,
-          TP_PROP_CHANNEL_TARGET_HANDLE_TYPE, &valid);
+  /* the key is the serialized classes, so there's no need to serialize
+   * them again for TpCapabilities:channel-classes-variant */
+  self->priv->classes_variant = variant;
+  self->priv->cache_key = g_bytes_ref (key);
+  g_hash_table_insert (*cache, key, self);
 
-      if (!valid)
-        continue;
+  G_UNLOCK (capabilities_cache);
 
-      if (!tp_strdiff (chan_type, expected_chan_type) &&
-          handle_type == expected_handle_type)
-        return TRUE;
-    }
+  if (empty != NULL)
+    g_ptr_array_unref (empty);
 
-  return FALSE;
+  return self;
 }
 
 /**
@@ -371,8 +725,9 @@ supports_simple_channel (TpCapabilities *self,
 gboolean
 tp_capabilities_supports_text_chats (TpCapabilities *self)
 {
-  return supports_simple_channel (self, TP_IFACE_CHANNEL_TYPE_TEXT,
-      TP_HANDLE_TYPE_CONTACT);
+  g_return_val_if_fail (TP_IS_CAPABILITIES (self), FALSE);
+
+  return ((self->priv->flags & CAP_FLAG_TEXT_CHATS) != 0);
 }
 
 /**
@@ -402,8 +757,9 @@ tp_capabilities_supports_text_chats (TpCapabilities *self)
 gboolean
 tp_capabilities_supports_text_chatrooms (TpCapabilities *self)
 {
-  return supports_simple_channel (self, TP_IFACE_CHANNEL_TYPE_TEXT,
-      TP_HANDLE_TYPE_ROOM);
+  g_return_val_if_fail (TP_IS_CAPABILITIES (self), FALSE);
+
+  return ((self->priv->flags & CAP_FLAG_TEXT_CHATROOMS) != 0);
 }
 
 /**
@@ -428,132 +784,22 @@ tp_capabilities_supports_text_chatrooms (TpCapabilities *self)
 gboolean
 tp_capabilities_supports_sms (TpCapabilities *self)
 {
-  guint i;
-
   g_return_val_if_fail (TP_IS_CAPABILITIES (self), FALSE);
 
-  for (i = 0; i < self->priv->classes->len; i++)
-    {
-      GValueArray *arr = g_ptr_array_index (self->priv->classes, i);
-      GHashTable *fixed;
-      const gchar * const *allowed;
-      const gchar *chan_type;
-      TpHandleType handle_type;
-      gboolean valid;
-      guint nb_fixed_props;
-
-      tp_value_array_unpack (arr, 2,
-          &fixed,
-          &allowed);
-
-      handle_type = tp_asv_get_uint32 (fixed,
-          TP_PROP_CHANNEL_TARGET_HANDLE_TYPE, &valid);
-
-      if (!valid)
-        continue;
-
-      if (handle_type != TP_HANDLE_TYPE_CONTACT)
-        continue;
-
-      chan_type = tp_asv_get_string (fixed, TP_PROP_CHANNEL_CHANNEL_TYPE);
-
-      if (tp_strdiff (chan_type, TP_IFACE_CHANNEL_TYPE_TEXT))
-        continue;
-
-      /* SMSChannel be either in fixed or allowed properties */
-      if (tp_asv_get_boolean (fixed, TP_PROP_CHANNEL_INTERFACE_SMS_SMS_CHANNEL,
-            NULL))
-        {
-          /* In fixed, succeed if there is no more fixed properties required */
-          nb_fixed_props = 3;
-        }
-      else
-        {
-          /* Not in fixed; check allowed */
-          if (!tp_strv_contains (allowed,
-                TP_PROP_CHANNEL_INTERFACE_SMS_SMS_CHANNEL))
-            continue;
-
-          nb_fixed_props = 2;
-        }
-
-      if (g_hash_table_size (fixed) == nb_fixed_props)
-        return TRUE;
-    }
-
-  return FALSE;
-
+  return ((self->priv->flags & CAP_FLAG_SMS) != 0);
 }
 
 static gboolean
 supports_call_full (TpCapabilities *self,
     TpHandleType expected_handle_type,
-    gboolean expected_initial_audio,
-    gboolean expected_initial_video)
+    CallCapFlags expected_flag)
 {
-  guint i;
-
   g_return_val_if_fail (TP_IS_CAPABILITIES (self), FALSE);
 
-  for (i = 0; i < self->priv->classes->len; i++)
-    {
-      GValueArray *arr = g_ptr_array_index (self->priv->classes, i);
-      GHashTable *fixed_prop;
-      const gchar * const *allowed_prop;
-      const gchar *chan_type;
-      TpHandleType handle_type;
-      gboolean valid;
-      guint nb_fixed_props = 2;
-
-      tp_value_array_unpack (arr, 2,
-          &fixed_prop,
-          &allowed_prop);
-
-      chan_type = tp_asv_get_string (fixed_prop, TP_PROP_CHANNEL_CHANNEL_TYPE);
-      if (tp_strdiff (chan_type, TP_IFACE_CHANNEL_TYPE_CALL))
-        continue;
+  if (expected_handle_type >= TP_NUM_HANDLE_TYPES)
+    return FALSE;
 
-      handle_type = tp_asv_get_uint32 (fixed_prop,
-          TP_PROP_CHANNEL_TARGET_HANDLE_TYPE, &valid);
-      if (!valid || handle_type != expected_handle_type)
-        continue;
-
-      if (expected_initial_audio)
-        {
-          /* We want audio, INITIAL_AUDIO must be in either fixed or allowed */
-          if (tp_asv_get_boolean (fixed_prop,
-                  TP_PROP_CHANNEL_TYPE_CALL_INITIAL_AUDIO, NULL))
-            {
-              nb_fixed_props++;
-            }
-          else if (!tp_strv_contains (allowed_prop,
-                  TP_PROP_CHANNEL_TYPE_CALL_INITIAL_AUDIO))
-            {
-              continue;
-            }
-        }
-
-      if (expected_initial_video)
-        {
-          /* We want video, INITIAL_VIDEO must be in either fixed or allowed */
-          if (tp_asv_get_boolean (fixed_prop,
-                  TP_PROP_CHANNEL_TYPE_CALL_INITIAL_VIDEO, NULL))
-            {
-              nb_fixed_props++;
-            }
-          else if (!tp_strv_contains (allowed_prop,
-                  TP_PROP_CHANNEL_TYPE_CALL_INITIAL_VIDEO))
-            {
-              continue;
-            }
-        }
-
-      /* We found the right class */
-      if (g_hash_table_size (fixed_prop) == nb_fixed_props)
-        return TRUE;
-    }
-
-  return FALSE;
+  return ((self->priv->call_flags[expected_handle_type] & expected_flag) != 0);
 }
 
 /**
@@ -581,7 +827,7 @@ gboolean
 tp_capabilities_supports_audio_call (TpCapabilities *self,
     TpHandleType handle_type)
 {
-  return supports_call_full (self, handle_type, TRUE, FALSE);
+  return supports_call_full (self, handle_type, CALL_CAP_FLAG_AUDIO);
 }
 
 /**
@@ -611,96 +857,16 @@ gboolean
 tp_capabilities_supports_audio_video_call (TpCapabilities *self,
     TpHandleType handle_type)
 {
-  return supports_call_full (self, handle_type, TRUE, TRUE);
+  return supports_call_full (self, handle_type, CALL_CAP_FLAG_AUDIO_VIDEO);
 }
 
-typedef enum {
-    FT_CAP_FLAGS_NONE = 0,
-    FT_CAP_FLAG_URI = (1<<0),
-    FT_CAP_FLAG_OFFSET = (1<<1),
-    FT_CAP_FLAG_DATE = (1<<2),
-    FT_CAP_FLAG_DESCRIPTION = (1<<3)
-} FTCapFlags;
-
 static gboolean
 supports_file_transfer (TpCapabilities *self,
     FTCapFlags flags)
 {
-  guint i;
-
   g_return_val_if_fail (TP_IS_CAPABILITIES (self), FALSE);
 
-  for (i = 0; i < self->priv->classes->len; i++)
-    {
-      GValueArray *arr = g_ptr_array_index (self->priv->classes, i);
-      GHashTable *fixed;
-      const gchar *chan_type;
-      TpHandleType handle_type;
-      gboolean valid;
-      guint n_fixed = 2;
-      const gchar * const *allowed;
-
-      tp_value_array_unpack (arr, 2, &fixed, &allowed);
-
-      chan_type = tp_asv_get_string (fixed, TP_PROP_CHANNEL_CHANNEL_TYPE);
-
-      if (tp_strdiff (chan_type, TP_IFACE_CHANNEL_TYPE_FILE_TRANSFER))
-        continue;
-
-      handle_type = tp_asv_get_uint32 (fixed,
-          TP_PROP_CHANNEL_TARGET_HANDLE_TYPE, &valid);
-
-      if (!valid)
-        continue;
-
-      if (handle_type != TP_HANDLE_TYPE_CONTACT)
-        continue;
-
-      /* ContentType, Filename, Size are mandatory. In principle we could check
-       * that the CM allows them, but not allowing them would be ridiculous,
-       * so we don't.
-       */
-
-      if ((flags & FT_CAP_FLAG_DESCRIPTION) != 0)
-        {
-          /* Description makes no sense as a fixed property so we assume
-           * the CM won't be ridiculous */
-          if (!tp_strv_contains (allowed,
-                TP_PROP_CHANNEL_TYPE_FILE_TRANSFER_DESCRIPTION))
-            continue;
-        }
-
-      if ((flags & FT_CAP_FLAG_DATE) != 0)
-        {
-          /* makes no sense as a fixed property */
-          if (!tp_strv_contains (allowed,
-                TP_PROP_CHANNEL_TYPE_FILE_TRANSFER_DATE))
-            continue;
-        }
-
-      if ((flags & FT_CAP_FLAG_URI) != 0)
-        {
-          /* makes no sense as a fixed property */
-          if (!tp_strv_contains (allowed,
-                TP_PROP_CHANNEL_TYPE_FILE_TRANSFER_URI))
-            continue;
-        }
-
-      if ((flags & FT_CAP_FLAG_OFFSET) != 0)
-        {
-          /* makes no sense as a fixed property */
-          if (!tp_strv_contains (allowed,
-                TP_PROP_CHANNEL_TYPE_FILE_TRANSFER_INITIAL_OFFSET))
-            continue;
-        }
-
-      if (n_fixed != tp_asv_size (fixed))
-        continue;
-
-      return TRUE;
-    }
-
-  return FALSE;
+  return ((self->priv->ft_queries & (1 << flags)) != 0);
 }
 
 /**
@@ -798,55 +964,25 @@ tp_capabilities_supports_file_transfer_timestamp (TpCapabilities *self)
 
 static gboolean
 tp_capabilities_supports_tubes_common (TpCapabilities *self,
-    const gchar *expected_channel_type,
+    TubeType tube_type,
     TpHandleType expected_handle_type,
-    const gchar *service_prop,
     const gchar *expected_service)
 {
-  guint i;
+  TubeClasses *tubes;
 
   g_return_val_if_fail (TP_IS_CAPABILITIES (self), FALSE);
   g_return_val_if_fail (expected_handle_type == TP_HANDLE_TYPE_CONTACT ||
       expected_handle_type == TP_HANDLE_TYPE_ROOM, FALSE);
 
-  for (i = 0; i < self->priv->classes->len; i++)
-    {
-      GValueArray *arr = g_ptr_array_index (self->priv->classes, i);
-      GHashTable *fixed;
-      const gchar * const *allowed;
-      const gchar *chan_type;
-      TpHandleType handle_type;
-      gboolean valid;
-      guint nb_fixed_props = 2;
-
-      tp_value_array_unpack (arr, 2,
-          &fixed,
-          &allowed);
-
-      chan_type = tp_asv_get_string (fixed, TP_PROP_CHANNEL_CHANNEL_TYPE);
-      if (tp_strdiff (chan_type, expected_channel_type))
-        continue;
-
-      handle_type = tp_asv_get_uint32 (fixed,
-          TP_PROP_CHANNEL_TARGET_HANDLE_TYPE, &valid);
-      if (!valid || handle_type != expected_handle_type)
-        continue;
-
-      if (expected_service != NULL && self->priv->contact_specific)
-        {
-          const gchar *service;
-
-          nb_fixed_props++;
-          service = tp_asv_get_string (fixed, service_prop);
-          if (tp_strdiff (service, expected_service))
-            continue;
-        }
+  tubes = &self->priv->tubes[tube_type]
+      [expected_handle_type == TP_HANDLE_TYPE_CONTACT ? 0 : 1];
 
-      if (g_hash_table_size (fixed) == nb_fixed_props)
-        return TRUE;
-    }
+  /* The service is only meaningful for a contact */
+  if (expected_service != NULL && self->priv->contact_specific)
+    return (tubes->services != NULL &&
+        g_hash_table_contains (tubes->services, expected_service));
 
-  return FALSE;
+  return tubes->any_service;
 }
 
 /**
@@ -876,9 +1012,8 @@ tp_capabilities_supports_stream_tubes (TpCapabilities *self,
     TpHandleType handle_type,
     const gchar *service)
 {
-  return tp_capabilities_supports_tubes_common (self,
-      TP_IFACE_CHANNEL_TYPE_STREAM_TUBE, handle_type,
-      TP_PROP_CHANNEL_TYPE_STREAM_TUBE_SERVICE, service);
+  return tp_capabilities_supports_tubes_common (self, TUBE_TYPE_STREAM,
+      handle_type, service);
 }
 
 /**
@@ -909,9 +1044,8 @@ tp_capabilities_supports_dbus_tubes (TpCapabilities *self,
     TpHandleType handle_type,
     const gchar *service_name)
 {
-  return tp_capabilities_supports_tubes_common (self,
-      TP_IFACE_CHANNEL_TYPE_DBUS_TUBE, handle_type,
-      TP_PROP_CHANNEL_TYPE_DBUS_TUBE_SERVICE_NAME, service_name);
+  return tp_capabilities_supports_tubes_common (self, TUBE_TYPE_DBUS,
+      handle_type, service_name);
 }
 
 /**
@@ -938,57 +1072,17 @@ tp_capabilities_supports_contact_search (TpCapabilities *self,
     gboolean *with_limit,
     gboolean *with_server)
 {
-  gboolean ret = FALSE;
-  guint i, j;
-
   g_return_val_if_fail (TP_IS_CAPABILITIES (self), FALSE);
 
   if (with_limit)
-    *with_limit = FALSE;
+    *with_limit =
+        ((self->priv->flags & CAP_FLAG_CONTACT_SEARCH_WITH_LIMIT) != 0);
 
   if (with_server)
-    *with_server = FALSE;
-
-  for (i = 0; i < self->priv->classes->len; i++)
-    {
-      GValueArray *arr = g_ptr_array_index (self->priv->classes, i);
-      GHashTable *fixed;
-      const gchar *chan_type;
-      const gchar **allowed_properties;
-
-      tp_value_array_unpack (arr, 2, &fixed, &allowed_properties);
-
-      /* ContactSearch channel should have ChannelType and TargetHandleType=NONE
-       * but CM implementations are wrong and omitted TargetHandleType,
-       * so it's set in stone now.  */
-      if (g_hash_table_size (fixed) != 1)
-        continue;
-
-      chan_type = tp_asv_get_string (fixed, TP_PROP_CHANNEL_CHANNEL_TYPE);
-      if (tp_strdiff (chan_type, TP_IFACE_CHANNEL_TYPE_CONTACT_SEARCH))
-        continue;
-
-      ret = TRUE;
-
-      for (j = 0; allowed_properties[j] != NULL; j++)
-        {
-          if (with_limit)
-            {
-              if (!tp_strdiff (allowed_properties[j],
-                       TP_PROP_CHANNEL_TYPE_CONTACT_SEARCH_LIMIT))
-                *with_limit = TRUE;
-            }
+    *with_server =
+        ((self->priv->flags & CAP_FLAG_CONTACT_SEARCH_WITH_SERVER) != 0);
 
-          if (with_server)
-            {
-              if (!tp_strdiff (allowed_properties[j],
-                       TP_PROP_CHANNEL_TYPE_CONTACT_SEARCH_SERVER))
-                *with_server = TRUE;
-            }
-        }
-    }
-
-  return ret;
+  return ((self->priv->flags & CAP_FLAG_CONTACT_SEARCH) != 0);
 }
 
 /**
@@ -1044,44 +1138,11 @@ gboolean
 tp_capabilities_supports_room_list (TpCapabilities *self,
     gboolean *with_server)
 {
-  gboolean result = FALSE;
-  gboolean server = FALSE;
-  guint i;
-
-  for (i = 0; i < self->priv->classes->len; i++)
-    {
-      GValueArray *arr = g_ptr_array_index (self->priv->classes, i);
-      GHashTable *fixed;
-      const gchar *chan_type;
-      const gchar **allowed_properties;
-      TpHandleType handle_type;
-      gboolean valid;
-
-      tp_value_array_unpack (arr, 2, &fixed, &allowed_properties);
-
-      if (g_hash_table_size (fixed) != 2)
-        continue;
-
-      chan_type = tp_asv_get_string (fixed, TP_PROP_CHANNEL_CHANNEL_TYPE);
-      if (tp_strdiff (chan_type, TP_IFACE_CHANNEL_TYPE_ROOM_LIST))
-        continue;
-
-      handle_type = tp_asv_get_uint32 (fixed,
-          TP_PROP_CHANNEL_TARGET_HANDLE_TYPE, &valid);
-      if (!valid || handle_type != TP_HANDLE_TYPE_NONE)
-        continue;
-
-      result = TRUE;
-
-      server = tp_strv_contains (allowed_properties,
-          TP_PROP_CHANNEL_TYPE_ROOM_LIST_SERVER);
-      break;
-    }
-
   if (with_server != NULL)
-    *with_server = server;
+    *with_server =
+        ((self->priv->flags & CAP_FLAG_ROOM_LIST_WITH_SERVER) != 0);
 
-  return result;
+  return ((self->priv->flags & CAP_FLAG_ROOM_LIST) != 0);
 }
 
 /**
@@ -1098,5 +1159,5 @@ tp_capabilities_supports_room_list (TpCapabilities *self,
 GVariant *
 tp_capabilities_dup_channel_classes_variant (TpCapabilities *self)
 {
-  return g_variant_ref (self->priv->classes_variant);
+  return g_variant_ref (get_classes_variant (self));
 }
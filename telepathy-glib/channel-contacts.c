@@ -258,19 +258,28 @@ static void
 contacts_queue_head_ready (TpChannel *self,
     const GError *error)
 {
-  GSimpleAsyncResult *result = self->priv->current_contacts_queue_result;
+  GPtrArray *batch = self->priv->current_contacts_queue_batch;
+  guint i;
 
   if (error != NULL)
+    DEBUG ("Error preparing channel contacts queue item: %s", error->message);
+
+  /* Items queued by the callbacks wait until the whole batch has been
+   * completed, so they can't overtake it */
+  for (i = 0; i < batch->len; i++)
     {
-      DEBUG ("Error preparing channel contacts queue item: %s", error->message);
-      g_simple_async_result_set_from_error (result, error);
+      GSimpleAsyncResult *result = g_ptr_array_index (batch, i);
+
+      if (error != NULL)
+        g_simple_async_result_set_from_error (result, error);
+
+      g_simple_async_result_complete (result);
     }
-  g_simple_async_result_complete (result);
 
-  self->priv->current_contacts_queue_result = NULL;
+  self->priv->current_contacts_queue_batch = NULL;
   process_contacts_queue (self);
 
-  g_object_unref (result);
+  g_ptr_array_unref (batch);
 }
 
 static void
@@ -343,6 +352,17 @@ contacts_queue_item_idle_cb (gpointer user_data)
   return FALSE;
 }
 
+/* Items which already have their TpContact objects, such as the ones queued
+ * for MembersChanged, just need those contacts to be upgraded; items which
+ * only have identifiers or handles need a request of their own to find out
+ * which contacts they get. */
+static gboolean
+contacts_queue_item_is_upgrade (ContactsQueueItem *item)
+{
+  return ((item->ids == NULL || item->ids->len == 0) &&
+      (item->handles == NULL || item->handles->len == 0));
+}
+
 static void
 process_contacts_queue (TpChannel *self)
 {
@@ -351,7 +371,7 @@ process_contacts_queue (TpChannel *self)
   GArray *features;
   const GError *error = NULL;
 
-  if (self->priv->current_contacts_queue_result != NULL)
+  if (self->priv->current_contacts_queue_batch != NULL)
     return;
 
   /* self can't die while there are queued items because item->result keeps a
@@ -376,7 +396,9 @@ process_contacts_queue (TpChannel *self)
   if (result == NULL)
     return;
 
-  self->priv->current_contacts_queue_result = result;
+  self->priv->current_contacts_queue_batch = g_ptr_array_new_with_free_func (
+      g_object_unref);
+  g_ptr_array_add (self->priv->current_contacts_queue_batch, result);
   item = g_simple_async_result_get_op_res_gpointer (result);
 
   features = tp_simple_client_factory_dup_contact_features (
@@ -386,17 +408,70 @@ process_contacts_queue (TpChannel *self)
    * CMs. by_id and by_handle are used only by TpTextChannel and are needed for
    * older CMs that does not give both message-sender and message-sender-id */
   G_GNUC_BEGIN_IGNORE_DEPRECATIONS
-  if (item->contacts != NULL && item->contacts->len > 0)
+  if (contacts_queue_item_is_upgrade (item))
     {
-      g_assert (item->ids == NULL);
-      g_assert (item->handles == NULL);
+      /* When a big room is joined, the CM may well emit MembersChanged once
+       * per member. Rather than waiting for a round-trip per signal, take
+       * every consecutive item that only needs upgrading, and upgrade the
+       * union of their contacts at once; the items still complete
+       * separately, in order. */
+      GHashTable *seen = g_hash_table_new (NULL, NULL);
+      GPtrArray *contacts = g_ptr_array_new ();
+
+      while (TRUE)
+        {
+          guint i;
 
-      tp_connection_upgrade_contacts (self->priv->connection,
-          item->contacts->len, (TpContact **) item->contacts->pdata,
-          features->len, (TpContactFeature *) features->data,
-          contacts_queue_item_upgraded_cb,
-          item, NULL,
-          (GObject *) self);
+          for (i = 0; item->contacts != NULL && i < item->contacts->len; i++)
+            {
+              TpContact *contact = g_ptr_array_index (item->contacts, i);
+
+              if (!g_hash_table_contains (seen, contact))
+                {
+                  g_hash_table_add (seen, contact);
+                  g_ptr_array_add (contacts, contact);
+                }
+            }
+
+          result = g_queue_peek_head (self->priv->contacts_queue);
+
+          if (result == NULL)
+            break;
+
+          item = g_simple_async_result_get_op_res_gpointer (result);
+
+          if (!contacts_queue_item_is_upgrade (item))
+            break;
+
+          g_ptr_array_add (self->priv->current_contacts_queue_batch,
+              g_queue_pop_head (self->priv->contacts_queue));
+        }
+
+      if (self->priv->current_contacts_queue_batch->len > 1)
+        DEBUG ("Upgrading %u contacts for %u queued items", contacts->len,
+            self->priv->current_contacts_queue_batch->len);
+
+      if (contacts->len > 0)
+        {
+          /* the items keep the contacts alive until the batch is done */
+          tp_connection_upgrade_contacts (self->priv->connection,
+              contacts->len, (TpContact **) contacts->pdata,
+              features->len, (TpContactFeature *) features->data,
+              contacts_queue_item_upgraded_cb,
+              NULL, NULL,
+              (GObject *) self);
+        }
+      else
+        {
+          /* It can happen there is no contact to prepare, and can still be
+           * useful in order to not reorder some events.
+           * We have to use an idle though, to guarantee callback is never
+           * called without reentering mainloop first. */
+          g_idle_add (contacts_queue_item_idle_cb, self);
+        }
+
+      g_ptr_array_unref (contacts);
+      g_hash_table_unref (seen);
     }
   else if (item->ids != NULL && item->ids->len > 0)
     {
@@ -410,10 +485,11 @@ process_contacts_queue (TpChannel *self)
           item, NULL,
           (GObject *) self);
     }
-  else if (item->handles != NULL && item->handles->len > 0)
+  else
     {
       g_assert (item->contacts == NULL);
       g_assert (item->ids == NULL);
+      g_assert (item->handles != NULL && item->handles->len > 0);
 
       tp_connection_get_contacts_by_handle (self->priv->connection,
           item->handles->len, (TpHandle *) item->handles->data,
@@ -422,14 +498,6 @@ process_contacts_queue (TpChannel *self)
           item, NULL,
           (GObject *) self);
     }
-  else
-    {
-      /* It can happen there is no contact to prepare, and can still be useful
-       * in order to not reorder some events.
-       * We have to use an idle though, to guarantee callback is never called
-       * without reentering mainloop first. */
-      g_idle_add (contacts_queue_item_idle_cb, self);
-    }
   G_GNUC_END_IGNORE_DEPRECATIONS
 
   g_array_unref (features);
@@ -0,0 +1,41 @@
+/*<private_header>*/
+/* Compiled index of channel filters - internal header
+ *
+ * Copyright © 2014 Collabora Ltd.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#ifndef __TP_CHANNEL_FILTER_INDEX_INTERNAL_H__
+#define __TP_CHANNEL_FILTER_INDEX_INTERNAL_H__
+
+#include <glib.h>
+
+G_BEGIN_DECLS
+
+typedef struct _TpChannelFilterIndex TpChannelFilterIndex;
+
+TpChannelFilterIndex *_tp_channel_filter_index_new (void);
+void _tp_channel_filter_index_free (TpChannelFilterIndex *self);
+
+void _tp_channel_filter_index_add (TpChannelFilterIndex *self,
+    GHashTable *filter);
+
+gboolean _tp_channel_filter_index_matches (TpChannelFilterIndex *self,
+    GHashTable *properties);
+
+G_END_DECLS
+
+#endif
@@ -0,0 +1,471 @@
+/*
+ * Compiled index of channel filters
+ *
+ * Copyright © 2014 Collabora Ltd.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include "config.h"
+
+#include "telepathy-glib/channel-filter-index-internal.h"
+
+#include <dbus/dbus-glib.h>
+
+#include <telepathy-glib/dbus.h>
+#include <telepathy-glib/gtypes.h>
+#include <telepathy-glib/interfaces.h>
+#include <telepathy-glib/util.h>
+
+/*
+ * A channel filter (a %TP_HASH_TYPE_CHANNEL_CLASS) matches a channel if
+ * every property in the filter is present in the channel's immutable
+ * properties, with an equal value. Integers of different D-Bus types
+ * compare equal if they have the same numeric value.
+ *
+ * Nearly every filter constrains ChannelType and TargetHandleType, so
+ * filters are compiled into buckets keyed by those two properties, with
+ * the rest of the filter kept as a short list of typed predicates. Matching
+ * a channel looks up at most four buckets and checks the predicates of the
+ * filters in them, so filters for other channel types are skipped without
+ * looking at their values. Within a bucket matching is still linear. Each
+ * TpBaseClient has its own index for each of its roles, and all it needs
+ * to know is whether any filter matches.
+ */
+
+typedef enum {
+    PREDICATE_STRING,
+    PREDICATE_OBJECT_PATH,
+    PREDICATE_BOOLEAN,
+    /* any integer type, with a non-negative value */
+    PREDICATE_UNSIGNED,
+    /* any integer type, with a negative value */
+    PREDICATE_SIGNED,
+    /* anything else: compared as a GVariant, if the GType matches */
+    PREDICATE_OTHER
+} PredicateType;
+
+typedef struct {
+    gchar *key;
+    PredicateType type;
+    /* only used by PREDICATE_OTHER */
+    GType gtype;
+    union {
+        gchar *s;
+        gboolean b;
+        guint64 u;
+        gint64 i;
+        GVariant *v;
+    } value;
+} Predicate;
+
+typedef struct {
+    /* Predicate for each property other than the bucket key */
+    GArray *predicates;
+} CompiledFilter;
+
+typedef struct {
+    /* 0 if the filter does not constrain ChannelType */
+    GQuark channel_type;
+    /* TRUE if the filter does not constrain TargetHandleType */
+    gboolean any_handle_type;
+    guint32 handle_type;
+} BucketKey;
+
+typedef struct {
+    BucketKey key;
+    /* owned CompiledFilter */
+    GPtrArray *filters;
+} Bucket;
+
+struct _TpChannelFilterIndex {
+    /* borrowed &bucket->key => owned Bucket */
+    GHashTable *buckets;
+};
+
+static guint
+bucket_key_hash (gconstpointer p)
+{
+  const BucketKey *key = p;
+
+  return key->channel_type * 1000003u +
+      (key->any_handle_type ? G_MAXUINT32 : key->handle_type);
+}
+
+static gboolean
+bucket_key_equal (gconstpointer a,
+    gconstpointer b)
+{
+  const BucketKey *ka = a;
+  const BucketKey *kb = b;
+
+  return (ka->channel_type == kb->channel_type &&
+      ka->any_handle_type == kb->any_handle_type &&
+      ka->handle_type == kb->handle_type);
+}
+
+static void
+predicate_clear (Predicate *pred)
+{
+  g_free (pred->key);
+
+  switch (pred->type)
+    {
+      case PREDICATE_STRING:
+      case PREDICATE_OBJECT_PATH:
+        g_free (pred->value.s);
+        break;
+
+      case PREDICATE_OTHER:
+        g_variant_unref (pred->value.v);
+        break;
+
+      default:
+        break;
+    }
+}
+
+static void
+predicate_init (Predicate *pred,
+    const gchar *key,
+    const GValue *value)
+{
+  GType gtype = G_VALUE_TYPE (value);
+
+  pred->key = g_strdup (key);
+  pred->gtype = gtype;
+
+  if (gtype == G_TYPE_STRING)
+    {
+      pred->type = PREDICATE_STRING;
+      pred->value.s = g_value_dup_string (value);
+    }
+  else if (gtype == DBUS_TYPE_G_OBJECT_PATH)
+    {
+      pred->type = PREDICATE_OBJECT_PATH;
+      pred->value.s = g_value_dup_boxed (value);
+    }
+  else if (gtype == G_TYPE_BOOLEAN)
+    {
+      pred->type = PREDICATE_BOOLEAN;
+      pred->value.b = g_value_get_boolean (value);
+    }
+  else if (gtype == G_TYPE_UCHAR)
+    {
+      pred->type = PREDICATE_UNSIGNED;
+      pred->value.u = g_value_get_uchar (value);
+    }
+  else if (gtype == G_TYPE_UINT)
+    {
+      pred->type = PREDICATE_UNSIGNED;
+      pred->value.u = g_value_get_uint (value);
+    }
+  else if (gtype == G_TYPE_UINT64)
+    {
+      pred->type = PREDICATE_UNSIGNED;
+      pred->value.u = g_value_get_uint64 (value);
+    }
+  else if (gtype == G_TYPE_INT || gtype == G_TYPE_INT64)
+    {
+      gint64 i = (gtype == G_TYPE_INT ? g_value_get_int (value) :
+          g_value_get_int64 (value));
+
+      if (i >= 0)
+        {
+          pred->type = PREDICATE_UNSIGNED;
+          pred->value.u = i;
+        }
+      else
+        {
+          pred->type = PREDICATE_SIGNED;
+          pred->value.i = i;
+        }
+    }
+  else
+    {
+      pred->type = PREDICATE_OTHER;
+      pred->value.v = g_variant_ref_sink (
+          dbus_g_value_build_g_variant (value));
+    }
+}
+
+static gboolean
+predicate_matches (const Predicate *pred,
+    GHashTable *properties)
+{
+  const GValue *value;
+  gboolean valid;
+
+  switch (pred->type)
+    {
+      case PREDICATE_UNSIGNED:
+        return (tp_asv_get_uint64 (properties, pred->key, &valid) ==
+            pred->value.u && valid);
+
+      case PREDICATE_SIGNED:
+        return (tp_asv_get_int64 (properties, pred->key, &valid) ==
+            pred->value.i && valid);
+
+      default:
+        break;
+    }
+
+  value = tp_asv_lookup (properties, pred->key);
+
+  if (value == NULL || G_VALUE_TYPE (value) != pred->gtype)
+    return FALSE;
+
+  switch (pred->type)
+    {
+      case PREDICATE_STRING:
+        return !tp_strdiff (g_value_get_string (value), pred->value.s);
+
+      case PREDICATE_OBJECT_PATH:
+        return !tp_strdiff (g_value_get_boxed (value), pred->value.s);
+
+      case PREDICATE_BOOLEAN:
+        return (!g_value_get_boolean (value) == !pred->value.b);
+
+      case PREDICATE_OTHER:
+        {
+          GVariant *v = g_variant_ref_sink (
+              dbus_g_value_build_g_variant (value));
+          gboolean ret = g_variant_equal (v, pred->value.v);
+
+          g_variant_unref (v);
+          return ret;
+        }
+
+      default:
+        g_return_val_if_reached (FALSE);
+    }
+}
+
+static void
+compiled_filter_free (gpointer p)
+{
+  CompiledFilter *filter = p;
+
+  g_array_unref (filter->predicates);
+  g_slice_free (CompiledFilter, filter);
+}
+
+static CompiledFilter *
+compiled_filter_new (GHashTable *filter,
+    BucketKey *key)
+{
+  CompiledFilter *compiled = g_slice_new0 (CompiledFilter);
+  GHashTableIter iter;
+  gpointer k, v;
+
+  compiled->predicates = g_array_new (FALSE, FALSE, sizeof (Predicate));
+  g_array_set_clear_func (compiled->predicates,
+      (GDestroyNotify) predicate_clear);
+
+  key->channel_type = 0;
+  key->any_handle_type = TRUE;
+  key->handle_type = 0;
+
+  g_hash_table_iter_init (&iter, filter);
+
+  while (g_hash_table_iter_next (&iter, &k, &v))
+    {
+      Predicate pred;
+
+      if (!tp_strdiff (k, TP_PROP_CHANNEL_CHANNEL_TYPE))
+        {
+          const gchar *type = tp_asv_get_string (filter, k);
+
+          if (type != NULL)
+            {
+              key->channel_type = g_quark_from_string (type);
+              continue;
+            }
+        }
+      else if (!tp_strdiff (k, TP_PROP_CHANNEL_TARGET_HANDLE_TYPE))
+        {
+          gboolean valid;
+          guint32 handle_type = tp_asv_get_uint32 (filter, k, &valid);
+
+          if (valid)
+            {
+              key->any_handle_type = FALSE;
+              key->handle_type = handle_type;
+              continue;
+            }
+        }
+
+      /* anything that can't be part of the bucket key is checked per
+       * filter */
+      predicate_init (&pred, k, v);
+      g_array_append_val (compiled->predicates, pred);
+    }
+
+  return compiled;
+}
+
+static gboolean
+compiled_filter_matches (const CompiledFilter *filter,
+    GHashTable *properties)
+{
+  guint i;
+
+  for (i = 0; i < filter->predicates->len; i++)
+    {
+      if (!predicate_matches (&g_array_index (filter->predicates, Predicate,
+              i), properties))
+        return FALSE;
+    }
+
+  return TRUE;
+}
+
+static void
+bucket_free (gpointer p)
+{
+  Bucket *bucket = p;
+
+  g_ptr_array_unref (bucket->filters);
+  g_slice_free (Bucket, bucket);
+}
+
+TpChannelFilterIndex *
+_tp_channel_filter_index_new (void)
+{
+  TpChannelFilterIndex *self = g_slice_new0 (TpChannelFilterIndex);
+
+  self->buckets = g_hash_table_new_full (bucket_key_hash, bucket_key_equal,
+      NULL, bucket_free);
+  return self;
+}
+
+void
+_tp_channel_filter_index_free (TpChannelFilterIndex *self)
+{
+  g_hash_table_unref (self->buckets);
+  g_slice_free (TpChannelFilterIndex, self);
+}
+
+/*
+ * _tp_channel_filter_index_add:
+ * @self: an index
+ * @filter: (transfer none): a %TP_HASH_TYPE_CHANNEL_CLASS
+ *
+ * Compile @filter into @self. @filter is not used after this function
+ * returns.
+ */
+void
+_tp_channel_filter_index_add (TpChannelFilterIndex *self,
+    GHashTable *filter)
+{
+  BucketKey key;
+  CompiledFilter *compiled;
+  Bucket *bucket;
+
+  g_return_if_fail (filter != NULL);
+
+  compiled = compiled_filter_new (filter, &key);
+  bucket = g_hash_table_lookup (self->buckets, &key);
+
+  if (bucket == NULL)
+    {
+      bucket = g_slice_new0 (Bucket);
+      bucket->key = key;
+      /* most buckets only ever hold one filter */
+      bucket->filters = g_ptr_array_new_full (1, compiled_filter_free);
+      g_hash_table_insert (self->buckets, &bucket->key, bucket);
+    }
+
+  g_ptr_array_add (bucket->filters, compiled);
+}
+
+/*
+ * _tp_channel_filter_index_matches:
+ * @self: an index
+ * @properties: (transfer none): a channel's immutable properties
+ *
+ * Returns: %TRUE if any filter in @self matches @properties
+ */
+gboolean
+_tp_channel_filter_index_matches (TpChannelFilterIndex *self,
+    GHashTable *properties)
+{
+  BucketKey keys[4];
+  guint n_keys = 0;
+  const gchar *type;
+  GQuark channel_type = 0;
+  gboolean have_handle_type;
+  guint32 handle_type;
+  guint i, j;
+
+  g_return_val_if_fail (properties != NULL, FALSE);
+
+  type = tp_asv_get_string (properties, TP_PROP_CHANNEL_CHANNEL_TYPE);
+
+  /* if no filter ever mentioned this channel type, there is no bucket for
+   * it, so there's no point in interning it */
+  if (type != NULL)
+    channel_type = g_quark_try_string (type);
+
+  handle_type = tp_asv_get_uint32 (properties,
+      TP_PROP_CHANNEL_TARGET_HANDLE_TYPE, &have_handle_type);
+
+  if (channel_type != 0)
+    {
+      if (have_handle_type)
+        {
+          keys[n_keys].channel_type = channel_type;
+          keys[n_keys].any_handle_type = FALSE;
+          keys[n_keys].handle_type = handle_type;
+          n_keys++;
+        }
+
+      keys[n_keys].channel_type = channel_type;
+      keys[n_keys].any_handle_type = TRUE;
+      keys[n_keys].handle_type = 0;
+      n_keys++;
+    }
+
+  if (have_handle_type)
+    {
+      keys[n_keys].channel_type = 0;
+      keys[n_keys].any_handle_type = FALSE;
+      keys[n_keys].handle_type = handle_type;
+      n_keys++;
+    }
+
+  keys[n_keys].channel_type = 0;
+  keys[n_keys].any_handle_type = TRUE;
+  keys[n_keys].handle_type = 0;
+  n_keys++;
+
+  for (i = 0; i < n_keys; i++)
+    {
+      Bucket *bucket = g_hash_table_lookup (self->buckets, &keys[i]);
+
+      if (bucket == NULL)
+        continue;
+
+      for (j = 0; j < bucket->filters->len; j++)
+        {
+          CompiledFilter *filter = g_ptr_array_index (bucket->filters, j);
+
+          if (compiled_filter_matches (filter, properties))
+            return TRUE;
+        }
+    }
+
+  return FALSE;
+}
@@ -491,21 +491,17 @@ _tp_channel_get_group_flags_0_16 (TpChannel *self)
 }
 
 
+/* Record why @handle is local-pending; the caller is responsible for
+ * putting it in group_local_pending */
 static void
-_tp_channel_group_set_one_lp (TpChannel *self,
-                              TpHandle handle,
-                              TpHandle actor,
-                              TpChannelGroupChangeReason reason,
-                              const gchar *message)
+_tp_channel_group_set_lp_info (TpChannel *self,
+                               TpHandle handle,
+                               TpHandle actor,
+                               TpChannelGroupChangeReason reason,
+                               const gchar *message)
 {
   LocalPendingInfo *info = NULL;
 
-  g_assert (self->priv->group_local_pending != NULL);
-
-  tp_intset_add (self->priv->group_local_pending, handle);
-  tp_intset_remove (self->priv->group_members, handle);
-  tp_intset_remove (self->priv->group_remote_pending, handle);
-
   if (actor == 0 && reason == TP_CHANNEL_GROUP_CHANGE_REASON_NONE &&
       tp_str_empty (message))
     {
@@ -555,6 +551,23 @@ _tp_channel_group_set_one_lp (TpChannel *self,
 }
 
 
+static void
+_tp_channel_group_set_one_lp (TpChannel *self,
+                              TpHandle handle,
+                              TpHandle actor,
+                              TpChannelGroupChangeReason reason,
+                              const gchar *message)
+{
+  g_assert (self->priv->group_local_pending != NULL);
+
+  tp_intset_add (self->priv->group_local_pending, handle);
+  tp_intset_remove (self->priv->group_members, handle);
+  tp_intset_remove (self->priv->group_remote_pending, handle);
+
+  _tp_channel_group_set_lp_info (self, handle, actor, reason, message);
+}
+
+
 static void
 _tp_channel_group_set_lp (TpChannel *self,
                           const GPtrArray *info)
@@ -976,6 +989,17 @@ _tp_channel_group_improve_remove_error (TpChannel *self,
   error->domain = TP_ERROR;
 }
 
+static TpIntset *
+members_changed_set_from_array (const GArray *handles)
+{
+  TpIntset *set = tp_intset_from_array (handles);
+
+  if (tp_intset_remove (set, 0))
+    DEBUG ("handle 0 shouldn't be in MembersChanged, ignoring");
+
+  return set;
+}
+
 static void
 handle_members_changed (TpChannel *self,
                         const gchar *message,
@@ -987,6 +1011,9 @@ handle_members_changed (TpChannel *self,
                         guint reason,
                         GHashTable *details)
 {
+  TpIntset *added_set, *removed_set, *lp_set, *rp_set;
+  TpIntsetFastIter iter;
+  TpHandle handle;
   guint i;
 
   if (self->priv->group_members == NULL)
@@ -995,34 +1022,41 @@ handle_members_changed (TpChannel *self,
   g_assert (self->priv->group_local_pending != NULL);
   g_assert (self->priv->group_remote_pending != NULL);
 
-  for (i = 0; i < added->len; i++)
-    {
-      TpHandle handle = g_array_index (added, guint, i);
-
-      DEBUG ("+++ contact#%u", handle);
-
-      if (handle == 0)
-        {
-          DEBUG ("handle 0 shouldn't be in MembersChanged, ignoring");
-          continue;
-        }
-
-      tp_intset_add (self->priv->group_members, handle);
-      tp_intset_remove (self->priv->group_local_pending, handle);
-      tp_intset_remove (self->priv->group_remote_pending, handle);
-    }
-
+  added_set = members_changed_set_from_array (added);
+  removed_set = members_changed_set_from_array (removed);
+  lp_set = members_changed_set_from_array (local_pending);
+  rp_set = members_changed_set_from_array (remote_pending);
+
+  /* Apply the whole change at once. A handle that appears in more than one
+   * of the arrays ends up where the last of added, local_pending,
+   * remote_pending and removed puts it, as if they had been applied in
+   * that order. */
+  tp_intset_union_update (self->priv->group_members, added_set);
+  tp_intset_difference_update (self->priv->group_members, lp_set);
+  tp_intset_difference_update (self->priv->group_members, rp_set);
+  tp_intset_difference_update (self->priv->group_members, removed_set);
+
+  tp_intset_difference_update (self->priv->group_local_pending, added_set);
+  tp_intset_union_update (self->priv->group_local_pending, lp_set);
+  tp_intset_difference_update (self->priv->group_local_pending, rp_set);
+  tp_intset_difference_update (self->priv->group_local_pending, removed_set);
+
+  tp_intset_difference_update (self->priv->group_remote_pending, added_set);
+  tp_intset_difference_update (self->priv->group_remote_pending, lp_set);
+  tp_intset_union_update (self->priv->group_remote_pending, rp_set);
+  tp_intset_difference_update (self->priv->group_remote_pending,
+      removed_set);
+
+  /* Only local-pending contacts have a LocalPendingInfo. This has to be
+   * done before forgetting the removed contacts' info, so that a renamed
+   * local-pending contact can inherit it. */
   for (i = 0; i < local_pending->len; i++)
     {
-      TpHandle handle = g_array_index (local_pending, guint, i);
+      handle = g_array_index (local_pending, guint, i);
 
-      DEBUG ("+LP contact#%u", handle);
-
-      if (handle == 0)
-        {
-          DEBUG ("handle 0 shouldn't be in MembersChanged, ignoring");
-          continue;
-        }
+      if (handle == 0 || !tp_intset_is_member (
+            self->priv->group_local_pending, handle))
+        continue;
 
       /* Special-case renaming a local-pending contact, if the
        * signal is spec-compliant. Keep the old actor/reason/message in
@@ -1041,105 +1075,86 @@ handle_members_changed (TpChannel *self,
 
           if (info != NULL)
             {
-              _tp_channel_group_set_one_lp (self, handle,
+              _tp_channel_group_set_lp_info (self, handle,
                   info->actor, info->reason, info->message);
               continue;
             }
         }
 
       /* not reached if the Renamed special case occurred */
-      _tp_channel_group_set_one_lp (self, handle, actor,
+      _tp_channel_group_set_lp_info (self, handle, actor,
           reason, message);
     }
 
-  for (i = 0; i < remote_pending->len; i++)
+  if (self->priv->group_local_pending_info != NULL)
     {
-      TpHandle handle = g_array_index (remote_pending, guint, i);
-
-      DEBUG ("+RP contact#%u", handle);
-
-      if (handle == 0)
-        {
-          DEBUG ("handle 0 shouldn't be in MembersChanged, ignoring");
-          continue;
-        }
+      tp_intset_union_update (added_set, rp_set);
+      tp_intset_union_update (added_set, removed_set);
+      tp_intset_difference_update (added_set,
+          self->priv->group_local_pending);
 
-      tp_intset_add (self->priv->group_remote_pending, handle);
-      tp_intset_remove (self->priv->group_members, handle);
-      tp_intset_remove (self->priv->group_local_pending, handle);
+      tp_intset_fast_iter_init (&iter, added_set);
+      while (tp_intset_fast_iter_next (&iter, &handle))
+        g_hash_table_remove (self->priv->group_local_pending_info,
+            GUINT_TO_POINTER (handle));
     }
 
-  for (i = 0; i < removed->len; i++)
+  if (tp_intset_is_member (removed_set, self->priv->group_self_handle) ||
+      tp_intset_is_member (removed_set,
+          tp_connection_get_self_handle (self->priv->connection)))
     {
-      TpHandle handle = g_array_index (removed, guint, i);
+      const gchar *error_detail = tp_asv_get_string (details, "error");
+      const gchar *debug_message = tp_asv_get_string (details,
+          "debug-message");
 
-      DEBUG ("--- contact#%u", handle);
+      if (debug_message == NULL && !tp_str_empty (message))
+        debug_message = message;
 
-      if (handle == 0)
-        {
-          DEBUG ("handle 0 shouldn't be in MembersChanged, ignoring");
-          continue;
-        }
+      if (debug_message == NULL && error_detail != NULL)
+        debug_message = error_detail;
 
-      if (self->priv->group_local_pending_info != NULL)
-        g_hash_table_remove (self->priv->group_local_pending_info,
-            GUINT_TO_POINTER (handle));
+      if (debug_message == NULL)
+        debug_message = "(no message provided)";
 
-      tp_intset_remove (self->priv->group_members, handle);
-      tp_intset_remove (self->priv->group_local_pending, handle);
-      tp_intset_remove (self->priv->group_remote_pending, handle);
+      if (self->priv->group_remove_error != NULL)
+        g_clear_error (&self->priv->group_remove_error);
 
-      if (handle == self->priv->group_self_handle ||
-          handle == tp_connection_get_self_handle (self->priv->connection))
+      if (error_detail != NULL)
         {
-          const gchar *error_detail = tp_asv_get_string (details, "error");
-          const gchar *debug_message = tp_asv_get_string (details,
-              "debug-message");
-
-          if (debug_message == NULL && !tp_str_empty (message))
-            debug_message = message;
-
-          if (debug_message == NULL && error_detail != NULL)
-            debug_message = error_detail;
-
-          if (debug_message == NULL)
-            debug_message = "(no message provided)";
-
-          if (self->priv->group_remove_error != NULL)
-            g_clear_error (&self->priv->group_remove_error);
-
-          if (error_detail != NULL)
+          /* CM specified a D-Bus error name */
+          tp_proxy_dbus_error_to_gerror (self, error_detail,
+              debug_message == NULL || debug_message[0] == '\0'
+                  ? error_detail
+                  : debug_message,
+              &self->priv->group_remove_error);
+
+          /* ... but if we don't know anything about that D-Bus error
+           * name, we can still do better by using RemovedFromGroup */
+          if (g_error_matches (self->priv->group_remove_error,
+                TP_DBUS_ERRORS, TP_DBUS_ERROR_UNKNOWN_REMOTE_ERROR))
             {
-              /* CM specified a D-Bus error name */
-              tp_proxy_dbus_error_to_gerror (self, error_detail,
-                  debug_message == NULL || debug_message[0] == '\0'
-                      ? error_detail
-                      : debug_message,
-                  &self->priv->group_remove_error);
-
-              /* ... but if we don't know anything about that D-Bus error
-               * name, we can still do better by using RemovedFromGroup */
-              if (g_error_matches (self->priv->group_remove_error,
-                    TP_DBUS_ERRORS, TP_DBUS_ERROR_UNKNOWN_REMOTE_ERROR))
-                {
-                  self->priv->group_remove_error->domain =
-                    TP_ERRORS_REMOVED_FROM_GROUP;
-                  self->priv->group_remove_error->code = reason;
-
-                  _tp_channel_group_improve_remove_error (self, actor);
-                }
-            }
-          else
-            {
-              /* Use our separate error domain */
-              g_set_error_literal (&self->priv->group_remove_error,
-                  TP_ERRORS_REMOVED_FROM_GROUP, reason, debug_message);
+              self->priv->group_remove_error->domain =
+                TP_ERRORS_REMOVED_FROM_GROUP;
+              self->priv->group_remove_error->code = reason;
 
               _tp_channel_group_improve_remove_error (self, actor);
             }
         }
+      else
+        {
+          /* Use our separate error domain */
+          g_set_error_literal (&self->priv->group_remove_error,
+              TP_ERRORS_REMOVED_FROM_GROUP, reason, debug_message);
+
+          _tp_channel_group_improve_remove_error (self, actor);
+        }
     }
 
+  tp_intset_destroy (added_set);
+  tp_intset_destroy (removed_set);
+  tp_intset_destroy (lp_set);
+  tp_intset_destroy (rp_set);
+
   g_signal_emit_by_name (self, "group-members-changed", message,
       added, removed, local_pending, remote_pending, actor, reason);
   g_signal_emit_by_name (self, "group-members-changed-detailed", added,
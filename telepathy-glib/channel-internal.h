@@ -91,8 +91,9 @@ struct _TpChannelPrivate {
 
     /* Queue of GSimpleAsyncResult with ContactsQueueItem payload */
     GQueue *contacts_queue;
-    /* Item currently being prepared, not part of contacts_queue anymore */
-    GSimpleAsyncResult *current_contacts_queue_result;
+    /* Items currently being prepared together, in the order they were
+     * queued, not part of contacts_queue anymore; or NULL */
+    GPtrArray *current_contacts_queue_batch;
 
     /* NULL, or TpHandle => TpChannelChatState;
      * if non-NULL, we're watching for ChatStateChanged */
@@ -174,6 +174,7 @@ tp_cm_message_set_message (TpMessage *self,
       g_ptr_array_add (parts, dest);
     }
 
+  _tp_message_part_changed (self, part);
   g_hash_table_insert (g_ptr_array_index (self->parts, part),
       g_strdup (key),
       tp_g_value_slice_new_take_boxed (TP_ARRAY_TYPE_MESSAGE_PART_LIST, parts));
@@ -212,6 +213,7 @@ tp_cm_message_take_message (TpMessage *self,
   g_return_if_fail (TP_CM_MESSAGE (self)->priv->connection ==
       TP_CM_MESSAGE (message)->priv->connection);
 
+  _tp_message_part_changed (self, part);
   g_hash_table_insert (g_ptr_array_index (self->parts, part),
       g_strdup (key),
       tp_g_value_slice_new_take_boxed (TP_ARRAY_TYPE_MESSAGE_PART_LIST,
@@ -265,7 +267,6 @@ _tp_cm_message_new_from_parts (TpBaseConnection *conn,
 {
   TpMessage *self;
   guint i;
-  const GHashTable *header;
   TpHandle sender;
 
   g_return_val_if_fail (parts != NULL, NULL);
@@ -281,8 +282,9 @@ _tp_cm_message_new_from_parts (TpBaseConnection *conn,
           (GBoxedCopyFunc) tp_g_value_slice_dup);
     }
 
-  header = tp_message_peek (self, 0);
-  sender = tp_asv_get_uint32 (header, "message-sender", NULL);
+  _tp_message_part_changed (self, 0);
+
+  sender = _tp_message_get_sender_handle (self);
   if (sender != 0)
     tp_cm_message_set_sender (self, sender);
 
@@ -304,7 +306,7 @@ TpHandle
 tp_cm_message_get_sender (TpMessage *self)
 {
   g_return_val_if_fail (TP_IS_CM_MESSAGE (self), 0);
-  return tp_asv_get_uint32 (tp_message_peek (self, 0), "message-sender", NULL);
+  return _tp_message_get_sender_handle (self);
 }
 
 /**
@@ -33,6 +33,7 @@
 
 #define DEBUG_FLAG TP_DEBUG_CONNECTION
 #include "telepathy-glib/connection-internal.h"
+#include "telepathy-glib/contact-info-cache-internal.h"
 #include "telepathy-glib/debug-internal.h"
 #include "telepathy-glib/proxy-internal.h"
 #include "telepathy-glib/util-internal.h"
@@ -457,6 +458,58 @@ tp_connection_get_contact_info_flags (TpConnection *self)
   return self->priv->contact_info_flags;
 }
 
+/**
+ * tp_connection_set_contact_info_cache_enabled:
+ * @self: a connection
+ * @enabled: whether to keep an on-disk cache of contacts' vCards
+ *
+ * Enable or disable a cache of the #TpContact:contact-info of @self's
+ * contacts, kept in the user's cache directory, separately for each
+ * account. It is disabled by default.
+ *
+ * While it is enabled, vCards received from the connection manager are
+ * saved, and vCards saved in the last day are used to prepare
+ * %TP_CONTACT_FEATURE_CONTACT_INFO and to satisfy
+ * tp_connection_request_contact_info_async() without contacting the
+ * server, so that applications showing many contacts at startup do not
+ * have to download their vCards again. tp_contact_request_contact_info_async()
+ * always asks the connection manager. Saved vCards are read and written
+ * without blocking the main loop, and are deleted once they are a day old.
+ *
+ * Disabling the cache deletes the vCards saved for @self's account.
+ *
+ * Since: 0.UNRELEASED
+ */
+void
+tp_connection_set_contact_info_cache_enabled (TpConnection *self,
+    gboolean enabled)
+{
+  const gchar *dir;
+
+  g_return_if_fail (TP_IS_CONNECTION (self));
+
+  enabled = (enabled != FALSE);
+
+  if (self->priv->contact_info_cache_enabled == (guint) enabled)
+    return;
+
+  self->priv->contact_info_cache_enabled = enabled;
+
+  if (enabled)
+    {
+      /* otherwise this is done when the directory is first needed */
+      if (self->priv->contact_info_cache_dir != NULL)
+        _tp_contact_info_cache_prune (self->priv->contact_info_cache_dir);
+    }
+  else
+    {
+      dir = _tp_contact_info_cache_get_dir (self);
+
+      if (dir != NULL)
+        _tp_contact_info_cache_clear (dir);
+    }
+}
+
 /**
  * tp_connection_get_contact_info_supported_fields:
  * @self: a connection
@@ -159,6 +159,10 @@ process_queued_contacts_changed (TpConnection *self)
   GHashTableIter iter;
   gpointer key, value;
 
+  /* Wait for the initial roster to be announced first */
+  if (self->priv->roster_loading)
+    return;
+
   item = g_queue_peek_head (self->priv->contacts_changed_queue);
   if (item == NULL)
     return;
@@ -218,6 +222,49 @@ contacts_changed_cb (TpConnection *self,
     process_queued_contacts_changed (self);
 }
 
+typedef struct
+{
+  TpConnection *self;
+  GSimpleAsyncResult *result;
+} RosterLoad;
+
+static void
+roster_deferred_info_loaded_cb (gpointer user_data)
+{
+  RosterLoad *load = user_data;
+  TpConnection *self = load->self;
+
+  self->priv->roster_loading = FALSE;
+
+  /* emit initial set if roster is not empty */
+  if (g_hash_table_size (self->priv->roster) != 0)
+    {
+      GPtrArray *added;
+      GPtrArray *removed;
+
+      added = tp_connection_dup_contact_list (self);
+      removed = g_ptr_array_new ();
+      g_signal_emit_by_name (self, "contact-list-changed", added, removed);
+      g_ptr_array_unref (added);
+      g_ptr_array_unref (removed);
+    }
+
+  self->priv->contact_list_state = TP_CONTACT_LIST_STATE_SUCCESS;
+  g_object_notify ((GObject *) self, "contact-list-state");
+
+  if (load->result != NULL)
+    {
+      g_simple_async_result_complete_in_idle (load->result);
+      g_object_unref (load->result);
+    }
+
+  /* ContactsChanged received in the meantime */
+  process_queued_contacts_changed (self);
+
+  g_object_unref (self);
+  g_slice_free (RosterLoad, load);
+}
+
 static void
 got_contact_list_attributes_cb (TpConnection *self,
     GHashTable *attributes,
@@ -229,6 +276,8 @@ got_contact_list_attributes_cb (TpConnection *self,
   GArray *features = user_data;
   GHashTableIter iter;
   gpointer key, value;
+  GPtrArray *contacts;
+  RosterLoad *load;
 
   if (error != NULL)
     {
@@ -236,9 +285,13 @@ got_contact_list_attributes_cb (TpConnection *self,
       g_object_notify ((GObject *) self, "contact-list-state");
 
       if (result != NULL)
-        g_simple_async_result_set_from_error (result, error);
+        {
+          g_simple_async_result_set_from_error (result, error);
+          g_simple_async_result_complete_in_idle (result);
+          g_object_unref (result);
+        }
 
-      goto OUT;
+      return;
     }
 
   DEBUG ("roster fetched with %d contacts", g_hash_table_size (attributes));
@@ -272,28 +325,20 @@ got_contact_list_attributes_cb (TpConnection *self,
       g_hash_table_insert (self->priv->roster, key, contact);
     }
 
-  /* emit initial set if roster is not empty */
-  if (g_hash_table_size (self->priv->roster) != 0)
-    {
-      GPtrArray *added;
-      GPtrArray *removed;
-
-      added = tp_connection_dup_contact_list (self);
-      removed = g_ptr_array_new ();
-      g_signal_emit_by_name (self, "contact-list-changed", added, removed);
-      g_ptr_array_unref (added);
-      g_ptr_array_unref (removed);
-    }
-
-  self->priv->contact_list_state = TP_CONTACT_LIST_STATE_SUCCESS;
-  g_object_notify ((GObject *) self, "contact-list-state");
-
-OUT:
-  if (result != NULL)
-    {
-      g_simple_async_result_complete_in_idle (result);
-      g_object_unref (result);
-    }
+  /* The vCards the CM did not have are read from the on-disk cache, if it
+   * is enabled, all at once. The roster is only announced, and the feature
+   * only prepared, once they have been, so that the contacts have all the
+   * features the factory asked for. */
+  load = g_slice_new (RosterLoad);
+  load->self = g_object_ref (self);
+  /* steal the ref we were given on result, if any */
+  load->result = result;
+  self->priv->roster_loading = TRUE;
+
+  contacts = tp_connection_dup_contact_list (self);
+  _tp_contacts_load_deferred_info (self, contacts,
+      roster_deferred_info_loaded_cb, load);
+  g_ptr_array_unref (contacts);
 }
 
 static void
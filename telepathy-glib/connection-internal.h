@@ -70,6 +70,10 @@ struct _TpConnectionPrivate {
 
     TpContactInfoFlags contact_info_flags;
     GList *contact_info_supported_fields;
+    /* TpHandle => borrowed ContactInfoFetch, see contact.c */
+    GHashTable *contact_info_fetches;
+    /* see contact-info-cache.c; NULL until first needed */
+    gchar *contact_info_cache_dir;
 
     gint balance;
     guint balance_scale;
@@ -86,6 +90,9 @@ struct _TpConnectionPrivate {
     /* Queue of owned ContactsChangedItem */
     GQueue *contacts_changed_queue;
     gboolean roster_fetched;
+    /* TRUE while the saved vCards of the roster just fetched are being read:
+     * ContactsChanged is queued but not processed until they are */
+    gboolean roster_loading;
     gboolean contact_list_properties_fetched;
 
     /* ContactGroups properties */
@@ -122,6 +129,7 @@ struct _TpConnectionPrivate {
     unsigned introspecting_self_contact:1;
     unsigned tracking_contacts_changed:1;
     unsigned tracking_contact_groups_changed:1;
+    unsigned contact_info_cache_enabled:1;
 };
 
 void _tp_connection_status_reason_to_gerror (TpConnectionStatusReason reason,
@@ -0,0 +1,48 @@
+/*<private_header>*/
+/* TpConnectionManager - internal header
+ *
+ * Copyright © 2014 Collabora Ltd.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#ifndef TP_CONNECTION_MANAGER_INTERNAL_H
+#define TP_CONNECTION_MANAGER_INTERNAL_H
+
+#include <telepathy-glib/connection-manager.h>
+
+G_BEGIN_DECLS
+
+typedef struct {
+    /* .manager files answered from a valid cache entry */
+    guint hits;
+    /* .manager files that had to be parsed (no entry, or a stale one) */
+    guint misses;
+    /* cache entries successfully written */
+    guint writes;
+    /* total time spent getting the protocols of the .manager files that
+     * were parsed, from looking the file up to having the TpProtocols, in
+     * microseconds */
+    gint64 parse_time;
+    /* the same for the .manager files answered from the cache */
+    gint64 load_time;
+} TpManagerFileCacheStats;
+
+void _tp_connection_manager_get_file_cache_stats (
+    TpManagerFileCacheStats *stats);
+
+G_END_DECLS
+
+#endif
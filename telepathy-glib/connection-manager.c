@@ -23,8 +23,11 @@
 
 #include "telepathy-glib/connection-manager.h"
 
+#include <errno.h>
 #include <string.h>
 
+#include <dbus/dbus-glib.h>
+
 #include "telepathy-glib/defs.h"
 #include "telepathy-glib/enums.h"
 #include "telepathy-glib/errors.h"
@@ -35,9 +38,11 @@
 #include "telepathy-glib/util.h"
 
 #define DEBUG_FLAG TP_DEBUG_MANAGER
+#include "telepathy-glib/connection-manager-internal.h"
 #include "telepathy-glib/debug-internal.h"
 #include "telepathy-glib/protocol-internal.h"
 #include "telepathy-glib/util-internal.h"
+#include "telepathy-glib/variant-util-internal.h"
 
 #include "telepathy-glib/_gen/tp-cli-connection-manager-body.h"
 
@@ -1040,151 +1045,715 @@ tp_connection_manager_name_owner_changed_cb (TpDBusDaemon *bus,
   g_object_unref (self);
 }
 
+/* Bump this whenever the layout of a cache entry changes. */
+#define MANAGER_FILE_CACHE_VERSION 3
+
+/* (version, path of the .manager file, its modification and status change
+ *  times in microseconds, its size, its inode number,
+ *  ConnectionManager.Interfaces, protocol name => immutable properties)
+ *
+ * An entry is only used if the file's metadata still match, so that a hit
+ * does not need to read the file at all. Rewriting a file changes its status
+ * change time, which cannot be set back, even if the new contents have the
+ * same size and the modification time is preserved. */
+#define MANAGER_FILE_CACHE_TYPE "(usxxttasa{sa{sv}})"
+
+#define MANAGER_FILE_CACHE_ATTRIBUTES \
+  G_FILE_ATTRIBUTE_STANDARD_SIZE "," \
+  G_FILE_ATTRIBUTE_TIME_MODIFIED "," \
+  G_FILE_ATTRIBUTE_TIME_MODIFIED_USEC "," \
+  G_FILE_ATTRIBUTE_TIME_CHANGED "," \
+  G_FILE_ATTRIBUTE_TIME_CHANGED_USEC "," \
+  G_FILE_ATTRIBUTE_UNIX_INODE
+
+static TpManagerFileCacheStats manager_file_cache_stats;
+
+void
+_tp_connection_manager_get_file_cache_stats (TpManagerFileCacheStats *stats)
+{
+  *stats = manager_file_cache_stats;
+}
+
+typedef struct {
+    gchar *cm_name;
+    gchar *filename;
+
+    /* set by the reading thread */
+    gint64 mtime;
+    gint64 ctime;
+    guint64 size;
+    guint64 inode;
+    /* a valid cache entry for the file's current metadata, or NULL */
+    GVariant *entry;
+    /* read only if there was no usable entry */
+    gchar *contents;
+    gsize len;
+    /* @contents parsed, if there was no usable entry */
+    GKeyFile *file;
+    /* time spent in the reading thread, in microseconds */
+    gint64 thread_time;
+
+    /* set on the main thread from @file */
+    GStrv interfaces;
+    /* dup'd protocol name => owned a{sv} of immutable properties */
+    GHashTable *protocols;
+} ManagerFileData;
+
+static void
+manager_file_data_free (gpointer p)
+{
+  ManagerFileData *data = p;
+
+  g_free (data->cm_name);
+  g_free (data->filename);
+  g_free (data->contents);
+  tp_clear_pointer (&data->entry, g_variant_unref);
+  tp_clear_pointer (&data->file, g_key_file_free);
+  g_strfreev (data->interfaces);
+  tp_clear_pointer (&data->protocols, g_hash_table_unref);
+  g_slice_free (ManagerFileData, data);
+}
+
+/* Reads and parses the file. Only touches @data, so it may be called in a
+ * worker thread. */
 static gboolean
-tp_connection_manager_read_file (TpDBusDaemon *dbus_daemon,
-    const gchar *cm_name,
-    const gchar *filename,
-    GHashTable **protocols_out,
-    GStrv *interfaces_out,
+manager_file_data_parse (ManagerFileData *data,
     GError **error)
 {
-  GKeyFile *file;
-  gchar **groups = NULL;
-  gchar **group;
-  TpProtocol *proto_object;
-  GHashTable *protocols = NULL;
-  GStrv interfaces = NULL;
+  if (data->contents == NULL &&
+      !g_file_get_contents (data->filename, &data->contents, &data->len,
+        error))
+    return FALSE;
 
-  file = g_key_file_new ();
+  data->file = g_key_file_new ();
 
-  if (!g_key_file_load_from_file (file, filename, G_KEY_FILE_NONE, error))
-    return FALSE;
+  if (!g_key_file_load_from_data (data->file, data->contents, data->len,
+        G_KEY_FILE_NONE, error))
+    {
+      tp_clear_pointer (&data->file, g_key_file_free);
+      return FALSE;
+    }
 
-  /* if missing, it's not an error, so ignore @error */
-  interfaces = g_key_file_get_string_list (file, "ConnectionManager",
-      "Interfaces", NULL, NULL);
+  return TRUE;
+}
 
-  protocols = g_hash_table_new_full (g_str_hash, g_str_equal, g_free,
-      g_object_unref);
+/* Turns @data->file into immutable properties. They are dbus-glib GValues,
+ * so this must run on the main thread. */
+static void
+manager_file_data_build (ManagerFileData *data)
+{
+  gchar **groups = NULL;
+  gchar **group;
+
+  /* if missing, it's not an error, so ignore the error */
+  data->interfaces = g_key_file_get_string_list (data->file,
+      "ConnectionManager", "Interfaces", NULL, NULL);
 
-  groups = g_key_file_get_groups (file, NULL);
+  data->protocols = g_hash_table_new_full (g_str_hash, g_str_equal, g_free,
+      (GDestroyNotify) g_hash_table_unref);
 
-  if (groups == NULL)
-    goto success;
+  groups = g_key_file_get_groups (data->file, NULL);
 
-  for (group = groups; *group != NULL; group++)
+  for (group = groups; group != NULL && *group != NULL; group++)
     {
       gchar *name;
       GHashTable *immutables;
 
-      immutables = _tp_protocol_parse_manager_file (file, cm_name, *group,
-          &name);
+      immutables = _tp_protocol_parse_manager_file (data->file,
+          data->cm_name, *group, &name);
 
       if (immutables == NULL)
         continue;
 
-      proto_object = tp_protocol_new (dbus_daemon, cm_name, name,
-          immutables, NULL);
-      g_assert (proto_object != NULL);
+      /* steals @name and @immutables */
+      g_hash_table_insert (data->protocols, name, immutables);
+    }
+
+  g_strfreev (groups);
+}
+
+static GVariant *manager_file_cache_lookup (ManagerFileData *data);
+
+/* Looks at the .manager file's metadata, then either finds the cache entry
+ * for them or reads and parses the file. Everything that involves dbus-glib
+ * is left to tp_connection_manager_read_file_cb(). */
+static void
+tp_connection_manager_read_file_thread (GTask *task,
+    gpointer source_object,
+    gpointer task_data,
+    GCancellable *cancellable)
+{
+  ManagerFileData *data = task_data;
+  gint64 start = g_get_monotonic_time ();
+  GFile *file = g_file_new_for_path (data->filename);
+  GFileInfo *info;
+  GError *error = NULL;
 
-      /* steals @name */
-      g_hash_table_insert (protocols, name, proto_object);
+  info = g_file_query_info (file, MANAGER_FILE_CACHE_ATTRIBUTES,
+      G_FILE_QUERY_INFO_NONE, cancellable, &error);
+  g_object_unref (file);
 
-      g_hash_table_unref (immutables);
+  if (info == NULL)
+    {
+      g_task_return_error (task, error);
+      return;
     }
 
-success:
-  g_strfreev (groups);
-  g_key_file_free (file);
+  /* if the file changes after this, the entry we write will be stale
+   * rather than wrong */
+  data->mtime = G_USEC_PER_SEC * (gint64) g_file_info_get_attribute_uint64 (
+        info, G_FILE_ATTRIBUTE_TIME_MODIFIED) +
+      g_file_info_get_attribute_uint32 (info,
+        G_FILE_ATTRIBUTE_TIME_MODIFIED_USEC);
+  data->ctime = G_USEC_PER_SEC * (gint64) g_file_info_get_attribute_uint64 (
+        info, G_FILE_ATTRIBUTE_TIME_CHANGED) +
+      g_file_info_get_attribute_uint32 (info,
+        G_FILE_ATTRIBUTE_TIME_CHANGED_USEC);
+  data->size = g_file_info_get_attribute_uint64 (info,
+      G_FILE_ATTRIBUTE_STANDARD_SIZE);
+  data->inode = g_file_info_get_attribute_uint64 (info,
+      G_FILE_ATTRIBUTE_UNIX_INODE);
+  g_object_unref (info);
 
-  if (protocols_out != NULL)
-    *protocols_out = protocols;
-  else
-    g_hash_table_unref (protocols);
+  data->entry = manager_file_cache_lookup (data);
 
-  if (interfaces_out != NULL)
-    *interfaces_out = interfaces;
-  else
-    g_strfreev (interfaces);
+  if (data->entry == NULL && !manager_file_data_parse (data, &error))
+    {
+      g_task_return_error (task, error);
+      return;
+    }
+
+  data->thread_time = g_get_monotonic_time () - start;
+  g_task_return_boolean (task, TRUE);
+}
+
+static gchar *
+manager_file_cache_path (const gchar *filename)
+{
+  gchar *checksum = g_compute_checksum_for_string (G_CHECKSUM_SHA1,
+      filename, -1);
+  gchar *basename = g_strdup_printf ("%s.cache", checksum);
+  gchar *path = g_build_filename (g_get_user_cache_dir (), "telepathy",
+      "managers", basename, NULL);
+
+  g_free (basename);
+  g_free (checksum);
+  return path;
+}
+
+/* Returns the cache entry for @data's file if there is one and it was
+ * built from the file as it is now, or NULL. The entry is a view onto the
+ * mapped cache file; entries are only ever replaced by renaming over them,
+ * so the mapping stays valid for as long as the entry is referenced. This
+ * only uses GLib, and is called in a worker thread. */
+static GVariant *
+manager_file_cache_lookup (ManagerFileData *data)
+{
+  const gchar *filename = data->filename;
+  gchar *path = manager_file_cache_path (filename);
+  GMappedFile *mapped;
+  GBytes *bytes;
+  GVariant *entry;
+  guint32 version;
+  const gchar *cached_filename;
+  gint64 mtime, ctime;
+  guint64 size, inode;
+
+  mapped = g_mapped_file_new (path, FALSE, NULL);
+
+  if (mapped == NULL)
+    {
+      DEBUG ("no cache entry for %s at %s", filename, path);
+      g_free (path);
+      return NULL;
+    }
+
+  bytes = g_mapped_file_get_bytes (mapped);
+  g_mapped_file_unref (mapped);
+
+  /* the cache is not trusted: GVariant copes with corrupt serialized data,
+   * and we check the header below */
+  entry = g_variant_ref_sink (g_variant_new_from_bytes (
+        G_VARIANT_TYPE (MANAGER_FILE_CACHE_TYPE), bytes, FALSE));
+  g_bytes_unref (bytes);
+
+  g_variant_get (entry, "(u&sxxtt@as@a{sa{sv}})", &version,
+      &cached_filename, &mtime, &ctime, &size, &inode, NULL, NULL);
 
+  if (version != MANAGER_FILE_CACHE_VERSION ||
+      tp_strdiff (cached_filename, filename) ||
+      mtime != data->mtime || ctime != data->ctime ||
+      size != data->size || inode != data->inode)
+    {
+      DEBUG ("cache entry %s for %s is stale", path, filename);
+      g_variant_unref (entry);
+      entry = NULL;
+    }
+
+  g_free (path);
+  return entry;
+}
+
+static gboolean
+manager_file_cache_load (TpDBusDaemon *dbus_daemon,
+    const gchar *cm_name,
+    GVariant *entry,
+    GHashTable **protocols_out,
+    GStrv *interfaces_out)
+{
+  GVariant *protocols_variant;
+  GVariantIter iter;
+  const gchar *name;
+  GVariant *immutables;
+  GHashTable *protocols;
+
+  protocols = g_hash_table_new_full (g_str_hash, g_str_equal, g_free,
+      g_object_unref);
+
+  protocols_variant = g_variant_get_child_value (entry, 7);
+  g_variant_iter_init (&iter, protocols_variant);
+
+  while (g_variant_iter_loop (&iter, "{&s@a{sv}}", &name, &immutables))
+    {
+      TpProtocol *proto_object;
+      GError *error = NULL;
+
+      proto_object = tp_protocol_new_vardict (dbus_daemon, cm_name, name,
+          immutables, &error);
+
+      if (proto_object == NULL)
+        {
+          DEBUG ("%s: ignoring corrupt cache entry: %s", cm_name,
+              error->message);
+          g_error_free (error);
+          g_variant_unref (immutables);
+          g_variant_unref (protocols_variant);
+          g_hash_table_unref (protocols);
+          return FALSE;
+        }
+
+      g_hash_table_insert (protocols, g_strdup (name), proto_object);
+    }
+
+  g_variant_unref (protocols_variant);
+
+  g_variant_get_child (entry, 6, "^as", interfaces_out);
+  *protocols_out = protocols;
   return TRUE;
 }
 
+/* Add @param_specs to @builder as they would arrive over D-Bus. Array
+ * defaults that the .manager file left unset come out empty. Returns FALSE
+ * if a default cannot be represented as a GVariant at all, for instance
+ * that of a parameter with an unsupported signature. */
 static gboolean
-tp_connection_manager_idle_read_manager_file (gpointer data)
+manager_file_cache_add_param_specs (GVariantBuilder *builder,
+    const GPtrArray *param_specs)
 {
-  TpConnectionManager *self = TP_CONNECTION_MANAGER (data);
+  guint i;
 
-  self->priv->manager_file_read_idle_id = 0;
+  g_variant_builder_open (builder, G_VARIANT_TYPE ("a(susv)"));
 
-  if (self->priv->protocol_objects == NULL)
+  for (i = 0; i < param_specs->len; i++)
     {
-      if (self->priv->manager_file != NULL &&
-          self->priv->manager_file[0] != '\0')
+      const gchar *name, *sig;
+      guint flags;
+      GValue *def;
+      GVariant *def_variant;
+
+      tp_value_array_unpack (g_ptr_array_index (param_specs, i), 4,
+          &name, &flags, &sig, &def);
+
+      if (!G_IS_VALUE (def) ||
+          (G_VALUE_HOLDS_BOXED (def) && g_value_get_boxed (def) == NULL &&
+           sig[0] != 'a'))
         {
-          GError *error = NULL;
-          GHashTable *protocols;
-          GStrv interfaces = NULL;
+          DEBUG ("parameter %s of type '%s' cannot be cached", name, sig);
+          return FALSE;
+        }
+
+      if (G_VALUE_HOLDS_BOXED (def) && g_value_get_boxed (def) == NULL)
+        def_variant = g_variant_new_array (
+            g_variant_type_element (G_VARIANT_TYPE (sig)), NULL, 0);
+      else
+        def_variant = dbus_g_value_build_g_variant (def);
 
-          DEBUG ("%s: reading %s", self->name, self->priv->manager_file);
+      g_variant_builder_add (builder, "(susv)", name, flags, sig,
+          def_variant);
+    }
 
-          if (!tp_connection_manager_read_file (
-              tp_proxy_get_dbus_daemon (self),
-              self->name, self->priv->manager_file, &protocols, &interfaces,
-              &error))
+  g_variant_builder_close (builder);
+  return TRUE;
+}
+
+static void
+manager_file_cache_add_rccs (GVariantBuilder *builder,
+    const GPtrArray *rccs)
+{
+  guint i;
+
+  g_variant_builder_open (builder, G_VARIANT_TYPE ("a(a{sv}as)"));
+
+  for (i = 0; i < rccs->len; i++)
+    {
+      GHashTable *fixed;
+      const gchar * const *allowed;
+      const gchar * const no_allowed[] = { NULL };
+      GVariant *fixed_variant;
+
+      tp_value_array_unpack (g_ptr_array_index (rccs, i), 2,
+          &fixed, &allowed);
+
+      fixed_variant = _tp_asv_to_vardict (fixed);
+      g_variant_builder_add (builder, "(@a{sv}^as)", fixed_variant,
+          allowed == NULL ? no_allowed : allowed);
+      g_variant_unref (fixed_variant);
+    }
+
+  g_variant_builder_close (builder);
+}
+
+static GVariant *
+manager_file_cache_build_immutables (GHashTable *immutables)
+{
+  GVariantBuilder builder;
+  GHashTableIter iter;
+  gpointer k, v;
+
+  g_variant_builder_init (&builder, G_VARIANT_TYPE_VARDICT);
+  g_hash_table_iter_init (&iter, immutables);
+
+  while (g_hash_table_iter_next (&iter, &k, &v))
+    {
+      GValue *value = v;
+
+      /* missing string lists are stored as NULL, but an absent key reads
+       * back the same way */
+      if (G_VALUE_HOLDS (value, G_TYPE_STRV) &&
+          g_value_get_boxed (value) == NULL)
+        continue;
+
+      g_variant_builder_open (&builder, G_VARIANT_TYPE ("{sv}"));
+      g_variant_builder_add (&builder, "s", k);
+      g_variant_builder_open (&builder, G_VARIANT_TYPE_VARIANT);
+
+      if (!tp_strdiff (k, TP_PROP_PROTOCOL_PARAMETERS))
+        {
+          if (!manager_file_cache_add_param_specs (&builder,
+                g_value_get_boxed (value)))
             {
-              DEBUG ("%s: failed to load %s: %s #%d: %s",
-                  self->name, self->priv->manager_file,
-                  g_quark_to_string (error->domain), error->code,
-                  error->message);
-              g_error_free (error);
-              error = NULL;
+              g_variant_builder_clear (&builder);
+              return NULL;
             }
-          else
-            {
-              tp_proxy_add_interfaces ((TpProxy *) self,
-                  (const gchar * const *) interfaces);
-              g_strfreev (interfaces);
+        }
+      else if (!tp_strdiff (k, TP_PROP_PROTOCOL_REQUESTABLE_CHANNEL_CLASSES))
+        {
+          manager_file_cache_add_rccs (&builder, g_value_get_boxed (value));
+        }
+      else
+        {
+          g_variant_builder_add_value (&builder,
+              dbus_g_value_build_g_variant (value));
+        }
+
+      g_variant_builder_close (&builder);
+      g_variant_builder_close (&builder);
+    }
 
-              self->priv->protocol_objects = protocols;
-              tp_connection_manager_update_protocol_structs (self);
+  return g_variant_builder_end (&builder);
+}
 
-              DEBUG ("%s: got info from file", self->name);
-              /* previously it must have been NONE */
-              self->info_source = TP_CM_INFO_SOURCE_FILE;
+static GVariant *
+manager_file_cache_build_entry (ManagerFileData *data)
+{
+  GVariantBuilder protocols;
+  GHashTableIter iter;
+  gpointer k, v;
+  const gchar * const no_interfaces[] = { NULL };
 
-              g_object_ref (self);
-              g_object_notify ((GObject *) self, "info-source");
+  g_variant_builder_init (&protocols, G_VARIANT_TYPE ("a{sa{sv}}"));
+  g_hash_table_iter_init (&iter, data->protocols);
 
-              g_signal_emit (self, signals[SIGNAL_GOT_INFO], 0,
-                  self->info_source);
-              tp_connection_manager_ready_or_failed (self, NULL);
-              g_object_unref (self);
+  while (g_hash_table_iter_next (&iter, &k, &v))
+    {
+      GVariant *immutables = manager_file_cache_build_immutables (v);
 
-              goto out;
-            }
+      if (immutables == NULL)
+        {
+          g_variant_builder_clear (&protocols);
+          return NULL;
         }
 
-      if (self->priv->introspect_idle_id == 0)
+      g_variant_builder_add (&protocols, "{s@a{sv}}", k, immutables);
+    }
+
+  return g_variant_ref_sink (g_variant_new ("(usxxtt^asa{sa{sv}})",
+        MANAGER_FILE_CACHE_VERSION, data->filename, data->mtime, data->ctime,
+        data->size, data->inode,
+        data->interfaces == NULL ? no_interfaces :
+          (const gchar * const *) data->interfaces,
+        &protocols));
+}
+
+static void
+manager_file_cache_write_thread (GTask *task,
+    gpointer source_object,
+    gpointer task_data,
+    GCancellable *cancellable)
+{
+  GVariant *entry = task_data;
+  const gchar *filename;
+  gchar *path, *dir;
+  GError *error = NULL;
+
+  g_variant_get_child (entry, 1, "&s", &filename);
+  path = manager_file_cache_path (filename);
+  dir = g_path_get_dirname (path);
+
+  if (g_mkdir_with_parents (dir, 0700) != 0)
+    {
+      int e = errno;
+
+      g_task_return_new_error (task, G_IO_ERROR, g_io_error_from_errno (e),
+          "Unable to create %s: %s", dir, g_strerror (e));
+    }
+  /* g_file_set_contents() renames a temporary file over @path, so
+   * readers that have the old entry mapped are unaffected */
+  else if (g_file_set_contents (path, g_variant_get_data (entry),
+        g_variant_get_size (entry), &error))
+    {
+      g_task_return_boolean (task, TRUE);
+    }
+  else
+    {
+      g_task_return_error (task, error);
+    }
+
+  g_free (dir);
+  g_free (path);
+}
+
+static void
+manager_file_cache_write_cb (GObject *source,
+    GAsyncResult *result,
+    gpointer user_data)
+{
+  GError *error = NULL;
+
+  if (g_task_propagate_boolean (G_TASK (result), &error))
+    {
+      manager_file_cache_stats.writes++;
+    }
+  else
+    {
+      DEBUG ("failed to write .manager file cache: %s", error->message);
+      g_error_free (error);
+    }
+}
+
+static void
+manager_file_cache_store (ManagerFileData *data)
+{
+  GVariant *entry = manager_file_cache_build_entry (data);
+  GTask *task;
+
+  if (entry == NULL)
+    {
+      DEBUG ("%s: not caching %s", data->cm_name, data->filename);
+      return;
+    }
+
+  task = g_task_new (NULL, NULL, manager_file_cache_write_cb, NULL);
+  g_task_set_task_data (task, entry, (GDestroyNotify) g_variant_unref);
+  g_task_run_in_thread (task, manager_file_cache_write_thread);
+  g_object_unref (task);
+}
+
+static void
+tp_connection_manager_got_manager_file (TpConnectionManager *self,
+    GHashTable *protocols,
+    GStrv interfaces)
+{
+  tp_proxy_add_interfaces ((TpProxy *) self,
+      (const gchar * const *) interfaces);
+
+  self->priv->protocol_objects = protocols;
+  tp_connection_manager_update_protocol_structs (self);
+
+  DEBUG ("%s: got info from file", self->name);
+  /* previously it must have been NONE */
+  self->info_source = TP_CM_INFO_SOURCE_FILE;
+
+  g_object_ref (self);
+  g_object_notify ((GObject *) self, "info-source");
+
+  g_signal_emit (self, signals[SIGNAL_GOT_INFO], 0,
+      self->info_source);
+  tp_connection_manager_ready_or_failed (self, NULL);
+  g_object_unref (self);
+}
+
+static void
+tp_connection_manager_no_manager_file (TpConnectionManager *self)
+{
+  if (self->priv->introspect_idle_id == 0)
+    {
+      DEBUG ("%s: no .manager file or failed to parse it, trying to "
+          "activate CM instead",
+          self->name);
+      tp_connection_manager_idle_introspect (self);
+    }
+  else
+    {
+      DEBUG ("%s: no .manager file, but will activate CM soon anyway",
+          self->name);
+    }
+}
+
+static void
+tp_connection_manager_read_file_failed (TpConnectionManager *self,
+    const gchar *filename,
+    const GError *error)
+{
+  DEBUG ("%s: failed to load %s: %s #%d: %s",
+      self->name, filename, g_quark_to_string (error->domain), error->code,
+      error->message);
+
+  if (!self->priv->disposed && self->priv->protocol_objects == NULL)
+    tp_connection_manager_no_manager_file (self);
+}
+
+static void
+tp_connection_manager_read_file_cb (GObject *source,
+    GAsyncResult *result,
+    gpointer user_data)
+{
+  TpConnectionManager *self = TP_CONNECTION_MANAGER (source);
+  ManagerFileData *data = g_task_get_task_data (G_TASK (result));
+  GError *error = NULL;
+  GHashTable *protocols = NULL;
+  GStrv interfaces = NULL;
+  GHashTableIter iter;
+  gpointer k, v;
+  gint64 start = g_get_monotonic_time ();
+
+  if (!g_task_propagate_boolean (G_TASK (result), &error))
+    {
+      tp_connection_manager_read_file_failed (self, data->filename, error);
+      g_error_free (error);
+      return;
+    }
+
+  if (data->entry != NULL)
+    {
+      if (manager_file_cache_load (tp_proxy_get_dbus_daemon (self),
+            self->name, data->entry, &protocols, &interfaces))
         {
-          DEBUG ("%s: no .manager file or failed to parse it, trying to "
-              "activate CM instead",
-              self->name);
-          tp_connection_manager_idle_introspect (self);
+          manager_file_cache_stats.hits++;
+          manager_file_cache_stats.load_time += data->thread_time +
+              g_get_monotonic_time () - start;
+
+          DEBUG ("%s: read %s from cache", self->name, data->filename);
         }
-      else
+      /* the entry matched but is unusable, so fall back to the file,
+       * which is small enough to read and parse here */
+      else if (!manager_file_data_parse (data, &error))
         {
-          DEBUG ("%s: no .manager file, but will activate CM soon anyway",
-              self->name);
+          tp_connection_manager_read_file_failed (self, data->filename,
+              error);
+          g_error_free (error);
+          return;
         }
     }
+
+  if (protocols == NULL)
+    {
+      DEBUG ("%s: parsed %s", self->name, data->filename);
+
+      manager_file_data_build (data);
+      manager_file_cache_store (data);
+
+      protocols = g_hash_table_new_full (g_str_hash, g_str_equal, g_free,
+          g_object_unref);
+
+      g_hash_table_iter_init (&iter, data->protocols);
+
+      while (g_hash_table_iter_next (&iter, &k, &v))
+        {
+          TpProtocol *proto_object;
+
+          proto_object = tp_protocol_new (tp_proxy_get_dbus_daemon (self),
+              self->name, k, v, NULL);
+          g_assert (proto_object != NULL);
+
+          g_hash_table_insert (protocols, g_strdup (k), proto_object);
+        }
+
+      interfaces = g_strdupv (data->interfaces);
+
+      manager_file_cache_stats.misses++;
+      manager_file_cache_stats.parse_time += data->thread_time +
+          g_get_monotonic_time () - start;
+    }
+
+  if (self->priv->disposed)
+    {
+      g_hash_table_unref (protocols);
+    }
+  else if (self->priv->protocol_objects != NULL)
+    {
+      DEBUG ("%s: discarding %s, %u protocols were discovered meanwhile",
+          self->name, data->filename,
+          g_hash_table_size (self->priv->protocol_objects));
+      g_hash_table_unref (protocols);
+    }
+  else
+    {
+      tp_connection_manager_got_manager_file (self, protocols, interfaces);
+    }
+
+  g_strfreev (interfaces);
+}
+
+static void
+tp_connection_manager_read_file (TpConnectionManager *self)
+{
+  ManagerFileData *data;
+  GTask *task;
+
+  DEBUG ("%s: reading %s", self->name, self->priv->manager_file);
+
+  data = g_slice_new0 (ManagerFileData);
+  data->cm_name = g_strdup (self->name);
+  data->filename = g_strdup (self->priv->manager_file);
+
+  task = g_task_new (self, NULL, tp_connection_manager_read_file_cb, NULL);
+  g_task_set_task_data (task, data, manager_file_data_free);
+  g_task_run_in_thread (task, tp_connection_manager_read_file_thread);
+  g_object_unref (task);
+}
+
+static gboolean
+tp_connection_manager_idle_read_manager_file (gpointer data)
+{
+  TpConnectionManager *self = TP_CONNECTION_MANAGER (data);
+
+  self->priv->manager_file_read_idle_id = 0;
+
+  if (self->priv->protocol_objects == NULL)
+    {
+      if (self->priv->manager_file == NULL ||
+          self->priv->manager_file[0] == '\0')
+        tp_connection_manager_no_manager_file (self);
+      else
+        tp_connection_manager_read_file (self);
+    }
   else
     {
       DEBUG ("%s: not reading manager file, %u protocols already discovered",
           self->name, g_hash_table_size (self->priv->protocol_objects));
     }
 
-out:
   return FALSE;
 }
 
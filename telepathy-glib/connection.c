@@ -1494,6 +1494,7 @@ tp_connection_init (TpConnection *self)
   self->priv->status = TP_UNKNOWN_CONNECTION_STATUS;
   self->priv->status_reason = TP_CONNECTION_STATUS_REASON_NONE_SPECIFIED;
   self->priv->contacts = g_hash_table_new (g_direct_hash, g_direct_equal);
+  self->priv->contact_info_fetches = g_hash_table_new (NULL, NULL);
   self->priv->introspection_call = NULL;
   self->priv->interests = tp_intset_new ();
   self->priv->contact_groups = g_ptr_array_new_with_free_func (g_free);
@@ -1519,6 +1520,10 @@ tp_connection_finalize (GObject *object)
 
   tp_clear_pointer (&self->priv->cm_name, g_free);
   tp_clear_pointer (&self->priv->proto_name, g_free);
+  /* every fetch holds a ref to us until it has finished */
+  g_assert (g_hash_table_size (self->priv->contact_info_fetches) == 0);
+  tp_clear_pointer (&self->priv->contact_info_fetches, g_hash_table_unref);
+  tp_clear_pointer (&self->priv->contact_info_cache_dir, g_free);
 
   /* not true unless we were finalized before we were ready */
   if (self->priv->introspect_needed != NULL)
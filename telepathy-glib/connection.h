@@ -186,6 +186,10 @@ void tp_connection_set_contact_info_async (TpConnection *self,
 gboolean tp_connection_set_contact_info_finish (TpConnection *self,
     GAsyncResult *result, GError **error);
 
+_TP_AVAILABLE_IN_UNRELEASED
+void tp_connection_set_contact_info_cache_enabled (TpConnection *self,
+    gboolean enabled);
+
 #ifndef TP_DISABLE_DEPRECATED
 _TP_DEPRECATED_IN_0_18_FOR (tp_proxy_is_prepared)
 gboolean tp_connection_is_ready (TpConnection *self);
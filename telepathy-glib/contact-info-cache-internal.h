@@ -0,0 +1,46 @@
+/*<private_header>*/
+/* On-disk cache of contacts' vCards - internal header
+ *
+ * Copyright © 2014 Collabora Ltd.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#ifndef __TP_CONTACT_INFO_CACHE_INTERNAL_H__
+#define __TP_CONTACT_INFO_CACHE_INTERNAL_H__
+
+#include <gio/gio.h>
+
+#include <telepathy-glib/connection.h>
+
+G_BEGIN_DECLS
+
+const gchar *_tp_contact_info_cache_get_dir (TpConnection *connection);
+
+void _tp_contact_info_cache_lookup_async (const gchar *dir,
+    const gchar * const *identifiers,
+    GAsyncReadyCallback callback,
+    gpointer user_data);
+GHashTable *_tp_contact_info_cache_lookup_finish (GAsyncResult *result,
+    GError **error);
+void _tp_contact_info_cache_store (const gchar *dir,
+    const gchar *identifier,
+    GList *fields);
+void _tp_contact_info_cache_prune (const gchar *dir);
+void _tp_contact_info_cache_clear (const gchar *dir);
+
+G_END_DECLS
+
+#endif
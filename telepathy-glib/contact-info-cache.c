@@ -0,0 +1,496 @@
+/*
+ * On-disk cache of contacts' vCards
+ *
+ * Copyright © 2014 Collabora Ltd.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include "config.h"
+
+#include "telepathy-glib/contact-info-cache-internal.h"
+
+#include <errno.h>
+
+#include <glib/gstdio.h>
+
+#include <telepathy-glib/account.h>
+#include <telepathy-glib/contact.h>
+#include <telepathy-glib/util.h>
+
+#include "telepathy-glib/connection-internal.h"
+
+#define DEBUG_FLAG TP_DEBUG_CONTACTS
+#include "telepathy-glib/debug-internal.h"
+
+/*
+ * Each account has a directory under $XDG_CACHE_HOME/telepathy/contact-info,
+ * holding one file per contact, named after a checksum of the contact's
+ * identifier. A file is a serialized CONTACT_INFO_CACHE_TYPE; entries are
+ * written to a temporary file and renamed into place, so readers never see
+ * a partial entry.
+ *
+ * All file access happens in a single worker thread, one job at a time
+ * and in the order the jobs were queued, so the main loop never waits for
+ * the disk, and an entry being saved cannot reappear after the cache has
+ * been cleared.
+ */
+
+/* Bump this whenever the layout of a cache entry changes. */
+#define CONTACT_INFO_CACHE_VERSION 1
+
+/* (version, identifier, time written in µs since the epoch,
+ *  ContactInfo fields) */
+#define CONTACT_INFO_CACHE_TYPE "(usxa(sasas))"
+
+/* Entries older than this are ignored and deleted, so that a contact's
+ * vCard is downloaded again now and then even if nothing signals a change,
+ * and so that the vCards of contacts who are no longer seen do not stay
+ * on disk forever. */
+#define CONTACT_INFO_CACHE_MAX_AGE (G_GINT64_CONSTANT (24) * 60 * 60 * \
+    G_USEC_PER_SEC)
+
+/*
+ * Returns: (transfer none): the directory in which @connection's contacts'
+ *  vCards are cached, or %NULL if it is not known yet
+ */
+const gchar *
+_tp_contact_info_cache_get_dir (TpConnection *connection)
+{
+  gchar *key;
+  gchar *checksum;
+
+  if (connection->priv->contact_info_cache_dir != NULL)
+    return connection->priv->contact_info_cache_dir;
+
+  if (connection->priv->account != NULL)
+    {
+      key = g_strdup (tp_proxy_get_object_path (
+            connection->priv->account));
+    }
+  else if (connection->priv->self_contact != NULL)
+    {
+      /* not created via an account: the closest equivalent is the
+       * protocol and the local user's identifier */
+      key = g_strdup_printf ("%s\n%s\n%s", connection->priv->cm_name,
+          connection->priv->proto_name,
+          tp_contact_get_identifier (connection->priv->self_contact));
+    }
+  else
+    {
+      return NULL;
+    }
+
+  checksum = g_compute_checksum_for_string (G_CHECKSUM_SHA1, key, -1);
+  connection->priv->contact_info_cache_dir = g_build_filename (
+      g_get_user_cache_dir (), "telepathy", "contact-info", checksum, NULL);
+
+  g_free (checksum);
+  g_free (key);
+
+  if (connection->priv->contact_info_cache_enabled)
+    _tp_contact_info_cache_prune (connection->priv->contact_info_cache_dir);
+
+  return connection->priv->contact_info_cache_dir;
+}
+
+typedef struct {
+    GTask *task;
+    GTaskThreadFunc func;
+} ContactInfoCacheJob;
+
+static void
+contact_info_cache_job_run (gpointer data,
+    gpointer unused G_GNUC_UNUSED)
+{
+  ContactInfoCacheJob *job = data;
+
+  job->func (job->task, g_task_get_source_object (job->task),
+      g_task_get_task_data (job->task), g_task_get_cancellable (job->task));
+
+  g_object_unref (job->task);
+  g_slice_free (ContactInfoCacheJob, job);
+}
+
+/* Like g_task_run_in_thread(), but in the cache's own thread, after any
+ * job queued before this one */
+static void
+contact_info_cache_run (GTask *task,
+    GTaskThreadFunc func)
+{
+  static gsize pool = 0;
+  ContactInfoCacheJob *job;
+
+  if (g_once_init_enter (&pool))
+    {
+      GThreadPool *p = g_thread_pool_new (contact_info_cache_job_run,
+          NULL, 1, FALSE, NULL);
+
+      g_once_init_leave (&pool, (gsize) p);
+    }
+
+  job = g_slice_new (ContactInfoCacheJob);
+  job->task = g_object_ref (task);
+  job->func = func;
+  g_thread_pool_push ((GThreadPool *) pool, job, NULL);
+}
+
+static void
+contact_info_cache_job_cb (GObject *source,
+    GAsyncResult *result,
+    gpointer user_data)
+{
+  GError *error = NULL;
+
+  if (!g_task_propagate_boolean (G_TASK (result), &error))
+    {
+      DEBUG ("contact info cache: %s", error->message);
+      g_error_free (error);
+    }
+}
+
+static gchar *
+contact_info_cache_path (const gchar *dir,
+    const gchar *identifier)
+{
+  gchar *checksum = g_compute_checksum_for_string (G_CHECKSUM_SHA1,
+      identifier, -1);
+  gchar *basename = g_strdup_printf ("%s.cache", checksum);
+  gchar *path = g_build_filename (dir, basename, NULL);
+
+  g_free (basename);
+  g_free (checksum);
+  return path;
+}
+
+/*
+ * Called in the cache's thread.
+ *
+ * @fields: (out) (transfer full): used to return a list of
+ *  #TpContactInfoField, which may be empty
+ *
+ * Returns: %TRUE if there is a recent enough entry for @identifier. Stale
+ *  entries are deleted.
+ */
+static gboolean
+contact_info_cache_read (const gchar *dir,
+    const gchar *identifier,
+    GList **fields)
+{
+  gchar *path = contact_info_cache_path (dir, identifier);
+  GMappedFile *mapped;
+  GBytes *bytes;
+  GVariant *entry;
+  GVariantIter *iter;
+  guint32 version;
+  const gchar *cached_identifier;
+  gint64 written;
+  const gchar *field_name;
+  gchar **parameters;
+  gchar **field_value;
+  GList *list = NULL;
+
+  mapped = g_mapped_file_new (path, FALSE, NULL);
+
+  if (mapped == NULL)
+    {
+      g_free (path);
+      return FALSE;
+    }
+
+  bytes = g_mapped_file_get_bytes (mapped);
+  g_mapped_file_unref (mapped);
+
+  /* the cache is not trusted: GVariant copes with corrupt serialized data,
+   * and we check the header below */
+  entry = g_variant_ref_sink (g_variant_new_from_bytes (
+        G_VARIANT_TYPE (CONTACT_INFO_CACHE_TYPE), bytes, FALSE));
+  g_bytes_unref (bytes);
+
+  g_variant_get (entry, "(u&sxa(sasas))", &version, &cached_identifier,
+      &written, &iter);
+
+  if (version != CONTACT_INFO_CACHE_VERSION ||
+      tp_strdiff (cached_identifier, identifier) ||
+      written + CONTACT_INFO_CACHE_MAX_AGE < g_get_real_time ())
+    {
+      DEBUG ("cache entry %s for %s is stale, deleting it", path,
+          identifier);
+      g_variant_iter_free (iter);
+      g_variant_unref (entry);
+      g_unlink (path);
+      g_free (path);
+      return FALSE;
+    }
+
+  while (g_variant_iter_loop (iter, "(&s^as^as)", &field_name, &parameters,
+        &field_value))
+    list = g_list_prepend (list,
+        tp_contact_info_field_new (field_name, parameters, field_value));
+
+  g_variant_iter_free (iter);
+  g_variant_unref (entry);
+  g_free (path);
+
+  *fields = g_list_reverse (list);
+  return TRUE;
+}
+
+typedef struct {
+    gchar *dir;
+    gchar **identifiers;
+} ContactInfoCacheLookup;
+
+static void
+contact_info_cache_lookup_free (gpointer p)
+{
+  ContactInfoCacheLookup *lookup = p;
+
+  g_free (lookup->dir);
+  g_strfreev (lookup->identifiers);
+  g_slice_free (ContactInfoCacheLookup, lookup);
+}
+
+static void
+contact_info_cache_lookup_thread (GTask *task,
+    gpointer source_object,
+    gpointer task_data,
+    GCancellable *cancellable)
+{
+  ContactInfoCacheLookup *lookup = task_data;
+  GHashTable *entries;
+  guint i;
+
+  entries = g_hash_table_new_full (g_str_hash, g_str_equal, g_free,
+      (GDestroyNotify) tp_contact_info_list_free);
+
+  for (i = 0; lookup->identifiers[i] != NULL; i++)
+    {
+      const gchar *identifier = lookup->identifiers[i];
+      GList *fields;
+
+      if (!g_hash_table_contains (entries, identifier) &&
+          contact_info_cache_read (lookup->dir, identifier, &fields))
+        g_hash_table_insert (entries, g_strdup (identifier), fields);
+    }
+
+  g_task_return_pointer (task, entries, (GDestroyNotify) g_hash_table_unref);
+}
+
+/*
+ * @identifiers: the identifiers of the contacts whose vCards are wanted
+ *
+ * Read the entries for all of @identifiers at once, without blocking the
+ * main loop; call _tp_contact_info_cache_lookup_finish() from @callback
+ * to get them.
+ */
+void
+_tp_contact_info_cache_lookup_async (const gchar *dir,
+    const gchar * const *identifiers,
+    GAsyncReadyCallback callback,
+    gpointer user_data)
+{
+  ContactInfoCacheLookup *lookup;
+  GTask *task;
+
+  lookup = g_slice_new (ContactInfoCacheLookup);
+  lookup->dir = g_strdup (dir);
+  lookup->identifiers = g_strdupv ((gchar **) identifiers);
+
+  task = g_task_new (NULL, NULL, callback, user_data);
+  g_task_set_task_data (task, lookup, contact_info_cache_lookup_free);
+  contact_info_cache_run (task, contact_info_cache_lookup_thread);
+  g_object_unref (task);
+}
+
+/*
+ * Returns: (transfer full): a map from the identifier of each contact
+ *  which has a recent enough entry to its vCard, a list of
+ *  #TpContactInfoField which may be empty
+ */
+GHashTable *
+_tp_contact_info_cache_lookup_finish (GAsyncResult *result,
+    GError **error)
+{
+  return g_task_propagate_pointer (G_TASK (result), error);
+}
+
+static void
+contact_info_cache_write_thread (GTask *task,
+    gpointer source_object,
+    gpointer task_data,
+    GCancellable *cancellable)
+{
+  GVariant *entry = task_data;
+  const gchar *path = g_object_get_data ((GObject *) task, "path");
+  GError *error = NULL;
+  gchar *dir;
+
+  dir = g_path_get_dirname (path);
+
+  if (g_mkdir_with_parents (dir, 0700) != 0)
+    {
+      int e = errno;
+
+      g_task_return_new_error (task, G_IO_ERROR, g_io_error_from_errno (e),
+          "Unable to create %s: %s", dir, g_strerror (e));
+    }
+  else if (g_file_set_contents (path, g_variant_get_data (entry),
+        g_variant_get_size (entry), &error))
+    {
+      g_task_return_boolean (task, TRUE);
+    }
+  else
+    {
+      g_task_return_error (task, error);
+    }
+
+  g_free (dir);
+}
+
+/*
+ * @fields: (transfer none): a list of #TpContactInfoField
+ *
+ * Replace the entry for @identifier with @fields, in the background.
+ */
+void
+_tp_contact_info_cache_store (const gchar *dir,
+    const gchar *identifier,
+    GList *fields)
+{
+  GVariantBuilder builder;
+  GVariant *entry;
+  GTask *task;
+  GList *l;
+
+  g_variant_builder_init (&builder, G_VARIANT_TYPE ("a(sasas)"));
+
+  for (l = fields; l != NULL; l = l->next)
+    {
+      TpContactInfoField *field = l->data;
+
+      g_variant_builder_add (&builder, "(s^as^as)", field->field_name,
+          field->parameters, field->field_value);
+    }
+
+  entry = g_variant_ref_sink (g_variant_new ("(usxa(sasas))",
+        CONTACT_INFO_CACHE_VERSION, identifier, g_get_real_time (),
+        &builder));
+
+  task = g_task_new (NULL, NULL, contact_info_cache_job_cb, NULL);
+  g_task_set_task_data (task, entry, (GDestroyNotify) g_variant_unref);
+  g_object_set_data_full ((GObject *) task, "path",
+      contact_info_cache_path (dir, identifier), g_free);
+  contact_info_cache_run (task, contact_info_cache_write_thread);
+  g_object_unref (task);
+}
+
+/* Called in the cache's thread: delete the files in @dir_path which were
+ * last written more than @max_age µs ago, or all of them if @max_age is 0.
+ * This includes any temporary file left behind by an interrupted write. */
+static void
+contact_info_cache_delete_entries (const gchar *dir_path,
+    gint64 max_age)
+{
+  GDir *dir = g_dir_open (dir_path, 0, NULL);
+  gint64 now = g_get_real_time ();
+  const gchar *name;
+
+  /* nothing was ever saved */
+  if (dir == NULL)
+    return;
+
+  while ((name = g_dir_read_name (dir)) != NULL)
+    {
+      gchar *path = g_build_filename (dir_path, name, NULL);
+      GStatBuf st;
+
+      if (max_age == 0 ||
+          (g_stat (path, &st) == 0 &&
+           (gint64) st.st_mtime * G_USEC_PER_SEC + max_age < now))
+        {
+          DEBUG ("deleting %s", path);
+
+          if (g_unlink (path) != 0)
+            DEBUG ("failed to delete %s: %s", path, g_strerror (errno));
+        }
+
+      g_free (path);
+    }
+
+  g_dir_close (dir);
+}
+
+static void
+contact_info_cache_prune_thread (GTask *task,
+    gpointer source_object,
+    gpointer task_data,
+    GCancellable *cancellable)
+{
+  contact_info_cache_delete_entries (task_data, CONTACT_INFO_CACHE_MAX_AGE);
+  g_task_return_boolean (task, TRUE);
+}
+
+/*
+ * Delete the entries in @dir which are too old to be used, in the
+ * background.
+ */
+void
+_tp_contact_info_cache_prune (const gchar *dir)
+{
+  GTask *task;
+
+  task = g_task_new (NULL, NULL, contact_info_cache_job_cb, NULL);
+  g_task_set_task_data (task, g_strdup (dir), g_free);
+  contact_info_cache_run (task, contact_info_cache_prune_thread);
+  g_object_unref (task);
+}
+
+static void
+contact_info_cache_clear_thread (GTask *task,
+    gpointer source_object,
+    gpointer task_data,
+    GCancellable *cancellable)
+{
+  const gchar *dir = task_data;
+
+  contact_info_cache_delete_entries (dir, 0);
+
+  if (g_rmdir (dir) != 0 && errno != ENOENT)
+    {
+      int e = errno;
+
+      g_task_return_new_error (task, G_IO_ERROR, g_io_error_from_errno (e),
+          "Unable to delete %s: %s", dir, g_strerror (e));
+      return;
+    }
+
+  g_task_return_boolean (task, TRUE);
+}
+
+/*
+ * Delete @dir and all the entries in it, in the background, after any
+ * entry being saved has been written.
+ */
+void
+_tp_contact_info_cache_clear (const gchar *dir)
+{
+  GTask *task;
+
+  task = g_task_new (NULL, NULL, contact_info_cache_job_cb, NULL);
+  g_task_set_task_data (task, g_strdup (dir), g_free);
+  contact_info_cache_run (task, contact_info_cache_clear_thread);
+  g_object_unref (task);
+}
@@ -35,6 +35,13 @@ gboolean _tp_contact_set_attributes (TpContact *contact,
     const TpContactFeature *features,
     GError **error);
 
+typedef void (*TpContactsDeferredInfoCb) (gpointer user_data);
+
+void _tp_contacts_load_deferred_info (TpConnection *connection,
+    GPtrArray *contacts,
+    TpContactsDeferredInfoCb callback,
+    gpointer user_data);
+
 const gchar **_tp_contacts_bind_to_signals (TpConnection *connection,
     guint n_features,
     const TpContactFeature *features);
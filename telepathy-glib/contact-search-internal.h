@@ -32,6 +32,9 @@ TpContactSearchResult *_tp_contact_search_result_new (const gchar *identifier);
 
 void _tp_contact_search_result_insert_field (TpContactSearchResult *self,
     TpContactInfoField *field);
+void _tp_contact_search_result_set_raw_fields (TpContactSearchResult *self,
+    GHashTable *batch,
+    const GPtrArray *raw_fields);
 
 G_END_DECLS
 
@@ -72,6 +72,10 @@ struct _TpContactSearchResultPrivate
   gchar *identifier;
   /* List of TpContactInfoField. The list and its contents are owned by us. */
   GList *fields;
+  /* If not NULL, fields as received from D-Bus, which are added to @fields
+   * when somebody first asks for them; @raw_batch keeps them alive */
+  const GPtrArray *raw_fields;
+  GHashTable *raw_batch;
 };
 
 enum /* properties */
@@ -89,6 +93,34 @@ find_tp_contact_info_field (gconstpointer f,
   return g_strcmp0 (field->field_name, n);
 }
 
+static void
+ensure_fields (TpContactSearchResult *self)
+{
+  const GPtrArray *raw = self->priv->raw_fields;
+  guint i;
+
+  if (raw == NULL)
+    return;
+
+  /* Prepending gives the same order as appending the fields in reverse,
+   * as we used to */
+  for (i = 0; i < raw->len; i++)
+    {
+      gchar *field;
+      gchar **parameters;
+      gchar **values;
+
+      tp_value_array_unpack (g_ptr_array_index (raw, i), 3,
+          &field, &parameters, &values);
+
+      self->priv->fields = g_list_prepend (self->priv->fields,
+          tp_contact_info_field_new (field, parameters, values));
+    }
+
+  self->priv->raw_fields = NULL;
+  tp_clear_pointer (&self->priv->raw_batch, g_hash_table_unref);
+}
+
 static void
 tp_contact_search_result_set_property (GObject *object,
     guint prop_id,
@@ -138,6 +170,8 @@ tp_contact_search_result_dispose (GObject *object)
   tp_clear_pointer (&self->priv->identifier, g_free);
 
   tp_clear_pointer (&self->priv->fields, tp_contact_info_list_free);
+  self->priv->raw_fields = NULL;
+  tp_clear_pointer (&self->priv->raw_batch, g_hash_table_unref);
 
   G_OBJECT_CLASS (tp_contact_search_result_parent_class)->dispose (object);
 }
@@ -188,12 +222,35 @@ _tp_contact_search_result_new (const gchar *identifier)
       NULL);
 }
 
+/*
+ * _tp_contact_search_result_set_raw_fields:
+ * @self: a search result with no fields yet
+ * @batch: a map from identifiers to contact info, as in SearchResultReceived
+ * @raw_fields: the contact info in @batch for @self
+ *
+ * Give @self fields which are only turned into #TpContactInfoField
+ * structures when they are needed. @batch is referenced until then.
+ */
+void
+_tp_contact_search_result_set_raw_fields (TpContactSearchResult *self,
+    GHashTable *batch,
+    const GPtrArray *raw_fields)
+{
+  g_return_if_fail (TP_IS_CONTACT_SEARCH_RESULT (self));
+  g_return_if_fail (self->priv->fields == NULL);
+  g_return_if_fail (self->priv->raw_fields == NULL);
+
+  self->priv->raw_fields = raw_fields;
+  self->priv->raw_batch = g_hash_table_ref (batch);
+}
+
 void
 _tp_contact_search_result_insert_field (TpContactSearchResult *self,
     TpContactInfoField *field)
 {
   g_return_if_fail (TP_IS_CONTACT_SEARCH_RESULT (self));
 
+  ensure_fields (self);
   self->priv->fields = g_list_append (self->priv->fields, field);
 }
 
@@ -235,6 +292,7 @@ tp_contact_search_result_get_field (TpContactSearchResult *self,
 
   g_return_val_if_fail (TP_IS_CONTACT_SEARCH_RESULT (self), NULL);
 
+  ensure_fields (self);
   l = g_list_find_custom (self->priv->fields,
       field,
       find_tp_contact_info_field);
@@ -259,6 +317,7 @@ tp_contact_search_result_get_fields (TpContactSearchResult *self)
 {
   g_return_val_if_fail (TP_IS_CONTACT_SEARCH_RESULT (self), NULL);
 
+  ensure_fields (self);
   return g_list_copy (self->priv->fields);
 }
 
@@ -278,6 +337,7 @@ tp_contact_search_result_dup_fields (TpContactSearchResult *self)
 {
   g_return_val_if_fail (TP_IS_CONTACT_SEARCH_RESULT (self), NULL);
 
+  ensure_fields (self);
   return _tp_g_list_copy_deep (self->priv->fields,
       (GCopyFunc) tp_contact_info_field_copy, NULL);
 }
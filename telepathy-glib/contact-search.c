@@ -94,6 +94,8 @@ struct _TpContactSearchPrivate
   gchar *server;
   guint limit;
   const gchar * const *keys;
+  /* number of results reported since the search started */
+  guint n_results;
 
   GCancellable *cancellable;
   GSimpleAsyncResult *async_res;
@@ -153,35 +155,43 @@ _search_results_received (TpChannel *channel,
     gpointer user_data,
     GObject *object)
 {
+  TpContactSearch *self = TP_CONTACT_SEARCH (object);
   GHashTableIter iter;
-  gchar *contact;
-  GPtrArray *info;
+  gpointer contact, info;
   GList *results = NULL;
+  guint max = G_MAXUINT;
+  guint n = 0;
+
+  /* Not every server honours the limit */
+  if (self->priv->limit != 0)
+    {
+      if (self->priv->n_results >= self->priv->limit)
+        {
+          DEBUG ("SearchResultsReceived (%u results), ignored: limit of %u "
+              "already reached", g_hash_table_size (result),
+              self->priv->limit);
+          return;
+        }
+
+      max = self->priv->limit - self->priv->n_results;
+    }
 
   g_hash_table_iter_init (&iter, result);
-  while (g_hash_table_iter_next (&iter, (gpointer) &contact, (gpointer) &info))
+  while (n < max && g_hash_table_iter_next (&iter, &contact, &info))
     {
       TpContactSearchResult *search_result;
-      char *field;
-      char **parameters;
-      char **values;
-      gint i;
 
+      /* The fields are only converted if somebody looks at them */
       search_result = _tp_contact_search_result_new (contact);
-
-      for (i = info->len - 1; i >= 0; i--)
-        {
-          TpContactInfoField *contact_field;
-          tp_value_array_unpack (g_ptr_array_index (info, i), 3,
-              &field, &parameters, &values);
-
-          contact_field = tp_contact_info_field_new (field, parameters, values);
-          _tp_contact_search_result_insert_field (search_result, contact_field);
-        }
+      _tp_contact_search_result_set_raw_fields (search_result, result, info);
       results = g_list_prepend (results, search_result);
+      n++;
     }
 
-  DEBUG ("SearchResultsReceived (%i results)", g_hash_table_size (result));
+  self->priv->n_results += n;
+
+  DEBUG ("SearchResultsReceived (%u results, %u reported)",
+      g_hash_table_size (result), n);
   g_signal_emit (object, _signals[SEARCH_RESULTS_RECEIVED], 0, results);
 
   g_list_free_full (results, g_object_unref);
@@ -468,6 +478,9 @@ tp_contact_search_class_init (TpContactSearchClass *klass)
    * Emitted when search results are received. Note that this signal may
    * be emitted multiple times for the same search.
    *
+   * If #TpContactSearch:limit is non-zero, no more than that many results
+   * are reported for each search, even if the server returns more.
+   *
    * Since: 0.13.11
    */
   _signals[SEARCH_RESULTS_RECEIVED] = g_signal_new ("search-results-received",
@@ -662,6 +675,8 @@ tp_contact_search_start (TpContactSearch *self,
   g_return_if_fail (self->priv->state ==
       TP_CHANNEL_CONTACT_SEARCH_STATE_NOT_STARTED);
 
+  self->priv->n_results = 0;
+
   tp_cli_channel_type_contact_search_call_search (self->priv->channel,
       -1, criteria, NULL, NULL, NULL, NULL);
 }
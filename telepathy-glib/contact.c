@@ -35,6 +35,7 @@
 #include "telepathy-glib/base-contact-list-internal.h"
 #include "telepathy-glib/connection-contact-list.h"
 #include "telepathy-glib/connection-internal.h"
+#include "telepathy-glib/contact-info-cache-internal.h"
 #include "telepathy-glib/contact-internal.h"
 #include "telepathy-glib/debug-internal.h"
 #include "telepathy-glib/util-internal.h"
@@ -255,6 +256,12 @@ struct _TpContactPrivate {
 
     /* a list of TpContactInfoField */
     GList *contact_info;
+    /* TRUE if contact_info was loaded from the on-disk cache, and has not
+     * been confirmed by the CM since */
+    gboolean contact_info_from_cache;
+    /* TRUE if the CM did not have a vCard for this contact, and its saved
+     * one is being looked up: see contacts_load_deferred_info() */
+    gboolean contact_info_deferred;
 
     /* Subscribe/Publish states */
     TpSubscriptionState subscribe;
@@ -3252,37 +3259,302 @@ contacts_get_avatar_tokens (ContactsContext *c)
   contacts_context_continue (c);
 }
 
+static gboolean
+contact_info_strv_equal (const gchar * const *a,
+    const gchar * const *b)
+{
+  static const gchar * const empty[] = { NULL };
+  guint i;
+
+  if (a == NULL)
+    a = empty;
+
+  if (b == NULL)
+    b = empty;
+
+  for (i = 0; a[i] != NULL && b[i] != NULL; i++)
+    {
+      if (tp_strdiff (a[i], b[i]))
+        return FALSE;
+    }
+
+  return (a[i] == NULL && b[i] == NULL);
+}
+
+/* @fields: a list of TpContactInfoField
+ * @contact_info: a TP_ARRAY_TYPE_CONTACT_INFO_FIELD_LIST, or NULL */
+static gboolean
+contact_info_equals (GList *fields,
+    const GPtrArray *contact_info)
+{
+  guint i;
+
+  for (i = 0; contact_info != NULL && i < contact_info->len; i++)
+    {
+      GValueArray *va = g_ptr_array_index (contact_info, i);
+      TpContactInfoField *field;
+      const gchar *field_name;
+      GStrv parameters;
+      GStrv field_value;
+
+      if (fields == NULL)
+        return FALSE;
+
+      field = fields->data;
+      tp_value_array_unpack (va, 3, &field_name, &parameters, &field_value);
+
+      if (tp_strdiff (field->field_name, field_name) ||
+          !contact_info_strv_equal ((const gchar * const *) field->parameters,
+            (const gchar * const *) parameters) ||
+          !contact_info_strv_equal (
+            (const gchar * const *) field->field_value,
+            (const gchar * const *) field_value))
+        return FALSE;
+
+      fields = fields->next;
+    }
+
+  return (fields == NULL);
+}
+
+/* Takes ownership of @fields. */
+static void
+contact_set_info_list (TpContact *self,
+    GList *fields,
+    gboolean from_cache)
+{
+  tp_contact_info_list_free (self->priv->contact_info);
+  self->priv->contact_info = fields;
+  self->priv->contact_info_from_cache = from_cache;
+  self->priv->contact_info_deferred = FALSE;
+
+  self->priv->has_features |= CONTACT_FEATURE_FLAG_CONTACT_INFO;
+
+  g_object_notify ((GObject *) self, "contact-info");
+}
+
+static const gchar *
+contact_get_info_cache_dir (TpContact *self)
+{
+  if (!self->priv->connection->priv->contact_info_cache_enabled ||
+      self->priv->identifier == NULL)
+    return NULL;
+
+  return _tp_contact_info_cache_get_dir (self->priv->connection);
+}
+
+/* Replace @self's vCard with its entry in @entries, a result of
+ * _tp_contact_info_cache_lookup_finish() which may be %NULL, unless the CM
+ * has given us one in the meantime. Returns TRUE if the entry was used. */
+static gboolean
+contact_use_cached_info (TpContact *self,
+    GHashTable *entries)
+{
+  GList *fields;
+
+  if (entries == NULL || self->priv->identifier == NULL)
+    return FALSE;
+
+  if ((self->priv->has_features & CONTACT_FEATURE_FLAG_CONTACT_INFO) != 0 &&
+      !self->priv->contact_info_from_cache)
+    return FALSE;
+
+  if (!g_hash_table_lookup_extended (entries, self->priv->identifier, NULL,
+        (gpointer *) &fields))
+    return FALSE;
+
+  DEBUG ("Using cached vCard for %s", self->priv->identifier);
+  contact_set_info_list (self, tp_contact_info_list_copy (fields), TRUE);
+  return TRUE;
+}
+
+/* Start looking up the saved vCards of @contacts, all at once. Returns
+ * FALSE, and does not call @callback, if the cache is disabled. */
+static gboolean
+contacts_lookup_cached_info (TpConnection *connection,
+    GPtrArray *contacts,
+    GAsyncReadyCallback callback,
+    gpointer user_data)
+{
+  GPtrArray *identifiers;
+  const gchar *dir;
+  guint i;
+
+  if (!connection->priv->contact_info_cache_enabled)
+    return FALSE;
+
+  dir = _tp_contact_info_cache_get_dir (connection);
+
+  if (dir == NULL)
+    return FALSE;
+
+  identifiers = g_ptr_array_sized_new (contacts->len + 1);
+
+  for (i = 0; i < contacts->len; i++)
+    {
+      TpContact *contact = g_ptr_array_index (contacts, i);
+
+      if (contact->priv->identifier != NULL)
+        g_ptr_array_add (identifiers, contact->priv->identifier);
+    }
+
+  g_ptr_array_add (identifiers, NULL);
+
+  _tp_contact_info_cache_lookup_async (dir,
+      (const gchar * const *) identifiers->pdata, callback, user_data);
+
+  g_ptr_array_unref (identifiers);
+  return TRUE;
+}
+
 static void
 contact_maybe_set_info (TpContact *self,
     const GPtrArray *contact_info)
 {
+  const gchar *dir;
+  GList *fields = NULL;
   guint i;
 
   if (self == NULL)
     return;
 
-  tp_contact_info_list_free (self->priv->contact_info);
-  self->priv->contact_info = NULL;
+  dir = contact_get_info_cache_dir (self);
 
-  self->priv->has_features |= CONTACT_FEATURE_FLAG_CONTACT_INFO;
+  /* The same vCard is often signalled more than once, for instance by
+   * ContactInfoChanged and then in reply to RequestContactInfo. Keep the
+   * fields we already have, so that the lists returned by
+   * tp_contact_get_contact_info() stay valid and nothing is notified. */
+  if ((self->priv->has_features & CONTACT_FEATURE_FLAG_CONTACT_INFO) != 0 &&
+      contact_info_equals (self->priv->contact_info, contact_info))
+    {
+      /* ... but a cached vCard the CM has confirmed is fresh again */
+      if (self->priv->contact_info_from_cache && dir != NULL)
+        _tp_contact_info_cache_store (dir, self->priv->identifier,
+            self->priv->contact_info);
+
+      self->priv->contact_info_from_cache = FALSE;
+      return;
+    }
+
+  /* else we don't know, but an empty list is perfectly valid; it is not
+   * saved, so that it does not replace a vCard we saved earlier. */
+  if (contact_info == NULL)
+    {
+      contact_set_info_list (self, NULL, FALSE);
+      return;
+    }
+
+  /* in the same order as @contact_info, which contact_info_equals()
+   * relies on */
+  for (i = 0; i < contact_info->len; i++)
+    {
+      GValueArray *va = g_ptr_array_index (contact_info, i);
+      const gchar *field_name;
+      GStrv parameters;
+      GStrv field_value;
+
+      tp_value_array_unpack (va, 3, &field_name, &parameters, &field_value);
+      fields = g_list_prepend (fields,
+          tp_contact_info_field_new (field_name, parameters, field_value));
+    }
+
+  contact_set_info_list (self, g_list_reverse (fields), FALSE);
+
+  if (dir != NULL)
+    _tp_contact_info_cache_store (dir, self->priv->identifier,
+        self->priv->contact_info);
+}
+
+typedef struct
+{
+  /* owned TpContact */
+  GPtrArray *contacts;
+  TpContactsDeferredInfoCb callback;
+  gpointer user_data;
+} DeferredInfoLoad;
 
-  if (contact_info != NULL)
+static void
+contacts_deferred_info_loaded (GObject *source,
+    GAsyncResult *result,
+    gpointer user_data)
+{
+  DeferredInfoLoad *load = user_data;
+  GHashTable *entries = NULL;
+  GError *error = NULL;
+  guint i;
+
+  if (result != NULL)
     {
-      for (i = contact_info->len; i > 0; i--)
+      entries = _tp_contact_info_cache_lookup_finish (result, &error);
+
+      if (entries == NULL)
         {
-          GValueArray *va = g_ptr_array_index (contact_info, i - 1);
-          const gchar *field_name;
-          GStrv parameters;
-          GStrv field_value;
-
-          tp_value_array_unpack (va, 3, &field_name, &parameters, &field_value);
-          self->priv->contact_info = g_list_prepend (self->priv->contact_info,
-              tp_contact_info_field_new (field_name, parameters, field_value));
+          DEBUG ("Failed to read cached vCards: %s", error->message);
+          g_clear_error (&error);
         }
     }
-  /* else we don't know, but an empty list is perfectly valid. */
 
-  g_object_notify ((GObject *) self, "contact-info");
+  for (i = 0; i < load->contacts->len; i++)
+    {
+      TpContact *contact = g_ptr_array_index (load->contacts, i);
+
+      /* the CM has given us its vCard in the meantime */
+      if (!contact->priv->contact_info_deferred)
+        continue;
+
+      if (!contact_use_cached_info (contact, entries))
+        contact_maybe_set_info (contact, NULL);
+    }
+
+  tp_clear_pointer (&entries, g_hash_table_unref);
+
+  if (load->callback != NULL)
+    load->callback (load->user_data);
+
+  g_ptr_array_unref (load->contacts);
+  g_slice_free (DeferredInfoLoad, load);
+}
+
+/* Give those of @contacts whose attributes did not include a vCard (see
+ * tp_contact_set_attributes()) their saved one, or an empty one if there is
+ * none, as they would have had without the cache. Their saved vCards are
+ * read all at once without blocking the main loop, then @callback is
+ * called. */
+static void
+contacts_load_deferred_info (TpConnection *connection,
+    GPtrArray *contacts,
+    TpContactsDeferredInfoCb callback,
+    gpointer user_data)
+{
+  DeferredInfoLoad *load;
+  guint i;
+
+  load = g_slice_new (DeferredInfoLoad);
+  load->contacts = g_ptr_array_new_with_free_func (g_object_unref);
+  load->callback = callback;
+  load->user_data = user_data;
+
+  for (i = 0; i < contacts->len; i++)
+    {
+      TpContact *contact = g_ptr_array_index (contacts, i);
+
+      if (contact->priv->contact_info_deferred)
+        g_ptr_array_add (load->contacts, g_object_ref (contact));
+    }
+
+  if (load->contacts->len == 0 ||
+      !contacts_lookup_cached_info (connection, load->contacts,
+        contacts_deferred_info_loaded, load))
+    contacts_deferred_info_loaded (NULL, NULL, load);
+}
+
+void
+_tp_contacts_load_deferred_info (TpConnection *connection,
+    GPtrArray *contacts,
+    TpContactsDeferredInfoCb callback,
+    gpointer user_data)
+{
+  contacts_load_deferred_info (connection, contacts, callback, user_data);
 }
 
 static void
@@ -3339,125 +3611,310 @@ contacts_bind_to_contact_info_changed (TpConnection *connection)
     }
 }
 
+static void
+contacts_get_contact_info_from_cm (ContactsContext *c)
+{
+  GArray *handles = NULL;
+  guint i;
+
+  for (i = 0; i < c->contacts->len; i++)
+    {
+      TpContact *contact = g_ptr_array_index (c->contacts, i);
+
+      if ((contact->priv->has_features &
+            CONTACT_FEATURE_FLAG_CONTACT_INFO) != 0)
+        continue;
+
+      if (handles == NULL)
+        handles = g_array_new (FALSE, FALSE, sizeof (TpHandle));
+
+      g_array_append_val (handles, contact->priv->handle);
+    }
+
+  if (handles != NULL)
+    {
+      c->refcount++;
+      tp_cli_connection_interface_contact_info_call_get_contact_info (
+          c->connection, -1, handles, contacts_got_contact_info,
+          c, contacts_context_unref, c->weak_object);
+      g_array_unref (handles);
+      return;
+    }
+
+  contacts_context_continue (c);
+}
+
+static void
+contacts_got_cached_contact_info (GObject *source,
+    GAsyncResult *result,
+    gpointer user_data)
+{
+  ContactsContext *c = user_data;
+  GHashTable *entries;
+  GError *error = NULL;
+  guint i;
+
+  entries = _tp_contact_info_cache_lookup_finish (result, &error);
+
+  if (entries == NULL)
+    {
+      DEBUG ("Failed to read cached vCards: %s", error->message);
+      g_clear_error (&error);
+    }
+  else
+    {
+      for (i = 0; i < c->contacts->len; i++)
+        contact_use_cached_info (g_ptr_array_index (c->contacts, i), entries);
+
+      g_hash_table_unref (entries);
+    }
+
+  /* ask the CM for the rest */
+  contacts_get_contact_info_from_cm (c);
+  contacts_context_unref (c);
+}
+
 static void
 contacts_get_contact_info (ContactsContext *c)
 {
+  GPtrArray *missing;
   guint i;
 
   g_assert (c->handles->len == c->contacts->len);
 
   contacts_bind_to_contact_info_changed (c->connection);
 
+  missing = g_ptr_array_new ();
+
   for (i = 0; i < c->contacts->len; i++)
     {
       TpContact *contact = g_ptr_array_index (c->contacts, i);
 
-      if ((contact->priv->has_features & CONTACT_FEATURE_FLAG_CONTACT_INFO) == 0)
-        {
-          c->refcount++;
-          tp_cli_connection_interface_contact_info_call_get_contact_info (
-              c->connection, -1, c->handles, contacts_got_contact_info,
-              c, contacts_context_unref, c->weak_object);
-          return;
-        }
+      if ((contact->priv->has_features &
+            CONTACT_FEATURE_FLAG_CONTACT_INFO) == 0)
+        g_ptr_array_add (missing, contact);
     }
 
-  contacts_context_continue (c);
+  /* c->contacts keeps them alive while their saved vCards are read */
+  if (missing->len > 0 &&
+      contacts_lookup_cached_info (c->connection, missing,
+        contacts_got_cached_contact_info, c))
+    c->refcount++;
+  else
+    contacts_get_contact_info_from_cm (c);
+
+  g_ptr_array_unref (missing);
 }
 
+/* Concurrent requests for the same contact's vCard share one
+ * RequestContactInfo call, which is only cancelled once every request
+ * waiting for it has been cancelled. */
+
+typedef struct _ContactInfoFetch ContactInfoFetch;
+
+typedef void (*ContactInfoFetchCb) (const GError *error,
+    gpointer user_data);
+
 typedef struct
 {
-  TpContact *contact;
-  GSimpleAsyncResult *result;
-  TpProxyPendingCall *call;
+  /* borrowed; NULL once the waiter has been called back */
+  ContactInfoFetch *fetch;
+  ContactInfoFetchCb callback;
+  gpointer user_data;
   GCancellable *cancellable;
   gulong cancelled_id;
-} ContactInfoRequestData;
+} ContactInfoWaiter;
+
+struct _ContactInfoFetch
+{
+  /* borrowed: the pending call keeps it alive */
+  TpConnection *connection;
+  TpHandle handle;
+  TpProxyPendingCall *call;
+  /* owned ContactInfoWaiter */
+  GQueue waiters;
+};
 
 static void
-contact_info_request_data_free (ContactInfoRequestData *data)
+contact_info_waiter_free (ContactInfoWaiter *waiter)
 {
-  if (data != NULL)
-    {
-      g_object_unref (data->result);
+  if (waiter->cancellable != NULL)
+    g_object_unref (waiter->cancellable);
+
+  g_slice_free (ContactInfoWaiter, waiter);
+}
 
-      if (data->cancellable != NULL)
-        g_object_unref (data->cancellable);
+/* Called when the pending call is destroyed, after it has either replied
+ * or been cancelled. */
+static void
+contact_info_fetch_free (gpointer p)
+{
+  ContactInfoFetch *fetch = p;
+  GHashTable *fetches = fetch->connection->priv->contact_info_fetches;
 
-      g_slice_free (ContactInfoRequestData, data);
-    }
+  g_assert (g_queue_is_empty (&fetch->waiters));
+
+  if (g_hash_table_lookup (fetches, GUINT_TO_POINTER (fetch->handle)) ==
+      fetch)
+    g_hash_table_remove (fetches, GUINT_TO_POINTER (fetch->handle));
+
+  g_slice_free (ContactInfoFetch, fetch);
 }
 
 static void
-contact_info_request_cb (TpConnection *connection,
+contact_info_fetch_cb (TpConnection *connection,
     const GPtrArray *contact_info,
     const GError *error,
     gpointer user_data,
     GObject *weak_object)
 {
-  ContactInfoRequestData *data = user_data;
-  TpContact *self = data->contact;
-
-  if (data->cancellable != NULL)
-    {
-      /* At this point it's too late to cancel the operation. This will block
-       * until the signal handler has finished if it's already running, so
-       * we're guaranteed to never be in a partially-cancelled state after
-       * this call. */
-      g_cancellable_disconnect (data->cancellable, data->cancelled_id);
-
-      /* If this is true, the cancelled callback has already run and completed the
-       * async result, so just bail. */
-      if (data->cancelled_id == 0)
-        return;
+  ContactInfoFetch *fetch = user_data;
+  ContactInfoWaiter *waiter;
 
-      data->cancelled_id = 0;
-    }
+  /* From now on, requests for this contact must start a new call */
+  g_hash_table_remove (connection->priv->contact_info_fetches,
+      GUINT_TO_POINTER (fetch->handle));
+  fetch->call = NULL;
 
   if (error != NULL)
     {
       DEBUG ("Failed to request ContactInfo: %s", error->message);
-      g_simple_async_result_set_from_error (data->result, error);
     }
   else
     {
-      contact_maybe_set_info (self, contact_info);
+      contact_maybe_set_info (
+          _tp_connection_lookup_contact (connection, fetch->handle),
+          contact_info);
     }
 
-  g_simple_async_result_complete_in_idle (data->result);
-  data->call = NULL;
+  while ((waiter = g_queue_pop_head (&fetch->waiters)) != NULL)
+    {
+      if (waiter->cancellable != NULL)
+        {
+          /* At this point it's too late to cancel the operation. This will
+           * block until the signal handler has finished if it's already
+           * running, so we're guaranteed to never be in a partially-cancelled
+           * state after this call. */
+          g_cancellable_disconnect (waiter->cancellable,
+              waiter->cancelled_id);
+          waiter->cancelled_id = 0;
+        }
+
+      waiter->fetch = NULL;
+      waiter->callback (error, waiter->user_data);
+      contact_info_waiter_free (waiter);
+    }
 }
 
 static void
-contact_info_request_cancelled_cb (GCancellable *cancellable,
-    ContactInfoRequestData *data)
+contact_info_waiter_cancelled_cb (GCancellable *cancellable,
+    ContactInfoWaiter *waiter)
 {
+  ContactInfoFetch *fetch = waiter->fetch;
   GError *error = NULL;
   gboolean was_cancelled;
 
   /* We disconnect from the signal manually; since we're in the cancelled
    * callback, we hold the cancellable's lock so calling this instead of
-   * g_cancellable_disconnect() is fine. We do this here so that
-   * g_cancellable_disconnect() isn't called by contact_info_request_data_free()
-   * which is called by tp_proxy_pending_call_cancel().
-   * cancelled_id might already be 0 if the cancellable was cancelled before
-   * we connected to it. */
-  if (data->cancelled_id != 0)
-    g_signal_handler_disconnect (data->cancellable, data->cancelled_id);
-  data->cancelled_id = 0;
-
-  was_cancelled = g_cancellable_set_error_if_cancelled (data->cancellable,
+   * g_cancellable_disconnect() is fine. */
+  if (waiter->cancelled_id != 0)
+    g_signal_handler_disconnect (waiter->cancellable, waiter->cancelled_id);
+  waiter->cancelled_id = 0;
+
+  if (fetch == NULL)
+    return;
+
+  was_cancelled = g_cancellable_set_error_if_cancelled (waiter->cancellable,
       &error);
   g_assert (was_cancelled);
 
   DEBUG ("Request ContactInfo cancelled");
 
-  g_simple_async_result_set_from_error (data->result, error);
-  g_simple_async_result_complete_in_idle (data->result);
+  g_queue_remove (&fetch->waiters, waiter);
+  waiter->fetch = NULL;
+  waiter->callback (error, waiter->user_data);
   g_clear_error (&error);
 
-  if (data->call != NULL)
-    tp_proxy_pending_call_cancel (data->call);
+  /* Nobody else is interested: stop asking. A later request for this
+   * contact must start a new call. */
+  if (g_queue_is_empty (&fetch->waiters) && fetch->call != NULL)
+    {
+      TpProxyPendingCall *call = fetch->call;
+
+      g_hash_table_remove (fetch->connection->priv->contact_info_fetches,
+          GUINT_TO_POINTER (fetch->handle));
+      fetch->call = NULL;
+      tp_proxy_pending_call_cancel (call);
+    }
+
+  /* the waiter is no longer in the queue, so the fetch will not free it */
+  contact_info_waiter_free (waiter);
+}
+
+/* Ask the CM for @self's vCard, sharing any call already in progress.
+ * @cancellable must not have been cancelled yet. @callback is called
+ * after the contact's vCard has been updated, or with an error. */
+static void
+contact_info_fetch (TpContact *self,
+    GCancellable *cancellable,
+    ContactInfoFetchCb callback,
+    gpointer user_data)
+{
+  TpConnection *connection = self->priv->connection;
+  ContactInfoFetch *fetch;
+  ContactInfoWaiter *waiter;
+
+  contacts_bind_to_contact_info_changed (connection);
+
+  fetch = g_hash_table_lookup (connection->priv->contact_info_fetches,
+      GUINT_TO_POINTER (self->priv->handle));
+
+  if (fetch == NULL)
+    {
+      fetch = g_slice_new0 (ContactInfoFetch);
+      fetch->connection = connection;
+      fetch->handle = self->priv->handle;
+      g_queue_init (&fetch->waiters);
+
+      g_hash_table_insert (connection->priv->contact_info_fetches,
+          GUINT_TO_POINTER (fetch->handle), fetch);
+
+      fetch->call =
+          tp_cli_connection_interface_contact_info_call_request_contact_info (
+              connection, 60*60*1000, fetch->handle, contact_info_fetch_cb,
+              fetch, contact_info_fetch_free, NULL);
+    }
+  else
+    {
+      DEBUG ("Joining the ContactInfo request already in progress for %s",
+          self->priv->identifier);
+    }
+
+  waiter = g_slice_new0 (ContactInfoWaiter);
+  waiter->fetch = fetch;
+  waiter->callback = callback;
+  waiter->user_data = user_data;
+  g_queue_push_tail (&fetch->waiters, waiter);
+
+  if (cancellable != NULL)
+    {
+      waiter->cancellable = g_object_ref (cancellable);
+      waiter->cancelled_id = g_cancellable_connect (cancellable,
+          G_CALLBACK (contact_info_waiter_cancelled_cb), waiter, NULL);
+    }
+}
+
+static void
+contact_info_request_done (const GError *error,
+    gpointer user_data)
+{
+  GSimpleAsyncResult *result = user_data;
+
+  if (error != NULL)
+    g_simple_async_result_set_from_error (result, error);
+
+  g_simple_async_result_complete_in_idle (result);
+  g_object_unref (result);
 }
 
 /**
@@ -3481,6 +3938,11 @@ contact_info_request_cancelled_cb (GCancellable *cancellable,
  * cancelled to free resources used in the D-Bus call if the caller is no longer
  * interested in the vCard.
  *
+ * Since 0.UNRELEASED, concurrent requests for the same contact share a
+ * single D-Bus call, which is only cancelled when all of them have been.
+ * To request many contacts' vCards at once, use
+ * tp_connection_request_contact_info_async().
+ *
  * If %TP_CONTACT_FEATURE_CONTACT_INFO is not yet set on @self, it will be
  * set before its property gets updated and @callback is called.
  *
@@ -3492,34 +3954,29 @@ tp_contact_request_contact_info_async (TpContact *self,
     GAsyncReadyCallback callback,
     gpointer user_data)
 {
-  ContactInfoRequestData *data;
+  GSimpleAsyncResult *result;
 
   g_return_if_fail (TP_IS_CONTACT (self));
 
   contacts_bind_to_contact_info_changed (self->priv->connection);
 
-  data = g_slice_new0 (ContactInfoRequestData);
-
-  data->contact = self;
-  data->result = g_simple_async_result_new (G_OBJECT (self), callback,
+  result = g_simple_async_result_new (G_OBJECT (self), callback,
       user_data, tp_contact_request_contact_info_finish);
 
-  if (cancellable != NULL)
+  /* Return early if the cancellable has already been cancelled */
+  if (g_cancellable_is_cancelled (cancellable))
     {
-      data->cancellable = g_object_ref (cancellable);
-      data->cancelled_id = g_cancellable_connect (data->cancellable,
-          G_CALLBACK (contact_info_request_cancelled_cb), data, NULL);
+      GError *error = NULL;
 
-      /* Return early if the cancellable has already been cancelled */
-      if (data->cancelled_id == 0)
-        return;
+      DEBUG ("Request ContactInfo cancelled");
+      g_cancellable_set_error_if_cancelled (cancellable, &error);
+      g_simple_async_result_take_error (result, error);
+      g_simple_async_result_complete_in_idle (result);
+      g_object_unref (result);
+      return;
     }
 
-  data->call = tp_cli_connection_interface_contact_info_call_request_contact_info (
-      self->priv->connection, 60*60*1000, self->priv->handle,
-      contact_info_request_cb,
-      data, (GDestroyNotify) contact_info_request_data_free,
-      NULL);
+  contact_info_fetch (self, cancellable, contact_info_request_done, result);
 }
 
 /**
@@ -3543,6 +4000,321 @@ tp_contact_request_contact_info_finish (TpContact *self,
   _tp_implement_finish_void (self, tp_contact_request_contact_info_finish);
 }
 
+/* How many RequestContactInfo calls one
+ * tp_connection_request_contact_info_async() makes at a time */
+#define MAX_CONTACT_INFO_FETCHES_PER_BATCH 8
+
+typedef struct
+{
+  TpConnection *connection;
+  GSimpleAsyncResult *result;
+  GCancellable *cancellable;
+  /* owned TpContact whose vCard has not been requested yet */
+  GQueue todo;
+  guint n_fetching;
+  gboolean got_cached;
+} ContactInfoBatch;
+
+static void
+contact_info_batch_free (ContactInfoBatch *batch)
+{
+  TpContact *contact;
+
+  while ((contact = g_queue_pop_head (&batch->todo)) != NULL)
+    g_object_unref (contact);
+
+  g_object_unref (batch->connection);
+  g_object_unref (batch->result);
+
+  if (batch->cancellable != NULL)
+    g_object_unref (batch->cancellable);
+
+  g_slice_free (ContactInfoBatch, batch);
+}
+
+static void contact_info_batch_fetched_cb (const GError *error,
+    gpointer user_data);
+
+static void
+contact_info_batch_continue (ContactInfoBatch *batch)
+{
+  GError *error = NULL;
+
+  if (g_cancellable_set_error_if_cancelled (batch->cancellable, &error))
+    {
+      TpContact *contact;
+
+      while ((contact = g_queue_pop_head (&batch->todo)) != NULL)
+        g_object_unref (contact);
+
+      /* wait for the fetches in progress to report their cancellation */
+      if (batch->n_fetching == 0)
+        {
+          g_simple_async_result_take_error (batch->result, error);
+          g_simple_async_result_complete_in_idle (batch->result);
+          contact_info_batch_free (batch);
+        }
+      else
+        {
+          g_error_free (error);
+        }
+
+      return;
+    }
+
+  while (batch->n_fetching < MAX_CONTACT_INFO_FETCHES_PER_BATCH &&
+      !g_queue_is_empty (&batch->todo))
+    {
+      TpContact *contact = g_queue_pop_head (&batch->todo);
+
+      batch->n_fetching++;
+      contact_info_fetch (contact, batch->cancellable,
+          contact_info_batch_fetched_cb, batch);
+      g_object_unref (contact);
+    }
+
+  if (batch->n_fetching == 0)
+    {
+      g_simple_async_result_complete_in_idle (batch->result);
+      contact_info_batch_free (batch);
+    }
+}
+
+static void
+contact_info_batch_fetched_cb (const GError *error,
+    gpointer user_data)
+{
+  ContactInfoBatch *batch = user_data;
+
+  /* one contact's vCard being unavailable does not fail the batch */
+  if (error != NULL)
+    DEBUG ("Failed to request ContactInfo: %s", error->message);
+
+  batch->n_fetching--;
+  contact_info_batch_continue (batch);
+}
+
+static void
+contact_info_batch_got_attributes_cb (TpConnection *connection,
+    GHashTable *attributes,
+    const GError *error,
+    gpointer user_data,
+    GObject *weak_object)
+{
+  ContactInfoBatch *batch = user_data;
+  GList *l, *next;
+
+  if (error != NULL)
+    {
+      DEBUG ("GetContactAttributes failed with %s %u: %s",
+          g_quark_to_string (error->domain), error->code, error->message);
+      contact_info_batch_continue (batch);
+      return;
+    }
+
+  /* Only the contacts whose vCard the CM did not already have need to
+   * be fetched from the network */
+  for (l = batch->todo.head; l != NULL; l = next)
+    {
+      TpContact *contact = l->data;
+      GHashTable *asv = g_hash_table_lookup (attributes,
+          GUINT_TO_POINTER (contact->priv->handle));
+      const GPtrArray *contact_info = NULL;
+
+      next = l->next;
+
+      if (asv != NULL)
+        contact_info = tp_asv_get_boxed (asv,
+            TP_TOKEN_CONNECTION_INTERFACE_CONTACT_INFO_INFO,
+            TP_ARRAY_TYPE_CONTACT_INFO_FIELD_LIST);
+
+      if (contact_info != NULL)
+        {
+          contact_maybe_set_info (contact, contact_info);
+          g_queue_delete_link (&batch->todo, l);
+          g_object_unref (contact);
+        }
+    }
+
+  contact_info_batch_continue (batch);
+}
+
+static void
+contact_info_batch_get_attributes (ContactInfoBatch *batch)
+{
+  static const gchar * const interfaces[] = {
+      TP_IFACE_CONNECTION_INTERFACE_CONTACT_INFO, NULL };
+  GArray *handles;
+  GList *l;
+
+  if (g_queue_is_empty (&batch->todo) ||
+      g_cancellable_is_cancelled (batch->cancellable) ||
+      !tp_proxy_has_interface_by_id (batch->connection,
+        TP_IFACE_QUARK_CONNECTION_INTERFACE_CONTACTS))
+    {
+      contact_info_batch_continue (batch);
+      return;
+    }
+
+  handles = g_array_sized_new (FALSE, FALSE, sizeof (TpHandle),
+      batch->todo.length);
+
+  for (l = batch->todo.head; l != NULL; l = l->next)
+    {
+      TpContact *contact = l->data;
+
+      g_array_append_val (handles, contact->priv->handle);
+    }
+
+  tp_cli_connection_interface_contacts_call_get_contact_attributes (
+      batch->connection, -1, handles, (const gchar **) interfaces, FALSE,
+      contact_info_batch_got_attributes_cb, batch, NULL, NULL);
+
+  g_array_unref (handles);
+}
+
+static void
+contact_info_batch_got_cached_cb (GObject *source,
+    GAsyncResult *result,
+    gpointer user_data)
+{
+  ContactInfoBatch *batch = user_data;
+  GHashTable *entries;
+  GError *error = NULL;
+  GList *l, *next;
+
+  entries = _tp_contact_info_cache_lookup_finish (result, &error);
+
+  if (entries == NULL)
+    {
+      DEBUG ("Failed to read cached vCards: %s", error->message);
+      g_clear_error (&error);
+    }
+  else
+    {
+      /* the contacts whose vCard was saved recently need not be fetched */
+      for (l = batch->todo.head; l != NULL; l = next)
+        {
+          TpContact *contact = l->data;
+
+          next = l->next;
+
+          if (contact_use_cached_info (contact, entries))
+            {
+              g_queue_delete_link (&batch->todo, l);
+              g_object_unref (contact);
+            }
+        }
+
+      g_hash_table_unref (entries);
+    }
+
+  contact_info_batch_get_attributes (batch);
+}
+
+/**
+ * tp_connection_request_contact_info_async:
+ * @self: a #TpConnection
+ * @n_contacts: The number of contacts in @contacts (must be at least 1)
+ * @contacts: (array length=n_contacts): An array of #TpContact objects
+ *  associated with @self
+ * @cancellable: optional #GCancellable object, %NULL to ignore
+ * @callback: a callback to call when the request is satisfied
+ * @user_data: data to pass to @callback
+ *
+ * Make sure that each of @contacts has an up-to-date
+ * #TpContact:contact-info, as efficiently as possible. The vCards that
+ * the connection manager already has are retrieved in a single call if it
+ * supports the Contacts interface; the others are requested from the
+ * network a few at a time, sharing any
+ * request already in progress for the same contact, for instance with
+ * tp_contact_request_contact_info_async(). If
+ * tp_connection_set_contact_info_cache_enabled() was used, vCards saved
+ * in the last day are used without contacting the connection manager.
+ *
+ * When the operation is finished, @callback will be called, after
+ * "notify::contact-info" has been emitted for each contact whose vCard
+ * was updated. You can then call tp_connection_request_contact_info_finish()
+ * to get the result of the operation. Failing to retrieve some contacts'
+ * vCards does not make the whole operation fail.
+ *
+ * If %TP_CONTACT_FEATURE_CONTACT_INFO is not yet set on a contact, it will
+ * be set before its property gets updated.
+ *
+ * Since: 0.UNRELEASED
+ */
+void
+tp_connection_request_contact_info_async (TpConnection *self,
+    guint n_contacts,
+    TpContact * const *contacts,
+    GCancellable *cancellable,
+    GAsyncReadyCallback callback,
+    gpointer user_data)
+{
+  ContactInfoBatch *batch;
+  GPtrArray *array;
+  guint i;
+
+  g_return_if_fail (TP_IS_CONNECTION (self));
+  g_return_if_fail (n_contacts >= 1);
+  g_return_if_fail (contacts != NULL);
+
+  for (i = 0; i < n_contacts; i++)
+    {
+      g_return_if_fail (TP_IS_CONTACT (contacts[i]));
+      g_return_if_fail (contacts[i]->priv->connection == self);
+    }
+
+  contacts_bind_to_contact_info_changed (self);
+
+  batch = g_slice_new0 (ContactInfoBatch);
+  batch->connection = g_object_ref (self);
+  batch->result = g_simple_async_result_new ((GObject *) self, callback,
+      user_data, tp_connection_request_contact_info_async);
+  g_queue_init (&batch->todo);
+
+  if (cancellable != NULL)
+    batch->cancellable = g_object_ref (cancellable);
+
+  for (i = 0; i < n_contacts; i++)
+    g_queue_push_tail (&batch->todo, g_object_ref (contacts[i]));
+
+  array = g_ptr_array_sized_new (n_contacts);
+
+  for (i = 0; i < n_contacts; i++)
+    g_ptr_array_add (array, contacts[i]);
+
+  /* batch->todo keeps the contacts alive while their saved vCards are
+   * read */
+  if (!contacts_lookup_cached_info (self, array,
+        contact_info_batch_got_cached_cb, batch))
+    contact_info_batch_get_attributes (batch);
+
+  g_ptr_array_unref (array);
+}
+
+/**
+ * tp_connection_request_contact_info_finish:
+ * @self: a #TpConnection
+ * @result: a #GAsyncResult
+ * @error: a #GError to be filled
+ *
+ * Finishes tp_connection_request_contact_info_async(). Whether or not
+ * the operation was successful, the contacts' vCards can be accessed
+ * using tp_contact_dup_contact_info().
+ *
+ * Returns: %TRUE if the request was successful, otherwise %FALSE
+ *
+ * Since: 0.UNRELEASED
+ */
+gboolean
+tp_connection_request_contact_info_finish (TpConnection *self,
+    GAsyncResult *result,
+    GError **error)
+{
+  _tp_implement_finish_void (self, tp_connection_request_contact_info_async);
+}
+
 /**
  * tp_connection_refresh_contact_info:
  * @self: a #TpConnection
@@ -4027,10 +4799,22 @@ tp_contact_set_attributes (TpContact *contact,
   /* ContactInfo */
   if (wanted & CONTACT_FEATURE_FLAG_CONTACT_INFO)
     {
+      gboolean had_info = ((contact->priv->has_features &
+            CONTACT_FEATURE_FLAG_CONTACT_INFO) != 0);
+
       boxed = tp_asv_get_boxed (asv,
           TP_TOKEN_CONNECTION_INTERFACE_CONTACT_INFO_INFO,
           TP_ARRAY_TYPE_CONTACT_INFO_FIELD_LIST);
-      contact_maybe_set_info (contact, boxed);
+
+      /* If the CM does not have this contact's vCard yet, a saved one is
+       * better than nothing. The caller looks them up for all the contacts
+       * at once with contacts_load_deferred_info(), rather than reading a
+       * file per contact here. */
+      if (boxed == NULL && !had_info &&
+          contact_get_info_cache_dir (contact) != NULL)
+        contact->priv->contact_info_deferred = TRUE;
+      else
+        contact_maybe_set_info (contact, boxed);
     }
 
   /* ClientTypes */
@@ -4110,6 +4894,15 @@ _tp_contact_set_attributes (TpContact *contact,
       0 /* can't know what we expected to get */, error);
 }
 
+static void
+contacts_got_deferred_info (gpointer user_data)
+{
+  ContactsContext *c = user_data;
+
+  contacts_context_continue (c);
+  contacts_context_unref (c);
+}
+
 static void
 contacts_got_attributes (TpConnection *connection,
                          GHashTable *attributes,
@@ -4184,7 +4977,9 @@ contacts_got_attributes (TpConnection *connection,
         }
     }
 
-  contacts_context_continue (c);
+  c->refcount++;
+  contacts_load_deferred_info (connection, c->contacts,
+      contacts_got_deferred_info, c);
 }
 
 static const gchar **
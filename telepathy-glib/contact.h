@@ -126,6 +126,18 @@ gboolean tp_contact_request_contact_info_finish (TpContact *self,
 void tp_connection_refresh_contact_info (TpConnection *self,
     guint n_contacts, TpContact * const *contacts);
 
+_TP_AVAILABLE_IN_UNRELEASED
+void tp_connection_request_contact_info_async (TpConnection *self,
+    guint n_contacts,
+    TpContact * const *contacts,
+    GCancellable *cancellable,
+    GAsyncReadyCallback callback,
+    gpointer user_data);
+_TP_AVAILABLE_IN_UNRELEASED
+gboolean tp_connection_request_contact_info_finish (TpConnection *self,
+    GAsyncResult *result,
+    GError **error);
+
 /* TP_CONTACT_FEATURE_CLIENT_TYPES */
 const gchar * const *
 /* this comment stops gtkdoc denying that this function exists */
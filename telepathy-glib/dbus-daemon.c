@@ -24,6 +24,8 @@
 #include <telepathy-glib/dbus.h>
 #include <telepathy-glib/dbus-internal.h>
 
+#include <string.h>
+
 #include <dbus/dbus.h>
 #include <dbus/dbus-glib-lowlevel.h>
 
@@ -71,6 +73,9 @@ struct _TpDBusDaemonPrivate
 {
   /* dup'd name => _NameOwnerWatch */
   GHashTable *name_owner_watches;
+  /* _NamespaceWatch, sorted by name_space so that the watches covering
+   * a name can be found by binary search */
+  GPtrArray *namespace_watches;
   /* reffed */
   DBusConnection *libdbus;
 };
@@ -248,90 +253,229 @@ _tp_dbus_daemon_name_owner_changed (TpDBusDaemon *self,
   g_object_unref (self);
 }
 
-static dbus_int32_t daemons_slot = -1;
+/* Per-DBusConnection state, shared by every TpDBusDaemon on that
+ * connection and stored in daemons_slot. */
+typedef struct {
+    /* borrowed TpDBusDaemon, removed in dispose */
+    GSList *daemons;
+
+    /* The rest is protected by the noc_queue lock, since libdbus filters
+     * and pending-call notifications can in principle run in any thread. */
+
+    /* PendingOwner, in the order the bus told us about them; see
+     * noc_queue_push() */
+    GQueue pending;
+    /* name (borrowed from the entry) => the most recent PendingOwner for
+     * that name in @pending */
+    GHashTable *pending_by_name;
+    /* TRUE if an idle is going to drain @pending */
+    gboolean drain_scheduled;
+} ConnectionData;
 
 typedef struct {
-    DBusConnection *libdbus;
-    DBusMessage *message;
-} NOCIdleContext;
+    gchar *name;
+    gchar *owner;
+    /* NULL if this came from NameOwnerChanged, which is for every
+     * TpDBusDaemon on the connection; or the TpDBusDaemon which called
+     * GetNameOwner, which is the only one to be told the result */
+    TpDBusDaemon *caller;
+    /* borrowed: this entry's link in ConnectionData.pending */
+    GList *link;
+} PendingOwner;
+
+static dbus_int32_t daemons_slot = -1;
+G_LOCK_DEFINE_STATIC (noc_queue);
 
-static NOCIdleContext *
-noc_idle_context_new (DBusConnection *libdbus,
-                      DBusMessage *message)
+static void
+pending_owner_free (PendingOwner *entry)
 {
-  NOCIdleContext *context = g_slice_new (NOCIdleContext);
+  g_free (entry->name);
+  g_free (entry->owner);
 
-  context->libdbus = dbus_connection_ref (libdbus);
-  context->message = dbus_message_ref (message);
-  return context;
+  if (entry->caller != NULL)
+    g_object_unref (entry->caller);
+
+  g_slice_free (PendingOwner, entry);
 }
 
 static void
-noc_idle_context_free (gpointer data)
+connection_data_free (gpointer p)
 {
-  NOCIdleContext *context = data;
+  ConnectionData *data = p;
 
-  dbus_connection_unref (context->libdbus);
-  dbus_message_unref (context->message);
-  g_slice_free (NOCIdleContext, context);
+  G_LOCK (noc_queue);
+  g_queue_foreach (&data->pending, (GFunc) pending_owner_free, NULL);
+  g_queue_clear (&data->pending);
+  g_hash_table_unref (data->pending_by_name);
+  G_UNLOCK (noc_queue);
+
+  g_slist_free (data->daemons);
+  g_slice_free (ConnectionData, data);
 }
 
+static void _tp_dbus_daemon_namespace_owner_changed (TpDBusDaemon *self,
+    const gchar *name, const gchar *new_owner);
+
 static gboolean
-noc_idle_context_invoke (gpointer data)
+noc_queue_drain (gpointer user_data)
 {
-  NOCIdleContext *context = data;
-  const gchar *name;
-  const gchar *old_owner;
-  const gchar *new_owner;
-  DBusError dbus_error = DBUS_ERROR_INIT;
-  GSList **daemons;
+  DBusConnection *libdbus = user_data;
+  ConnectionData *data;
 
   if (daemons_slot == -1)
     return FALSE;
 
-  if (!dbus_message_get_args (context->message, &dbus_error,
-        DBUS_TYPE_STRING, &name,
-        DBUS_TYPE_STRING, &old_owner,
-        DBUS_TYPE_STRING, &new_owner,
-        DBUS_TYPE_INVALID))
+  G_LOCK (noc_queue);
+  data = dbus_connection_get_data (libdbus, daemons_slot);
+
+  /* Anything that arrives while we're calling out to user code gets a new
+   * idle, in case the user code runs a nested main loop waiting for it;
+   * otherwise, we'll drain it below and that idle will find nothing to do. */
+  if (data != NULL)
+    data->drain_scheduled = FALSE;
+
+  while (data != NULL && !g_queue_is_empty (&data->pending))
     {
-      DEBUG ("Couldn't unpack NameOwnerChanged(s, s, s): %s: %s",
-          dbus_error.name, dbus_error.message);
-      dbus_error_free (&dbus_error);
-      return FALSE;
-    }
+      PendingOwner *entry = g_queue_pop_head (&data->pending);
+      GSList *daemons, *iter;
 
-  daemons = dbus_connection_get_data (context->libdbus, daemons_slot);
+      if (g_hash_table_lookup (data->pending_by_name, entry->name) == entry)
+        g_hash_table_remove (data->pending_by_name, entry->name);
 
-  DEBUG ("NameOwnerChanged(%s, %s -> %s)", name, old_owner, new_owner);
+      /* Callbacks can dispose TpDBusDaemons (including the last one, which
+       * frees @data), so work on a reffed copy. The list is only ever
+       * changed in the main thread, which is where we are now. */
+      if (entry->caller != NULL)
+        {
+          daemons = g_slist_prepend (NULL, g_object_ref (entry->caller));
+        }
+      else
+        {
+          daemons = g_slist_copy (data->daemons);
+          g_slist_foreach (daemons, (GFunc) g_object_ref, NULL);
+        }
 
-  /* should always be non-NULL, barring bugs */
-  if (G_LIKELY (daemons != NULL))
-    {
-      GSList *iter;
+      G_UNLOCK (noc_queue);
 
-      for (iter = *daemons; iter != NULL; iter = iter->next)
+      for (iter = daemons; iter != NULL; iter = iter->next)
         {
-          _tp_dbus_daemon_name_owner_changed (iter->data, name, new_owner);
+          _tp_dbus_daemon_name_owner_changed (iter->data, entry->name,
+              entry->owner);
+
+          if (entry->caller == NULL)
+            _tp_dbus_daemon_namespace_owner_changed (iter->data, entry->name,
+                entry->owner);
         }
+
+      g_slist_free_full (daemons, g_object_unref);
+      pending_owner_free (entry);
+
+      G_LOCK (noc_queue);
+      data = dbus_connection_get_data (libdbus, daemons_slot);
     }
 
+  G_UNLOCK (noc_queue);
   return FALSE;
 }
 
+/*
+ * Queue a change of owner for @name, to be passed on from a single idle to
+ * @caller if it is the result of @caller's GetNameOwner call, or to every
+ * TpDBusDaemon on @libdbus if it is a NameOwnerChanged signal (@caller is
+ * %NULL).
+ *
+ * A signal for a name whose latest queued entry is also a signal replaces
+ * that entry, so a burst of changes results in one callback with the
+ * latest owner. The replacement goes to the end of the queue, so callbacks
+ * for different names are still called in the order of the last change to
+ * each of them; only the intermediate owners are skipped. GetNameOwner
+ * results are never merged, so that they stay in order with respect to the
+ * signals.
+ */
+static void
+noc_queue_push (DBusConnection *libdbus,
+    const gchar *name,
+    const gchar *owner,
+    TpDBusDaemon *caller)
+{
+  ConnectionData *data;
+  PendingOwner *entry;
+
+  if (daemons_slot == -1)
+    return;
+
+  G_LOCK (noc_queue);
+  data = dbus_connection_get_data (libdbus, daemons_slot);
+
+  /* NULL if the last TpDBusDaemon has gone away, in which case nobody
+   * cares any more */
+  if (data == NULL)
+    goto finally;
+
+  entry = g_hash_table_lookup (data->pending_by_name, name);
+
+  if (caller == NULL && entry != NULL && entry->caller == NULL)
+    {
+      /* the drain idle is already scheduled */
+      g_free (entry->owner);
+      entry->owner = g_strdup (owner);
+      g_queue_unlink (&data->pending, entry->link);
+      g_queue_push_tail_link (&data->pending, entry->link);
+      goto finally;
+    }
+
+  entry = g_slice_new (PendingOwner);
+  entry->name = g_strdup (name);
+  entry->owner = g_strdup (owner);
+  entry->caller = (caller == NULL ? NULL : g_object_ref (caller));
+  g_queue_push_tail (&data->pending, entry);
+  entry->link = data->pending.tail;
+  g_hash_table_insert (data->pending_by_name, entry->name, entry);
+
+  if (!data->drain_scheduled)
+    {
+      data->drain_scheduled = TRUE;
+      g_idle_add_full (G_PRIORITY_HIGH, noc_queue_drain,
+          dbus_connection_ref (libdbus),
+          (GDestroyNotify) dbus_connection_unref);
+    }
+
+finally:
+  G_UNLOCK (noc_queue);
+}
+
 static DBusHandlerResult
 _tp_dbus_daemon_name_owner_changed_filter (DBusConnection *libdbus,
                                            DBusMessage *message,
                                            void *unused G_GNUC_UNUSED)
 {
+  const gchar *name;
+  const gchar *old_owner;
+  const gchar *new_owner;
+  DBusError dbus_error = DBUS_ERROR_INIT;
+
+  if (!dbus_message_is_signal (message, DBUS_INTERFACE_DBUS,
+        "NameOwnerChanged") ||
+      !dbus_message_has_sender (message, DBUS_SERVICE_DBUS))
+    return DBUS_HANDLER_RESULT_NOT_YET_HANDLED;
+
+  if (!dbus_message_get_args (message, &dbus_error,
+        DBUS_TYPE_STRING, &name,
+        DBUS_TYPE_STRING, &old_owner,
+        DBUS_TYPE_STRING, &new_owner,
+        DBUS_TYPE_INVALID))
+    {
+      DEBUG ("Couldn't unpack NameOwnerChanged(s, s, s): %s: %s",
+          dbus_error.name, dbus_error.message);
+      dbus_error_free (&dbus_error);
+      return DBUS_HANDLER_RESULT_NOT_YET_HANDLED;
+    }
+
+  DEBUG ("NameOwnerChanged(%s, %s -> %s)", name, old_owner, new_owner);
+
   /* We have to do the real work in an idle, so we don't break re-entrant
    * calls (the dbus-glib event source isn't re-entrant) */
-  if (dbus_message_is_signal (message, DBUS_INTERFACE_DBUS,
-        "NameOwnerChanged") &&
-      dbus_message_has_sender (message, DBUS_SERVICE_DBUS))
-    g_idle_add_full (G_PRIORITY_HIGH, noc_idle_context_invoke,
-        noc_idle_context_new (libdbus, message),
-        noc_idle_context_free);
+  noc_queue_push (libdbus, name, new_owner, NULL);
 
   return DBUS_HANDLER_RESULT_NOT_YET_HANDLED;
 }
@@ -339,8 +483,6 @@ _tp_dbus_daemon_name_owner_changed_filter (DBusConnection *libdbus,
 typedef struct {
     TpDBusDaemon *self;
     gchar *name;
-    DBusMessage *reply;
-    gsize refs;
 } GetNameOwnerContext;
 
 static GetNameOwnerContext *
@@ -351,43 +493,64 @@ get_name_owner_context_new (TpDBusDaemon *self,
 
   context->self = g_object_ref (self);
   context->name = g_strdup (name);
-  context->reply = NULL;
-  context->refs = 1;
   return context;
 }
 
 static void
-get_name_owner_context_unref (gpointer data)
+get_name_owner_context_free (gpointer data)
 {
   GetNameOwnerContext *context = data;
 
-  if (--context->refs == 0)
-    {
-      g_object_unref (context->self);
-      g_free (context->name);
+  g_object_unref (context->self);
+  g_free (context->name);
+  g_slice_free (GetNameOwnerContext, context);
+}
 
-      if (context->reply != NULL)
-        dbus_message_unref (context->reply);
+/**
+ * TpDBusDaemonNameOwnerChangedCb:
+ * @bus_daemon: The D-Bus daemon
+ * @name: The name whose ownership has changed or been discovered
+ * @new_owner: The unique name that now owns @name
+ * @user_data: Arbitrary user-supplied data as passed to
+ *  tp_dbus_daemon_watch_name_owner()
+ *
+ * The signature of the callback called by tp_dbus_daemon_watch_name_owner().
+ *
+ * Since: 0.7.1
+ */
 
-      g_slice_free (GetNameOwnerContext, context);
-    }
+static inline gchar *
+_tp_dbus_daemon_get_noc_rule (const gchar *name)
+{
+  return g_strdup_printf ("type='signal',"
+      "sender='" DBUS_SERVICE_DBUS "',"
+      "path='" DBUS_PATH_DBUS "',"
+      "interface='"DBUS_INTERFACE_DBUS "',"
+      "member='NameOwnerChanged',"
+      "arg0='%s'", name);
 }
 
-static gboolean
-_tp_dbus_daemon_get_name_owner_idle (gpointer data)
+static void
+_tp_dbus_daemon_get_name_owner_notify (DBusPendingCall *pc,
+                                       gpointer data)
 {
   GetNameOwnerContext *context = data;
+  DBusMessage *reply = NULL;
   const gchar *owner = "";
 
-  if (context->reply == NULL)
+  /* we recycle this function for the case where the connection is already
+   * disconnected: in that case we use pc = NULL */
+  if (pc != NULL)
+    reply = dbus_pending_call_steal_reply (pc);
+
+  if (reply == NULL)
     {
       DEBUG ("Connection disconnected or no reply to GetNameOwner(%s)",
           context->name);
     }
-  else if (dbus_message_get_type (context->reply) ==
-      DBUS_MESSAGE_TYPE_METHOD_RETURN)
+  else if (dbus_message_get_type (reply) == DBUS_MESSAGE_TYPE_METHOD_RETURN)
     {
-      if (dbus_message_get_args (context->reply, NULL,
+      if (dbus_message_get_args (reply, NULL,
             DBUS_TYPE_STRING, &owner,
             DBUS_TYPE_INVALID))
         {
@@ -405,7 +568,7 @@ _tp_dbus_daemon_get_name_owner_idle (gpointer data)
         {
           DBusError error = DBUS_ERROR_INIT;
 
-          if (dbus_set_error_from_message (&error, context->reply))
+          if (dbus_set_error_from_message (&error, reply))
             {
               DEBUG ("GetNameOwner(%s) raised %s: %s", context->name,
                   error.name, error.message);
@@ -419,51 +582,14 @@ _tp_dbus_daemon_get_name_owner_idle (gpointer data)
         }
     }
 
-  _tp_dbus_daemon_name_owner_changed (context->self, context->name, owner);
-
-  return FALSE;
-}
-
-/**
- * TpDBusDaemonNameOwnerChangedCb:
- * @bus_daemon: The D-Bus daemon
- * @name: The name whose ownership has changed or been discovered
- * @new_owner: The unique name that now owns @name
- * @user_data: Arbitrary user-supplied data as passed to
- *  tp_dbus_daemon_watch_name_owner()
- *
- * The signature of the callback called by tp_dbus_daemon_watch_name_owner().
- *
- * Since: 0.7.1
- */
-
-static inline gchar *
-_tp_dbus_daemon_get_noc_rule (const gchar *name)
-{
-  return g_strdup_printf ("type='signal',"
-      "sender='" DBUS_SERVICE_DBUS "',"
-      "path='" DBUS_PATH_DBUS "',"
-      "interface='"DBUS_INTERFACE_DBUS "',"
-      "member='NameOwnerChanged',"
-      "arg0='%s'", name);
-}
-
-static void
-_tp_dbus_daemon_get_name_owner_notify (DBusPendingCall *pc,
-                                       gpointer data)
-{
-  GetNameOwnerContext *context = data;
-
-  /* we recycle this function for the case where the connection is already
-   * disconnected: in that case we use pc = NULL */
-  if (pc != NULL)
-    context->reply = dbus_pending_call_steal_reply (pc);
+  /* This goes through the same queue as NameOwnerChanged, so that it is
+   * delivered in the right order relative to any signals that arrived
+   * before or after it, but only to the TpDBusDaemon that asked. */
+  noc_queue_push (context->self->priv->libdbus, context->name, owner,
+      context->self);
 
-  /* We have to do the real work in an idle, so we don't break re-entrant
-   * calls (the dbus-glib event source isn't re-entrant) */
-  context->refs++;
-  g_idle_add_full (G_PRIORITY_HIGH, _tp_dbus_daemon_get_name_owner_idle,
-      context, get_name_owner_context_unref);
+  if (reply != NULL)
+    dbus_message_unref (reply);
 
   if (pc != NULL)
     dbus_pending_call_unref (pc);
@@ -480,7 +606,14 @@ _tp_dbus_daemon_get_name_owner_notify (DBusPendingCall *pc,
  *
  * Arrange for @callback to be called with the owner of @name as soon as
  * possible (which might even be before this function returns!), then
- * again every time the ownership of @name changes.
+ * again whenever the ownership of @name has changed.
+ *
+ * Changes are delivered from the main loop in batches, and several
+ * changes to the same @name that arrive before they are dispatched result
+ * in a single call, with the most recent owner. Intermediate owners,
+ * including the "" reported between two owners when one replaces another,
+ * may therefore never be seen, and consecutive calls may even have the
+ * same owner. The last call always reflects the current owner.
  *
  * If multiple watches are registered for the same @name, they will be called
  * in the order they were registered.
@@ -551,11 +684,11 @@ tp_dbus_daemon_watch_name_owner (TpDBusDaemon *self,
         {
           /* pc can be NULL when the connection is already disconnected */
           _tp_dbus_daemon_get_name_owner_notify (pc, context);
-          get_name_owner_context_unref (context);
+          get_name_owner_context_free (context);
         }
       else if (!dbus_pending_call_set_notify (pc,
             _tp_dbus_daemon_get_name_owner_notify,
-            context, get_name_owner_context_unref))
+            context, get_name_owner_context_free))
         {
           ERROR ("Out of memory");
         }
@@ -659,6 +792,333 @@ tp_dbus_daemon_cancel_name_owner_watch (TpDBusDaemon *self,
   return FALSE;
 }
 
+typedef struct
+{
+  gchar *name_space;
+  /* dup'd name => dup'd owner, for names in the namespace that currently
+   * have an owner */
+  GHashTable *owners;
+  GArray *callbacks;
+  gsize invoking;
+} _NamespaceWatch;
+
+static inline gchar *
+_tp_dbus_daemon_get_noc_namespace_rule (const gchar *name_space)
+{
+  return g_strdup_printf ("type='signal',"
+      "sender='" DBUS_SERVICE_DBUS "',"
+      "path='" DBUS_PATH_DBUS "',"
+      "interface='"DBUS_INTERFACE_DBUS "',"
+      "member='NameOwnerChanged',"
+      "arg0namespace='%s'", name_space);
+}
+
+/* Binary search in self->priv->namespace_watches. If there is no watch for
+ * @name_space, return NULL and set *@index to where it should be inserted. */
+static _NamespaceWatch *
+_tp_dbus_daemon_find_namespace_watch (TpDBusDaemon *self,
+    const gchar *name_space,
+    guint *index)
+{
+  GPtrArray *array = self->priv->namespace_watches;
+  guint lower = 0;
+  guint upper;
+
+  if (array == NULL)
+    return NULL;
+
+  upper = array->len;
+
+  while (lower < upper)
+    {
+      guint mid = lower + (upper - lower) / 2;
+      _NamespaceWatch *watch = g_ptr_array_index (array, mid);
+      gint cmp = strcmp (name_space, watch->name_space);
+
+      if (cmp == 0)
+        {
+          if (index != NULL)
+            *index = mid;
+
+          return watch;
+        }
+
+      if (cmp < 0)
+        upper = mid;
+      else
+        lower = mid + 1;
+    }
+
+  if (index != NULL)
+    *index = lower;
+
+  return NULL;
+}
+
+static void
+_tp_dbus_daemon_stop_watching_namespace (TpDBusDaemon *self,
+    _NamespaceWatch *watch)
+{
+  gchar *match_rule;
+  guint i;
+
+  for (i = 0; i < watch->callbacks->len; i++)
+    {
+      _NameOwnerSubWatch *entry = &g_array_index (watch->callbacks,
+          _NameOwnerSubWatch, i);
+
+      if (entry->destroy != NULL)
+        entry->destroy (entry->user_data);
+    }
+
+  match_rule = _tp_dbus_daemon_get_noc_namespace_rule (watch->name_space);
+  DEBUG ("Removing match rule %s", match_rule);
+  dbus_bus_remove_match (self->priv->libdbus, match_rule, NULL);
+  g_free (match_rule);
+
+  g_array_unref (watch->callbacks);
+  g_hash_table_unref (watch->owners);
+  g_free (watch->name_space);
+  g_slice_free (_NamespaceWatch, watch);
+}
+
+static void
+tp_dbus_daemon_maybe_free_namespace_watch (TpDBusDaemon *self,
+    _NamespaceWatch *watch)
+{
+  GArray *array = watch->callbacks;
+  guint i;
+
+  if (watch->invoking > 0)
+    return;
+
+  for (i = array->len; i > 0; i--)
+    {
+      _NameOwnerSubWatch *entry = &g_array_index (array,
+          _NameOwnerSubWatch, i - 1);
+
+      if (entry->callback != NULL)
+        continue;
+
+      if (entry->destroy != NULL)
+        entry->destroy (entry->user_data);
+
+      g_array_remove_index (array, i - 1);
+    }
+
+  if (array->len == 0)
+    {
+      guint index;
+
+      if (_tp_dbus_daemon_find_namespace_watch (self, watch->name_space,
+            &index) == watch)
+        g_ptr_array_remove_index (self->priv->namespace_watches, index);
+
+      _tp_dbus_daemon_stop_watching_namespace (self, watch);
+    }
+}
+
+static void
+_tp_dbus_daemon_namespace_watch_invoke (TpDBusDaemon *self,
+    _NamespaceWatch *watch,
+    const gchar *name,
+    const gchar *new_owner)
+{
+  const gchar *last_owner = g_hash_table_lookup (watch->owners, name);
+  GArray *array = watch->callbacks;
+  guint i;
+
+  if (!tp_strdiff (last_owner, new_owner) ||
+      (last_owner == NULL && new_owner[0] == '\0'))
+    return;
+
+  if (new_owner[0] == '\0')
+    g_hash_table_remove (watch->owners, name);
+  else
+    g_hash_table_insert (watch->owners, g_strdup (name),
+        g_strdup (new_owner));
+
+  watch->invoking++;
+
+  for (i = 0; i < array->len; i++)
+    {
+      _NameOwnerSubWatch *subwatch = &g_array_index (array,
+          _NameOwnerSubWatch, i);
+
+      if (subwatch->callback != NULL)
+        subwatch->callback (self, name, new_owner, subwatch->user_data);
+    }
+
+  watch->invoking--;
+
+  tp_dbus_daemon_maybe_free_namespace_watch (self, watch);
+}
+
+static void
+_tp_dbus_daemon_namespace_owner_changed (TpDBusDaemon *self,
+    const gchar *name,
+    const gchar *new_owner)
+{
+  gchar *prefix;
+  gchar *dot;
+
+  /* unique names are not in any namespace */
+  if (self->priv->namespace_watches == NULL ||
+      self->priv->namespace_watches->len == 0 ||
+      name[0] == ':')
+    return;
+
+  /* Try @name itself, then each of its parent namespaces, innermost first:
+   * a.b.c is in namespaces a.b.c, a.b and a */
+  prefix = g_strdup (name);
+  g_object_ref (self);
+
+  do
+    {
+      _NamespaceWatch *watch = _tp_dbus_daemon_find_namespace_watch (self,
+          prefix, NULL);
+
+      if (watch != NULL)
+        _tp_dbus_daemon_namespace_watch_invoke (self, watch, name, new_owner);
+
+      dot = strrchr (prefix, '.');
+
+      if (dot != NULL)
+        *dot = '\0';
+    }
+  while (dot != NULL);
+
+  g_object_unref (self);
+  g_free (prefix);
+}
+
+/**
+ * tp_dbus_daemon_watch_name_owner_namespace:
+ * @self: The D-Bus daemon
+ * @name_space: A well-known name, such as
+ *  <literal>org.freedesktop.Telepathy.Client</literal>
+ * @callback: Callback to call when the ownership of a name in @name_space
+ *  changes
+ * @user_data: Arbitrary data to pass to @callback
+ * @destroy: Called to destroy @user_data when the watch is cancelled due to
+ *  tp_dbus_daemon_cancel_name_owner_namespace_watch()
+ *
+ * Arrange for @callback to be called every time the ownership of
+ * @name_space, or of any well-known name below it (such as
+ * <literal>org.freedesktop.Telepathy.Client.Empathy</literal> in the
+ * example above), changes. This uses a single D-Bus match rule for the whole
+ * namespace, rather than one per name.
+ *
+ * Unlike tp_dbus_daemon_watch_name_owner(), names that already have an
+ * owner when the watch is added are not reported until their ownership
+ * changes; use tp_dbus_daemon_list_names() to discover them. If ownership of
+ * a name changes several times in quick succession, @callback might only be
+ * called for the most recent owner.
+ *
+ * This relies on support for <literal>arg0namespace</literal> match rules,
+ * which was added in dbus-daemon 1.5.0.
+ *
+ * Since: 0.UNRELEASED
+ */
+void
+tp_dbus_daemon_watch_name_owner_namespace (TpDBusDaemon *self,
+    const gchar *name_space,
+    TpDBusDaemonNameOwnerChangedCb callback,
+    gpointer user_data,
+    GDestroyNotify destroy)
+{
+  _NameOwnerSubWatch tmp = { callback, user_data, destroy };
+  _NamespaceWatch *watch;
+  guint index;
+
+  g_return_if_fail (TP_IS_DBUS_DAEMON (self));
+  g_return_if_fail (tp_dbus_check_valid_bus_name (name_space,
+        TP_DBUS_NAME_TYPE_WELL_KNOWN, NULL));
+  g_return_if_fail (callback != NULL);
+  g_return_if_fail (self->priv->namespace_watches != NULL);
+
+  watch = _tp_dbus_daemon_find_namespace_watch (self, name_space, &index);
+
+  if (watch == NULL)
+    {
+      GPtrArray *array = self->priv->namespace_watches;
+      gchar *match_rule;
+
+      watch = g_slice_new0 (_NamespaceWatch);
+      watch->name_space = g_strdup (name_space);
+      watch->owners = g_hash_table_new_full (g_str_hash, g_str_equal,
+          g_free, g_free);
+      watch->callbacks = g_array_new (FALSE, FALSE,
+          sizeof (_NameOwnerSubWatch));
+
+      /* insert at @index, keeping the array sorted */
+      g_ptr_array_add (array, NULL);
+      memmove (array->pdata + index + 1, array->pdata + index,
+          (array->len - 1 - index) * sizeof (gpointer));
+      array->pdata[index] = watch;
+
+      match_rule = _tp_dbus_daemon_get_noc_namespace_rule (name_space);
+      DEBUG ("Adding match rule %s", match_rule);
+      dbus_bus_add_match (self->priv->libdbus, match_rule, NULL);
+      g_free (match_rule);
+    }
+
+  g_array_append_val (watch->callbacks, tmp);
+}
+
+/**
+ * tp_dbus_daemon_cancel_name_owner_namespace_watch: (skip)
+ * @self: the D-Bus daemon
+ * @name_space: the namespace that was being watched
+ * @callback: the callback that was called
+ * @user_data: the user data that was provided
+ *
+ * If there was a previous call to tp_dbus_daemon_watch_name_owner_namespace()
+ * with exactly the given @name_space, @callback and @user_data, remove it.
+ *
+ * If more than one watch matching the details provided was active, remove
+ * only the most recently added one.
+ *
+ * Returns: %TRUE if there was such a watch, %FALSE otherwise
+ *
+ * Since: 0.UNRELEASED
+ */
+gboolean
+tp_dbus_daemon_cancel_name_owner_namespace_watch (TpDBusDaemon *self,
+    const gchar *name_space,
+    TpDBusDaemonNameOwnerChangedCb callback,
+    gconstpointer user_data)
+{
+  _NamespaceWatch *watch;
+
+  g_return_val_if_fail (TP_IS_DBUS_DAEMON (self), FALSE);
+  g_return_val_if_fail (name_space != NULL, FALSE);
+  g_return_val_if_fail (callback != NULL, FALSE);
+
+  watch = _tp_dbus_daemon_find_namespace_watch (self, name_space, NULL);
+
+  if (watch != NULL)
+    {
+      GArray *array = watch->callbacks;
+      guint i;
+
+      for (i = array->len; i > 0; i--)
+        {
+          _NameOwnerSubWatch *entry = &g_array_index (array,
+              _NameOwnerSubWatch, i - 1);
+
+          if (entry->callback == callback && entry->user_data == user_data)
+            {
+              entry->callback = NULL;
+              tp_dbus_daemon_maybe_free_namespace_watch (self, watch);
+              return TRUE;
+            }
+        }
+    }
+
+  return FALSE;
+}
+
 /* for internal use (TpChannel, TpConnection _new convenience functions) */
 gboolean
 _tp_dbus_daemon_get_name_owner (TpDBusDaemon *self,
@@ -1246,15 +1706,6 @@ tp_dbus_daemon_list_activatable_names (TpDBusDaemon *self,
       callback, user_data, destroy, weak_object);
 }
 
-static void
-free_daemon_list (gpointer p)
-{
-  GSList **slistp = p;
-
-  g_slist_free (*slistp);
-  g_slice_free (GSList *, slistp);
-}
-
 /* If you add more slice-allocation in this function, make the suppression
  * "tp_dbus_daemon_constructor @daemons once per DBusConnection" in
  * telepathy-glib.supp more specific. */
@@ -1268,7 +1719,7 @@ tp_dbus_daemon_constructor (GType type,
   TpDBusDaemon *self = TP_DBUS_DAEMON (object_class->constructor (type,
         n_params, params));
   TpProxy *as_proxy = (TpProxy *) self;
-  GSList **daemons;
+  ConnectionData *data;
 
   g_assert (!tp_strdiff (as_proxy->bus_name, DBUS_SERVICE_DBUS));
   g_assert (!tp_strdiff (as_proxy->object_path, DBUS_PATH_DBUS));
@@ -1281,16 +1732,16 @@ tp_dbus_daemon_constructor (GType type,
   if (!dbus_connection_allocate_data_slot (&daemons_slot))
     ERROR ("Out of memory");
 
-  daemons = dbus_connection_get_data (self->priv->libdbus, daemons_slot);
+  data = dbus_connection_get_data (self->priv->libdbus, daemons_slot);
 
-  if (daemons == NULL)
+  if (data == NULL)
     {
       /* This slice is never freed; it's a one-per-DBusConnection leak. */
-      daemons = g_slice_new (GSList *);
-
-      *daemons = NULL;
-      dbus_connection_set_data (self->priv->libdbus, daemons_slot, daemons,
-          free_daemon_list);
+      data = g_slice_new0 (ConnectionData);
+      g_queue_init (&data->pending);
+      data->pending_by_name = g_hash_table_new (g_str_hash, g_str_equal);
+      dbus_connection_set_data (self->priv->libdbus, daemons_slot, data,
+          connection_data_free);
 
       /* we add this filter at most once per DBusConnection */
       if (!dbus_connection_add_filter (self->priv->libdbus,
@@ -1298,7 +1749,7 @@ tp_dbus_daemon_constructor (GType type,
         ERROR ("Out of memory");
     }
 
-  *daemons = g_slist_prepend (*daemons, self);
+  data->daemons = g_slist_prepend (data->daemons, self);
 
   return (GObject *) self;
 }
@@ -1311,13 +1762,14 @@ tp_dbus_daemon_init (TpDBusDaemon *self)
 
   self->priv->name_owner_watches = g_hash_table_new_full (g_str_hash,
       g_str_equal, g_free, NULL);
+  self->priv->namespace_watches = g_ptr_array_new ();
 }
 
 static void
 tp_dbus_daemon_dispose (GObject *object)
 {
   TpDBusDaemon *self = TP_DBUS_DAEMON (object);
-  GSList **daemons;
+  ConnectionData *data;
 
   if (self->priv->name_owner_watches != NULL)
     {
@@ -1341,19 +1793,38 @@ tp_dbus_daemon_dispose (GObject *object)
       g_hash_table_unref (tmp);
     }
 
+  if (self->priv->namespace_watches != NULL)
+    {
+      GPtrArray *tmp = self->priv->namespace_watches;
+      guint i;
+
+      self->priv->namespace_watches = NULL;
+
+      for (i = 0; i < tmp->len; i++)
+        {
+          _NamespaceWatch *watch = g_ptr_array_index (tmp, i);
+
+          /* it refs us while invoking stuff */
+          g_assert (watch->invoking == 0);
+          _tp_dbus_daemon_stop_watching_namespace (self, watch);
+        }
+
+      g_ptr_array_unref (tmp);
+    }
+
   if (self->priv->libdbus != NULL)
     {
       /* remove myself from the list to be notified on NoC */
-      daemons = dbus_connection_get_data (self->priv->libdbus, daemons_slot);
+      data = dbus_connection_get_data (self->priv->libdbus, daemons_slot);
 
       /* should always be non-NULL, barring bugs */
-      if (G_LIKELY (daemons != NULL))
+      if (G_LIKELY (data != NULL))
         {
-          *daemons = g_slist_remove (*daemons, self);
+          data->daemons = g_slist_remove (data->daemons, self);
 
-          if (*daemons == NULL)
+          if (data->daemons == NULL)
             {
-              /* this results in a call to free_daemon_list (daemons) */
+              /* this results in a call to connection_data_free (data) */
               dbus_connection_set_data (self->priv->libdbus, daemons_slot,
                   NULL, NULL);
             }
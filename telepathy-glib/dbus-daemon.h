@@ -70,6 +70,16 @@ gboolean tp_dbus_daemon_cancel_name_owner_watch (TpDBusDaemon *self,
     const gchar *name, TpDBusDaemonNameOwnerChangedCb callback,
     gconstpointer user_data);
 
+_TP_AVAILABLE_IN_UNRELEASED
+void tp_dbus_daemon_watch_name_owner_namespace (TpDBusDaemon *self,
+    const gchar *name_space, TpDBusDaemonNameOwnerChangedCb callback,
+    gpointer user_data, GDestroyNotify destroy);
+
+_TP_AVAILABLE_IN_UNRELEASED
+gboolean tp_dbus_daemon_cancel_name_owner_namespace_watch (TpDBusDaemon *self,
+    const gchar *name_space, TpDBusDaemonNameOwnerChangedCb callback,
+    gconstpointer user_data);
+
 gboolean tp_dbus_daemon_request_name (TpDBusDaemon *self,
     const gchar *well_known_name, gboolean idempotent, GError **error);
 gboolean tp_dbus_daemon_release_name (TpDBusDaemon *self,
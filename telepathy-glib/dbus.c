@@ -213,6 +213,171 @@ tp_get_bus_proxy (void)
  * Since: 0.11.5
  */
 
+/* Character classes for the D-Bus name and object path validators. The
+ * validators make one pass over the string, looking up each byte here,
+ * and only fall back to the slower code that explains what is wrong if the
+ * string turns out to be invalid. Non-ASCII bytes are never valid. */
+enum {
+    /* A-Z, a-z, _ */
+    CHAR_ALPHA = 1 << 0,
+    /* 0-9 */
+    CHAR_DIGIT = 1 << 1,
+    /* - (only in bus names) */
+    CHAR_HYPHEN = 1 << 2,
+    /* . */
+    CHAR_DOT = 1 << 3,
+    /* / (only in object paths) */
+    CHAR_SLASH = 1 << 4
+};
+
+#define A CHAR_ALPHA
+#define D CHAR_DIGIT
+#define H CHAR_HYPHEN
+#define P CHAR_DOT
+#define S CHAR_SLASH
+
+static const guint8 dbus_char_classes[256] = {
+  0, 0, 0, 0, 0, 0, 0, 0, /* 0x00 */
+  0, 0, 0, 0, 0, 0, 0, 0, /* 0x08 */
+  0, 0, 0, 0, 0, 0, 0, 0, /* 0x10 */
+  0, 0, 0, 0, 0, 0, 0, 0, /* 0x18 */
+  0, 0, 0, 0, 0, 0, 0, 0, /* 0x20 */
+  0, 0, 0, 0, 0, H, P, S, /* 0x28 */
+  D, D, D, D, D, D, D, D, /* 0x30 */
+  D, D, 0, 0, 0, 0, 0, 0, /* 0x38 */
+  0, A, A, A, A, A, A, A, /* 0x40 */
+  A, A, A, A, A, A, A, A, /* 0x48 */
+  A, A, A, A, A, A, A, A, /* 0x50 */
+  A, A, A, 0, 0, 0, 0, A, /* 0x58 */
+  0, A, A, A, A, A, A, A, /* 0x60 */
+  A, A, A, A, A, A, A, A, /* 0x68 */
+  A, A, A, A, A, A, A, A, /* 0x70 */
+  A, A, A, 0, 0, 0, 0, 0, /* 0x78 */
+  /* the rest are 0 */
+};
+
+#undef A
+#undef D
+#undef H
+#undef P
+#undef S
+
+#define DBUS_CHAR_CLASS(c) (dbus_char_classes[(guchar) (c)])
+
+/* Maximum length of a bus, interface or member name */
+#define DBUS_MAXIMUM_NAME_LENGTH 255
+
+/*
+ * Return TRUE if @name is a dot-separated sequence of at least two
+ * non-empty elements made of characters in @allowed (which must include
+ * CHAR_DOT), no longer than 255 bytes. If @digit_may_start is FALSE,
+ * no element may start with a digit.
+ */
+static inline gboolean
+dbus_dotted_name_is_valid (const gchar *name,
+    guint allowed,
+    gboolean digit_may_start)
+{
+  gboolean element_start = TRUE;
+  gboolean dot = FALSE;
+  const gchar *ptr;
+
+  for (ptr = name; *ptr != '\0'; ptr++)
+    {
+      guint klass = DBUS_CHAR_CLASS (*ptr);
+
+      if ((klass & allowed) == 0)
+        return FALSE;
+
+      if (klass == CHAR_DOT)
+        {
+          if (element_start)
+            return FALSE;
+
+          dot = TRUE;
+          element_start = TRUE;
+        }
+      else
+        {
+          if (element_start && klass == CHAR_DIGIT && !digit_may_start)
+            return FALSE;
+
+          element_start = FALSE;
+        }
+    }
+
+  return (dot && !element_start && ptr - name <= DBUS_MAXIMUM_NAME_LENGTH);
+}
+
+static gboolean
+dbus_bus_name_is_valid (const gchar *name,
+    TpDBusNameType allow_types)
+{
+  if (name[0] == ':')
+    return ((allow_types & TP_DBUS_NAME_TYPE_UNIQUE) != 0 &&
+        strlen (name) <= DBUS_MAXIMUM_NAME_LENGTH &&
+        dbus_dotted_name_is_valid (name + 1,
+          CHAR_ALPHA | CHAR_DIGIT | CHAR_HYPHEN | CHAR_DOT, TRUE));
+
+  if (!dbus_dotted_name_is_valid (name,
+        CHAR_ALPHA | CHAR_DIGIT | CHAR_HYPHEN | CHAR_DOT, FALSE))
+    return FALSE;
+
+  /* The bus daemon's name is syntactically a well-known name, so this
+   * check only needs to happen for names that are otherwise valid */
+  if (G_UNLIKELY (name[0] == 'o' && !tp_strdiff (name, DBUS_SERVICE_DBUS)))
+    return ((allow_types & TP_DBUS_NAME_TYPE_BUS_DAEMON) != 0);
+
+  return ((allow_types & TP_DBUS_NAME_TYPE_WELL_KNOWN) != 0);
+}
+
+static gboolean
+dbus_member_name_is_valid (const gchar *name)
+{
+  const gchar *ptr;
+
+  if (DBUS_CHAR_CLASS (name[0]) != CHAR_ALPHA)
+    return FALSE;
+
+  for (ptr = name + 1; *ptr != '\0'; ptr++)
+    {
+      if ((DBUS_CHAR_CLASS (*ptr) & (CHAR_ALPHA | CHAR_DIGIT)) == 0)
+        return FALSE;
+    }
+
+  return (ptr - name <= DBUS_MAXIMUM_NAME_LENGTH);
+}
+
+static gboolean
+dbus_object_path_is_valid (const gchar *path)
+{
+  const gchar *ptr;
+  guint last;
+
+  if (path[0] != '/')
+    return FALSE;
+
+  if (path[1] == '\0')
+    return TRUE;
+
+  last = CHAR_SLASH;
+
+  for (ptr = path + 1; *ptr != '\0'; ptr++)
+    {
+      guint klass = DBUS_CHAR_CLASS (*ptr);
+
+      if ((klass & (CHAR_ALPHA | CHAR_DIGIT | CHAR_SLASH)) == 0)
+        return FALSE;
+
+      if (klass == CHAR_SLASH && last == CHAR_SLASH)
+        return FALSE;
+
+      last = klass;
+    }
+
+  return (last != CHAR_SLASH);
+}
+
 /**
  * tp_dbus_check_valid_bus_name:
  * @name: a possible bus name
@@ -241,6 +406,12 @@ tp_dbus_check_valid_bus_name (const gchar *name,
 
   g_return_val_if_fail (name != NULL, FALSE);
 
+  if (G_LIKELY (dbus_bus_name_is_valid (name, allow_types)))
+    return TRUE;
+
+  /* The rest of this function only runs for unacceptable names, and works
+   * out why they're unacceptable. */
+
   if (name[0] == '\0')
     {
       g_set_error (error, TP_DBUS_ERRORS, TP_DBUS_ERROR_INVALID_BUS_NAME,
@@ -386,6 +557,13 @@ tp_dbus_check_valid_interface_name (const gchar *name,
 
   g_return_val_if_fail (name != NULL, FALSE);
 
+  if (G_LIKELY (dbus_dotted_name_is_valid (name,
+          CHAR_ALPHA | CHAR_DIGIT | CHAR_DOT, FALSE)))
+    return TRUE;
+
+  /* The rest of this function only runs for invalid names, and works out
+   * why they're invalid. */
+
   if (name[0] == '\0')
     {
       g_set_error (error, TP_DBUS_ERRORS, TP_DBUS_ERROR_INVALID_INTERFACE_NAME,
@@ -496,6 +674,12 @@ tp_dbus_check_valid_member_name (const gchar *name,
 
   g_return_val_if_fail (name != NULL, FALSE);
 
+  if (G_LIKELY (dbus_member_name_is_valid (name)))
+    return TRUE;
+
+  /* The rest of this function only runs for invalid names, and works out
+   * why they're invalid. */
+
   if (name[0] == '\0')
     {
       g_set_error (error, TP_DBUS_ERRORS, TP_DBUS_ERROR_INVALID_MEMBER_NAME,
@@ -559,6 +743,12 @@ tp_dbus_check_valid_object_path (const gchar *path, GError **error)
 
   g_return_val_if_fail (path != NULL, FALSE);
 
+  if (G_LIKELY (dbus_object_path_is_valid (path)))
+    return TRUE;
+
+  /* The rest of this function only runs for invalid paths, and works out
+   * why they're invalid. */
+
   if (path[0] != '/')
     {
       g_set_error (error, TP_DBUS_ERRORS, TP_DBUS_ERROR_INVALID_OBJECT_PATH,
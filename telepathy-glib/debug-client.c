@@ -20,6 +20,8 @@
 
 #include "config.h"
 
+#include <string.h>
+
 #include <telepathy-glib/debug-client.h>
 #include <telepathy-glib/debug-message-internal.h>
 #include <telepathy-glib/dbus.h>
@@ -461,6 +463,56 @@ tp_debug_client_is_enabled (TpDebugClient *self)
   return self->priv->enabled;
 }
 
+typedef struct {
+    GSimpleAsyncResult *result;
+    /* FALSE if every message is wanted */
+    gboolean filter;
+    gdouble since;
+    gchar *domain;
+    GLogLevelFlags levels;
+} GetMessagesData;
+
+static void
+get_messages_data_free (gpointer p)
+{
+  GetMessagesData *data = p;
+
+  g_object_unref (data->result);
+  g_free (data->domain);
+  g_slice_free (GetMessagesData, data);
+}
+
+/* @domain is the whole "domain/category" of a message */
+static gboolean
+domain_matches (const gchar *domain,
+    const gchar *filter)
+{
+  gsize len;
+
+  if (filter == NULL)
+    return TRUE;
+
+  len = strlen (filter);
+
+  return (strncmp (domain, filter, len) == 0 &&
+      (domain[len] == '\0' || domain[len] == '/'));
+}
+
+static gboolean
+message_matches (GetMessagesData *data,
+    gdouble timestamp,
+    const gchar *domain,
+    TpDebugLevel level)
+{
+  /* messages logged at exactly @since are included, so that none logged
+   * in the same instant as the previous poll's last message are lost */
+  if (data->since != 0 && timestamp < data->since)
+    return FALSE;
+
+  return (domain_matches (domain, data->domain) &&
+      (_tp_debug_level_to_log_level_flags (level) & data->levels) != 0);
+}
+
 static void
 get_messages_cb (TpDebugClient *self,
     const GPtrArray *messages,
@@ -468,14 +520,14 @@ get_messages_cb (TpDebugClient *self,
     gpointer user_data,
     GObject *weak_object)
 {
-  GSimpleAsyncResult *result = user_data;
+  GetMessagesData *data = user_data;
   guint i;
   GPtrArray *messages_arr;
 
   if (error != NULL)
     {
       DEBUG ("GetMessages() failed: %s", error->message);
-      g_simple_async_result_set_from_error (result, error);
+      g_simple_async_result_set_from_error (data->result, error);
       goto out;
     }
 
@@ -483,24 +535,52 @@ get_messages_cb (TpDebugClient *self,
 
   for (i = 0; i < messages->len; i++)
     {
+      GValueArray *va = g_ptr_array_index (messages, i);
       TpDebugMessage *msg;
       gdouble timestamp;
       const gchar *domain, *message;
       TpDebugLevel level;
 
-      tp_value_array_unpack (g_ptr_array_index (messages, i), 4,
+      tp_value_array_unpack (va, 4,
           &timestamp, &domain, &level, &message);
 
+      /* Only make objects for the messages the caller asked for */
+      if (data->filter && !message_matches (data, timestamp, domain, level))
+        continue;
+
       msg = _tp_debug_message_new (timestamp, domain, level, message);
 
       g_ptr_array_add (messages_arr, msg);
     }
 
-  g_simple_async_result_set_op_res_gpointer (result, messages_arr,
+  g_simple_async_result_set_op_res_gpointer (data->result, messages_arr,
       (GDestroyNotify) g_ptr_array_unref);
 
 out:
-  g_simple_async_result_complete (result);
+  g_simple_async_result_complete (data->result);
+}
+
+static void
+get_messages (TpDebugClient *self,
+    gboolean filter,
+    gdouble since,
+    const gchar *domain,
+    GLogLevelFlags levels,
+    GAsyncReadyCallback callback,
+    gpointer user_data,
+    gpointer source_tag)
+{
+  GetMessagesData *data = g_slice_new (GetMessagesData);
+
+  data->result = g_simple_async_result_new (G_OBJECT (self),
+      callback, user_data, source_tag);
+  data->filter = filter;
+  data->since = since;
+  data->domain = g_strdup (domain);
+  data->levels = levels;
+
+  tp_cli_debug_call_get_messages (self, -1, get_messages_cb,
+      data, get_messages_data_free, NULL);
 }
 
 /**
@@ -521,11 +601,71 @@ tp_debug_client_get_messages_async (
     GAsyncReadyCallback callback,
     gpointer user_data)
 {
-  GSimpleAsyncResult *result = g_simple_async_result_new (G_OBJECT (self),
-      callback, user_data, tp_debug_client_set_enabled_async);
+  get_messages (self, FALSE, 0, NULL, G_LOG_LEVEL_MASK, callback, user_data,
+      tp_debug_client_get_messages_async);
+}
 
-  tp_cli_debug_call_get_messages (self, -1, get_messages_cb,
-      result, g_object_unref, NULL);
+/**
+ * tp_debug_client_get_messages_since_async:
+ * @self: a #TpDebugClient
+ * @since: only retrieve messages logged at or after this time, in seconds
+ *  since the Unix epoch, or 0 to retrieve messages from any time
+ * @domain: (allow-none): only retrieve messages in this domain, which may
+ *  include a category such as "gabble/connection"; or %NULL to retrieve
+ *  messages from any domain
+ * @levels: only retrieve messages with one of these #GLogLevelFlags, or
+ *  %G_LOG_LEVEL_MASK to retrieve messages of any level
+ * @callback: callback to call when the messages have been retrieved
+ * @user_data: data to pass to @callback
+ *
+ * Like tp_debug_client_get_messages_async(), but only the messages matching
+ * the given criteria are turned into #TpDebugMessage objects. This is
+ * intended for debug viewers which poll for new messages: passing the time
+ * of the most recent message already seen as @since retrieves just the
+ * messages logged since then. Several messages can have the same
+ * timestamp, so messages logged at exactly @since are included; the
+ * caller should skip those it has already seen.
+ *
+ * Once @callback is called, use
+ * tp_debug_client_get_messages_since_finish() to retrieve the
+ * #TpDebugMessage objects.
+ *
+ * Since: 0.UNRELEASED
+ */
+void
+tp_debug_client_get_messages_since_async (TpDebugClient *self,
+    gdouble since,
+    const gchar *domain,
+    GLogLevelFlags levels,
+    GAsyncReadyCallback callback,
+    gpointer user_data)
+{
+  g_return_if_fail (TP_IS_DEBUG_CLIENT (self));
+
+  get_messages (self, TRUE, since, domain, levels, callback, user_data,
+      tp_debug_client_get_messages_since_async);
+}
+
+/**
+ * tp_debug_client_get_messages_since_finish:
+ * @self: a #TpDebugClient
+ * @result: a #GAsyncResult
+ * @error: a #GError to fill
+ *
+ * Finishes tp_debug_client_get_messages_since_async().
+ *
+ * Returns: (transfer container) (type GLib.PtrArray) (element-type TelepathyGLib.DebugMessage):
+ * a #GPtrArray of #TpDebugMessage, free with g_ptr_array_unref()
+ *
+ * Since: 0.UNRELEASED
+ */
+GPtrArray *
+tp_debug_client_get_messages_since_finish (TpDebugClient *self,
+    GAsyncResult *result,
+    GError **error)
+{
+  _tp_implement_finish_return_copy_pointer (self,
+      tp_debug_client_get_messages_since_async, g_ptr_array_ref)
 }
 
 /**
@@ -534,7 +674,7 @@ tp_debug_client_get_messages_async (
  * @result: a #GAsyncResult
  * @error: a #GError to fill
  *
- * Finishes tp_debug_client_set_enabled_async().
+ * Finishes tp_debug_client_get_messages_async().
  *
  * Returns: (transfer container) (type GLib.PtrArray) (element-type TelepathyGLib.DebugMessage):
  * a #GPtrArray of #TpDebugMessage, free with g_ptr_array_unref()
@@ -547,5 +687,5 @@ tp_debug_client_get_messages_finish (TpDebugClient *self,
     GError **error)
 {
   _tp_implement_finish_return_copy_pointer (self,
-      tp_debug_client_set_enabled_async, g_ptr_array_ref)
+      tp_debug_client_get_messages_async, g_ptr_array_ref)
 }
@@ -92,6 +92,19 @@ void tp_debug_client_get_messages_async (
     GAsyncReadyCallback callback,
     gpointer user_data);
 
+_TP_AVAILABLE_IN_UNRELEASED
+void tp_debug_client_get_messages_since_async (TpDebugClient *self,
+    gdouble since,
+    const gchar *domain,
+    GLogLevelFlags levels,
+    GAsyncReadyCallback callback,
+    gpointer user_data);
+
+_TP_AVAILABLE_IN_UNRELEASED
+GPtrArray *tp_debug_client_get_messages_since_finish (TpDebugClient *self,
+    GAsyncResult *result,
+    GError **error) G_GNUC_WARN_UNUSED_RESULT;
+
 _TP_AVAILABLE_IN_0_20
 GPtrArray * tp_debug_client_get_messages_finish (TpDebugClient *self,
     GAsyncResult *result,
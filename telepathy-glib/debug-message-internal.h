@@ -29,4 +29,6 @@ TpDebugMessage * _tp_debug_message_new (gdouble timestamp,
     TpDebugLevel level,
     const gchar *message);
 
+GLogLevelFlags _tp_debug_level_to_log_level_flags (TpDebugLevel level);
+
 #endif
@@ -21,6 +21,8 @@
 
 #include "config.h"
 
+#include <string.h>
+
 #include "debug-message.h"
 #include "debug-message-internal.h"
 
@@ -203,8 +205,8 @@ tp_debug_message_init (TpDebugMessage *self)
       TP_TYPE_DEBUG_MESSAGE, TpDebugMessagePriv);
 }
 
-static GLogLevelFlags
-debug_level_to_log_level_flags (TpDebugLevel level)
+GLogLevelFlags
+_tp_debug_level_to_log_level_flags (TpDebugLevel level)
 {
   if (level == TP_DEBUG_LEVEL_ERROR)
     return G_LOG_LEVEL_ERROR;
@@ -231,6 +233,7 @@ _tp_debug_message_new (gdouble timestamp,
 {
   TpDebugMessage *self;
   GTimeVal tv;
+  const gchar *slash;
 
   g_return_val_if_fail (domain != NULL, NULL);
   g_return_val_if_fail (message != NULL, NULL);
@@ -241,12 +244,12 @@ _tp_debug_message_new (gdouble timestamp,
   tv.tv_sec = (glong) timestamp;
   tv.tv_usec = ((timestamp - (int) timestamp) * 1e6);
 
-  if (g_strrstr (domain, "/"))
+  slash = strchr (domain, '/');
+
+  if (slash != NULL)
     {
-      gchar **parts = g_strsplit (domain, "/", 2);
-      self->priv->domain = g_strdup (parts[0]);
-      self->priv->category = g_strdup (parts[1]);
-      g_strfreev (parts);
+      self->priv->domain = g_strndup (domain, slash - domain);
+      self->priv->category = g_strdup (slash + 1);
     }
   else
     {
@@ -256,7 +259,7 @@ _tp_debug_message_new (gdouble timestamp,
 
   self->priv->time = g_date_time_new_from_timeval_utc (&tv);
 
-  self->priv->level = debug_level_to_log_level_flags (level);
+  self->priv->level = _tp_debug_level_to_log_level_flags (level);
   self->priv->message = g_strdup (message);
   g_strchomp (self->priv->message);
 
@@ -24,6 +24,7 @@
 
 #include <telepathy-glib/base-call-internal.h>
 #include <telepathy-glib/errors.h>
+#include <telepathy-glib/timer-internal.h>
 #include <telepathy-glib/util.h>
 
 
@@ -187,7 +188,8 @@ struct _TpDTMFPlayerPrivate
   gchar *dialstring;
   /* a pointer into dialstring, or NULL */
   const gchar *dialstring_remaining;
-  guint timer_id;
+  /* borrowed: freed by the scheduler when it fires, or NULL */
+  TpTimer *timer;
   guint tone_ms;
   guint gap_ms;
   guint pause_ms;
@@ -250,26 +252,26 @@ tp_dtmf_player_cancel (TpDTMFPlayer *self)
 {
   g_return_if_fail (TP_IS_DTMF_PLAYER (self));
 
-  if (self->priv->timer_id != 0)
+  if (self->priv->timer != NULL)
     {
       tp_dtmf_player_maybe_emit_stopped_tone (self);
       tp_dtmf_player_emit_finished (self, TRUE);
 
-      g_source_remove (self->priv->timer_id);
-      self->priv->timer_id = 0;
+      _tp_timer_cancel (self->priv->timer);
+      self->priv->timer = NULL;
     }
 
   tp_clear_pointer (&self->priv->dialstring, g_free);
 }
 
-static gboolean
+static void
 tp_dtmf_player_timer_cb (gpointer data)
 {
   TpDTMFPlayer *self = data;
   gboolean was_playing = self->priv->playing_tone;
   gboolean was_paused = self->priv->paused;
 
-  self->priv->timer_id = 0;
+  self->priv->timer = NULL;
 
   tp_dtmf_player_maybe_emit_stopped_tone (self);
 
@@ -285,7 +287,7 @@ tp_dtmf_player_timer_cb (gpointer data)
       /* die of natural causes */
       tp_dtmf_player_emit_finished (self, FALSE);
       tp_dtmf_player_cancel (self);
-      return FALSE;
+      return;
     }
 
   switch (_tp_dtmf_char_classify (*self->priv->dialstring_remaining))
@@ -294,7 +296,7 @@ tp_dtmf_player_timer_cb (gpointer data)
         if (was_playing)
           {
             /* Play a gap (short silence) before the next tone */
-            self->priv->timer_id = g_timeout_add (self->priv->gap_ms,
+            self->priv->timer = _tp_timer_add (self->priv->gap_ms, 0,
                 tp_dtmf_player_timer_cb, self);
           }
         else
@@ -303,7 +305,7 @@ tp_dtmf_player_timer_cb (gpointer data)
              * Play the tone straight away. */
             tp_dtmf_player_emit_started_tone (self,
                 _tp_dtmf_char_to_event (*self->priv->dialstring_remaining));
-            self->priv->timer_id = g_timeout_add (self->priv->tone_ms,
+            self->priv->timer = _tp_timer_add (self->priv->tone_ms, 0,
                 tp_dtmf_player_timer_cb, self);
           }
         break;
@@ -312,7 +314,7 @@ tp_dtmf_player_timer_cb (gpointer data)
         /* Pause, typically for 3 seconds. We don't need to have a gap
          * first. */
         self->priv->paused = TRUE;
-        self->priv->timer_id = g_timeout_add (self->priv->pause_ms,
+        self->priv->timer = _tp_timer_add (self->priv->pause_ms, 0,
             tp_dtmf_player_timer_cb, self);
         break;
 
@@ -332,8 +334,6 @@ tp_dtmf_player_timer_cb (gpointer data)
       default:
         g_assert_not_reached ();
     }
-
-  return FALSE;
 }
 
 /**
@@ -391,7 +391,7 @@ tp_dtmf_player_play (TpDTMFPlayer *self,
       return FALSE;
     }
 
-  g_assert (self->priv->timer_id == 0);
+  g_assert (self->priv->timer == NULL);
 
   for (i = 0; tones[i] != '\0'; i++)
     {
@@ -446,7 +446,7 @@ tp_dtmf_player_init (TpDTMFPlayer *self)
   self->priv->dialstring = NULL;
   self->priv->dialstring_remaining = NULL;
   self->priv->playing_tone = FALSE;
-  self->priv->timer_id = 0;
+  self->priv->timer = NULL;
 }
 
 static void
@@ -0,0 +1,36 @@
+/*<private_header>*/
+/*
+ * file-transfer-channel-internal.h - TpFileTransferChannel internals
+ *
+ * Copyright (C) 2010-2011 Collabora Ltd. <http://www.collabora.co.uk/>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#ifndef __TP_FILE_TRANSFER_CHANNEL_INTERNAL_H__
+#define __TP_FILE_TRANSFER_CHANNEL_INTERNAL_H__
+
+#include <telepathy-glib/file-transfer-channel.h>
+
+G_BEGIN_DECLS
+
+/* Used by tests to force the copy through userspace */
+void _tp_file_transfer_channel_set_zero_copy_enabled (
+    TpFileTransferChannel *self,
+    gboolean enabled);
+
+G_END_DECLS
+
+#endif
@@ -94,9 +94,16 @@
  * Since: 0.15.5
  */
 
+/* for splice(); this has to be defined before config.h and any system
+ * header are included */
+#ifndef _GNU_SOURCE
+# define _GNU_SOURCE
+#endif
+
 #include "config.h"
 
 #include "telepathy-glib/file-transfer-channel.h"
+#include "telepathy-glib/file-transfer-channel-internal.h"
 
 #include <telepathy-glib/dbus.h>
 #include <telepathy-glib/gnio-util.h>
@@ -121,6 +128,25 @@
 #include <gio/gunixconnection.h>
 #endif /* HAVE_GIO_UNIX */
 
+/* On Linux, move data directly between the file and the CM's socket in the
+ * kernel, with sendfile() when sending and splice() (through a pipe) when
+ * receiving, rather than copying it through userspace buffers. */
+#if defined(HAVE_GIO_UNIX) && defined(HAVE_SPLICE) && defined(HAVE_SENDFILE) \
+    && defined(HAVE_SYS_SENDFILE_H)
+# define USE_ZERO_COPY 1
+# include <errno.h>
+# include <fcntl.h>
+# include <unistd.h>
+# include <sys/sendfile.h>
+# include <gio/gfiledescriptorbased.h>
+#endif
+
+#define DEFAULT_CHUNK_SIZE (64 * 1024)
+#define MIN_CHUNK_SIZE 4096
+/* how often local-transferred-bytes and local-throughput are notified while
+ * the data is moving */
+#define PROGRESS_INTERVAL (200 * G_TIME_SPAN_MILLISECOND)
+
 G_DEFINE_TYPE (TpFileTransferChannel, tp_file_transfer_channel, TP_TYPE_CHANNEL)
 
 struct _TpFileTransferChannelPrivate
@@ -160,6 +186,31 @@ struct _TpFileTransferChannelPrivate
     TpSocketAccessControl access_control;
     GValue *access_control_param;
 
+    /* bytes moved between the local file and the socket, as seen by us */
+    guint64 local_transferred_bytes;
+    /* bytes per second, averaged since the transfer started */
+    guint64 local_throughput;
+    /* monotonic times when the data started moving, and when the progress
+     * was last notified */
+    gint64 transfer_start_time;
+    gint64 last_progress_notify;
+    guint chunk_size;
+
+    /* Used while copying through userspace */
+    gchar *copy_buffer;
+    gsize copy_buffer_size;
+    gsize copy_pending;
+    gsize copy_written;
+
+#ifdef USE_ZERO_COPY
+    /* Set by tests to exercise the fallback */
+    gboolean zero_copy_disabled;
+    /* Used while copying with sendfile() or splice(); -1 otherwise */
+    int file_fd;
+    /* Pipe to splice() through when receiving; -1 otherwise */
+    int pipe_fds[2];
+#endif
+
     GSimpleAsyncResult *result;
     GCancellable *cancellable;
 };
@@ -177,6 +228,9 @@ enum /* properties */
   PROP_INITIAL_OFFSET,
   PROP_SERVICE_NAME,
   PROP_METADATA,
+  PROP_LOCAL_TRANSFERRED_BYTES,
+  PROP_CHUNK_SIZE,
+  PROP_LOCAL_THROUGHPUT,
   N_PROPS
 };
 
@@ -210,20 +264,59 @@ stream_close_cb (GObject *source,
   g_object_unref (self);
 }
 
+/* Account for @n more bytes having been moved. The properties are notified
+ * at most every PROGRESS_INTERVAL, so that moving small chunks over a fast
+ * local socket doesn't flood the main loop with signals; @finished forces a
+ * notification so that the final values are always seen. */
 static void
-splice_stream_ready_cb (GObject *output,
+update_local_progress (TpFileTransferChannel *self,
+    gsize n,
+    gboolean finished)
+{
+  gint64 now = g_get_monotonic_time ();
+  gint64 elapsed;
+
+  self->priv->local_transferred_bytes += n;
+
+  if (!finished &&
+      now - self->priv->last_progress_notify < PROGRESS_INTERVAL)
+    return;
+
+  elapsed = now - self->priv->transfer_start_time;
+
+  if (elapsed > 0)
+    self->priv->local_throughput = (guint64) (
+        (gdouble) self->priv->local_transferred_bytes * G_USEC_PER_SEC /
+        elapsed);
+
+  self->priv->last_progress_notify = now;
+
+  g_object_freeze_notify ((GObject *) self);
+  g_object_notify ((GObject *) self, "local-transferred-bytes");
+  g_object_notify ((GObject *) self, "local-throughput");
+  g_object_thaw_notify ((GObject *) self);
+}
+
+static void
+file_stream_close_cb (GObject *source,
     GAsyncResult *result,
     gpointer user_data)
 {
   TpFileTransferChannel *self = user_data;
   GError *error = NULL;
+  gboolean ok;
 
-  g_output_stream_splice_finish (G_OUTPUT_STREAM (output), result,
-      &error);
+  if (G_IS_INPUT_STREAM (source))
+    ok = g_input_stream_close_finish ((GInputStream *) source, result, &error);
+  else
+    ok = g_output_stream_close_finish ((GOutputStream *) source, result,
+        &error);
 
-  if (error != NULL && !g_cancellable_is_cancelled (self->priv->cancellable))
-    DEBUG ("splice operation failed: %s", error->message);
-  g_clear_error (&error);
+  if (!ok)
+    {
+      DEBUG ("Failed to close file: %s", error->message);
+      g_clear_error (&error);
+    }
 
   g_io_stream_close_async (self->priv->stream, G_PRIORITY_DEFAULT,
       NULL, stream_close_cb, g_object_ref (self));
@@ -231,67 +324,494 @@ splice_stream_ready_cb (GObject *output,
   g_object_unref (self);
 }
 
+/* Close the file and then the socket, whichever way the data was moved */
 static void
-client_socket_connected (TpFileTransferChannel *self)
+finish_copying (TpFileTransferChannel *self)
 {
-  GSocketConnection *conn;
+  update_local_progress (self, 0, TRUE);
+
+  DEBUG ("transfer finished after %" G_GUINT64_FORMAT " bytes, %"
+      G_GUINT64_FORMAT " bytes/s", self->priv->local_transferred_bytes,
+      self->priv->local_throughput);
+
+  tp_clear_pointer (&self->priv->copy_buffer, g_free);
+  self->priv->copy_buffer_size = 0;
+
+  if (tp_channel_get_requested (TP_CHANNEL (self)))
+    g_input_stream_close_async (self->priv->in_stream, G_PRIORITY_DEFAULT,
+        NULL, file_stream_close_cb, g_object_ref (self));
+  else
+    g_output_stream_close_async (self->priv->out_stream, G_PRIORITY_DEFAULT,
+        NULL, file_stream_close_cb, g_object_ref (self));
+}
+
+static GInputStream *
+copy_get_source (TpFileTransferChannel *self)
+{
+  if (tp_channel_get_requested (TP_CHANNEL (self)))
+    return self->priv->in_stream;
+  else
+    return g_io_stream_get_input_stream (self->priv->stream);
+}
+
+static GOutputStream *
+copy_get_target (TpFileTransferChannel *self)
+{
+  if (tp_channel_get_requested (TP_CHANNEL (self)))
+    return g_io_stream_get_output_stream (self->priv->stream);
+  else
+    return self->priv->out_stream;
+}
+
+static void copy_read_cb (GObject *source,
+    GAsyncResult *result,
+    gpointer user_data);
+
+static void copy_write_cb (GObject *source,
+    GAsyncResult *result,
+    gpointer user_data);
+
+static void
+copy_next_chunk (TpFileTransferChannel *self)
+{
+  /* chunk-size can change while we are copying */
+  if (self->priv->copy_buffer_size != self->priv->chunk_size)
+    {
+      self->priv->copy_buffer_size = self->priv->chunk_size;
+      self->priv->copy_buffer = g_realloc (self->priv->copy_buffer,
+          self->priv->copy_buffer_size);
+    }
+
+  g_input_stream_read_async (copy_get_source (self), self->priv->copy_buffer,
+      self->priv->copy_buffer_size, G_PRIORITY_DEFAULT,
+      self->priv->cancellable, copy_read_cb, g_object_ref (self));
+}
+
+static void
+copy_write_pending (TpFileTransferChannel *self)
+{
+  g_output_stream_write_async (copy_get_target (self),
+      self->priv->copy_buffer + self->priv->copy_written,
+      self->priv->copy_pending - self->priv->copy_written,
+      G_PRIORITY_DEFAULT, self->priv->cancellable, copy_write_cb,
+      g_object_ref (self));
+}
+
+static void
+copy_read_cb (GObject *source,
+    GAsyncResult *result,
+    gpointer user_data)
+{
+  TpFileTransferChannel *self = user_data;
   GError *error = NULL;
+  gssize n;
 
-  conn = g_socket_connection_factory_create_connection (
-      self->priv->client_socket);
-  if (conn == NULL)
+  n = g_input_stream_read_finish ((GInputStream *) source, result, &error);
+
+  if (n > 0)
     {
-      DEBUG ("Failed to create client connection");
-      return;
+      self->priv->copy_pending = n;
+      self->priv->copy_written = 0;
+      copy_write_pending (self);
+      goto out;
     }
 
-  DEBUG ("File transfer socket connected");
+  if (n < 0)
+    {
+      if (!g_cancellable_is_cancelled (self->priv->cancellable))
+        DEBUG ("Failed to read: %s", error->message);
+      g_clear_error (&error);
+    }
 
-#ifdef HAVE_GIO_UNIX
-  if (self->priv->access_control == TP_SOCKET_ACCESS_CONTROL_CREDENTIALS)
+  finish_copying (self);
+
+out:
+  g_object_unref (self);
+}
+
+static void
+copy_write_cb (GObject *source,
+    GAsyncResult *result,
+    gpointer user_data)
+{
+  TpFileTransferChannel *self = user_data;
+  GError *error = NULL;
+  gssize n;
+
+  n = g_output_stream_write_finish ((GOutputStream *) source, result,
+      &error);
+
+  if (n < 0)
     {
-      guchar byte;
+      if (!g_cancellable_is_cancelled (self->priv->cancellable))
+        DEBUG ("Failed to write: %s", error->message);
+      g_clear_error (&error);
+      finish_copying (self);
+      goto out;
+    }
 
-      byte = g_value_get_uchar (self->priv->access_control_param);
+  self->priv->copy_written += n;
+  update_local_progress (self, n, FALSE);
 
-      /* FIXME: we should an async version of this API (bgo #629503) */
-      if (!tp_unix_connection_send_credentials_with_byte (
-              conn, byte, NULL, &error))
+  if (self->priv->copy_written < self->priv->copy_pending)
+    copy_write_pending (self);
+  else
+    copy_next_chunk (self);
+
+out:
+  g_object_unref (self);
+}
+
+/* Copy the rest of the file through userspace, one chunk at a time, carrying
+ * on from wherever the file and the socket currently are */
+static void
+start_copying_through_userspace (TpFileTransferChannel *self)
+{
+  DEBUG ("Copying the file in chunks of %u bytes", self->priv->chunk_size);
+
+  copy_next_chunk (self);
+}
+
+#ifdef USE_ZERO_COPY
+typedef enum {
+    ZERO_COPY_CONTINUE,
+    ZERO_COPY_WOULD_BLOCK,
+    ZERO_COPY_DONE,
+    ZERO_COPY_FALL_BACK,
+    ZERO_COPY_FAILED
+} ZeroCopyResult;
+
+static void
+zero_copy_close_fds (TpFileTransferChannel *self)
+{
+  /* file_fd belongs to the GFile stream */
+  self->priv->file_fd = -1;
+
+  if (self->priv->pipe_fds[0] != -1)
+    {
+      close (self->priv->pipe_fds[0]);
+      close (self->priv->pipe_fds[1]);
+      self->priv->pipe_fds[0] = -1;
+      self->priv->pipe_fds[1] = -1;
+    }
+}
+
+/* The @left bytes still in the pipe have already been taken off the socket,
+ * so write them to the file through its stream rather than losing them */
+static gboolean
+zero_copy_drain_pipe (TpFileTransferChannel *self,
+    gsize left,
+    GError **error)
+{
+  gchar buffer[4096];
+
+  while (left > 0)
+    {
+      ssize_t n = read (self->priv->pipe_fds[0], buffer,
+          MIN (left, sizeof (buffer)));
+
+      if (n < 0 && errno == EINTR)
+        continue;
+
+      if (n <= 0)
         {
-          DEBUG ("Failed to send credentials: %s", error->message);
-          g_object_unref (conn);
-          g_clear_error (&error);
-          return;
+          /* the data we've been told is in the pipe isn't there */
+          int errsv = (n < 0 ? errno : EIO);
+
+          g_set_error (error, G_IO_ERROR, g_io_error_from_errno (errsv),
+              "Failed to read from pipe: %s", g_strerror (errsv));
+          return FALSE;
         }
+
+      if (!g_output_stream_write_all (self->priv->out_stream, buffer, n,
+              NULL, self->priv->cancellable, error))
+        return FALSE;
+
+      left -= n;
     }
-#endif
 
-  self->priv->stream = G_IO_STREAM (conn);
+  return TRUE;
+}
+
+static ZeroCopyResult
+zero_copy_step (TpFileTransferChannel *self,
+    GError **error)
+{
+  int sock_fd = g_socket_get_fd (self->priv->client_socket);
+  ssize_t n;
 
   if (tp_channel_get_requested (TP_CHANNEL (self)))
     {
-      GOutputStream *stream;
+      /* with a NULL offset, sendfile() reads from and updates the file's own
+       * position, just like reading from the GFileInputStream would */
+      n = sendfile (sock_fd, self->priv->file_fd, NULL,
+          self->priv->chunk_size);
+    }
+  else
+    {
+      n = splice (sock_fd, NULL, self->priv->pipe_fds[1], NULL,
+          self->priv->chunk_size, SPLICE_F_MOVE | SPLICE_F_NONBLOCK);
+
+      if (n > 0)
+        {
+          ssize_t left = n;
+
+          while (left > 0)
+            {
+              ssize_t written = splice (self->priv->pipe_fds[0], NULL,
+                  self->priv->file_fd, NULL, left, SPLICE_F_MOVE);
+
+              if (written > 0)
+                {
+                  left -= written;
+                  continue;
+                }
+
+              if (written < 0 && errno == EINTR)
+                continue;
+
+              if (written < 0)
+                DEBUG ("Failed to splice into the file: %s",
+                    g_strerror (errno));
+              else
+                DEBUG ("splice() into the file made no progress");
+
+              break;
+            }
+
+          if (left > 0)
+            {
+              if (!zero_copy_drain_pipe (self, left, error))
+                return ZERO_COPY_FAILED;
+
+              update_local_progress (self, n, FALSE);
+              return ZERO_COPY_FALL_BACK;
+            }
+        }
+    }
+
+  if (n > 0)
+    {
+      update_local_progress (self, n, FALSE);
+      return ZERO_COPY_CONTINUE;
+    }
+
+  if (n == 0)
+    return ZERO_COPY_DONE;
+
+  switch (errno)
+    {
+      case EINTR:
+        return ZERO_COPY_CONTINUE;
+
+      case EAGAIN:
+#if EWOULDBLOCK != EAGAIN
+      case EWOULDBLOCK:
+#endif
+        return ZERO_COPY_WOULD_BLOCK;
+
+      case EINVAL:
+      case ENOSYS:
+      case EOPNOTSUPP:
+        /* this combination of file and socket doesn't support it; nothing
+         * was moved by this call, so copying can carry on from here */
+        return ZERO_COPY_FALL_BACK;
+
+      default:
+        {
+          int errsv = errno;
+
+          g_set_error (error, G_IO_ERROR, g_io_error_from_errno (errsv),
+              "Failed to transfer file: %s", g_strerror (errsv));
+          return ZERO_COPY_FAILED;
+        }
+    }
+}
+
+static gboolean
+zero_copy_cb (GSocket *socket,
+    GIOCondition condition,
+    TpFileTransferChannel *self)
+{
+  GError *error = NULL;
+
+  if (g_cancellable_is_cancelled (self->priv->cancellable))
+    {
+      /* anything left in the pipe is lost, like the content of the copy
+       * buffer would be */
+      DEBUG ("transfer cancelled");
+    }
+  else
+    {
+      /* move one chunk per iteration, so that a fast local socket doesn't
+       * starve the rest of the main loop */
+      switch (zero_copy_step (self, &error))
+        {
+          case ZERO_COPY_CONTINUE:
+          case ZERO_COPY_WOULD_BLOCK:
+            return TRUE;
+
+          case ZERO_COPY_FALL_BACK:
+            DEBUG ("zero-copy transfer not possible after %" G_GUINT64_FORMAT
+                " bytes, falling back to copying",
+                self->priv->local_transferred_bytes);
+            zero_copy_close_fds (self);
+            start_copying_through_userspace (self);
+            return FALSE;
+
+          case ZERO_COPY_DONE:
+            break;
+
+          case ZERO_COPY_FAILED:
+            DEBUG ("%s", error->message);
+            g_clear_error (&error);
+            break;
+        }
+    }
+
+  zero_copy_close_fds (self);
+  finish_copying (self);
+
+  return FALSE;
+}
+
+/* Returns: %TRUE if the transfer was started, %FALSE if the caller should
+ * fall back to start_copying_through_userspace() */
+static gboolean
+start_zero_copy (TpFileTransferChannel *self)
+{
+  gboolean requested = tp_channel_get_requested (TP_CHANNEL (self));
+  GObject *file_stream;
+  GSource *source;
+
+  if (self->priv->zero_copy_disabled)
+    return FALSE;
 
-      stream = g_io_stream_get_output_stream (G_IO_STREAM (conn));
+  if (requested)
+    file_stream = (GObject *) self->priv->in_stream;
+  else
+    file_stream = (GObject *) self->priv->out_stream;
+
+  /* only local files have a file descriptor */
+  if (!G_IS_FILE_DESCRIPTOR_BASED (file_stream))
+    return FALSE;
+
+  if (!requested)
+    {
+      if (pipe (self->priv->pipe_fds) != 0)
+        {
+          DEBUG ("Failed to create pipe: %s", g_strerror (errno));
+          self->priv->pipe_fds[0] = -1;
+          self->priv->pipe_fds[1] = -1;
+          return FALSE;
+        }
 
-      g_output_stream_splice_async (stream, self->priv->in_stream,
-          G_OUTPUT_STREAM_SPLICE_CLOSE_SOURCE |
-          G_OUTPUT_STREAM_SPLICE_CLOSE_TARGET,
-          G_PRIORITY_DEFAULT, self->priv->cancellable,
-          splice_stream_ready_cb, g_object_ref (self));
+#ifdef F_SETPIPE_SZ
+      /* a bigger pipe means fewer round-trips per chunk; if it fails, we
+       * just move less per splice() */
+      fcntl (self->priv->pipe_fds[1], F_SETPIPE_SZ, self->priv->chunk_size);
+#endif
+    }
+
+  self->priv->file_fd = g_file_descriptor_based_get_fd (
+      G_FILE_DESCRIPTOR_BASED (file_stream));
+
+  DEBUG ("Starting zero-copy transfer in chunks of %u bytes",
+      self->priv->chunk_size);
+
+  source = g_socket_create_source (self->priv->client_socket,
+      requested ? G_IO_OUT : G_IO_IN, self->priv->cancellable);
+  g_source_set_callback (source, (GSourceFunc) zero_copy_cb,
+      g_object_ref (self), g_object_unref);
+  g_source_attach (source, g_main_context_get_thread_default ());
+  g_source_unref (source);
+
+  return TRUE;
+}
+#endif /* USE_ZERO_COPY */
+
+static void
+start_copying (TpFileTransferChannel *self)
+{
+  self->priv->transfer_start_time = g_get_monotonic_time ();
+  self->priv->last_progress_notify = self->priv->transfer_start_time;
+
+#ifdef USE_ZERO_COPY
+  if (start_zero_copy (self))
+    return;
+#endif
+
+  start_copying_through_userspace (self);
+}
+
+void
+_tp_file_transfer_channel_set_zero_copy_enabled (TpFileTransferChannel *self,
+    gboolean enabled)
+{
+  g_return_if_fail (TP_IS_FILE_TRANSFER_CHANNEL (self));
+
+#ifdef USE_ZERO_COPY
+  self->priv->zero_copy_disabled = !enabled;
+#endif
+}
+
+#ifdef HAVE_GIO_UNIX
+static void
+send_credentials_cb (GObject *source,
+    GAsyncResult *result,
+    gpointer user_data)
+{
+  TpFileTransferChannel *self = user_data;
+  GError *error = NULL;
+
+  if (!tp_unix_connection_send_credentials_with_byte_finish (
+          (GSocketConnection *) source, result, &error))
+    {
+      DEBUG ("Failed to send credentials: %s", error->message);
+      g_clear_error (&error);
+      g_clear_object (&self->priv->stream);
     }
   else
     {
-      GInputStream *stream;
+      start_copying (self);
+    }
 
-      stream = g_io_stream_get_input_stream (G_IO_STREAM (conn));
+  g_object_unref (self);
+}
+#endif
+
+static void
+client_socket_connected (TpFileTransferChannel *self)
+{
+  GSocketConnection *conn;
 
-      g_output_stream_splice_async (self->priv->out_stream, stream,
-          G_OUTPUT_STREAM_SPLICE_CLOSE_SOURCE |
-          G_OUTPUT_STREAM_SPLICE_CLOSE_TARGET,
-          G_PRIORITY_DEFAULT, self->priv->cancellable,
-          splice_stream_ready_cb, g_object_ref (self));
+  conn = g_socket_connection_factory_create_connection (
+      self->priv->client_socket);
+  if (conn == NULL)
+    {
+      DEBUG ("Failed to create client connection");
+      return;
     }
+
+  DEBUG ("File transfer socket connected");
+
+  self->priv->stream = G_IO_STREAM (conn);
+
+#ifdef HAVE_GIO_UNIX
+  if (self->priv->access_control == TP_SOCKET_ACCESS_CONTROL_CREDENTIALS)
+    {
+      guchar byte;
+
+      byte = g_value_get_uchar (self->priv->access_control_param);
+
+      /* the credentials have to be sent before any of the file */
+      tp_unix_connection_send_credentials_with_byte_async (conn, byte,
+          self->priv->cancellable, send_credentials_cb, g_object_ref (self));
+      return;
+    }
+#endif
+
+  start_copying (self);
 }
 
 static gboolean
@@ -674,6 +1194,38 @@ tp_file_transfer_channel_get_property (GObject *object,
         g_value_set_boxed (value, self->priv->metadata);
         break;
 
+      case PROP_LOCAL_TRANSFERRED_BYTES:
+        g_value_set_uint64 (value, self->priv->local_transferred_bytes);
+        break;
+
+      case PROP_CHUNK_SIZE:
+        g_value_set_uint (value, self->priv->chunk_size);
+        break;
+
+      case PROP_LOCAL_THROUGHPUT:
+        g_value_set_uint64 (value, self->priv->local_throughput);
+        break;
+
+      default:
+        G_OBJECT_WARN_INVALID_PROPERTY_ID (object, property_id, pspec);
+        break;
+    }
+}
+
+static void
+tp_file_transfer_channel_set_property (GObject *object,
+    guint property_id,
+    const GValue *value,
+    GParamSpec *pspec)
+{
+  TpFileTransferChannel *self = (TpFileTransferChannel *) object;
+
+  switch (property_id)
+    {
+      case PROP_CHUNK_SIZE:
+        self->priv->chunk_size = g_value_get_uint (value);
+        break;
+
       default:
         G_OBJECT_WARN_INVALID_PROPERTY_ID (object, property_id, pspec);
         break;
@@ -738,6 +1290,7 @@ tp_file_transfer_channel_dispose (GObject *obj)
 
   tp_clear_pointer (&self->priv->access_control_param, tp_g_value_slice_free);
   tp_clear_object (&self->priv->client_socket);
+  tp_clear_pointer (&self->priv->copy_buffer, g_free);
 
   G_OBJECT_CLASS (tp_file_transfer_channel_parent_class)->dispose (obj);
 }
@@ -751,6 +1304,7 @@ tp_file_transfer_channel_class_init (TpFileTransferChannelClass *klass)
 
   object_class->constructed = tp_file_transfer_channel_constructed;
   object_class->get_property = tp_file_transfer_channel_get_property;
+  object_class->set_property = tp_file_transfer_channel_set_property;
   object_class->dispose = tp_file_transfer_channel_dispose;
 
   proxy_class->list_features = tp_file_transfer_channel_list_features;
@@ -1003,6 +1557,69 @@ tp_file_transfer_channel_class_init (TpFileTransferChannelClass *klass)
   g_object_class_install_property (object_class, PROP_METADATA,
       param_spec);
 
+  /**
+   * TpFileTransferChannel:local-transferred-bytes:
+   *
+   * The number of bytes this process has moved between the local file and
+   * the connection manager so far. Unlike
+   * #TpFileTransferChannel:transferred-bytes, this does not depend on the
+   * connection manager emitting signals, so it can be used for progress
+   * and throughput reporting as soon as the transfer has started.
+   *
+   * On Linux, when both the file and the connection manager's socket
+   * are local, the data is moved without being copied through userspace;
+   * otherwise it is copied in chunks of #TpFileTransferChannel:chunk-size
+   * bytes. Either way, this property is updated after each chunk, but
+   * change notification is only emitted a few times per second, and once
+   * more when the transfer finishes.
+   *
+   * Since: 0.UNRELEASED
+   */
+  param_spec = g_param_spec_uint64 ("local-transferred-bytes",
+      "Local transferred bytes",
+      "Bytes moved between the local file and the connection manager",
+      0, G_MAXUINT64, 0,
+      G_PARAM_READABLE | G_PARAM_STATIC_STRINGS);
+  g_object_class_install_property (object_class, PROP_LOCAL_TRANSFERRED_BYTES,
+      param_spec);
+
+  /**
+   * TpFileTransferChannel:chunk-size:
+   *
+   * The maximum number of bytes to move at once between the file and the
+   * connection manager (see
+   * #TpFileTransferChannel:local-transferred-bytes). Bigger chunks use less
+   * CPU; smaller chunks give finer-grained progress and let the main loop
+   * run more often. Changes take effect from the next chunk.
+   *
+   * Since: 0.UNRELEASED
+   */
+  param_spec = g_param_spec_uint ("chunk-size",
+      "Chunk size",
+      "Maximum number of bytes to transfer at once",
+      MIN_CHUNK_SIZE, G_MAXINT, DEFAULT_CHUNK_SIZE,
+      G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS);
+  g_object_class_install_property (object_class, PROP_CHUNK_SIZE,
+      param_spec);
+
+  /**
+   * TpFileTransferChannel:local-throughput:
+   *
+   * The average number of bytes per second this process has moved between
+   * the local file and the connection manager since the transfer started,
+   * or 0 if it hasn't started yet. It is notified together with
+   * #TpFileTransferChannel:local-transferred-bytes.
+   *
+   * Since: 0.UNRELEASED
+   */
+  param_spec = g_param_spec_uint64 ("local-throughput",
+      "Local throughput",
+      "Average bytes per second moved by this process",
+      0, G_MAXUINT64, 0,
+      G_PARAM_READABLE | G_PARAM_STATIC_STRINGS);
+  g_object_class_install_property (object_class, PROP_LOCAL_THROUGHPUT,
+      param_spec);
+
   g_type_class_add_private (object_class, sizeof
       (TpFileTransferChannelPrivate));
 }
@@ -1012,6 +1629,14 @@ tp_file_transfer_channel_init (TpFileTransferChannel *self)
 {
   self->priv = G_TYPE_INSTANCE_GET_PRIVATE ((self),
       TP_TYPE_FILE_TRANSFER_CHANNEL, TpFileTransferChannelPrivate);
+
+  self->priv->chunk_size = DEFAULT_CHUNK_SIZE;
+
+#ifdef USE_ZERO_COPY
+  self->priv->file_fd = -1;
+  self->priv->pipe_fds[0] = -1;
+  self->priv->pipe_fds[1] = -1;
+#endif
 }
 
 /**
@@ -1646,6 +2271,45 @@ tp_file_transfer_channel_get_transferred_bytes (TpFileTransferChannel *self)
   return self->priv->transferred_bytes;
 }
 
+/**
+ * tp_file_transfer_channel_get_local_transferred_bytes:
+ * @self: a #TpFileTransferChannel
+ *
+ * Return the #TpFileTransferChannel:local-transferred-bytes property
+ *
+ * Returns: the value of the #TpFileTransferChannel:local-transferred-bytes
+ *  property
+ *
+ * Since: 0.UNRELEASED
+ */
+guint64
+tp_file_transfer_channel_get_local_transferred_bytes (
+    TpFileTransferChannel *self)
+{
+  g_return_val_if_fail (TP_IS_FILE_TRANSFER_CHANNEL (self), 0);
+
+  return self->priv->local_transferred_bytes;
+}
+
+/**
+ * tp_file_transfer_channel_get_local_throughput:
+ * @self: a #TpFileTransferChannel
+ *
+ * Return the #TpFileTransferChannel:local-throughput property
+ *
+ * Returns: the value of the #TpFileTransferChannel:local-throughput
+ *  property
+ *
+ * Since: 0.UNRELEASED
+ */
+guint64
+tp_file_transfer_channel_get_local_throughput (TpFileTransferChannel *self)
+{
+  g_return_val_if_fail (TP_IS_FILE_TRANSFER_CHANNEL (self), 0);
+
+  return self->priv->local_throughput;
+}
+
 /**
  * tp_file_transfer_channel_get_service_name:
  * @self: a #TpFileTransferChannel
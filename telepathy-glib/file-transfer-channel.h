@@ -128,6 +128,14 @@ _TP_AVAILABLE_IN_0_16
 guint64 tp_file_transfer_channel_get_transferred_bytes (
     TpFileTransferChannel *self);
 
+_TP_AVAILABLE_IN_UNRELEASED
+guint64 tp_file_transfer_channel_get_local_transferred_bytes (
+    TpFileTransferChannel *self);
+
+_TP_AVAILABLE_IN_UNRELEASED
+guint64 tp_file_transfer_channel_get_local_throughput (
+    TpFileTransferChannel *self);
+
 /* Metadata */
 
 _TP_AVAILABLE_IN_0_18
@@ -60,6 +60,7 @@
 
 #define DEBUG_FLAG TP_DEBUG_CLIENT
 #include "telepathy-glib/debug-internal.h"
+#include "telepathy-glib/proxy-internal.h"
 
 struct _TpHandleChannelsContextClass {
     /*<private>*/
@@ -640,10 +641,10 @@ context_prepare (TpHandleChannelsContext *self,
 
   self->priv->num_pending = 2;
 
-  tp_proxy_prepare_async (self->account, account_features,
+  _tp_proxy_prepare_shared_async (self->account, account_features,
       account_prepare_cb, g_object_ref (self));
 
-  tp_proxy_prepare_async (self->connection, connection_features,
+  _tp_proxy_prepare_shared_async (self->connection, connection_features,
       conn_prepare_cb, g_object_ref (self));
 
   for (i = 0; i < self->channels->len; i++)
@@ -652,7 +653,7 @@ context_prepare (TpHandleChannelsContext *self,
 
       self->priv->num_pending++;
 
-      tp_proxy_prepare_async (channel, channel_features,
+      _tp_proxy_prepare_shared_async (channel, channel_features,
           hcc_channel_prepare_cb, g_object_ref (self));
     }
 }
@@ -25,6 +25,16 @@
  * @short_description: a heap queue of pointers
  *
  * A heap queue of pointers.
+ *
+ * Elements are ordered either by a #GCompareFunc, for heaps created with
+ * tp_heap_new() or tp_heap_new_from_array(), or by a #gint64 key stored
+ * alongside each element, for heaps created with tp_heap_new_with_keys().
+ * Keyed heaps never call back into user code to compare elements, which
+ * makes them a good fit for large timer and priority queues.
+ *
+ * Elements added with tp_heap_add_with_handle() or tp_heap_add_with_key()
+ * get a #TpHeapHandle, which can be used to remove the element or to change
+ * its priority in O(log n) time.
  */
 
 #include "config.h"
@@ -35,6 +45,36 @@
 
 #define DEFAULT_SIZE 64
 
+/* Number of children per node. A 4-ary heap is shallower than a binary
+ * heap, and a node's children share a cache line. */
+#define ARITY 4
+
+#define PARENT(i) (((i) - 1) / ARITY)
+#define FIRST_CHILD(i) ((i) * ARITY + 1)
+
+typedef struct {
+    /* only meaningful in heaps created with tp_heap_new_with_keys() */
+    gint64 key;
+    gpointer element;
+    /* NULL if the element was added without a handle */
+    TpHeapHandle *handle;
+} Entry;
+
+/**
+ * TpHeapHandle:
+ *
+ * An opaque reference to an element in a #TpHeap, returned by
+ * tp_heap_add_with_handle() and tp_heap_add_with_key(). It remains valid
+ * until the element is removed from the heap, by whatever means.
+ *
+ * Since: 0.UNRELEASED
+ */
+struct _TpHeapHandle
+{
+  /* 0-based position of the element in TpHeap.entries */
+  guint index;
+};
+
 /**
  * TpHeap:
  *
@@ -42,11 +82,116 @@
  */
 struct _TpHeap
 {
-  GPtrArray *data;
+  /* array of Entry, in heap order */
+  GArray *entries;
+  /* NULL if ordered by key */
   GCompareFunc comparator;
   GDestroyNotify destructor;
 };
 
+#define ENTRY(heap, i) (&g_array_index ((heap)->entries, Entry, (i)))
+
+static inline gboolean
+entry_less (TpHeap *heap,
+    const Entry *a,
+    const Entry *b)
+{
+  if (heap->comparator == NULL)
+    return a->key < b->key;
+
+  return heap->comparator (a->element, b->element) < 0;
+}
+
+/* Copy @entry into position @i, keeping its handle up to date */
+static inline void
+place_entry (TpHeap *heap,
+    guint i,
+    const Entry *entry)
+{
+  *ENTRY (heap, i) = *entry;
+
+  if (entry->handle != NULL)
+    entry->handle->index = i;
+}
+
+/* The entry at @i may be ordered before its parent: move it up */
+static void
+sift_up (TpHeap *heap,
+    guint i)
+{
+  Entry tmp = *ENTRY (heap, i);
+
+  while (i > 0)
+    {
+      guint parent = PARENT (i);
+
+      if (!entry_less (heap, &tmp, ENTRY (heap, parent)))
+        break;
+
+      place_entry (heap, i, ENTRY (heap, parent));
+      i = parent;
+    }
+
+  place_entry (heap, i, &tmp);
+}
+
+/* The entry at @i may be ordered after one of its children: move it down */
+static void
+sift_down (TpHeap *heap,
+    guint i)
+{
+  guint len = heap->entries->len;
+  Entry tmp = *ENTRY (heap, i);
+
+  while (FIRST_CHILD (i) < len)
+    {
+      guint child = FIRST_CHILD (i);
+      guint last = MIN (child + ARITY, len);
+      guint best = child;
+
+      /* select the child which is supposed to come FIRST */
+      for (child++; child < last; child++)
+        {
+          if (entry_less (heap, ENTRY (heap, child), ENTRY (heap, best)))
+            best = child;
+        }
+
+      if (!entry_less (heap, ENTRY (heap, best), &tmp))
+        break;
+
+      place_entry (heap, i, ENTRY (heap, best));
+      i = best;
+    }
+
+  place_entry (heap, i, &tmp);
+}
+
+/* The priority of the entry at @i changed: restore the heap property */
+static void
+reposition (TpHeap *heap,
+    guint i)
+{
+  if (i > 0 && entry_less (heap, ENTRY (heap, i), ENTRY (heap, PARENT (i))))
+    sift_up (heap, i);
+  else
+    sift_down (heap, i);
+}
+
+static TpHeap *
+heap_new (GCompareFunc comparator,
+    GDestroyNotify destructor,
+    guint reserved)
+{
+  TpHeap *ret = g_slice_new (TpHeap);
+
+  ret->entries = g_array_sized_new (FALSE, FALSE, sizeof (Entry),
+      MAX (reserved, DEFAULT_SIZE));
+  ret->comparator = comparator;
+  ret->destructor = destructor;
+
+  return ret;
+}
+
 /**
  * tp_heap_new:
  * @comparator: Comparator by which to order the pointers in the heap
@@ -60,16 +205,96 @@ struct _TpHeap
 TpHeap *
 tp_heap_new (GCompareFunc comparator, GDestroyNotify destructor)
 {
-  TpHeap *ret = g_slice_new (TpHeap);
   g_assert (comparator != NULL);
 
-  ret->data = g_ptr_array_sized_new (DEFAULT_SIZE);
-  ret->comparator = comparator;
-  ret->destructor = destructor;
+  return heap_new (comparator, destructor, 0);
+}
+
+/**
+ * tp_heap_new_from_array:
+ * @comparator: Comparator by which to order the pointers in the heap
+ * @destructor: Function to call on the pointers when the heap is destroyed
+ *  or cleared, or %NULL if this is not needed
+ * @elements: (array length=n_elements): the initial elements of the heap
+ * @n_elements: the number of elements in @elements
+ *
+ * Create a heap queue containing @elements. This takes O(n) time, which is
+ * cheaper than adding the elements one by one.
+ *
+ * Returns: A new heap queue.
+ *
+ * Since: 0.UNRELEASED
+ */
+TpHeap *
+tp_heap_new_from_array (GCompareFunc comparator,
+    GDestroyNotify destructor,
+    gpointer *elements,
+    guint n_elements)
+{
+  TpHeap *ret;
+  guint i;
+
+  g_assert (comparator != NULL);
+  g_return_val_if_fail (elements != NULL || n_elements == 0, NULL);
+
+  ret = heap_new (comparator, destructor, n_elements);
+  g_array_set_size (ret->entries, n_elements);
+
+  for (i = 0; i < n_elements; i++)
+    {
+      Entry *entry = ENTRY (ret, i);
+
+      entry->key = 0;
+      entry->element = elements[i];
+      entry->handle = NULL;
+    }
+
+  /* leaves have no children, so start from the last parent */
+  for (i = n_elements / ARITY + 1; i-- > 0;)
+    {
+      if (FIRST_CHILD (i) < n_elements)
+        sift_down (ret, i);
+    }
 
   return ret;
 }
 
+/**
+ * tp_heap_new_with_keys:
+ * @destructor: Function to call on the pointers when the heap is destroyed
+ *  or cleared, or %NULL if this is not needed
+ *
+ * Create a heap queue whose elements are ordered by a key given when they
+ * are added, smallest first. Elements must be added with
+ * tp_heap_add_with_key().
+ *
+ * Returns: A new, empty heap queue.
+ *
+ * Since: 0.UNRELEASED
+ */
+TpHeap *
+tp_heap_new_with_keys (GDestroyNotify destructor)
+{
+  return heap_new (NULL, destructor, 0);
+}
+
+static void
+free_entries (TpHeap *heap)
+{
+  guint i;
+
+  for (i = 0; i < heap->entries->len; i++)
+    {
+      Entry *entry = ENTRY (heap, i);
+
+      if (entry->handle != NULL)
+        g_slice_free (TpHeapHandle, entry->handle);
+
+      if (heap->destructor)
+        (heap->destructor) (entry->element);
+    }
+}
+
 /**
  * tp_heap_destroy:
  * @heap: The heap queue
@@ -81,17 +306,8 @@ tp_heap_destroy (TpHeap * heap)
 {
   g_return_if_fail (heap != NULL);
 
-  if (heap->destructor)
-    {
-      guint i;
-
-      for (i = 0; i < heap->data->len; i++)
-        {
-          (heap->destructor) (g_ptr_array_index (heap->data, i));
-        }
-    }
-
-  g_ptr_array_unref (heap->data);
+  free_entries (heap);
+  g_array_unref (heap->entries);
   g_slice_free (TpHeap, heap);
 }
 
@@ -107,21 +323,30 @@ tp_heap_clear (TpHeap *heap)
 {
   g_return_if_fail (heap != NULL);
 
-  if (heap->destructor)
-    {
-      guint i;
+  free_entries (heap);
+  g_array_set_size (heap->entries, 0);
+}
 
-      for (i = 0; i < heap->data->len; i++)
-        {
-          (heap->destructor) (g_ptr_array_index (heap->data, i));
-        }
-    }
+static TpHeapHandle *
+add_entry (TpHeap *heap,
+    gpointer element,
+    gint64 key,
+    gboolean want_handle)
+{
+  Entry entry = { key, element, NULL };
 
-  g_ptr_array_unref (heap->data);
-  heap->data = g_ptr_array_sized_new (DEFAULT_SIZE);
-}
+  if (want_handle)
+    entry.handle = g_slice_new (TpHeapHandle);
 
-#define HEAP_INDEX(heap, index) (g_ptr_array_index ((heap)->data, (index)-1))
+  g_array_append_val (heap->entries, entry);
+
+  if (entry.handle != NULL)
+    entry.handle->index = heap->entries->len - 1;
+
+  sift_up (heap, heap->entries->len - 1);
+
+  return entry.handle;
+}
 
 /**
  * tp_heap_add:
@@ -133,25 +358,58 @@ tp_heap_clear (TpHeap *heap)
 void
 tp_heap_add (TpHeap *heap, gpointer element)
 {
-  guint m;
-
   g_return_if_fail (heap != NULL);
+  g_return_if_fail (heap->comparator != NULL);
 
-  g_ptr_array_add (heap->data, element);
-  m = heap->data->len;
-  while (m != 1)
-    {
-      gpointer parent = HEAP_INDEX (heap, m / 2);
+  add_entry (heap, element, 0, FALSE);
+}
 
-      if (heap->comparator (element, parent) < 0)
-        {
-          HEAP_INDEX (heap, m / 2) = element;
-          HEAP_INDEX (heap, m) = parent;
-          m /= 2;
-        }
-      else
-        break;
-    }
+/**
+ * tp_heap_add_with_handle:
+ * @heap: The heap queue
+ * @element: An element
+ *
+ * Add element to the heap queue, maintaining correct order, and return
+ * a handle which can be passed to tp_heap_remove_handle() and
+ * tp_heap_update_handle().
+ *
+ * Returns: (transfer none): a handle for @element, valid until @element
+ *  is removed from @heap
+ *
+ * Since: 0.UNRELEASED
+ */
+TpHeapHandle *
+tp_heap_add_with_handle (TpHeap *heap,
+    gpointer element)
+{
+  g_return_val_if_fail (heap != NULL, NULL);
+  g_return_val_if_fail (heap->comparator != NULL, NULL);
+
+  return add_entry (heap, element, 0, TRUE);
+}
+
+/**
+ * tp_heap_add_with_key:
+ * @heap: A heap queue created with tp_heap_new_with_keys()
+ * @element: An element
+ * @key: The priority of @element; smaller keys come first
+ *
+ * Add element to the heap queue, maintaining correct order.
+ *
+ * Returns: (transfer none): a handle for @element, valid until @element
+ *  is removed from @heap
+ *
+ * Since: 0.UNRELEASED
+ */
+TpHeapHandle *
+tp_heap_add_with_key (TpHeap *heap,
+    gpointer element,
+    gint64 key)
+{
+  g_return_val_if_fail (heap != NULL, NULL);
+  g_return_val_if_fail (heap->comparator == NULL, NULL);
+
+  return add_entry (heap, element, key, TRUE);
 }
 
 /**
@@ -167,64 +425,67 @@ tp_heap_peek_first (TpHeap *heap)
 {
   g_return_val_if_fail (heap != NULL, NULL);
 
-  if (heap->data->len > 0)
-    return HEAP_INDEX (heap, 1);
+  if (heap->entries->len > 0)
+    return ENTRY (heap, 0)->element;
   else
     return NULL;
 }
 
+/**
+ * tp_heap_peek_first_key:
+ * @heap: A heap queue created with tp_heap_new_with_keys()
+ *
+ * <!--Returns: says it all-->
+ *
+ * Returns: The key of the first item in the queue, or %G_MAXINT64 if the
+ *  queue is empty
+ *
+ * Since: 0.UNRELEASED
+ */
+gint64
+tp_heap_peek_first_key (TpHeap *heap)
+{
+  g_return_val_if_fail (heap != NULL, G_MAXINT64);
+  g_return_val_if_fail (heap->comparator == NULL, G_MAXINT64);
+
+  if (heap->entries->len > 0)
+    return ENTRY (heap, 0)->key;
+  else
+    return G_MAXINT64;
+}
+
 /*
  * extract_element:
  * @heap: The heap queue
- * @index: The index into the queue
+ * @index: The 0-based index into the queue
  *
- * Remove the element at 1-based index @index from the queue and return it.
- * The destructor, if any, is not called.
+ * Remove the element at @index from the queue and return it.
+ * The destructor, if any, is not called, but the element's handle is freed.
  *
- * Returns: The element with 1-based index @index
+ * Returns: The element with index @index
  */
 static gpointer
-extract_element (TpHeap * heap, int index)
+extract_element (TpHeap *heap,
+    guint index)
 {
-  gpointer ret;
+  Entry *entry = ENTRY (heap, index);
+  guint last = heap->entries->len - 1;
+  gpointer ret = entry->element;
 
-  g_return_val_if_fail (heap != NULL, NULL);
+  if (entry->handle != NULL)
+    g_slice_free (TpHeapHandle, entry->handle);
 
-  if (heap->data->len > 0)
+  if (index != last)
     {
-      guint m = heap->data->len;
-      guint i = 1, j;
-      ret = HEAP_INDEX (heap, index);
-
-      HEAP_INDEX (heap, index) = HEAP_INDEX (heap, m);
-
-      while (i * 2 <= m)
-        {
-          /* select the child which is supposed to come FIRST */
-          if ((i * 2 + 1 <= m)
-              && (heap->
-                  comparator (HEAP_INDEX (heap, i * 2),
-                              HEAP_INDEX (heap, i * 2 + 1)) > 0))
-            j = i * 2 + 1;
-          else
-            j = i * 2;
-
-          if (heap->comparator (HEAP_INDEX (heap, i), HEAP_INDEX (heap, j)) >
-              0)
-            {
-              gpointer tmp = HEAP_INDEX (heap, i);
-              HEAP_INDEX (heap, i) = HEAP_INDEX (heap, j);
-              HEAP_INDEX (heap, j) = tmp;
-              i = j;
-            }
-          else
-            break;
-        }
-
-      g_ptr_array_remove_index (heap->data, m - 1);
+      /* fill the hole with the last element, then move that into place */
+      place_entry (heap, index, ENTRY (heap, last));
+      g_array_set_size (heap->entries, last);
+      reposition (heap, index);
     }
   else
-    ret = NULL;
+    {
+      g_array_set_size (heap->entries, last);
+    }
 
   return ret;
 }
@@ -236,6 +497,9 @@ extract_element (TpHeap * heap, int index)
  *
  * Remove @element from @heap, if it's present. The destructor, if any,
  * is not called.
+ *
+ * This has to search the heap for @element; if you kept the #TpHeapHandle
+ * for @element, tp_heap_remove_handle() is faster.
  */
 void
 tp_heap_remove (TpHeap *heap, gpointer element)
@@ -244,9 +508,9 @@ tp_heap_remove (TpHeap *heap, gpointer element)
 
     g_return_if_fail (heap != NULL);
 
-    for (i = 1; i <= heap->data->len; i++)
+    for (i = 0; i < heap->entries->len; i++)
       {
-          if (element == HEAP_INDEX (heap, i))
+          if (element == ENTRY (heap, i)->element)
             {
               extract_element (heap, i);
               break;
@@ -254,6 +518,81 @@ tp_heap_remove (TpHeap *heap, gpointer element)
       }
 }
 
+/**
+ * tp_heap_remove_handle:
+ * @heap: The heap queue
+ * @handle: A handle for an element in @heap
+ *
+ * Remove the element referred to by @handle from @heap, in O(log n) time.
+ * The destructor, if any, is not called. @handle is no longer valid
+ * afterwards.
+ *
+ * Returns: the removed element
+ *
+ * Since: 0.UNRELEASED
+ */
+gpointer
+tp_heap_remove_handle (TpHeap *heap,
+    TpHeapHandle *handle)
+{
+  g_return_val_if_fail (heap != NULL, NULL);
+  g_return_val_if_fail (handle != NULL, NULL);
+  g_return_val_if_fail (handle->index < heap->entries->len, NULL);
+  g_return_val_if_fail (ENTRY (heap, handle->index)->handle == handle, NULL);
+
+  return extract_element (heap, handle->index);
+}
+
+/**
+ * tp_heap_update_handle:
+ * @heap: A heap queue created with tp_heap_new() or tp_heap_new_from_array()
+ * @handle: A handle for an element in @heap
+ *
+ * Restore the order of @heap after the element referred to by @handle
+ * changed in a way that affects the heap's comparator, in O(log n) time.
+ * The order of the heap is undefined between changing the element and
+ * calling this function.
+ *
+ * Since: 0.UNRELEASED
+ */
+void
+tp_heap_update_handle (TpHeap *heap,
+    TpHeapHandle *handle)
+{
+  g_return_if_fail (heap != NULL);
+  g_return_if_fail (handle != NULL);
+  g_return_if_fail (handle->index < heap->entries->len);
+  g_return_if_fail (ENTRY (heap, handle->index)->handle == handle);
+
+  reposition (heap, handle->index);
+}
+
+/**
+ * tp_heap_set_key:
+ * @heap: A heap queue created with tp_heap_new_with_keys()
+ * @handle: A handle for an element in @heap
+ * @key: The new priority of the element
+ *
+ * Change the key of the element referred to by @handle, moving it to its
+ * new position in O(log n) time.
+ *
+ * Since: 0.UNRELEASED
+ */
+void
+tp_heap_set_key (TpHeap *heap,
+    TpHeapHandle *handle,
+    gint64 key)
+{
+  g_return_if_fail (heap != NULL);
+  g_return_if_fail (heap->comparator == NULL);
+  g_return_if_fail (handle != NULL);
+  g_return_if_fail (handle->index < heap->entries->len);
+  g_return_if_fail (ENTRY (heap, handle->index)->handle == handle);
+
+  ENTRY (heap, handle->index)->key = key;
+  reposition (heap, handle->index);
+}
+
 /**
  * tp_heap_extract_first:
  * @heap: The heap queue
@@ -268,10 +607,10 @@ tp_heap_extract_first (TpHeap * heap)
 {
   g_return_val_if_fail (heap != NULL, NULL);
 
-  if (heap->data->len == 0)
+  if (heap->entries->len == 0)
       return NULL;
 
-  return extract_element (heap, 1);
+  return extract_element (heap, 0);
 }
 
 /**
@@ -287,5 +626,5 @@ tp_heap_size (TpHeap *heap)
 {
   g_return_val_if_fail (heap != NULL, 0);
 
-  return heap->data->len;
+  return heap->entries->len;
 }
@@ -29,12 +29,22 @@
 
 #include <glib.h>
 
+#include <telepathy-glib/defs.h>
+
 G_BEGIN_DECLS
 
 typedef struct _TpHeap TpHeap;
+typedef struct _TpHeapHandle TpHeapHandle;
 
 TpHeap *tp_heap_new (GCompareFunc comparator, GDestroyNotify destructor)
   G_GNUC_WARN_UNUSED_RESULT;
+_TP_AVAILABLE_IN_UNRELEASED
+TpHeap *tp_heap_new_from_array (GCompareFunc comparator,
+    GDestroyNotify destructor, gpointer *elements, guint n_elements)
+  G_GNUC_WARN_UNUSED_RESULT;
+_TP_AVAILABLE_IN_UNRELEASED
+TpHeap *tp_heap_new_with_keys (GDestroyNotify destructor)
+  G_GNUC_WARN_UNUSED_RESULT;
 void tp_heap_destroy (TpHeap *heap);
 void tp_heap_clear (TpHeap *heap);
 
@@ -43,6 +53,20 @@ void tp_heap_remove (TpHeap *heap, gpointer element);
 gpointer tp_heap_peek_first (TpHeap *heap);
 gpointer tp_heap_extract_first (TpHeap *heap);
 
+_TP_AVAILABLE_IN_UNRELEASED
+TpHeapHandle *tp_heap_add_with_handle (TpHeap *heap, gpointer element);
+_TP_AVAILABLE_IN_UNRELEASED
+TpHeapHandle *tp_heap_add_with_key (TpHeap *heap, gpointer element,
+    gint64 key);
+_TP_AVAILABLE_IN_UNRELEASED
+gpointer tp_heap_remove_handle (TpHeap *heap, TpHeapHandle *handle);
+_TP_AVAILABLE_IN_UNRELEASED
+void tp_heap_update_handle (TpHeap *heap, TpHeapHandle *handle);
+_TP_AVAILABLE_IN_UNRELEASED
+void tp_heap_set_key (TpHeap *heap, TpHeapHandle *handle, gint64 key);
+_TP_AVAILABLE_IN_UNRELEASED
+gint64 tp_heap_peek_first_key (TpHeap *heap);
+
 guint tp_heap_size (TpHeap *heap);
 
 G_END_DECLS
@@ -50,6 +50,11 @@ struct _TpMessage {
 };
 
 void _tp_message_set_immutable (TpMessage *self);
+void _tp_message_part_changed (TpMessage *self,
+    guint part);
+TpHandle _tp_message_get_sender_handle (TpMessage *self);
+const gchar *_tp_message_peek_text (TpMessage *self,
+    TpChannelTextMessageFlags *out_flags);
 
 G_END_DECLS
 
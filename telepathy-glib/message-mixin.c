@@ -78,6 +78,7 @@
 #include <telepathy-glib/gtypes.h>
 #include <telepathy-glib/interfaces.h>
 #include <telepathy-glib/message-internal.h>
+#include <telepathy-glib/timer-internal.h>
 
 #define DEBUG_FLAG TP_DEBUG_IM
 
@@ -114,6 +115,23 @@ struct _TpMessageMixinPrivate
   /* TpHandle -> TpChannelChatState */
   GHashTable *chat_states;
   TpMessageMixinSendChatStateImpl send_chat_state;
+
+  /* See tp_message_mixin_set_chat_state_coalescing(). 0 if disabled. */
+  guint chat_state_interval_ms;
+  guint chat_state_expiry_ms;
+  /* TpHandle -> TpChannelChatState, changes not yet in chat_states */
+  GHashTable *pending_chat_states;
+  /* running while changes are pending, and for chat_state_interval_ms after
+   * our own chat state was sent */
+  TpTimer *chat_state_flush_timer;
+  /* TpHandle -> owned gint64, monotonic time at which a member's Composing
+   * or Paused state expires */
+  GHashTable *chat_state_deadlines;
+  TpTimer *chat_state_expiry_timer;
+  /* the last chat state passed to send_chat_state, and one to send when
+   * chat_state_flush_timer fires; NO_CHAT_STATE if none */
+  TpChannelChatState sent_chat_state;
+  TpChannelChatState queued_chat_state;
   /* FALSE unless at least one chat state notification has been sent; <gone/>
    * will only be sent when the channel closes if this is TRUE. This prevents
    * opening a channel and closing it immediately sending a spurious <gone/> to
@@ -212,43 +230,44 @@ pending_item_id_equals_data (gconstpointer item,
   return (self->incoming_id != id);
 }
 
-static gchar *
+/* The returned string is borrowed from @msg, and is valid until @msg is
+ * modified or destroyed */
+static const gchar *
 parts_to_text (TpMessage *msg,
                TpChannelTextMessageFlags *out_flags,
                TpChannelTextMessageType *out_type,
                TpHandle *out_sender,
                guint *out_timestamp)
 {
-  GHashTable *header = g_ptr_array_index (msg->parts, 0);
-
   if (out_type != NULL)
     {
-      /* The fallback behaviour of tp_asv_get_uint32 is OK here, because
-       * message type NORMAL is zero */
-      *out_type = tp_asv_get_uint32 (header, "message-type", NULL);
+      /* if message-type is absent or invalid this is 0, which is
+       * NORMAL */
+      *out_type = tp_message_get_message_type (msg);
     }
 
   if (out_sender != NULL)
     {
-      /* The fallback behaviour of tp_asv_get_uint32 is OK here - if there's
-       * no good sender, then 0 is the least bad */
-      *out_sender = tp_asv_get_uint32 (header, "message-sender", NULL);
+      /* if there's no good sender, then 0 is the least bad */
+      *out_sender = _tp_message_get_sender_handle (msg);
     }
 
   if (out_timestamp != NULL)
     {
-      /* The fallback behaviour of tp_asv_get_uint32 is OK here - we assume
-       * that we won't legitimately receive messages from 1970-01-01 :-) */
-      *out_timestamp = tp_asv_get_uint32 (header, "message-sent", NULL);
+      /* We assume that we won't legitimately receive messages from
+       * 1970-01-01 :-) */
+      gint64 ts = tp_message_get_sent_timestamp (msg);
+
+      if (ts <= 0 || ts > G_MAXUINT32)
+        ts = tp_message_get_received_timestamp (msg);
 
-      if (*out_timestamp == 0)
-        *out_timestamp = tp_asv_get_uint32 (header, "message-received", NULL);
+      if (ts <= 0 || ts > G_MAXUINT32)
+        ts = time (NULL);
 
-      if (*out_timestamp == 0)
-        *out_timestamp = time (NULL);
+      *out_timestamp = ts;
     }
 
-  return tp_message_to_text (msg, out_flags);
+  return _tp_message_peek_text (msg, out_flags);
 }
 
 
@@ -315,8 +334,30 @@ tp_message_mixin_implement_sending (GObject *object,
       (gchar **) supported_content_types);
 }
 
+#define NO_CHAT_STATE TP_NUM_CHANNEL_CHAT_STATES
+
+/* FIXME: Use tp_base_channel_get_self_handle() when TpMessageMixin requires
+ * TpBaseChannel. See bug #49366 */
+static TpHandle
+get_self_handle (GObject *object)
+{
+  TpMessageMixin *mixin = TP_MESSAGE_MIXIN (object);
+
+  if (TP_HAS_GROUP_MIXIN (object))
+    {
+      guint ret = 0;
+
+      tp_group_mixin_get_self_handle (object, &ret, NULL);
+      if (ret != 0)
+        return ret;
+    }
+
+  return tp_base_connection_get_self_handle (mixin->priv->connection);
+}
+
+/* The chat state that has been signalled for @member */
 static TpChannelChatState
-lookup_current_chat_state (TpMessageMixin *mixin,
+lookup_signalled_chat_state (TpMessageMixin *mixin,
     TpHandle member)
 {
   gpointer tmp;
@@ -330,6 +371,196 @@ lookup_current_chat_state (TpMessageMixin *mixin,
   return TP_CHANNEL_CHAT_STATE_INACTIVE;
 }
 
+/* The chat state of @member, including changes not signalled yet */
+static TpChannelChatState
+lookup_current_chat_state (TpMessageMixin *mixin,
+    TpHandle member)
+{
+  gpointer tmp;
+
+  if (g_hash_table_lookup_extended (mixin->priv->pending_chat_states,
+          GUINT_TO_POINTER (member), NULL, &tmp))
+    {
+      return GPOINTER_TO_UINT (tmp);
+    }
+
+  return lookup_signalled_chat_state (mixin, member);
+}
+
+static void
+commit_chat_state (GObject *object,
+    TpHandle member,
+    TpChannelChatState state)
+{
+  TpMessageMixin *mixin = TP_MESSAGE_MIXIN (object);
+
+  /* a coalesced burst can end where it started */
+  if (state == lookup_signalled_chat_state (mixin, member))
+    return;
+
+  if (state == TP_CHANNEL_CHAT_STATE_INACTIVE ||
+      state == TP_CHANNEL_CHAT_STATE_GONE)
+    {
+      g_hash_table_remove (mixin->priv->chat_states,
+          GUINT_TO_POINTER (member));
+    }
+  else
+    {
+      g_hash_table_insert (mixin->priv->chat_states,
+          GUINT_TO_POINTER (member),
+          GUINT_TO_POINTER (state));
+    }
+
+  tp_svc_channel_interface_chat_state_emit_chat_state_changed (object,
+      member, state);
+}
+
+static void chat_state_flush_timer_cb (gpointer user_data);
+
+static void
+chat_state_ensure_flush (GObject *object)
+{
+  TpMessageMixin *mixin = TP_MESSAGE_MIXIN (object);
+
+  g_assert (mixin->priv->chat_state_interval_ms > 0);
+
+  /* using the interval as the slack too means that all channels with the
+   * same interval flush together */
+  if (mixin->priv->chat_state_flush_timer == NULL)
+    mixin->priv->chat_state_flush_timer = _tp_timer_add (
+        mixin->priv->chat_state_interval_ms,
+        mixin->priv->chat_state_interval_ms,
+        chat_state_flush_timer_cb, object);
+}
+
+static void
+chat_state_flush (GObject *object)
+{
+  TpMessageMixin *mixin = TP_MESSAGE_MIXIN (object);
+  GHashTable *pending = mixin->priv->pending_chat_states;
+  TpChannelChatState queued = mixin->priv->queued_chat_state;
+  GHashTableIter iter;
+  gpointer k, v;
+
+  /* in case a ChatStateChanged handler changes a chat state */
+  mixin->priv->pending_chat_states = g_hash_table_new (NULL, NULL);
+
+  g_hash_table_iter_init (&iter, pending);
+
+  while (g_hash_table_iter_next (&iter, &k, &v))
+    commit_chat_state (object, GPOINTER_TO_UINT (k), GPOINTER_TO_UINT (v));
+
+  g_hash_table_unref (pending);
+
+  mixin->priv->queued_chat_state = NO_CHAT_STATE;
+
+  if (queued != NO_CHAT_STATE && queued != mixin->priv->sent_chat_state)
+    {
+      GError *error = NULL;
+
+      if (mixin->priv->send_chat_state (object, queued, &error))
+        {
+          mixin->priv->sent_chat_state = queued;
+
+          if (mixin->priv->chat_state_interval_ms > 0)
+            chat_state_ensure_flush (object);
+        }
+      else
+        {
+          /* SetChatState has already returned, so there's nobody to tell */
+          DEBUG ("failed to send chat state %u: %s", queued, error->message);
+          g_clear_error (&error);
+        }
+    }
+}
+
+static void
+chat_state_flush_timer_cb (gpointer user_data)
+{
+  GObject *object = user_data;
+  TpMessageMixin *mixin = TP_MESSAGE_MIXIN (object);
+
+  mixin->priv->chat_state_flush_timer = NULL;
+  chat_state_flush (object);
+}
+
+static void
+chat_state_expiry_timer_cb (gpointer user_data)
+{
+  GObject *object = user_data;
+  TpMessageMixin *mixin = TP_MESSAGE_MIXIN (object);
+  gint64 now = g_get_monotonic_time ();
+  gint64 next = G_MAXINT64;
+  GArray *expired = g_array_new (FALSE, FALSE, sizeof (TpHandle));
+  GHashTableIter iter;
+  gpointer k, v;
+  guint i;
+
+  mixin->priv->chat_state_expiry_timer = NULL;
+
+  g_hash_table_iter_init (&iter, mixin->priv->chat_state_deadlines);
+
+  while (g_hash_table_iter_next (&iter, &k, &v))
+    {
+      gint64 deadline = *(gint64 *) v;
+      TpHandle member = GPOINTER_TO_UINT (k);
+
+      if (deadline <= now)
+        g_array_append_val (expired, member);
+      else
+        next = MIN (next, deadline);
+    }
+
+  /* this removes them from chat_state_deadlines */
+  for (i = 0; i < expired->len; i++)
+    {
+      TpHandle member = g_array_index (expired, TpHandle, i);
+
+      DEBUG ("chat state of handle %u has expired", member);
+      tp_message_mixin_change_chat_state (object, member,
+          TP_CHANNEL_CHAT_STATE_ACTIVE);
+    }
+
+  g_array_unref (expired);
+
+  if (next != G_MAXINT64)
+    mixin->priv->chat_state_expiry_timer = _tp_timer_add (
+        (guint) ((next - now) / 1000 + 1),
+        MIN (mixin->priv->chat_state_expiry_ms, 1000),
+        chat_state_expiry_timer_cb, object);
+}
+
+static void
+chat_state_update_deadline (GObject *object,
+    TpHandle member,
+    TpChannelChatState state)
+{
+  TpMessageMixin *mixin = TP_MESSAGE_MIXIN (object);
+  guint expiry_ms = mixin->priv->chat_state_expiry_ms;
+  gint64 *deadline;
+
+  /* our own chat state is up to the client to change */
+  if ((state != TP_CHANNEL_CHAT_STATE_COMPOSING &&
+        state != TP_CHANNEL_CHAT_STATE_PAUSED) ||
+      member == get_self_handle (object))
+    {
+      g_hash_table_remove (mixin->priv->chat_state_deadlines,
+          GUINT_TO_POINTER (member));
+      return;
+    }
+
+  deadline = g_new (gint64, 1);
+  *deadline = g_get_monotonic_time () + expiry_ms * G_GINT64_CONSTANT (1000);
+  g_hash_table_insert (mixin->priv->chat_state_deadlines,
+      GUINT_TO_POINTER (member), deadline);
+
+  /* every deadline is later than the ones already set, so a running timer
+   * fires early enough */
+  if (mixin->priv->chat_state_expiry_timer == NULL)
+    mixin->priv->chat_state_expiry_timer = _tp_timer_add (expiry_ms,
+        MIN (expiry_ms, 1000), chat_state_expiry_timer_cb, object);
+}
+
 /**
  * tp_message_mixin_change_chat_state:
  * @object: an instance of the implementation that uses this mixin
@@ -339,6 +570,10 @@ lookup_current_chat_state (TpMessageMixin *mixin,
  * Change the current chat state of @member to be @state. This emits
  * ChatStateChanged signal and update ChatStates property.
  *
+ * If tp_message_mixin_set_chat_state_coalescing() has been called, the
+ * signal and property change may be delayed, and might not happen at all if
+ * @member's chat state changes back before then.
+ *
  * Since: 0.19.0
  */
 void
@@ -353,21 +588,76 @@ tp_message_mixin_change_chat_state (GObject *object,
   if (state == lookup_current_chat_state (mixin, member))
     return;
 
-  if (state == TP_CHANNEL_CHAT_STATE_INACTIVE ||
-      state == TP_CHANNEL_CHAT_STATE_GONE)
+  if (mixin->priv->chat_state_expiry_ms > 0)
+    chat_state_update_deadline (object, member, state);
+
+  if (mixin->priv->chat_state_interval_ms == 0)
     {
-      g_hash_table_remove (mixin->priv->chat_states,
-          GUINT_TO_POINTER (member));
+      commit_chat_state (object, member, state);
+      return;
     }
-  else
+
+  g_hash_table_insert (mixin->priv->pending_chat_states,
+      GUINT_TO_POINTER (member), GUINT_TO_POINTER (state));
+  chat_state_ensure_flush (object);
+}
+
+/**
+ * tp_message_mixin_set_chat_state_coalescing:
+ * @object: an instance of the implementation that uses this mixin
+ * @interval_ms: how long to coalesce chat state changes for, in
+ *  milliseconds, or 0 to signal and send each change as it happens
+ * @expiry_ms: how long a member may stay in the Composing or Paused state
+ *  without an update before being considered Active again, in milliseconds,
+ *  or 0 to keep those states until they are changed
+ *
+ * Reduce the rate of chat state changes on this channel. This is intended
+ * for chatrooms with many members, whose typing notifications would
+ * otherwise result in a D-Bus signal for every change.
+ *
+ * If @interval_ms is non-zero, changes made with
+ * tp_message_mixin_change_chat_state() are signalled and applied to the
+ * ChatStates property between @interval_ms and twice that time after the
+ * first change, together with any others made in the meantime; changes
+ * for several channels with the same @interval_ms are signalled together.
+ * A member whose chat state changes back to its previous value in that
+ * time is not signalled at all.
+ *
+ * Similarly, a SetChatState call that would not change our own chat state
+ * does not call the #TpMessageMixinSendChatStateImpl, and once it has
+ * been called, further changes are only sent when @interval_ms has passed,
+ * in which case errors from the #TpMessageMixinSendChatStateImpl are
+ * ignored.
+ *
+ * Setting @interval_ms to 0, which is the default, signals and sends any
+ * pending chat state changes immediately.
+ *
+ * Since: 0.UNRELEASED
+ */
+void
+tp_message_mixin_set_chat_state_coalescing (GObject *object,
+    guint interval_ms,
+    guint expiry_ms)
+{
+  TpMessageMixin *mixin = TP_MESSAGE_MIXIN (object);
+
+  mixin->priv->chat_state_interval_ms = interval_ms;
+
+  if (interval_ms == 0)
     {
-      g_hash_table_insert (mixin->priv->chat_states,
-          GUINT_TO_POINTER (member),
-          GUINT_TO_POINTER (state));
+      tp_clear_pointer (&mixin->priv->chat_state_flush_timer,
+          _tp_timer_cancel);
+      chat_state_flush (object);
     }
 
-  tp_svc_channel_interface_chat_state_emit_chat_state_changed (object,
-      member, state);
+  mixin->priv->chat_state_expiry_ms = expiry_ms;
+
+  if (expiry_ms == 0)
+    {
+      tp_clear_pointer (&mixin->priv->chat_state_expiry_timer,
+          _tp_timer_cancel);
+      g_hash_table_remove_all (mixin->priv->chat_state_deadlines);
+    }
 }
 
 /**
@@ -426,25 +716,29 @@ tp_message_mixin_maybe_send_gone (GObject *object)
     }
 
   mixin->priv->send_gone = FALSE;
+  mixin->priv->sent_chat_state = NO_CHAT_STATE;
+  mixin->priv->queued_chat_state = NO_CHAT_STATE;
 }
 
-/* FIXME: Use tp_base_channel_get_self_handle() when TpMessageMixin requires
- * TpBaseChannel. See bug #49366 */
-static TpHandle
-get_self_handle (GObject *object)
+/* Returns TRUE if @state should not be sent now, either because it is what
+ * was last sent or because it has been queued for chat_state_flush() */
+static gboolean
+chat_state_defer_send (TpMessageMixin *mixin,
+    TpChannelChatState state)
 {
-  TpMessageMixin *mixin = TP_MESSAGE_MIXIN (object);
+  if (mixin->priv->chat_state_interval_ms == 0)
+    return FALSE;
 
-  if (TP_HAS_GROUP_MIXIN (object))
-    {
-      guint ret = 0;
+  if (mixin->priv->queued_chat_state == NO_CHAT_STATE &&
+      state == mixin->priv->sent_chat_state)
+    return TRUE;
 
-      tp_group_mixin_get_self_handle (object, &ret, NULL);
-      if (ret != 0)
-        return ret;
-    }
+  if (mixin->priv->chat_state_flush_timer == NULL)
+    return FALSE;
 
-  return tp_base_connection_get_self_handle (mixin->priv->connection);
+  /* if this is what was last sent, chat_state_flush() won't send it again */
+  mixin->priv->queued_chat_state = state;
+  return TRUE;
 }
 
 static void
@@ -481,8 +775,17 @@ tp_message_mixin_set_chat_state_async (TpSvcChannelInterfaceChatState *iface,
       goto error;
     }
 
-  if (!mixin->priv->send_chat_state (object, state, &error))
-    goto error;
+  if (!chat_state_defer_send (mixin, state))
+    {
+      if (!mixin->priv->send_chat_state (object, state, &error))
+        goto error;
+
+      mixin->priv->sent_chat_state = state;
+      mixin->priv->queued_chat_state = NO_CHAT_STATE;
+
+      if (mixin->priv->chat_state_interval_ms > 0)
+        chat_state_ensure_flush (object);
+    }
 
   mixin->priv->send_gone = TRUE;
   tp_message_mixin_change_chat_state (object, get_self_handle (object), state);
@@ -538,6 +841,11 @@ tp_message_mixin_init (GObject *obj,
   mixin->priv->supported_content_types = g_new0 (gchar *, 1);
 
   mixin->priv->chat_states = g_hash_table_new (NULL, NULL);
+  mixin->priv->pending_chat_states = g_hash_table_new (NULL, NULL);
+  mixin->priv->chat_state_deadlines = g_hash_table_new_full (NULL, NULL,
+      NULL, g_free);
+  mixin->priv->sent_chat_state = NO_CHAT_STATE;
+  mixin->priv->queued_chat_state = NO_CHAT_STATE;
 }
 
 
@@ -585,6 +893,10 @@ tp_message_mixin_finalize (GObject *obj)
   g_object_unref (mixin->priv->connection);
 
   g_hash_table_unref (mixin->priv->chat_states);
+  g_hash_table_unref (mixin->priv->pending_chat_states);
+  g_hash_table_unref (mixin->priv->chat_state_deadlines);
+  tp_clear_pointer (&mixin->priv->chat_state_flush_timer, _tp_timer_cancel);
+  tp_clear_pointer (&mixin->priv->chat_state_expiry_timer, _tp_timer_cancel);
 
   g_slice_free (TpMessageMixinPrivate, mixin->priv);
 }
@@ -678,7 +990,7 @@ tp_message_mixin_list_pending_messages_async (TpSvcChannelTypeText *iface,
       TpMessage *msg = cur->data;
       TpCMMessage *cm_msg = cur->data;
       GValue val = { 0, };
-      gchar *text;
+      const gchar *text;
       TpChannelTextMessageFlags flags;
       TpChannelTextMessageType type;
       TpHandle sender;
@@ -698,8 +1010,6 @@ tp_message_mixin_list_pending_messages_async (TpSvcChannelTypeText *iface,
           5, text,
           G_MAXUINT);
 
-      g_free (text);
-
       g_ptr_array_add (messages, g_value_get_boxed (&val));
     }
 
@@ -839,7 +1149,7 @@ queue_pending (GObject *object, TpMessage *pending)
   TpChannelTextMessageType type;
   TpHandle sender;
   guint timestamp;
-  gchar *text;
+  const gchar *text;
   const GHashTable *header;
   TpDeliveryStatus delivery_status;
   TpCMMessage *cm_message = (TpCMMessage *) pending;
@@ -849,7 +1159,6 @@ queue_pending (GObject *object, TpMessage *pending)
   text = parts_to_text (pending, &flags, &type, &sender, &timestamp);
   tp_svc_channel_type_text_emit_received (object, cm_message->incoming_id,
       timestamp, sender, type, flags, text);
-  g_free (text);
 
   tp_svc_channel_interface_messages_emit_message_received (object,
       pending->parts);
@@ -867,6 +1176,7 @@ queue_pending (GObject *object, TpMessage *pending)
           "delivery-error", NULL);
       GPtrArray *echo = tp_asv_get_boxed (header, "delivery-echo",
           TP_ARRAY_TYPE_MESSAGE_PART_LIST);
+      TpMessage *echo_msg = NULL;
 
       type = TP_CHANNEL_TEXT_MESSAGE_TYPE_NORMAL;
 
@@ -880,7 +1190,6 @@ queue_pending (GObject *object, TpMessage *pending)
       else if (echo != NULL)
         {
           const GHashTable *echo_header = g_ptr_array_index (echo, 0);
-          TpMessage *echo_msg;
 
           echo_msg = _tp_cm_message_new_from_parts (mixin->priv->connection,
               echo);
@@ -896,14 +1205,13 @@ queue_pending (GObject *object, TpMessage *pending)
            */
           text = parts_to_text (echo_msg, NULL, &type, NULL, NULL);
           timestamp = tp_asv_get_uint32 (echo_header, "message-sent", NULL);
-
-          g_object_unref (echo_msg);
         }
 
       tp_svc_channel_type_text_emit_send_error (object, send_error, timestamp,
           type, text != NULL ? text : "");
 
-      g_free (text);
+      /* @text is borrowed from @echo_msg, so this must come last */
+      tp_clear_object (&echo_msg);
     }
 }
 
@@ -1099,7 +1407,7 @@ tp_message_mixin_sent (GObject *object,
   else
     {
       TpChannelTextMessageType message_type;
-      gchar *string;
+      const gchar *string;
       GHashTable *header = g_ptr_array_index (message->parts, 0);
 
       mixin->priv->send_gone = TRUE;
@@ -1116,7 +1424,6 @@ tp_message_mixin_sent (GObject *object,
       string = parts_to_text (message, NULL, &message_type, NULL, NULL);
       tp_svc_channel_type_text_emit_sent (object, now, message_type,
           string);
-      g_free (string);
 
       /* return successfully */
 
@@ -1271,6 +1578,8 @@ tp_message_mixin_send_message_async (TpSvcChannelInterfaceMessages *iface,
           (GBoxedCopyFunc) tp_g_value_slice_dup);
     }
 
+  _tp_message_part_changed (message, 0);
+
   cm_msg->outgoing_context = context;
   cm_msg->outgoing_text_api = FALSE;
 
@@ -1380,16 +1689,23 @@ tp_message_mixin_get_dbus_property (GObject *object,
       GPtrArray *arrays = g_ptr_array_sized_new (g_queue_get_length (
             mixin->priv->pending));
       GList *l;
-      GType type = dbus_g_type_get_collection ("GPtrArray",
-          TP_HASH_TYPE_MESSAGE_PART);
+      guint i;
 
+      /* Share each message's parts rather than deep-copying them: the
+       * outer arrays are new, so that freeing @value frees them and drops
+       * one reference to each part. */
       for (l = g_queue_peek_head_link (mixin->priv->pending);
            l != NULL;
            l = g_list_next (l))
         {
           TpMessage *msg = l->data;
+          GPtrArray *parts = g_ptr_array_sized_new (msg->parts->len);
+
+          for (i = 0; i < msg->parts->len; i++)
+            g_ptr_array_add (parts,
+                g_hash_table_ref (g_ptr_array_index (msg->parts, i)));
 
-          g_ptr_array_add (arrays, g_boxed_copy (type, msg->parts));
+          g_ptr_array_add (arrays, parts);
         }
 
       g_value_take_boxed (value, arrays);
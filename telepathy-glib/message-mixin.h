@@ -90,6 +90,11 @@ void tp_message_mixin_implement_send_chat_state (GObject *object,
 _TP_AVAILABLE_IN_0_20
 void tp_message_mixin_maybe_send_gone (GObject *object);
 
+_TP_AVAILABLE_IN_UNRELEASED
+void tp_message_mixin_set_chat_state_coalescing (GObject *object,
+    guint interval_ms,
+    guint expiry_ms);
+
 /* Initialization */
 void tp_message_mixin_text_iface_init (gpointer g_iface, gpointer iface_data);
 void tp_message_mixin_messages_iface_init (gpointer g_iface,
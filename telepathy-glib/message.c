@@ -65,11 +65,102 @@ G_DEFINE_TYPE (TpMessage, tp_message, G_TYPE_OBJECT)
  * can be accessed with tp_signalled_message_get_sender().
  */
 
+/* Typed copies of the well-known header fields, parsed from parts[0] the
+ * first time one of them is needed and discarded whenever parts[0] is
+ * modified. Strings are borrowed from parts[0]. */
+typedef struct
+{
+  const gchar *token;
+  const gchar *supersedes;
+  const gchar *interface;
+  gint64 sent;
+  gint64 received;
+  TpChannelTextMessageType message_type;
+  TpHandle sender;
+  guint32 pending_message_id;
+  gboolean has_pending_message_id;
+  gboolean is_delivery_report;
+  gboolean scrollback;
+  gboolean rescued;
+} MessageHeader;
+
 struct _TpMessagePrivate
 {
   gboolean mutable;
+
+  gboolean header_valid;
+  MessageHeader header;
+
+  /* The result of tp_message_to_text(), computed on demand and discarded
+   * whenever any part is modified; NULL if not computed yet */
+  gchar *text;
+  TpChannelTextMessageFlags text_flags;
 };
 
+static const MessageHeader *
+message_get_header (TpMessage *self)
+{
+  MessageHeader *h = &self->priv->header;
+  const GHashTable *part;
+
+  if (self->priv->header_valid)
+    return h;
+
+  part = g_ptr_array_index (self->parts, 0);
+
+  h->token = tp_asv_get_string (part, "message-token");
+  h->supersedes = tp_asv_get_string (part, "supersedes");
+  h->interface = tp_asv_get_string (part, "interface");
+  h->sent = tp_asv_get_int64 (part, "message-sent", NULL);
+  h->received = tp_asv_get_int64 (part, "message-received", NULL);
+  /* if message-type is absent or invalid we use 0, which is NORMAL */
+  h->message_type = tp_asv_get_uint32 (part, "message-type", NULL);
+  h->sender = tp_asv_get_uint32 (part, "message-sender", NULL);
+  h->pending_message_id = tp_asv_get_uint32 (part, "pending-message-id",
+      &h->has_pending_message_id);
+  tp_asv_get_uint32 (part, "delivery-status", &h->is_delivery_report);
+  h->scrollback = tp_asv_get_boolean (part, "scrollback", NULL);
+  h->rescued = tp_asv_get_boolean (part, "rescued", NULL);
+
+  if (tp_str_empty (h->token))
+    h->token = NULL;
+
+  if (tp_str_empty (h->supersedes))
+    h->supersedes = NULL;
+
+  self->priv->header_valid = TRUE;
+  return h;
+}
+
+/*
+ * _tp_message_part_changed:
+ * @self: a message
+ * @part: a part number
+ *
+ * Must be called after modifying @self->parts directly.
+ */
+void
+_tp_message_part_changed (TpMessage *self,
+    guint part)
+{
+  if (part == 0)
+    self->priv->header_valid = FALSE;
+
+  tp_clear_pointer (&self->priv->text, g_free);
+}
+
+/*
+ * _tp_message_get_sender_handle:
+ * @self: a message
+ *
+ * Returns: the message-sender header, or 0
+ */
+TpHandle
+_tp_message_get_sender_handle (TpMessage *self)
+{
+  return message_get_header (self)->sender;
+}
+
 static void
 tp_message_dispose (GObject *object)
 {
@@ -89,6 +180,8 @@ tp_message_dispose (GObject *object)
       self->parts = NULL;
     }
 
+  tp_clear_pointer (&self->priv->text, g_free);
+
   if (dispose != NULL)
     dispose (object);
 }
@@ -241,6 +334,7 @@ tp_message_append_part (TpMessage *self)
 
   g_ptr_array_add (self->parts, g_hash_table_new_full (g_str_hash,
         g_str_equal, g_free, (GDestroyNotify) tp_g_value_slice_free));
+  _tp_message_part_changed (self, self->parts->len - 1);
   return self->parts->len - 1;
 }
 
@@ -263,6 +357,7 @@ tp_message_delete_part (TpMessage *self,
   g_return_if_fail (self->priv->mutable);
 
   g_hash_table_unref (g_ptr_array_remove_index (self->parts, part));
+  _tp_message_part_changed (self, part);
 }
 
 /**
@@ -312,6 +407,7 @@ tp_message_delete_key (TpMessage *self,
   g_return_val_if_fail (part < self->parts->len, FALSE);
   g_return_val_if_fail (self->priv->mutable, FALSE);
 
+  _tp_message_part_changed (self, part);
   return g_hash_table_remove (g_ptr_array_index (self->parts, part), key);
 }
 
@@ -373,6 +469,7 @@ tp_message_set_boolean (TpMessage *self,
   g_return_if_fail (key != NULL);
   g_return_if_fail (self->priv->mutable);
 
+  _tp_message_part_changed (self, part);
   g_hash_table_insert (g_ptr_array_index (self->parts, part),
       g_strdup (key), tp_g_value_slice_new_boolean (b));
 }
@@ -412,6 +509,7 @@ tp_message_set_int32 (TpMessage *self,
   g_return_if_fail (key != NULL);
   g_return_if_fail (self->priv->mutable);
 
+  _tp_message_part_changed (self, part);
   g_hash_table_insert (g_ptr_array_index (self->parts, part),
       g_strdup (key), tp_g_value_slice_new_int (i));
 }
@@ -439,6 +537,7 @@ tp_message_set_int64 (TpMessage *self,
   g_return_if_fail (key != NULL);
   g_return_if_fail (self->priv->mutable);
 
+  _tp_message_part_changed (self, part);
   g_hash_table_insert (g_ptr_array_index (self->parts, part),
       g_strdup (key), tp_g_value_slice_new_int64 (i));
 }
@@ -479,6 +578,7 @@ tp_message_set_uint32 (TpMessage *self,
   g_return_if_fail (key != NULL);
   g_return_if_fail (self->priv->mutable);
 
+  _tp_message_part_changed (self, part);
   g_hash_table_insert (g_ptr_array_index (self->parts, part),
       g_strdup (key), tp_g_value_slice_new_uint (u));
 }
@@ -506,6 +606,7 @@ tp_message_set_uint64 (TpMessage *self,
   g_return_if_fail (key != NULL);
   g_return_if_fail (self->priv->mutable);
 
+  _tp_message_part_changed (self, part);
   g_hash_table_insert (g_ptr_array_index (self->parts, part),
       g_strdup (key), tp_g_value_slice_new_uint64 (u));
 }
@@ -534,6 +635,7 @@ tp_message_set_string (TpMessage *self,
   g_return_if_fail (s != NULL);
   g_return_if_fail (self->priv->mutable);
 
+  _tp_message_part_changed (self, part);
   g_hash_table_insert (g_ptr_array_index (self->parts, part),
       g_strdup (key), tp_g_value_slice_new_string (s));
 }
@@ -572,6 +674,7 @@ tp_message_set_string_printf (TpMessage *self,
   s = g_strdup_vprintf (fmt, va);
   va_end (va);
 
+  _tp_message_part_changed (self, part);
   g_hash_table_insert (g_ptr_array_index (self->parts, part),
       g_strdup (key), tp_g_value_slice_new_take_string (s));
 }
@@ -602,6 +705,7 @@ tp_message_set_bytes (TpMessage *self,
   g_return_if_fail (bytes != NULL);
   g_return_if_fail (self->priv->mutable);
 
+  _tp_message_part_changed (self, part);
   g_hash_table_insert (g_ptr_array_index (self->parts, part),
       g_strdup (key),
       tp_g_value_slice_new_bytes (len, bytes));
@@ -636,6 +740,7 @@ tp_message_set (TpMessage *self,
   g_return_if_fail (source != NULL);
   g_return_if_fail (self->priv->mutable);
 
+  _tp_message_part_changed (self, part);
   g_hash_table_insert (g_ptr_array_index (self->parts, part),
       g_strdup (key), tp_g_value_slice_dup (source));
 }
@@ -673,6 +778,7 @@ tp_message_set_variant (TpMessage *self,
   dbus_g_value_parse_g_variant (value, gvalue);
   g_variant_unref (value);
 
+  _tp_message_part_changed (self, part);
   g_hash_table_insert (g_ptr_array_index (self->parts, part),
       g_strdup (key), gvalue);
 }
@@ -714,24 +820,13 @@ subtract_from_hash (gpointer key,
   g_hash_table_remove (user_data, key);
 }
 
-/**
- * tp_message_to_text:
- * @message: a #TpMessage
- * @out_flags: (out) : if not %NULL, the #TpChannelTextMessageFlags of @message
- *
- * Concatene all the text parts contained in @message.
- *
- * Returns: (transfer full): a newly allocated string containing the
- * text content of #message
- *
- * Since: 0.13.9
- */
-gchar *
-tp_message_to_text (TpMessage *message,
+static gchar *
+message_build_text (TpMessage *message,
     TpChannelTextMessageFlags *out_flags)
 {
   guint i;
   GHashTable *header = g_ptr_array_index (message->parts, 0);
+  const MessageHeader *h = message_get_header (message);
   /* Lazily created hash tables, used as a sets: keys are borrowed
    * "alternative" string values from @parts, value == key. */
   /* Alternative IDs for which we have already extracted an alternative */
@@ -744,17 +839,16 @@ tp_message_to_text (TpMessage *message,
   GString *buffer = g_string_new ("");
   TpChannelTextMessageFlags flags = 0;
 
-  if (tp_asv_get_boolean (header, "scrollback", NULL))
+  if (h->scrollback)
     flags |= TP_CHANNEL_TEXT_MESSAGE_FLAG_SCROLLBACK;
 
-  if (tp_asv_get_boolean (header, "rescued", NULL))
+  if (h->rescued)
     flags |= TP_CHANNEL_TEXT_MESSAGE_FLAG_RESCUED;
 
   /* If the message is on an extended interface, is a delivery report, or only
    * contains headers, definitely set the "your client is too old" flag. */
   if (message->parts->len <= 1 ||
-      tp_asv_get_uint32 (header, "message-type", NULL)
-          == TP_CHANNEL_TEXT_MESSAGE_TYPE_DELIVERY_REPORT ||
+      h->message_type == TP_CHANNEL_TEXT_MESSAGE_TYPE_DELIVERY_REPORT ||
       g_hash_table_lookup (header, "interface") != NULL)
     {
       flags |= TP_CHANNEL_TEXT_MESSAGE_FLAG_NON_TEXT_CONTENT;
@@ -876,12 +970,51 @@ tp_message_to_text (TpMessage *message,
   if (alternatives_used != NULL)
     g_hash_table_unref (alternatives_used);
 
+  *out_flags = flags;
+  return g_string_free (buffer, FALSE);
+}
+
+/*
+ * _tp_message_peek_text:
+ * @self: a message
+ * @out_flags: (out) (allow-none): the #TpChannelTextMessageFlags of @self
+ *
+ * Like tp_message_to_text(), but the result is cached until @self is next
+ * modified.
+ *
+ * Returns: (transfer none): the text content of @self, valid until @self
+ *  is modified or destroyed
+ */
+const gchar *
+_tp_message_peek_text (TpMessage *self,
+    TpChannelTextMessageFlags *out_flags)
+{
+  if (self->priv->text == NULL)
+    self->priv->text = message_build_text (self, &self->priv->text_flags);
+
   if (out_flags != NULL)
-    {
-      *out_flags = flags;
-    }
+    *out_flags = self->priv->text_flags;
 
-  return g_string_free (buffer, FALSE);
+  return self->priv->text;
+}
+
+/**
+ * tp_message_to_text:
+ * @message: a #TpMessage
+ * @out_flags: (out) : if not %NULL, the #TpChannelTextMessageFlags of @message
+ *
+ * Concatene all the text parts contained in @message.
+ *
+ * Returns: (transfer full): a newly allocated string containing the
+ * text content of #message
+ *
+ * Since: 0.13.9
+ */
+gchar *
+tp_message_to_text (TpMessage *message,
+    TpChannelTextMessageFlags *out_flags)
+{
+  return g_strdup (_tp_message_peek_text (message, out_flags));
 }
 
 void
@@ -927,16 +1060,9 @@ tp_message_is_mutable (TpMessage *self)
 const gchar *
 tp_message_get_token (TpMessage *self)
 {
-  const gchar *token;
-
   g_return_val_if_fail (TP_IS_MESSAGE (self), NULL);
 
-  token = tp_asv_get_string (tp_message_peek (self, 0), "message-token");
-
-  if (tp_str_empty (token))
-    return NULL;
-  else
-    return token;
+  return message_get_header (self)->token;
 }
 
 /**
@@ -954,8 +1080,7 @@ tp_message_get_message_type (TpMessage *self)
 {
   g_return_val_if_fail (TP_IS_MESSAGE (self),
       TP_CHANNEL_TEXT_MESSAGE_TYPE_NORMAL);
-  /* if message-type is absent or invalid we just return 0, which is NORMAL */
-  return tp_asv_get_uint32 (tp_message_peek (self, 0), "message-type", NULL);
+  return message_get_header (self)->message_type;
 }
 
 /**
@@ -978,7 +1103,7 @@ gint64
 tp_message_get_sent_timestamp (TpMessage *self)
 {
   g_return_val_if_fail (TP_IS_MESSAGE (self), 0);
-  return tp_asv_get_int64 (tp_message_peek (self, 0), "message-sent", NULL);
+  return message_get_header (self)->sent;
 }
 
 /**
@@ -997,8 +1122,7 @@ gint64
 tp_message_get_received_timestamp (TpMessage *self)
 {
   g_return_val_if_fail (TP_IS_MESSAGE (self), 0);
-  return tp_asv_get_int64 (tp_message_peek (self, 0), "message-received",
-      NULL);
+  return message_get_header (self)->received;
 }
 
 /**
@@ -1016,7 +1140,7 @@ gboolean
 tp_message_is_scrollback (TpMessage *self)
 {
   g_return_val_if_fail (TP_IS_MESSAGE (self), FALSE);
-  return tp_asv_get_boolean (tp_message_peek (self, 0), "scrollback", NULL);
+  return message_get_header (self)->scrollback;
 }
 
 /**
@@ -1039,7 +1163,7 @@ gboolean
 tp_message_is_rescued (TpMessage *self)
 {
   g_return_val_if_fail (TP_IS_MESSAGE (self), FALSE);
-  return tp_asv_get_boolean (tp_message_peek (self, 0), "rescued", NULL);
+  return message_get_header (self)->rescued;
 }
 
 /**
@@ -1059,16 +1183,9 @@ tp_message_is_rescued (TpMessage *self)
 const gchar *
 tp_message_get_supersedes (TpMessage *self)
 {
-  const gchar *token;
-
   g_return_val_if_fail (TP_IS_MESSAGE (self), NULL);
 
-  token = tp_asv_get_string (tp_message_peek (self, 0), "supersedes");
-
-  if (tp_str_empty (token))
-    return NULL;
-  else
-    return token;
+  return message_get_header (self)->supersedes;
 }
 
 /**
@@ -1090,7 +1207,7 @@ const gchar *
 tp_message_get_specific_to_interface (TpMessage *self)
 {
   g_return_val_if_fail (TP_IS_MESSAGE (self), NULL);
-  return tp_asv_get_string (tp_message_peek (self, 0), "interface");
+  return message_get_header (self)->interface;
 }
 
 /**
@@ -1107,12 +1224,9 @@ tp_message_get_specific_to_interface (TpMessage *self)
 gboolean
 tp_message_is_delivery_report (TpMessage *self)
 {
-  gboolean valid;
-
   g_return_val_if_fail (TP_IS_MESSAGE (self), FALSE);
 
-  tp_asv_get_uint32 (tp_message_peek (self, 0), "delivery-status", &valid);
-  return valid;
+  return message_get_header (self)->is_delivery_report;
 }
 
 /**
@@ -1132,10 +1246,16 @@ guint32
 tp_message_get_pending_message_id (TpMessage *self,
     gboolean *valid)
 {
+  const MessageHeader *h;
+
   g_return_val_if_fail (TP_IS_MESSAGE (self), FALSE);
 
-  return tp_asv_get_uint32 (tp_message_peek (self, 0),
-      "pending-message-id", valid);
+  h = message_get_header (self);
+
+  if (valid != NULL)
+    *valid = h->has_pending_message_id;
+
+  return h->pending_message_id;
 }
 
 /*
@@ -57,6 +57,7 @@
 
 #define DEBUG_FLAG TP_DEBUG_CLIENT
 #include "telepathy-glib/debug-internal.h"
+#include "telepathy-glib/proxy-internal.h"
 
 struct _TpObserveChannelsContextClass {
     /*<private>*/
@@ -638,17 +639,17 @@ context_prepare (TpObserveChannelsContext *self,
 
   self->priv->num_pending = 2;
 
-  tp_proxy_prepare_async (self->account, account_features,
+  _tp_proxy_prepare_shared_async (self->account, account_features,
       account_prepare_cb, g_object_ref (self));
 
-  tp_proxy_prepare_async (self->connection, connection_features,
+  _tp_proxy_prepare_shared_async (self->connection, connection_features,
       conn_prepare_cb, g_object_ref (self));
 
   if (self->dispatch_operation != NULL)
     {
       self->priv->num_pending++;
-      tp_proxy_prepare_async (self->dispatch_operation, cdo_features,
-          cdo_prepare_cb, g_object_ref (self));
+      _tp_proxy_prepare_shared_async (self->dispatch_operation,
+          cdo_features, cdo_prepare_cb, g_object_ref (self));
     }
 
   for (i = 0; i < self->channels->len; i++)
@@ -657,7 +658,7 @@ context_prepare (TpObserveChannelsContext *self,
 
       self->priv->num_pending++;
 
-      tp_proxy_prepare_async (channel, channel_features,
+      _tp_proxy_prepare_shared_async (channel, channel_features,
           occ_channel_prepare_cb, g_object_ref (self));
     }
 }
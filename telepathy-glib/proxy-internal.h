@@ -36,6 +36,11 @@ void _tp_proxy_set_feature_prepared (TpProxy *self,
 void _tp_proxy_set_features_failed (TpProxy *self,
     const GError *error);
 
+void _tp_proxy_prepare_shared_async (gpointer self,
+    const GQuark *features,
+    GAsyncReadyCallback callback,
+    gpointer user_data);
+
 void _tp_proxy_will_announce_connected_async (TpProxy *self,
     GAsyncReadyCallback callback,
     gpointer user_data);
@@ -402,6 +402,10 @@ struct _TpProxyPrivate {
      * completed */
     guint pending_will_announce_calls;
 
+    /* owned SharedPrepare for each distinct set of features being prepared
+     * by _tp_proxy_prepare_shared_async() */
+    GSList *shared_prepares;
+
     gboolean dispose_has_run;
 
     TpSimpleClientFactory *factory;
@@ -1193,6 +1197,7 @@ tp_proxy_finalize (GObject *object)
 
   /* invalidation ensures that these have gone away */
   g_assert_cmpuint (g_queue_get_length (self->priv->prepare_requests), ==, 0);
+  g_assert (self->priv->shared_prepares == NULL);
   tp_clear_pointer (&self->priv->prepare_requests, g_queue_free);
 
   g_free (self->bus_name);
@@ -2041,6 +2046,139 @@ tp_proxy_prepare_finish (gpointer self,
   _tp_implement_finish_void (self, tp_proxy_prepare_async);
 }
 
+typedef struct {
+    /* sorted, without duplicates */
+    GArray *features;
+    /* owned GSimpleAsyncResult */
+    GPtrArray *waiters;
+} SharedPrepare;
+
+static gint
+quark_cmp (gconstpointer a,
+    gconstpointer b)
+{
+  GQuark qa = *(const GQuark *) a;
+  GQuark qb = *(const GQuark *) b;
+
+  return (qa > qb) - (qa < qb);
+}
+
+static gboolean
+quark_arrays_equal (GArray *a,
+    GArray *b)
+{
+  return (a->len == b->len &&
+      memcmp (a->data, b->data, a->len * sizeof (GQuark)) == 0);
+}
+
+static void
+shared_prepare_cb (GObject *source,
+    GAsyncResult *result,
+    gpointer user_data)
+{
+  TpProxy *self = TP_PROXY (source);
+  SharedPrepare *shared = user_data;
+  GError *error = NULL;
+  guint i;
+
+  /* anyone who asks from now on will have to start again */
+  self->priv->shared_prepares = g_slist_remove (self->priv->shared_prepares,
+      shared);
+
+  tp_proxy_prepare_finish (self, result, &error);
+
+  /* we're already in an idle (or the proxy was invalidated), so it's OK to
+   * complete these directly */
+  for (i = 0; i < shared->waiters->len; i++)
+    {
+      GSimpleAsyncResult *waiter = g_ptr_array_index (shared->waiters, i);
+
+      if (error != NULL)
+        g_simple_async_result_set_from_error (waiter, error);
+
+      g_simple_async_result_complete (waiter);
+    }
+
+  g_clear_error (&error);
+  g_ptr_array_unref (shared->waiters);
+  g_array_unref (shared->features);
+  g_slice_free (SharedPrepare, shared);
+}
+
+/*
+ * _tp_proxy_prepare_shared_async:
+ * @self: an instance of a #TpProxy subclass
+ * @features: (transfer none) (array zero-terminated=1) (allow-none): the
+ *  same as for tp_proxy_prepare_async()
+ * @callback: called exactly once, as for tp_proxy_prepare_async()
+ * @user_data: user data for @callback
+ *
+ * The same as tp_proxy_prepare_async(), whose finish function should be
+ * used with the result, except that while a preparation of the same set of
+ * features is already in progress on @self, this waits for that one
+ * instead of adding another request.
+ *
+ * This is for code that prepares the same account or connection many
+ * times over in quick succession, such as TpBaseClient when a burst of
+ * channels is dispatched: tp_proxy_prepare_async() re-examines every
+ * outstanding request each time any feature becomes ready, which is
+ * quadratic in the length of the burst.
+ */
+void
+_tp_proxy_prepare_shared_async (gpointer self,
+    const GQuark *features,
+    GAsyncReadyCallback callback,
+    gpointer user_data)
+{
+  TpProxy *proxy = self;
+  GSimpleAsyncResult *result;
+  SharedPrepare *shared;
+  GArray *sorted;
+  GSList *l;
+  guint i;
+
+  g_return_if_fail (TP_IS_PROXY (self));
+
+  result = g_simple_async_result_new (self, callback, user_data,
+      tp_proxy_prepare_async);
+
+  sorted = _tp_quark_array_copy (features);
+  g_array_sort (sorted, quark_cmp);
+
+  for (i = 1; i < sorted->len; )
+    {
+      if (g_array_index (sorted, GQuark, i) ==
+          g_array_index (sorted, GQuark, i - 1))
+        g_array_remove_index (sorted, i);
+      else
+        i++;
+    }
+
+  for (l = proxy->priv->shared_prepares; l != NULL; l = l->next)
+    {
+      shared = l->data;
+
+      if (quark_arrays_equal (shared->features, sorted))
+        {
+          DEBUG ("%p: joining preparation %p", self, shared);
+          g_ptr_array_add (shared->waiters, result);
+          g_array_unref (sorted);
+          return;
+        }
+    }
+
+  shared = g_slice_new0 (SharedPrepare);
+  shared->features = sorted;
+  shared->waiters = g_ptr_array_new_with_free_func (g_object_unref);
+  g_ptr_array_add (shared->waiters, result);
+
+  proxy->priv->shared_prepares = g_slist_prepend (
+      proxy->priv->shared_prepares, shared);
+
+  tp_proxy_prepare_async (self, (const GQuark *) shared->features->data,
+      shared_prepare_cb, shared);
+}
+
 static gboolean
 prepare_finish (TpProxy *self,
     GAsyncResult *result,
@@ -24,6 +24,8 @@
 #ifndef __TP_ROOM_INFO_INTERNAL_H__
 #define __TP_ROOM_INFO_INTERNAL_H__
 
-TpRoomInfo * _tp_room_info_new (GValueArray *dbus_struct);
+TpRoomInfo * _tp_room_info_new_from_parts (TpHandle handle,
+    const gchar *channel_type,
+    GHashTable *info);
 
 #endif
@@ -94,31 +94,22 @@ tp_room_info_init (TpRoomInfo *self)
       TP_TYPE_ROOM_INFO, TpRoomInfoPriv);
 }
 
+/* @info is never modified, so it is shared rather than copied */
 TpRoomInfo *
-_tp_room_info_new (GValueArray *dbus_struct)
+_tp_room_info_new_from_parts (TpHandle handle,
+    const gchar *channel_type,
+    GHashTable *info)
 {
   TpRoomInfo *room;
-  const gchar *channel_type;
-  GHashTable *info;
-
-  g_return_val_if_fail (dbus_struct != NULL, NULL);
-  g_return_val_if_fail (dbus_struct->n_values == 3, NULL);
 
   /* We don't want to expose the GValueArray in the API so it's not
    * a GObject property. */
   room = g_object_new (TP_TYPE_ROOM_INFO,
       NULL);
 
-  tp_value_array_unpack (dbus_struct, 3,
-      &room->priv->handle,
-      &channel_type,
-      &info);
+  room->priv->handle = handle;
   room->priv->channel_type = g_strdup (channel_type);
-  room->priv->info = g_hash_table_new_full (g_str_hash, g_str_equal,
-      g_free, (GDestroyNotify) tp_g_value_slice_free);
-  tp_g_hash_table_update (room->priv->info, info,
-      (GBoxedCopyFunc) g_strdup,
-      (GBoxedCopyFunc) tp_g_value_slice_dup);
+  room->priv->info = g_hash_table_ref (info);
 
   return room;
 }
@@ -55,6 +55,7 @@
 #include "telepathy-glib/debug-internal.h"
 
 #include <stdio.h>
+#include <string.h>
 #include <glib/gstdio.h>
 
 static void async_initable_iface_init (GAsyncInitableIface *iface);
@@ -72,8 +73,28 @@ struct _TpRoomListPrivate
 
   GSimpleAsyncResult *async_res;
   gulong invalidated_id;
+
+  /* See tp_room_list_set_filter(); name_filter is casefolded */
+  gchar *name_filter;
+  guint min_members;
+  guint max_members;
+
+  /* See tp_room_list_set_max_rooms(). If max_rooms is non-zero, kept is
+   * a min-heap of RoomRecord, ordered by number of members */
+  guint max_rooms;
+  GPtrArray *kept;
 };
 
+/* A room found while listing, before it has become a TpRoomInfo */
+typedef struct
+{
+  TpHandle handle;
+  /* interned */
+  const gchar *channel_type;
+  GHashTable *info;
+  guint members;
+} RoomRecord;
+
 enum
 {
   PROP_ACCOUNT = 1,
@@ -83,6 +104,7 @@ enum
 
 enum {
   SIG_GOT_ROOM,
+  SIG_GOT_ROOMS,
   SIG_FAILED,
   LAST_SIGNAL
 };
@@ -143,6 +165,170 @@ tp_room_list_set_property (GObject *object,
     }
 }
 
+static void
+room_record_free (gpointer p)
+{
+  RoomRecord *record = p;
+
+  g_hash_table_unref (record->info);
+  g_slice_free (RoomRecord, record);
+}
+
+static void
+room_record_swap (GPtrArray *heap,
+    guint i,
+    guint j)
+{
+  gpointer tmp = heap->pdata[i];
+
+  heap->pdata[i] = heap->pdata[j];
+  heap->pdata[j] = tmp;
+}
+
+#define RECORD_MEMBERS(heap, i) (((RoomRecord *) (heap)->pdata[i])->members)
+
+static void
+room_heap_sift_up (GPtrArray *heap,
+    guint i)
+{
+  while (i > 0)
+    {
+      guint parent = (i - 1) / 2;
+
+      if (RECORD_MEMBERS (heap, parent) <= RECORD_MEMBERS (heap, i))
+        return;
+
+      room_record_swap (heap, i, parent);
+      i = parent;
+    }
+}
+
+static void
+room_heap_sift_down (GPtrArray *heap,
+    guint i)
+{
+  while (TRUE)
+    {
+      guint smallest = i;
+      guint child;
+
+      for (child = 2 * i + 1; child <= 2 * i + 2 && child < heap->len; child++)
+        {
+          if (RECORD_MEMBERS (heap, child) < RECORD_MEMBERS (heap, smallest))
+            smallest = child;
+        }
+
+      if (smallest == i)
+        return;
+
+      room_record_swap (heap, i, smallest);
+      i = smallest;
+    }
+}
+
+/* Keep the room if it is one of the max_rooms largest seen so far */
+static void
+keep_room (TpRoomList *self,
+    TpHandle handle,
+    const gchar *channel_type,
+    GHashTable *info,
+    guint members)
+{
+  GPtrArray *kept = self->priv->kept;
+  RoomRecord *record;
+
+  if (kept->len < self->priv->max_rooms)
+    {
+      record = g_slice_new (RoomRecord);
+      g_ptr_array_add (kept, record);
+    }
+  else
+    {
+      /* replace the smallest room, if this one is larger */
+      record = g_ptr_array_index (kept, 0);
+
+      if (members <= record->members)
+        return;
+
+      g_hash_table_unref (record->info);
+    }
+
+  record->handle = handle;
+  record->channel_type = g_intern_string (channel_type);
+  record->info = g_hash_table_ref (info);
+  record->members = members;
+
+  if (record == g_ptr_array_index (kept, 0) && kept->len > 1)
+    room_heap_sift_down (kept, 0);
+  else
+    room_heap_sift_up (kept, kept->len - 1);
+}
+
+static gboolean
+room_matches_filter (TpRoomList *self,
+    GHashTable *info,
+    guint *members)
+{
+  gboolean known;
+
+  *members = tp_asv_get_uint32 (info, "members", &known);
+
+  if (self->priv->min_members > 0 &&
+      (!known || *members < self->priv->min_members))
+    return FALSE;
+
+  if (self->priv->max_members > 0 && known &&
+      *members > self->priv->max_members)
+    return FALSE;
+
+  if (self->priv->name_filter != NULL)
+    {
+      const gchar *name = tp_asv_get_string (info, "name");
+      gchar *folded;
+      gboolean found;
+
+      if (name == NULL)
+        name = tp_asv_get_string (info, "handle-name");
+
+      if (name == NULL)
+        return FALSE;
+
+      folded = g_utf8_casefold (name, -1);
+      found = (strstr (folded, self->priv->name_filter) != NULL);
+      g_free (folded);
+
+      if (!found)
+        return FALSE;
+    }
+
+  return TRUE;
+}
+
+/* Emit got-room for each of @rooms, and got-rooms for all of them */
+static void
+emit_rooms (TpRoomList *self,
+    GPtrArray *rooms)
+{
+  guint i;
+
+  if (rooms->len == 0)
+    return;
+
+  for (i = 0; i < rooms->len; i++)
+    g_signal_emit (self, signals[SIG_GOT_ROOM], 0,
+        g_ptr_array_index (rooms, i));
+
+  g_signal_emit (self, signals[SIG_GOT_ROOMS], 0, rooms);
+}
+
+static gboolean
+has_room_handlers (TpRoomList *self)
+{
+  return (g_signal_has_handler_pending (self, signals[SIG_GOT_ROOM], 0,
+        FALSE) ||
+      g_signal_has_handler_pending (self, signals[SIG_GOT_ROOMS], 0, FALSE));
+}
+
 static void
 got_rooms_cb (TpChannel *channel,
     const GPtrArray *rooms,
@@ -150,16 +336,88 @@ got_rooms_cb (TpChannel *channel,
     GObject *weak_object)
 {
   TpRoomList *self = TP_ROOM_LIST (weak_object);
+  GPtrArray *found;
   guint i;
 
+  /* Don't make objects that nobody will see */
+  if (self->priv->max_rooms == 0 && !has_room_handlers (self))
+    return;
+
+  found = g_ptr_array_new_with_free_func (g_object_unref);
+
   for (i = 0; i < rooms->len; i++)
     {
-      TpRoomInfo *room;
+      GValueArray *room_struct = g_ptr_array_index (rooms, i);
+      TpHandle handle;
+      const gchar *channel_type;
+      GHashTable *info;
+      guint members;
 
-      room = _tp_room_info_new (g_ptr_array_index (rooms, i));
-      g_signal_emit (self, signals[SIG_GOT_ROOM], 0, room);
-      g_object_unref (room);
+      if (room_struct->n_values != 3)
+        {
+          DEBUG ("ignoring malformed room");
+          continue;
+        }
+
+      tp_value_array_unpack (room_struct, 3,
+          &handle,
+          &channel_type,
+          &info);
+
+      if (!room_matches_filter (self, info, &members))
+        continue;
+
+      if (self->priv->max_rooms > 0)
+        keep_room (self, handle, channel_type, info, members);
+      else
+        g_ptr_array_add (found,
+            _tp_room_info_new_from_parts (handle, channel_type, info));
     }
+
+  emit_rooms (self, found);
+  g_ptr_array_unref (found);
+}
+
+static gint
+room_record_cmp_members_desc (gconstpointer a,
+    gconstpointer b)
+{
+  const RoomRecord *ra = *(RoomRecord * const *) a;
+  const RoomRecord *rb = *(RoomRecord * const *) b;
+
+  if (ra->members == rb->members)
+    return 0;
+
+  return (ra->members > rb->members ? -1 : 1);
+}
+
+/* Deliver the rooms kept in bounded mode, largest first */
+static void
+emit_kept_rooms (TpRoomList *self)
+{
+  GPtrArray *kept = self->priv->kept;
+  GPtrArray *found;
+  guint i;
+
+  if (kept->len == 0)
+    return;
+
+  g_ptr_array_sort (kept, room_record_cmp_members_desc);
+
+  found = g_ptr_array_new_full (kept->len, g_object_unref);
+
+  for (i = 0; i < kept->len; i++)
+    {
+      RoomRecord *record = g_ptr_array_index (kept, i);
+
+      g_ptr_array_add (found, _tp_room_info_new_from_parts (record->handle,
+            record->channel_type, record->info));
+    }
+
+  g_ptr_array_set_size (kept, 0);
+
+  emit_rooms (self, found);
+  g_ptr_array_unref (found);
 }
 
 static void
@@ -174,6 +432,10 @@ listing_rooms_cb (TpChannel *proxy,
     return;
 
   self->priv->listing = listing;
+
+  if (!listing)
+    emit_kept_rooms (self);
+
   g_object_notify (G_OBJECT (self), "listing");
 }
 
@@ -215,6 +477,8 @@ tp_room_list_finalize (GObject *object)
       ((GObjectClass *) tp_room_list_parent_class)->finalize;
 
   g_free (self->priv->server);
+  g_free (self->priv->name_filter);
+  g_ptr_array_unref (self->priv->kept);
 
   if (chain_up != NULL)
     chain_up (object);
@@ -293,6 +557,26 @@ tp_room_list_class_init (TpRoomListClass *klass)
       G_TYPE_NONE,
       1, TP_TYPE_ROOM_INFO);
 
+  /**
+   * TpRoomList::got-rooms:
+   * @self: a #TpRoomList
+   * @rooms: (element-type TelepathyGLib.RoomInfo): the #TpRoomInfo
+   *  objects found
+   *
+   * Fired after #TpRoomList::got-room has been fired for each room in a
+   * batch of rooms found together, for users who would rather deal with
+   * them all at once. If tp_room_list_set_max_rooms() has been used, there
+   * is only one batch, when the listing process finishes.
+   *
+   * Since: 0.UNRELEASED
+   */
+  signals[SIG_GOT_ROOMS] = g_signal_new ("got-rooms",
+      G_OBJECT_CLASS_TYPE (klass),
+      G_SIGNAL_RUN_LAST,
+      0, NULL, NULL, NULL,
+      G_TYPE_NONE,
+      1, G_TYPE_PTR_ARRAY);
+
   /**
    * TpRoomList::failed:
    * @self: a #TpRoomList
@@ -318,6 +602,8 @@ tp_room_list_init (TpRoomList *self)
 {
   self->priv = G_TYPE_INSTANCE_GET_PRIVATE ((self), TP_TYPE_ROOM_LIST,
       TpRoomListPrivate);
+
+  self->priv->kept = g_ptr_array_new_with_free_func (room_record_free);
 }
 
 /**
@@ -382,12 +668,74 @@ list_rooms_cb (TpChannel *channel,
     }
 }
 
+/**
+ * tp_room_list_set_filter:
+ * @self: a #TpRoomList
+ * @name_substring: (allow-none): only report rooms whose name, or handle
+ *  name if they have no name, contains this string, ignoring case; or
+ *  %NULL to report rooms with any name
+ * @min_members: only report rooms known to have at least this many
+ *  members, or 0
+ * @max_members: don't report rooms known to have more than this many
+ *  members, or 0 for no limit
+ *
+ * Only report the rooms matching the given criteria. Rooms that don't
+ * match are discarded as they are found, without creating a #TpRoomInfo.
+ *
+ * This should be called before tp_room_list_start().
+ *
+ * Since: 0.UNRELEASED
+ */
+void
+tp_room_list_set_filter (TpRoomList *self,
+    const gchar *name_substring,
+    guint min_members,
+    guint max_members)
+{
+  g_return_if_fail (TP_IS_ROOM_LIST (self));
+
+  g_free (self->priv->name_filter);
+  self->priv->name_filter = NULL;
+
+  if (!tp_str_empty (name_substring))
+    self->priv->name_filter = g_utf8_casefold (name_substring, -1);
+
+  self->priv->min_members = min_members;
+  self->priv->max_members = max_members;
+}
+
+/**
+ * tp_room_list_set_max_rooms:
+ * @self: a #TpRoomList
+ * @max_rooms: the number of rooms to report, or 0 to report every room
+ *  as soon as it is found
+ *
+ * Only report the @max_rooms rooms with the most members. Instead of being
+ * reported as they are found, the matching rooms are kept until the
+ * listing process finishes, at which point they are reported in
+ * descending order of size by one #TpRoomList::got-rooms signal. This
+ * bounds the memory used by the listing of a large server.
+ *
+ * This should be called before tp_room_list_start().
+ *
+ * Since: 0.UNRELEASED
+ */
+void
+tp_room_list_set_max_rooms (TpRoomList *self,
+    guint max_rooms)
+{
+  g_return_if_fail (TP_IS_ROOM_LIST (self));
+
+  self->priv->max_rooms = max_rooms;
+  g_ptr_array_set_size (self->priv->kept, 0);
+}
+
 /**
  * tp_room_list_start:
  * @self: a #TpRoomList
  *
- * Start listing rooms using @self. Use the TpRoomList::got-rooms
- * signal to get the rooms found.
+ * Start listing rooms using @self. Use the TpRoomList::got-room
+ * or TpRoomList::got-rooms signal to get the rooms found.
  * Errors will be reported using the TpRoomList::failed signal.
  *
  * Since: 0.19.0
@@ -397,6 +745,8 @@ tp_room_list_start (TpRoomList *self)
 {
   g_return_if_fail (self->priv->channel != NULL);
 
+  g_ptr_array_set_size (self->priv->kept, 0);
+
   tp_cli_channel_type_room_list_call_list_rooms (self->priv->channel, -1,
       list_rooms_cb, NULL, NULL, G_OBJECT (self));
 }
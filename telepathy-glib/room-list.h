@@ -71,6 +71,16 @@ const gchar * tp_room_list_get_server (TpRoomList *self);
 
 gboolean tp_room_list_is_listing (TpRoomList *self);
 
+_TP_AVAILABLE_IN_UNRELEASED
+void tp_room_list_set_filter (TpRoomList *self,
+    const gchar *name_substring,
+    guint min_members,
+    guint max_members);
+
+_TP_AVAILABLE_IN_UNRELEASED
+void tp_room_list_set_max_rooms (TpRoomList *self,
+    guint max_rooms);
+
 void tp_room_list_start (TpRoomList *self);
 
 G_END_DECLS
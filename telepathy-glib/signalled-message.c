@@ -195,6 +195,8 @@ _tp_signalled_message_new (const GPtrArray *parts,
           (GBoxedCopyFunc) tp_g_value_slice_dup);
     }
 
+  _tp_message_part_changed (self, 0);
+
   /* This handle may not be persistent, user should use the TpContact
    * directly */
   tp_message_delete_key (self, 0, "message-sender");
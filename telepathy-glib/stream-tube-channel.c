@@ -81,21 +81,18 @@ G_DEFINE_TYPE (TpStreamTubeChannel, tp_stream_tube_channel, TP_TYPE_CHANNEL)
 typedef struct
 {
   TpHandle handle;
-  GValue *param;
   guint connection_id;
   gboolean rejected;
 } SigWaitingConn;
 
 static SigWaitingConn *
 sig_waiting_conn_new (TpHandle handle,
-    const GValue *param,
     guint connection_id,
     gboolean rejected)
 {
   SigWaitingConn *ret = g_slice_new0 (SigWaitingConn);
 
   ret->handle = handle;
-  ret->param = tp_g_value_slice_dup (param);
   ret->connection_id = connection_id;
   ret->rejected = rejected;
   return ret;
@@ -106,26 +103,26 @@ sig_waiting_conn_free (SigWaitingConn *sig)
 {
   g_assert (sig != NULL);
 
-  tp_g_value_slice_free (sig->param);
   g_slice_free (SigWaitingConn, sig);
 }
 
+static void
+sig_waiting_conn_queue_free (GQueue *queue)
+{
+  g_queue_free_full (queue, (GDestroyNotify) sig_waiting_conn_free);
+}
+
 typedef struct
 {
   GSocketConnection *conn;
-  /* Used only with TP_SOCKET_ACCESS_CONTROL_CREDENTIALS to store the byte
-   * read with the credentials. */
-  guchar byte;
 } ConnWaitingSig;
 
 static ConnWaitingSig *
-conn_waiting_sig_new (GSocketConnection *conn,
-    guchar byte)
+conn_waiting_sig_new (GSocketConnection *conn)
 {
   ConnWaitingSig *ret = g_slice_new0 (ConnWaitingSig);
 
   ret->conn = g_object_ref (conn);
-  ret->byte = byte;
   return ret;
 }
 
@@ -138,6 +135,12 @@ conn_waiting_sig_free (ConnWaitingSig *c)
   g_slice_free (ConnWaitingSig, c);
 }
 
+static void
+conn_waiting_sig_queue_free (GQueue *queue)
+{
+  g_queue_free_full (queue, (GDestroyNotify) conn_waiting_sig_free);
+}
+
 struct _TpStreamTubeChannelPrivate
 {
   GHashTable *parameters;
@@ -147,11 +150,20 @@ struct _TpStreamTubeChannelPrivate
   GSocketAddress *address;
   gchar *unix_tmpdir;
   /* GSocketConnection we have accepted but are still waiting a
-   * NewRemoteConnection to identify them. Owned ConnWaitingSig. */
-  GSList *conn_waiting_sig;
+   * NewRemoteConnection to identify them.
+   * (guint) key => owned GQueue of owned ConnWaitingSig, oldest first.
+   * See get_sig_key() and get_conn_key() for what the key is. */
+  GHashTable *conn_waiting_sig;
   /* NewRemoteConnection signals we have received but didn't accept their TCP
-   * connection yet. Owned SigWaitingConn. */
-  GSList *sig_waiting_conn;
+   * connection yet.
+   * (guint) key => owned GQueue of owned SigWaitingConn, oldest first. */
+  GHashTable *sig_waiting_conn;
+  /* Connections and signals for which no key could be computed, so they
+   * can never be identified. They are kept until the channel goes away, as
+   * they would have been if they had a key that never matched. Owned
+   * ConnWaitingSig and SigWaitingConn respectively. */
+  GQueue *conn_without_key;
+  GQueue *sig_without_key;
 
   /* Accepting side */
   GSocket *client_socket;
@@ -226,13 +238,14 @@ tp_stream_tube_channel_dispose (GObject *obj)
   tp_clear_object (&self->priv->result);
   tp_clear_pointer (&self->priv->parameters, g_hash_table_unref);
 
-  g_slist_foreach (self->priv->conn_waiting_sig, (GFunc) conn_waiting_sig_free,
-      NULL);
-  tp_clear_pointer (&self->priv->conn_waiting_sig, g_slist_free);
+  g_hash_table_remove_all (self->priv->conn_waiting_sig);
+  g_hash_table_remove_all (self->priv->sig_waiting_conn);
 
-  g_slist_foreach (self->priv->sig_waiting_conn, (GFunc) sig_waiting_conn_free,
-      NULL);
-  tp_clear_pointer (&self->priv->sig_waiting_conn, g_slist_free);
+  while (!g_queue_is_empty (self->priv->conn_without_key))
+    conn_waiting_sig_free (g_queue_pop_head (self->priv->conn_without_key));
+
+  while (!g_queue_is_empty (self->priv->sig_without_key))
+    sig_waiting_conn_free (g_queue_pop_head (self->priv->sig_without_key));
 
   if (self->priv->tube_connections != NULL)
     {
@@ -281,6 +294,19 @@ tp_stream_tube_channel_dispose (GObject *obj)
   G_OBJECT_CLASS (tp_stream_tube_channel_parent_class)->dispose (obj);
 }
 
+static void
+tp_stream_tube_channel_finalize (GObject *obj)
+{
+  TpStreamTubeChannel *self = (TpStreamTubeChannel *) obj;
+
+  g_hash_table_unref (self->priv->conn_waiting_sig);
+  g_hash_table_unref (self->priv->sig_waiting_conn);
+  g_queue_free (self->priv->conn_without_key);
+  g_queue_free (self->priv->sig_without_key);
+
+  G_OBJECT_CLASS (tp_stream_tube_channel_parent_class)->finalize (obj);
+}
+
 static void
 tp_stream_tube_channel_get_property (GObject *object,
     guint property_id,
@@ -425,6 +451,7 @@ tp_stream_tube_channel_class_init (TpStreamTubeChannelClass *klass)
   gobject_class->constructed = tp_stream_tube_channel_constructed;
   gobject_class->get_property = tp_stream_tube_channel_get_property;
   gobject_class->dispose = tp_stream_tube_channel_dispose;
+  gobject_class->finalize = tp_stream_tube_channel_finalize;
 
   /**
    * TpStreamTubeChannel:service:
@@ -503,6 +530,12 @@ tp_stream_tube_channel_init (TpStreamTubeChannel *self)
       TpStreamTubeChannelPrivate);
 
   self->priv->tube_connections = g_hash_table_new (NULL, NULL);
+  self->priv->conn_waiting_sig = g_hash_table_new_full (NULL, NULL, NULL,
+      (GDestroyNotify) conn_waiting_sig_queue_free);
+  self->priv->sig_waiting_conn = g_hash_table_new_full (NULL, NULL, NULL,
+      (GDestroyNotify) sig_waiting_conn_queue_free);
+  self->priv->conn_without_key = g_queue_new ();
+  self->priv->sig_without_key = g_queue_new ();
 }
 
 
@@ -1015,59 +1048,123 @@ _new_remote_connection_with_contact (TpConnection *conn,
   /* anyone receiving the signal is required to hold their own reference */
 }
 
+/*
+ * Connections and NewRemoteConnection signals are matched by a key which
+ * both of them carry: the source port with the Port access control, or the
+ * byte sent along with the credentials with the Credentials access control.
+ * With other access controls we can't properly identify connections, so
+ * every connection and signal gets the same key, and they are matched in
+ * the order they arrived. A connection whose address can't be read, or a
+ * signal whose parameter doesn't fit the access control, has no key: it is
+ * queued all the same, but can never be matched.
+ */
 static gboolean
-sig_match_conn (TpStreamTubeChannel *self,
-    SigWaitingConn *sig,
-    ConnWaitingSig *c)
+get_sig_key (TpStreamTubeChannel *self,
+    const GValue *param,
+    guint *key)
 {
   if (self->priv->access_control == TP_SOCKET_ACCESS_CONTROL_PORT)
     {
-      /* Use the port to identify the connection */
       guint port;
-      GSocketAddress *address;
-      GError *error = NULL;
 
-      address = g_socket_connection_get_remote_address (c->conn, &error);
-      if (address == NULL)
+      if (!dbus_g_type_struct_get (param, 1, &port, G_MAXUINT))
         {
-          DEBUG ("Failed to get connection address: %s", error->message);
+          DEBUG ("NewRemoteConnection parameter is not an (sq) structure");
+          return FALSE;
+        }
 
-          g_error_free (error);
+      *key = port;
+    }
+  else if (self->priv->access_control == TP_SOCKET_ACCESS_CONTROL_CREDENTIALS)
+    {
+      if (!G_VALUE_HOLDS_UCHAR (param))
+        {
+          DEBUG ("NewRemoteConnection parameter is not a byte");
           return FALSE;
         }
 
-      dbus_g_type_struct_get (sig->param, 1, &port, G_MAXINT);
+      *key = g_value_get_uchar (param);
+    }
+  else
+    {
+      *key = 0;
+    }
+
+  return TRUE;
+}
+
+static gboolean
+get_conn_key (TpStreamTubeChannel *self,
+    GSocketConnection *conn,
+    guchar byte,
+    guint *key)
+{
+  if (self->priv->access_control == TP_SOCKET_ACCESS_CONTROL_PORT)
+    {
+      GSocketAddress *address;
+      GError *error = NULL;
 
-      if (port == g_inet_socket_address_get_port (
-            G_INET_SOCKET_ADDRESS (address)))
+      address = g_socket_connection_get_remote_address (conn, &error);
+      if (address == NULL)
         {
-          DEBUG ("Identified connection %u using port %u",
-              port, sig->connection_id);
+          DEBUG ("Failed to get connection address: %s", error->message);
 
-          g_object_unref (address);
-          return TRUE;
+          g_error_free (error);
+          return FALSE;
         }
 
+      *key = g_inet_socket_address_get_port (G_INET_SOCKET_ADDRESS (address));
       g_object_unref (address);
     }
   else if (self->priv->access_control == TP_SOCKET_ACCESS_CONTROL_CREDENTIALS)
     {
-      guchar byte;
-
-      byte = g_value_get_uchar (sig->param);
-
-      return byte == c->byte;
+      *key = byte;
     }
   else
     {
       DEBUG ("Can't properly identify connection as we are using "
-          "access control %u. Assume it's the head of the list",
+          "access control %u. Assume it's the oldest one",
           self->priv->access_control);
 
-      return TRUE;
+      *key = 0;
     }
 
-  return FALSE;
+  return TRUE;
+}
+
+static void
+waiting_push (GHashTable *waiting,
+    guint key,
+    gpointer item)
+{
+  GQueue *queue = g_hash_table_lookup (waiting, GUINT_TO_POINTER (key));
+
+  if (queue == NULL)
+    {
+      queue = g_queue_new ();
+      g_hash_table_insert (waiting, GUINT_TO_POINTER (key), queue);
+    }
+
+  g_queue_push_tail (queue, item);
+}
+
+/* Returns: (transfer full): the oldest item waiting with @key, or %NULL */
+static gpointer
+waiting_pop (GHashTable *waiting,
+    guint key)
+{
+  GQueue *queue = g_hash_table_lookup (waiting, GUINT_TO_POINTER (key));
+  gpointer item;
+
+  if (queue == NULL)
+    return NULL;
+
+  item = g_queue_pop_head (queue);
+
+  if (g_queue_is_empty (queue))
+    g_hash_table_remove (waiting, GUINT_TO_POINTER (key));
+
+  return item;
 }
 
 static gboolean
@@ -1173,12 +1270,12 @@ _new_remote_connection (TpChannel *channel,
     GObject *obj)
 {
   TpStreamTubeChannel *self = (TpStreamTubeChannel *) obj;
-  GSList *l;
-  ConnWaitingSig *found_conn = NULL;
+  ConnWaitingSig *found_conn;
   SigWaitingConn *sig;
   TpHandle chan_handle;
   TpHandleType handle_type;
   gboolean rejected = FALSE;
+  guint key;
 
   chan_handle = tp_channel_get_handle (channel, &handle_type);
   if (handle_type == TP_HANDLE_TYPE_CONTACT &&
@@ -1191,32 +1288,32 @@ _new_remote_connection (TpChannel *channel,
       rejected = TRUE;
     }
 
-  sig = sig_waiting_conn_new (handle, param, connection_id, rejected);
+  sig = sig_waiting_conn_new (handle, connection_id, rejected);
 
-  for (l = self->priv->conn_waiting_sig; l != NULL && found_conn == NULL;
-      l = g_slist_next (l))
+  if (!get_sig_key (self, param, &key))
     {
-      ConnWaitingSig *conn = l->data;
-
-      if (sig_match_conn (self, sig, conn))
-        found_conn = conn;
+      DEBUG ("Can't identify connection %u, it will never be matched",
+          connection_id);
 
+      /* Pass ownership of sig to the queue */
+      g_queue_push_tail (self->priv->sig_without_key, sig);
+      return;
     }
 
+  found_conn = waiting_pop (self->priv->conn_waiting_sig, key);
+
   if (found_conn == NULL)
     {
       DEBUG ("Didn't find any connection for %u. Waiting for more",
           connection_id);
 
-      /* Pass ownership of sig to the list */
-      self->priv->sig_waiting_conn = g_slist_append (
-          self->priv->sig_waiting_conn, sig);
+      /* Pass ownership of sig to the queue */
+      waiting_push (self->priv->sig_waiting_conn, key, sig);
       return;
     }
 
   /* We found a connection */
-  self->priv->conn_waiting_sig = g_slist_remove (
-      self->priv->conn_waiting_sig, found_conn);
+  DEBUG ("Identified connection %u using key %u", connection_id, key);
 
   if (rejected)
     connection_rejected (self, found_conn->conn, handle, connection_id);
@@ -1298,48 +1395,38 @@ finally:
     tp_g_value_slice_free (addressv);
 }
 
-static SigWaitingConn *
-find_sig_for_conn (TpStreamTubeChannel *self,
-    ConnWaitingSig *c)
-{
-  GSList *l;
-
-  for (l = self->priv->sig_waiting_conn; l != NULL; l = g_slist_next (l))
-    {
-      SigWaitingConn *sig = l->data;
-
-      if (sig_match_conn (self, sig, c))
-        return sig;
-    }
-
-  return NULL;
-}
-
 static void
 credentials_received (TpStreamTubeChannel *self,
     GSocketConnection *conn,
     guchar byte)
 {
   SigWaitingConn *sig;
-  ConnWaitingSig *c;
+  guint key;
+
+  if (!get_conn_key (self, conn, byte, &key))
+    {
+      DEBUG ("Can't identify the connection, it will never be matched");
 
-  c = conn_waiting_sig_new (conn, byte);
+      /* Pass ownership to the queue; this keeps the connection open */
+      g_queue_push_tail (self->priv->conn_without_key,
+          conn_waiting_sig_new (conn));
+      return;
+    }
 
-  sig = find_sig_for_conn (self, c);
+  sig = waiting_pop (self->priv->sig_waiting_conn, key);
   if (sig == NULL)
     {
       DEBUG ("Can't identify the connection, wait for NewRemoteConnection sig");
 
-      /* Pass ownership to the list */
-      self->priv->conn_waiting_sig = g_slist_append (
-          self->priv->conn_waiting_sig, c);
+      /* Pass ownership to the queue */
+      waiting_push (self->priv->conn_waiting_sig, key,
+          conn_waiting_sig_new (conn));
 
       return;
     }
 
   /* Connection has been identified */
-  self->priv->sig_waiting_conn = g_slist_remove (self->priv->sig_waiting_conn,
-      sig);
+  DEBUG ("Identified connection %u using key %u", sig->connection_id, key);
 
   if (sig->rejected)
     connection_rejected (self, conn, sig->handle, sig->connection_id);
@@ -1347,7 +1434,6 @@ credentials_received (TpStreamTubeChannel *self,
     connection_identified (self, conn, sig->handle, sig->connection_id);
 
   sig_waiting_conn_free (sig);
-  conn_waiting_sig_free (c);
 }
 
 #ifdef HAVE_GIO_UNIX
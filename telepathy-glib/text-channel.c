@@ -82,6 +82,11 @@ struct _TpTextChannelPrivate
 
   /* queue of owned TpSignalledMessage */
   GQueue *pending_messages;
+  /* (guint) pending message ID => owned GList of borrowed links in
+   * pending_messages, oldest first; a broken CM could reuse an ID before
+   * the first message with it is removed. Messages without a valid ID are
+   * not in here */
+  GHashTable *pending_messages_by_id;
   gboolean got_initial_messages;
 
   gboolean is_sms_channel;
@@ -119,6 +124,7 @@ tp_text_channel_dispose (GObject *obj)
 
   g_queue_foreach (self->priv->pending_messages, (GFunc) g_object_unref, NULL);
   tp_clear_pointer (&self->priv->pending_messages, g_queue_free);
+  tp_clear_pointer (&self->priv->pending_messages_by_id, g_hash_table_unref);
 
   G_OBJECT_CLASS (tp_text_channel_parent_class)->dispose (obj);
 }
@@ -514,11 +520,39 @@ add_message_received (TpTextChannel *self,
     gboolean fire_received)
 {
   TpMessage *msg;
+  gboolean valid;
+  guint id;
 
   msg = _tp_signalled_message_new (parts, sender);
 
   g_queue_push_tail (self->priv->pending_messages, msg);
 
+  id = _tp_signalled_message_get_pending_message_id (msg, &valid);
+
+  if (!valid)
+    {
+      DEBUG ("Message doesn't have pending-message-id ?!");
+    }
+  else
+    {
+      GList *links = g_hash_table_lookup (self->priv->pending_messages_by_id,
+          GUINT_TO_POINTER (id));
+      GList *link_ = g_queue_peek_tail_link (self->priv->pending_messages);
+
+      if (links == NULL)
+        {
+          g_hash_table_insert (self->priv->pending_messages_by_id,
+              GUINT_TO_POINTER (id), g_list_prepend (NULL, link_));
+        }
+      else
+        {
+          DEBUG ("Already have a pending message with id %u", id);
+          /* appending to a non-empty list doesn't change its head, so the
+           * hash table doesn't need updating */
+          links = g_list_append (links, link_);
+        }
+    }
+
   if (fire_received)
     g_signal_emit (self, signals[SIG_MESSAGE_RECEIVED], 0, msg);
 }
@@ -558,22 +592,6 @@ message_received_cb (TpChannel *proxy,
       copy_parts (message));
 }
 
-static gint
-find_msg_by_id (gconstpointer a,
-    gconstpointer b)
-{
-  TpMessage *msg = TP_MESSAGE (a);
-  guint id = GPOINTER_TO_UINT (b);
-  gboolean valid;
-  guint msg_id;
-
-  msg_id = _tp_signalled_message_get_pending_message_id (msg, &valid);
-  if (!valid)
-    return 1;
-
-  return msg_id != id;
-}
-
 static void
 pending_messages_removed_ready_cb (GObject *object,
     GAsyncResult *result,
@@ -589,20 +607,31 @@ pending_messages_removed_ready_cb (GObject *object,
   for (i = 0; i < ids->len; i++)
     {
       guint id = g_array_index (ids, guint, i);
-      GList *link_;
+      GList *links, *link_;
       TpMessage *msg;
 
-      link_ = g_queue_find_custom (self->priv->pending_messages,
-          GUINT_TO_POINTER (id), find_msg_by_id);
+      links = g_hash_table_lookup (self->priv->pending_messages_by_id,
+          GUINT_TO_POINTER (id));
 
-      if (link_ == NULL)
+      if (links == NULL)
         {
           DEBUG ("Unable to find pending message having id %d", id);
           continue;
         }
 
+      /* if the ID was reused, remove the oldest message with it, as
+       * searching the queue from the start would */
+      link_ = links->data;
       msg = link_->data;
 
+      g_hash_table_steal (self->priv->pending_messages_by_id,
+          GUINT_TO_POINTER (id));
+      links = g_list_delete_link (links, links);
+
+      if (links != NULL)
+        g_hash_table_insert (self->priv->pending_messages_by_id,
+            GUINT_TO_POINTER (id), links);
+
       g_queue_delete_link (self->priv->pending_messages, link_);
 
       g_signal_emit (self, signals[SIG_PENDING_MESSAGE_REMOVED], 0, msg);
@@ -1107,6 +1136,8 @@ tp_text_channel_init (TpTextChannel *self)
       TpTextChannelPrivate);
 
   self->priv->pending_messages = g_queue_new ();
+  self->priv->pending_messages_by_id = g_hash_table_new_full (NULL, NULL,
+      NULL, (GDestroyNotify) g_list_free);
 }
 
 
@@ -0,0 +1,40 @@
+/*<private_header>*/
+/* Shared timer scheduler - internal header
+ *
+ * Copyright © 2014 Collabora Ltd.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#ifndef __TP_TIMER_INTERNAL_H__
+#define __TP_TIMER_INTERNAL_H__
+
+#include <glib.h>
+
+G_BEGIN_DECLS
+
+typedef struct _TpTimer TpTimer;
+typedef void (*TpTimerFunc) (gpointer user_data);
+
+TpTimer *_tp_timer_add (guint interval_ms,
+    guint slack_ms,
+    TpTimerFunc callback,
+    gpointer user_data);
+
+void _tp_timer_cancel (TpTimer *timer);
+
+G_END_DECLS
+
+#endif
@@ -0,0 +1,242 @@
+/*
+ * Shared timer scheduler
+ *
+ * Copyright © 2014 Collabora Ltd.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include "config.h"
+
+#include "telepathy-glib/timer-internal.h"
+
+#include <telepathy-glib/heap.h>
+
+/*
+ * All the one-shot timers armed with _tp_timer_add() in a given main
+ * context share a single GSource, whose ready time is the deadline of the
+ * first timer. A connection manager with thousands of channels therefore
+ * has one timer source for the main loop to poll, not thousands.
+ */
+
+typedef struct {
+    GSource source;
+    /* borrowed: the context we are attached to */
+    GMainContext *context;
+    /* owned TpTimer, keyed by the monotonic time at which they fire */
+    TpHeap *timers;
+    /* TpTimer which are due and being dispatched */
+    GQueue firing;
+} TimerSource;
+
+struct _TpTimer {
+    TimerSource *source;
+    /* NULL once the timer is due */
+    TpHeapHandle *handle;
+    /* NULL if cancelled while due */
+    TpTimerFunc callback;
+    gpointer user_data;
+};
+
+/* GMainContext * => borrowed TimerSource * */
+static GHashTable *sources = NULL;
+G_LOCK_DEFINE_STATIC (sources);
+
+static void
+tp_timer_free (gpointer p)
+{
+  g_slice_free (TpTimer, p);
+}
+
+static void
+timer_source_update (TimerSource *self)
+{
+  if (tp_heap_size (self->timers) == 0)
+    g_source_set_ready_time ((GSource *) self, -1);
+  else
+    g_source_set_ready_time ((GSource *) self,
+        tp_heap_peek_first_key (self->timers));
+}
+
+static gboolean
+timer_source_dispatch (GSource *source,
+    GSourceFunc unused,
+    gpointer unused_data)
+{
+  TimerSource *self = (TimerSource *) source;
+  gint64 now = g_source_get_time (source);
+  TpTimer *timer;
+
+  /* Take every due timer out of the heap before calling any of them, so
+   * that timers armed by the callbacks wait for the next iteration. */
+  while (tp_heap_peek_first_key (self->timers) <= now)
+    {
+      timer = tp_heap_extract_first (self->timers);
+      timer->handle = NULL;
+      g_queue_push_tail (&self->firing, timer);
+    }
+
+  while ((timer = g_queue_pop_head (&self->firing)) != NULL)
+    {
+      if (timer->callback != NULL)
+        timer->callback (timer->user_data);
+
+      tp_timer_free (timer);
+    }
+
+  timer_source_update (self);
+  return TRUE;
+}
+
+static void
+timer_source_finalize (GSource *source)
+{
+  TimerSource *self = (TimerSource *) source;
+
+  G_LOCK (sources);
+
+  if (sources != NULL &&
+      g_hash_table_lookup (sources, self->context) == self)
+    g_hash_table_remove (sources, self->context);
+
+  G_UNLOCK (sources);
+
+  g_queue_foreach (&self->firing, (GFunc) tp_timer_free, NULL);
+  g_queue_clear (&self->firing);
+  tp_heap_destroy (self->timers);
+}
+
+static GSourceFuncs timer_source_funcs = {
+    NULL, /* prepare: we use the ready time instead */
+    NULL, /* check: likewise */
+    timer_source_dispatch,
+    timer_source_finalize
+};
+
+/* Returns the source for the thread-default main context, creating it if
+ * necessary. It stays attached until the context is destroyed. */
+static TimerSource *
+timer_source_get (void)
+{
+  GMainContext *context = g_main_context_ref_thread_default ();
+  TimerSource *self;
+
+  G_LOCK (sources);
+
+  if (sources == NULL)
+    sources = g_hash_table_new (NULL, NULL);
+
+  self = g_hash_table_lookup (sources, context);
+
+  if (self == NULL)
+    {
+      GSource *source = g_source_new (&timer_source_funcs,
+          sizeof (TimerSource));
+
+      self = (TimerSource *) source;
+      self->context = context;
+      self->timers = tp_heap_new_with_keys (tp_timer_free);
+      g_queue_init (&self->firing);
+
+      g_source_set_name (source, "TpTimer");
+      g_source_attach (source, context);
+      /* the context keeps it alive */
+      g_source_unref (source);
+
+      g_hash_table_insert (sources, context, self);
+    }
+
+  G_UNLOCK (sources);
+
+  g_main_context_unref (context);
+  return self;
+}
+
+/*
+ * _tp_timer_add:
+ * @interval_ms: the time to wait before calling @callback, in milliseconds
+ * @slack_ms: how much later than @interval_ms @callback may be called, so
+ *  that it can share a wakeup with other timers; 0 for no slack
+ * @callback: called once when the timer expires
+ * @user_data: data for @callback
+ *
+ * Arm a one-shot timer in the thread-default main context, like
+ * g_timeout_add() but without a GSource of its own.
+ *
+ * With a non-zero @slack_ms, the deadline is rounded up to a multiple of
+ * @slack_ms, so that timers with the same slack whose deadlines are close
+ * together expire in the same main loop iteration.
+ *
+ * Returns: a handle which may be passed to _tp_timer_cancel() until
+ *  @callback is called
+ */
+TpTimer *
+_tp_timer_add (guint interval_ms,
+    guint slack_ms,
+    TpTimerFunc callback,
+    gpointer user_data)
+{
+  TpTimer *timer;
+  gint64 deadline;
+
+  g_return_val_if_fail (callback != NULL, NULL);
+
+  deadline = g_get_monotonic_time () + (gint64) interval_ms * 1000;
+
+  if (slack_ms > 0)
+    {
+      gint64 slack = (gint64) slack_ms * 1000;
+
+      deadline = ((deadline + slack - 1) / slack) * slack;
+    }
+
+  timer = g_slice_new (TpTimer);
+  timer->source = timer_source_get ();
+  timer->callback = callback;
+  timer->user_data = user_data;
+  timer->handle = tp_heap_add_with_key (timer->source->timers, timer,
+      deadline);
+
+  if (tp_heap_peek_first (timer->source->timers) == timer)
+    timer_source_update (timer->source);
+
+  return timer;
+}
+
+/*
+ * _tp_timer_cancel:
+ * @timer: a timer which has not yet called its callback
+ *
+ * Cancel @timer. This must be called from the thread that armed @timer.
+ */
+void
+_tp_timer_cancel (TpTimer *timer)
+{
+  TimerSource *source;
+
+  g_return_if_fail (timer != NULL);
+
+  if (timer->handle == NULL)
+    {
+      /* due, but not yet dispatched: the dispatcher will free it */
+      timer->callback = NULL;
+      return;
+    }
+
+  source = timer->source;
+  tp_heap_remove_handle (source->timers, timer->handle);
+  tp_timer_free (timer);
+  timer_source_update (source);
+}
@@ -23,10 +23,13 @@
 #include <config.h>
 #include "telepathy-glib/tls-certificate.h"
 
+#include <string.h>
+
 #include <glib/gstdio.h>
 
 #include <telepathy-glib/_gen/tp-cli-tls-cert.h>
 
+#include <telepathy-glib/channel.h>
 #include <telepathy-glib/dbus.h>
 #include <telepathy-glib/dbus-internal.h>
 #include <telepathy-glib/enums.h>
@@ -34,9 +37,11 @@
 #include <telepathy-glib/interfaces.h>
 #include <telepathy-glib/proxy-internal.h>
 #include <telepathy-glib/proxy-subclass.h>
+#include <telepathy-glib/simple-client-factory.h>
 #include <telepathy-glib/util.h>
 #include <telepathy-glib/util-internal.h>
 #include <telepathy-glib/tls-certificate-rejection-internal.h>
+#include "telepathy-glib/channel-internal.h"
 #include "telepathy-glib/variant-util-internal.h"
 
 #define DEBUG_FLAG TP_DEBUG_TLS
@@ -81,6 +86,13 @@ enum {
 
 struct _TpTLSCertificatePrivate {
   TpProxy *parent;
+  /* the parent's factory, which owns the chain cache; may be NULL */
+  TpSimpleClientFactory *factory;
+  /* key into the chain cache, or NULL before CORE is prepared */
+  gchar *fingerprint;
+  /* the parent channel's Hostname, which decisions are recorded for;
+   * NULL if it is not known */
+  gchar *hostname;
 
   /* TLSCertificate properties */
   gchar *cert_type;
@@ -124,6 +136,238 @@ tp_tls_certificate_get_feature_quark_core (void)
   return g_quark_from_static_string ("tp-tls-certificate-feature-core");
 }
 
+/* Chains seen through the same client factory are cached by fingerprint,
+ * so that certificates presented by many accounts reconnecting to the
+ * same server share their data, their parsed form, the results of
+ * tp_tls_certificate_verify_async() for each reference identity and the
+ * last decision taken on them for each host name. */
+
+/* Verification results are reused for this long */
+#define CHAIN_VERIFICATION_LIFETIME (10 * 60 * G_USEC_PER_SEC)
+/* Beyond this many chains, the least recently used one is forgotten */
+#define MAX_CACHED_CHAINS 64
+
+typedef struct {
+    GTlsCertificateFlags flags;
+    /* monotonic time */
+    gint64 expires;
+} ChainVerification;
+
+typedef struct {
+    /* GBytes, shared by every TpTLSCertificate with this chain */
+    GPtrArray *cert_data;
+    /* owned, or NULL if the chain has not been parsed yet */
+    GTlsCertificate *parsed;
+    /* reference identity, or "" => owned ChainVerification */
+    GHashTable *verifications;
+    /* host name => TpTLSCertificateState, ACCEPTED or REJECTED */
+    GHashTable *decisions;
+    /* in ChainCache.lru; its data is the fingerprint */
+    GList *link;
+} CachedChain;
+
+typedef struct {
+    /* fingerprint => owned CachedChain */
+    GHashTable *chains;
+    /* borrowed fingerprints, least recently used first */
+    GQueue lru;
+} ChainCache;
+
+static void
+chain_verification_free (gpointer p)
+{
+  g_slice_free (ChainVerification, p);
+}
+
+static void
+cached_chain_free (gpointer p)
+{
+  CachedChain *chain = p;
+
+  g_ptr_array_unref (chain->cert_data);
+  g_clear_object (&chain->parsed);
+  g_hash_table_unref (chain->verifications);
+  g_hash_table_unref (chain->decisions);
+  g_slice_free (CachedChain, chain);
+}
+
+static void
+chain_cache_free (gpointer p)
+{
+  ChainCache *cache = p;
+
+  g_queue_clear (&cache->lru);
+  g_hash_table_unref (cache->chains);
+  g_slice_free (ChainCache, cache);
+}
+
+static GQuark
+chain_cache_quark (void)
+{
+  static GQuark quark = 0;
+
+  if (G_UNLIKELY (quark == 0))
+    quark = g_quark_from_static_string ("tp-tls-certificate-chain-cache");
+
+  return quark;
+}
+
+/* Returns: (transfer none): the factory's cache, or NULL */
+static ChainCache *
+chain_cache_get (TpSimpleClientFactory *factory,
+    gboolean create)
+{
+  ChainCache *cache;
+
+  if (factory == NULL)
+    return NULL;
+
+  cache = g_object_get_qdata ((GObject *) factory, chain_cache_quark ());
+
+  if (cache == NULL && create)
+    {
+      cache = g_slice_new0 (ChainCache);
+      cache->chains = g_hash_table_new_full (g_str_hash, g_str_equal, g_free,
+          cached_chain_free);
+      g_queue_init (&cache->lru);
+      g_object_set_qdata_full ((GObject *) factory, chain_cache_quark (),
+          cache, chain_cache_free);
+    }
+
+  return cache;
+}
+
+static CachedChain *
+chain_cache_lookup (TpSimpleClientFactory *factory,
+    const gchar *fingerprint)
+{
+  ChainCache *cache = chain_cache_get (factory, FALSE);
+  CachedChain *chain;
+
+  if (cache == NULL || fingerprint == NULL)
+    return NULL;
+
+  chain = g_hash_table_lookup (cache->chains, fingerprint);
+
+  if (chain != NULL)
+    {
+      /* it's now the most recently used */
+      g_queue_unlink (&cache->lru, chain->link);
+      g_queue_push_tail_link (&cache->lru, chain->link);
+    }
+
+  return chain;
+}
+
+static void
+chain_cache_insert (ChainCache *cache,
+    const gchar *fingerprint,
+    GPtrArray *cert_data)
+{
+  CachedChain *chain;
+  gchar *key;
+
+  if (g_hash_table_size (cache->chains) >= MAX_CACHED_CHAINS)
+    {
+      const gchar *oldest = g_queue_pop_head (&cache->lru);
+
+      DEBUG ("Too many cached certificate chains, forgetting %s", oldest);
+      g_hash_table_remove (cache->chains, oldest);
+    }
+
+  chain = g_slice_new0 (CachedChain);
+  chain->cert_data = g_ptr_array_ref (cert_data);
+  chain->verifications = g_hash_table_new_full (g_str_hash, g_str_equal,
+      g_free, chain_verification_free);
+  chain->decisions = g_hash_table_new_full (g_str_hash, g_str_equal,
+      g_free, NULL);
+
+  key = g_strdup (fingerprint);
+  g_queue_push_tail (&cache->lru, key);
+  chain->link = g_queue_peek_tail_link (&cache->lru);
+  g_hash_table_insert (cache->chains, key, chain);
+}
+
+static gboolean
+cached_chain_get_verification (CachedChain *chain,
+    const gchar *identity,
+    GTlsCertificateFlags *flags)
+{
+  ChainVerification *verification = g_hash_table_lookup (
+      chain->verifications, identity == NULL ? "" : identity);
+
+  if (verification == NULL ||
+      verification->expires < g_get_monotonic_time ())
+    return FALSE;
+
+  *flags = verification->flags;
+  return TRUE;
+}
+
+static void
+cached_chain_set_verification (CachedChain *chain,
+    const gchar *identity,
+    GTlsCertificateFlags flags)
+{
+  ChainVerification *verification = g_slice_new (ChainVerification);
+
+  verification->flags = flags;
+  verification->expires = g_get_monotonic_time () +
+      CHAIN_VERIFICATION_LIFETIME;
+
+  g_hash_table_insert (chain->verifications,
+      g_strdup (identity == NULL ? "" : identity), verification);
+}
+
+/* @cert_data is the CertificateChainData, an array of GArray of guchar */
+static gchar *
+chain_fingerprint (const gchar *cert_type,
+    const GPtrArray *cert_data)
+{
+  GChecksum *checksum = g_checksum_new (G_CHECKSUM_SHA256);
+  gchar *ret;
+  guint i;
+
+  if (cert_type == NULL)
+    cert_type = "";
+
+  /* include the NUL, so the type cannot run into the first certificate */
+  g_checksum_update (checksum, (const guchar *) cert_type,
+      strlen (cert_type) + 1);
+
+  for (i = 0; i < cert_data->len; i++)
+    {
+      GArray *arr = g_ptr_array_index (cert_data, i);
+      guint32 len = GUINT32_TO_BE (arr->len);
+
+      g_checksum_update (checksum, (const guchar *) &len, sizeof (len));
+      g_checksum_update (checksum, (const guchar *) arr->data, arr->len);
+    }
+
+  ret = g_strdup (g_checksum_get_string (checksum));
+  g_checksum_free (checksum);
+  return ret;
+}
+
+static void
+tp_tls_certificate_record_decision (TpTLSCertificate *self,
+    TpTLSCertificateState decision)
+{
+  CachedChain *chain;
+
+  /* accepting a chain for one server says nothing about another one that
+   * happens to present the same chain, so only share decisions taken for
+   * a known host name */
+  if (self->priv->hostname == NULL)
+    return;
+
+  chain = chain_cache_lookup (self->priv->factory, self->priv->fingerprint);
+
+  if (chain != NULL)
+    g_hash_table_insert (chain->decisions, g_strdup (self->priv->hostname),
+        GUINT_TO_POINTER (decision));
+}
+
 static void
 tp_tls_certificate_accepted_cb (TpTLSCertificate *self,
     gpointer unused G_GNUC_UNUSED,
@@ -207,6 +451,8 @@ tls_certificate_got_all_cb (TpProxy *proxy,
 {
   GPtrArray *cert_data;
   TpTLSCertificate *self = TP_TLS_CERTIFICATE (proxy);
+  ChainCache *cache;
+  CachedChain *chain = NULL;
   guint state;
   guint i;
 
@@ -263,16 +509,35 @@ tls_certificate_got_all_cb (TpProxy *proxy,
       return;
     }
 
-  self->priv->cert_data = g_ptr_array_new_with_free_func (
-      (GDestroyNotify) g_bytes_unref);
+  self->priv->fingerprint = chain_fingerprint (self->priv->cert_type,
+      cert_data);
+  cache = chain_cache_get (self->priv->factory, TRUE);
 
-  for (i = 0; i < cert_data->len; i++)
+  if (cache != NULL)
+    chain = chain_cache_lookup (self->priv->factory, self->priv->fingerprint);
+
+  if (chain != NULL)
     {
-      GArray *arr = g_ptr_array_index (cert_data, i);
-      GBytes *bytes;
+      DEBUG ("Reusing cached certificate chain %s", self->priv->fingerprint);
+      self->priv->cert_data = g_ptr_array_ref (chain->cert_data);
+    }
+  else
+    {
+      self->priv->cert_data = g_ptr_array_new_with_free_func (
+          (GDestroyNotify) g_bytes_unref);
 
-      bytes = g_bytes_new (arr->data, arr->len);
-      g_ptr_array_add (self->priv->cert_data, bytes);
+      for (i = 0; i < cert_data->len; i++)
+        {
+          GArray *arr = g_ptr_array_index (cert_data, i);
+          GBytes *bytes;
+
+          bytes = g_bytes_new (arr->data, arr->len);
+          g_ptr_array_add (self->priv->cert_data, bytes);
+        }
+
+      if (cache != NULL)
+        chain_cache_insert (cache, self->priv->fingerprint,
+            self->priv->cert_data);
     }
 
   DEBUG ("Got a certificate chain long %u, of type %s",
@@ -313,6 +578,23 @@ tp_tls_certificate_constructed (GObject *object)
 
   if (self->priv->parent != NULL)
     {
+      TpSimpleClientFactory *factory = tp_proxy_get_factory (
+          self->priv->parent);
+
+      if (factory != NULL)
+        self->priv->factory = g_object_ref (factory);
+
+      if (TP_IS_CHANNEL (self->priv->parent))
+        {
+          const gchar *hostname = tp_asv_get_string (
+              _tp_channel_get_immutable_properties (
+                  (TpChannel *) self->priv->parent),
+              TP_PROP_CHANNEL_TYPE_SERVER_TLS_CONNECTION_HOSTNAME);
+
+          if (!tp_str_empty (hostname))
+            self->priv->hostname = g_strdup (hostname);
+        }
+
       if (self->priv->parent->invalidated != NULL)
         {
           GError *invalidated = self->priv->parent->invalidated;
@@ -346,6 +628,9 @@ tp_tls_certificate_finalize (GObject *object)
   DEBUG ("%p", object);
 
   tp_clear_pointer (&self->priv->rejections, g_ptr_array_unref);
+  tp_clear_object (&priv->factory);
+  g_free (priv->fingerprint);
+  g_free (priv->hostname);
   g_free (priv->cert_type);
   if (priv->cert_data != NULL)
     g_ptr_array_unref (priv->cert_data);
@@ -537,6 +822,11 @@ cert_proxy_accept_cb (TpTLSCertificate *self,
       DEBUG ("Error was %s", error->message);
       g_simple_async_result_set_from_error (accept_result, error);
     }
+  else
+    {
+      tp_tls_certificate_record_decision (self,
+          TP_TLS_CERTIFICATE_STATE_ACCEPTED);
+    }
 
   g_simple_async_result_complete (accept_result);
 }
@@ -556,6 +846,11 @@ cert_proxy_reject_cb (TpTLSCertificate *self,
       DEBUG ("Error was %s", error->message);
       g_simple_async_result_set_from_error (reject_result, error);
     }
+  else
+    {
+      tp_tls_certificate_record_decision (self,
+          TP_TLS_CERTIFICATE_STATE_REJECTED);
+    }
 
   g_simple_async_result_complete (reject_result);
 }
@@ -807,6 +1102,337 @@ tp_tls_certificate_reject_finish (TpTLSCertificate *self,
   _tp_implement_finish_void (self, tp_tls_certificate_reject_async)
 }
 
+/**
+ * tp_tls_certificate_get_cached_decision:
+ * @self: a TLS certificate
+ *
+ * Return the last decision taken with tp_tls_certificate_accept_async() or
+ * tp_tls_certificate_reject_async() on any certificate with exactly the
+ * same type and chain as @self, presented for the same host name, whose
+ * channel was created by the same #TpSimpleClientFactory. For instance,
+ * a certificate handler can use this to avoid asking the user about the
+ * same certificate for each account that reconnects to a server.
+ *
+ * The host name is the #TpChannel's
+ * %TP_PROP_CHANNEL_TYPE_SERVER_TLS_CONNECTION_HOSTNAME immutable property.
+ * If the #TpTLSCertificate:parent is not a channel with that property,
+ * decisions taken on @self are not remembered, and this function always
+ * returns %TP_TLS_CERTIFICATE_STATE_PENDING.
+ *
+ * %TP_TLS_CERTIFICATE_FEATURE_CORE must have been prepared.
+ *
+ * Returns: %TP_TLS_CERTIFICATE_STATE_ACCEPTED or
+ *  %TP_TLS_CERTIFICATE_STATE_REJECTED, or
+ *  %TP_TLS_CERTIFICATE_STATE_PENDING if no decision is known
+ * Since: 0.UNRELEASED
+ */
+TpTLSCertificateState
+tp_tls_certificate_get_cached_decision (TpTLSCertificate *self)
+{
+  CachedChain *chain;
+
+  g_return_val_if_fail (TP_IS_TLS_CERTIFICATE (self),
+      TP_TLS_CERTIFICATE_STATE_PENDING);
+
+  if (self->priv->hostname == NULL)
+    return TP_TLS_CERTIFICATE_STATE_PENDING;
+
+  chain = chain_cache_lookup (self->priv->factory, self->priv->fingerprint);
+
+  if (chain == NULL)
+    return TP_TLS_CERTIFICATE_STATE_PENDING;
+
+  return GPOINTER_TO_UINT (g_hash_table_lookup (chain->decisions,
+        self->priv->hostname));
+}
+
+typedef struct {
+    /* owned, may be NULL */
+    TpSimpleClientFactory *factory;
+    gchar *fingerprint;
+    /* may be NULL */
+    gchar *identity;
+    /* GBytes; only read in the worker thread */
+    GPtrArray *cert_data;
+    /* owned; set by the worker thread if the cache did not have it */
+    GTlsCertificate *parsed;
+    GTlsCertificateFlags flags;
+} VerifyData;
+
+static void
+verify_data_free (gpointer p)
+{
+  VerifyData *data = p;
+
+  g_clear_object (&data->factory);
+  g_free (data->fingerprint);
+  g_free (data->identity);
+  g_ptr_array_unref (data->cert_data);
+  g_clear_object (&data->parsed);
+  g_slice_free (VerifyData, data);
+}
+
+/* Runs in a worker thread. */
+static GTlsCertificate *
+parse_chain (GTlsBackend *backend,
+    const GPtrArray *cert_data,
+    GError **error)
+{
+  GTlsCertificate *issuer = NULL;
+  guint i;
+
+  if (cert_data->len == 0)
+    {
+      g_set_error (error, TP_ERROR, TP_ERROR_INVALID_ARGUMENT,
+          "The certificate chain is empty");
+      return NULL;
+    }
+
+  /* The chain starts with the peer's certificate, and each certificate is
+   * issued by the next one, so build it from the end */
+  for (i = cert_data->len; i > 0; i--)
+    {
+      GByteArray *der = g_bytes_unref_to_array (
+          g_bytes_ref (g_ptr_array_index (cert_data, i - 1)));
+      GTlsCertificate *cert;
+
+      cert = g_initable_new (g_tls_backend_get_certificate_type (backend),
+          NULL, error,
+          "certificate", der,
+          "issuer", issuer,
+          NULL);
+
+      g_byte_array_unref (der);
+      g_clear_object (&issuer);
+
+      if (cert == NULL)
+        return NULL;
+
+      issuer = cert;
+    }
+
+  return issuer;
+}
+
+/* Runs in a worker thread. */
+static void
+verify_chain_thread (GTask *task,
+    gpointer source_object,
+    gpointer task_data,
+    GCancellable *cancellable)
+{
+  VerifyData *data = task_data;
+  GTlsBackend *backend = g_tls_backend_get_default ();
+  GTlsDatabase *database;
+  GSocketConnectable *identity = NULL;
+  GError *error = NULL;
+
+  if (data->parsed == NULL)
+    {
+      data->parsed = parse_chain (backend, data->cert_data, &error);
+
+      if (data->parsed == NULL)
+        {
+          g_task_return_error (task, error);
+          return;
+        }
+    }
+
+  database = g_tls_backend_get_default_database (backend);
+
+  if (database == NULL)
+    {
+      g_task_return_new_error (task, TP_ERROR, TP_ERROR_NOT_AVAILABLE,
+          "No TLS certificate database is available");
+      return;
+    }
+
+  if (data->identity != NULL)
+    identity = g_network_address_new (data->identity, 0);
+
+  data->flags = g_tls_database_verify_chain (database, data->parsed,
+      G_TLS_DATABASE_PURPOSE_AUTHENTICATE_SERVER, identity, NULL,
+      G_TLS_DATABASE_VERIFY_NONE, cancellable, &error);
+
+  if (error != NULL)
+    g_task_return_error (task, error);
+  else
+    g_task_return_boolean (task, TRUE);
+
+  g_clear_object (&identity);
+  g_object_unref (database);
+}
+
+static void
+verify_chain_cb (GObject *source,
+    GAsyncResult *result,
+    gpointer user_data)
+{
+  GSimpleAsyncResult *verify_result = user_data;
+  VerifyData *data = g_task_get_task_data (G_TASK (result));
+  GError *error = NULL;
+
+  if (g_task_propagate_boolean (G_TASK (result), &error))
+    {
+      CachedChain *chain = chain_cache_lookup (data->factory,
+          data->fingerprint);
+
+      DEBUG ("Verified chain %s for '%s': flags 0x%x", data->fingerprint,
+          data->identity == NULL ? "" : data->identity, data->flags);
+
+      /* the cache might have been emptied in the meantime */
+      if (chain != NULL)
+        {
+          if (chain->parsed == NULL)
+            chain->parsed = g_object_ref (data->parsed);
+
+          cached_chain_set_verification (chain, data->identity, data->flags);
+        }
+
+      g_simple_async_result_set_op_res_gssize (verify_result, data->flags);
+    }
+  else
+    {
+      DEBUG ("Failed to verify chain %s: %s", data->fingerprint,
+          error->message);
+      g_simple_async_result_take_error (verify_result, error);
+    }
+
+  g_simple_async_result_complete (verify_result);
+  g_object_unref (verify_result);
+}
+
+/**
+ * tp_tls_certificate_verify_async:
+ * @self: a TLS certificate
+ * @reference_identity: (allow-none): the host name that the certificate
+ *  is expected to match, or %NULL to skip that check
+ * @cancellable: (allow-none): optional #GCancellable object, %NULL to ignore
+ * @callback: called on success or failure
+ * @user_data: user data for the callback
+ *
+ * Verify an X.509 certificate chain against the system's default
+ * #GTlsDatabase, as a server certificate for @reference_identity.
+ * The chain is parsed and checked in a worker thread. In or after
+ * @callback, call tp_tls_certificate_verify_finish() to get the result.
+ *
+ * The parsed chain and the result for @reference_identity are remembered
+ * for a few minutes, and shared with any certificate with exactly the same
+ * chain whose connection or channel was created by the same
+ * #TpSimpleClientFactory.
+ * When many accounts reconnect to the same server, verification
+ * only happens once.
+ *
+ * %TP_TLS_CERTIFICATE_FEATURE_CORE must have been prepared.
+ *
+ * Since: 0.UNRELEASED
+ */
+void
+tp_tls_certificate_verify_async (TpTLSCertificate *self,
+    const gchar *reference_identity,
+    GCancellable *cancellable,
+    GAsyncReadyCallback callback,
+    gpointer user_data)
+{
+  GSimpleAsyncResult *result;
+  GTlsCertificateFlags flags;
+  CachedChain *chain;
+  VerifyData *data;
+  GTask *task;
+
+  g_return_if_fail (TP_IS_TLS_CERTIFICATE (self));
+
+  result = g_simple_async_result_new ((GObject *) self, callback,
+      user_data, tp_tls_certificate_verify_async);
+
+  if (tp_str_empty (reference_identity))
+    reference_identity = NULL;
+
+  if (self->priv->cert_data == NULL)
+    {
+      g_simple_async_result_set_error (result, TP_ERROR, TP_ERROR_NOT_YET,
+          "TP_TLS_CERTIFICATE_FEATURE_CORE has not been prepared");
+      goto complete_in_idle;
+    }
+
+  if (tp_strdiff (self->priv->cert_type, "x509"))
+    {
+      g_simple_async_result_set_error (result, TP_ERROR,
+          TP_ERROR_NOT_IMPLEMENTED,
+          "Only X.509 certificates can be verified, not '%s'",
+          self->priv->cert_type);
+      goto complete_in_idle;
+    }
+
+  chain = chain_cache_lookup (self->priv->factory, self->priv->fingerprint);
+
+  if (chain != NULL &&
+      cached_chain_get_verification (chain, reference_identity, &flags))
+    {
+      DEBUG ("Reusing verification of chain %s", self->priv->fingerprint);
+      g_simple_async_result_set_op_res_gssize (result, flags);
+      goto complete_in_idle;
+    }
+
+  data = g_slice_new0 (VerifyData);
+
+  if (self->priv->factory != NULL)
+    data->factory = g_object_ref (self->priv->factory);
+
+  data->fingerprint = g_strdup (self->priv->fingerprint);
+  data->identity = g_strdup (reference_identity);
+  data->cert_data = g_ptr_array_ref (self->priv->cert_data);
+
+  if (chain != NULL && chain->parsed != NULL)
+    data->parsed = g_object_ref (chain->parsed);
+
+  /* the callback owns @result */
+  task = g_task_new (self, cancellable, verify_chain_cb, result);
+  g_task_set_task_data (task, data, verify_data_free);
+  g_task_run_in_thread (task, verify_chain_thread);
+  g_object_unref (task);
+  return;
+
+complete_in_idle:
+  g_simple_async_result_complete_in_idle (result);
+  g_object_unref (result);
+}
+
+/**
+ * tp_tls_certificate_verify_finish:
+ * @self: a TLS certificate
+ * @result: the result passed to the callback by
+ *  tp_tls_certificate_verify_async()
+ * @flags: (out): used to return the problems found with the certificate,
+ *  or 0 if it is trusted
+ * @error: used to raise an error if %FALSE is returned
+ *
+ * Check the result of tp_tls_certificate_verify_async().
+ *
+ * Returns: %TRUE if the chain could be verified, in which case @flags
+ *  is set; %FALSE if it could not be parsed or checked at all
+ * Since: 0.UNRELEASED
+ */
+gboolean
+tp_tls_certificate_verify_finish (TpTLSCertificate *self,
+    GAsyncResult *result,
+    GTlsCertificateFlags *flags,
+    GError **error)
+{
+  GSimpleAsyncResult *simple = (GSimpleAsyncResult *) result;
+
+  g_return_val_if_fail (g_simple_async_result_is_valid (result,
+        (GObject *) self, tp_tls_certificate_verify_async), FALSE);
+
+  if (g_simple_async_result_propagate_error (simple, error))
+    return FALSE;
+
+  if (flags != NULL)
+    *flags = g_simple_async_result_get_op_res_gssize (simple);
+
+  return TRUE;
+}
+
 #include <telepathy-glib/_gen/tp-cli-tls-cert-body.h>
 
 /**
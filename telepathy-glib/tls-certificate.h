@@ -126,6 +126,22 @@ GPtrArray * tp_tls_certificate_get_cert_data (TpTLSCertificate *self);
 _TP_AVAILABLE_IN_0_20
 TpTLSCertificateState tp_tls_certificate_get_state (TpTLSCertificate *self);
 
+_TP_AVAILABLE_IN_UNRELEASED
+TpTLSCertificateState tp_tls_certificate_get_cached_decision (
+    TpTLSCertificate *self);
+
+_TP_AVAILABLE_IN_UNRELEASED
+void tp_tls_certificate_verify_async (TpTLSCertificate *self,
+    const gchar *reference_identity,
+    GCancellable *cancellable,
+    GAsyncReadyCallback callback,
+    gpointer user_data);
+_TP_AVAILABLE_IN_UNRELEASED
+gboolean tp_tls_certificate_verify_finish (TpTLSCertificate *self,
+    GAsyncResult *result,
+    GTlsCertificateFlags *flags,
+    GError **error);
+
 G_END_DECLS
 
 #endif /* multiple-inclusion guard */
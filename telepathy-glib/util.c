@@ -696,15 +696,6 @@ tp_mixin_class_get_offset (gpointer klass,
 }
 
 
-static inline gboolean
-_esc_ident_bad (gchar c, gboolean is_first)
-{
-  return ((c < 'a' || c > 'z') &&
-          (c < 'A' || c > 'Z') &&
-          (c < '0' || c > '9' || is_first));
-}
-
-
 /**
  * tp_escape_as_identifier:
  * @name: The string to be escaped
@@ -732,10 +723,10 @@ _esc_ident_bad (gchar c, gboolean is_first)
 gchar *
 tp_escape_as_identifier (const gchar *name)
 {
-  gboolean bad = FALSE;
-  size_t len = 0;
-  GString *op;
-  const gchar *ptr, *first_ok;
+  static const gchar hex_digits[] = "0123456789abcdef";
+  gsize n_bad = 0;
+  gchar *ret, *out;
+  const gchar *ptr;
 
   g_return_val_if_fail (name != NULL, NULL);
 
@@ -743,46 +734,42 @@ tp_escape_as_identifier (const gchar *name)
   if (name[0] == '\0')
     return g_strdup ("_");
 
-  for (ptr = name; *ptr; ptr++)
+  /* g_ascii_isalnum() is a table lookup, and is FALSE for non-ASCII bytes */
+  if (g_ascii_isdigit (name[0]))
+    n_bad++;
+
+  for (ptr = name + n_bad; *ptr != '\0'; ptr++)
     {
-      if (_esc_ident_bad (*ptr, ptr == name))
-        {
-          bad = TRUE;
-          len += 3;
-        }
-      else
-        len++;
+      if (!g_ascii_isalnum (*ptr))
+        n_bad++;
     }
 
   /* fast path if it's clean */
-  if (!bad)
-    return g_strdup (name);
+  if (n_bad == 0)
+    return g_memdup (name, ptr - name + 1);
+
+  /* each bad character becomes "_xx" */
+  ret = g_malloc ((ptr - name) + 2 * n_bad + 1);
+  out = ret;
 
-  /* If strictly less than ptr, first_ok is the first uncopied safe character.
-   */
-  first_ok = name;
-  op = g_string_sized_new (len);
-  for (ptr = name; *ptr; ptr++)
+  for (ptr = name; *ptr != '\0'; ptr++)
     {
-      if (_esc_ident_bad (*ptr, ptr == name))
+      if (g_ascii_isalnum (*ptr) && (ptr != name || !g_ascii_isdigit (*ptr)))
         {
-          /* copy preceding safe characters if any */
-          if (first_ok < ptr)
-            {
-              g_string_append_len (op, first_ok, ptr - first_ok);
-            }
-          /* escape the unsafe character */
-          g_string_append_printf (op, "_%02x", (unsigned char)(*ptr));
-          /* restart after it */
-          first_ok = ptr + 1;
+          *out++ = *ptr;
+        }
+      else
+        {
+          guchar c = (guchar) *ptr;
+
+          *out++ = '_';
+          *out++ = hex_digits[c >> 4];
+          *out++ = hex_digits[c & 0xf];
         }
     }
-  /* copy trailing safe characters if any */
-  if (first_ok < ptr)
-    {
-      g_string_append_len (op, first_ok, ptr - first_ok);
-    }
-  return g_string_free (op, FALSE);
+
+  *out = '\0';
+  return ret;
 }
 
 
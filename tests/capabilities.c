@@ -1187,6 +1187,58 @@ test_classes_variant (Test *test,
   g_object_unref (caps);
 }
 
+static void
+test_shared (Test *test,
+    gconstpointer data G_GNUC_UNUSED)
+{
+  TpCapabilities *caps, *caps2, *other;
+  GPtrArray *classes, *classes2;
+
+  classes = g_ptr_array_sized_new (2);
+  add_text_chat_class (classes, TP_HANDLE_TYPE_CONTACT);
+  add_ft_class (classes, NULL);
+
+  classes2 = g_ptr_array_sized_new (2);
+  add_text_chat_class (classes2, TP_HANDLE_TYPE_CONTACT);
+  add_ft_class (classes2, NULL);
+
+  /* identical classes give the same object */
+  caps = _tp_capabilities_new (classes, TRUE);
+  caps2 = _tp_capabilities_new (classes2, TRUE);
+  g_assert (caps == caps2);
+  g_assert (tp_capabilities_supports_text_chats (caps));
+  g_assert (tp_capabilities_supports_file_transfer (caps));
+  g_object_unref (caps2);
+
+  /* ... but contact-specific capabilities aren't shared with the
+   * connection's */
+  other = _tp_capabilities_new (classes, FALSE);
+  g_assert (other != caps);
+  g_assert (!tp_capabilities_is_specific_to_contact (other));
+  g_object_unref (other);
+
+  /* different classes give a different object */
+  add_text_chat_class (classes2, TP_HANDLE_TYPE_ROOM);
+  other = _tp_capabilities_new (classes2, TRUE);
+  g_assert (other != caps);
+  g_assert (!tp_capabilities_supports_text_chatrooms (caps));
+  g_assert (tp_capabilities_supports_text_chatrooms (other));
+  g_object_unref (other);
+
+  /* once the last reference has gone, a new object is made */
+  g_object_add_weak_pointer ((GObject *) caps, (gpointer *) &caps);
+  g_object_unref (caps);
+  g_assert (caps == NULL);
+
+  caps = _tp_capabilities_new (classes, TRUE);
+  g_assert (caps != NULL);
+  g_assert (tp_capabilities_supports_text_chats (caps));
+  g_object_unref (caps);
+
+  g_boxed_free (TP_ARRAY_TYPE_REQUESTABLE_CHANNEL_CLASS_LIST, classes);
+  g_boxed_free (TP_ARRAY_TYPE_REQUESTABLE_CHANNEL_CLASS_LIST, classes2);
+}
+
 int
 main (int argc,
     char **argv)
@@ -1212,6 +1264,8 @@ main (int argc,
       test_supports_call, NULL);
   g_test_add (TEST_PREFIX "classes-variant", Test, NULL, setup,
       test_classes_variant, NULL);
+  g_test_add (TEST_PREFIX "shared", Test, NULL, setup,
+      test_shared, NULL);
 
   return g_test_run ();
 }
@@ -59,6 +59,64 @@ test_contact_search_result (void)
   g_object_unref (result);
 }
 
+static void
+add_raw_field (GPtrArray *raw,
+    const gchar *name,
+    const gchar *value)
+{
+  const gchar *parameters[] = { NULL };
+  const gchar *values[] = { value, NULL };
+
+  g_ptr_array_add (raw, tp_value_array_build (3,
+        G_TYPE_STRING, name,
+        G_TYPE_STRV, parameters,
+        G_TYPE_STRV, values,
+        G_TYPE_INVALID));
+}
+
+static void
+test_raw_fields (void)
+{
+  TpContactSearchResult *result;
+  TpContactInfoField *field;
+  GHashTable *batch;
+  GPtrArray *raw;
+  GList *fields;
+
+  raw = g_ptr_array_new_with_free_func ((GDestroyNotify) tp_value_array_free);
+  add_raw_field (raw, "fn", "Joe");
+  add_raw_field (raw, "tel", "123");
+  add_raw_field (raw, "tel", "456");
+
+  batch = g_hash_table_new_full (g_str_hash, g_str_equal, g_free,
+      (GDestroyNotify) g_ptr_array_unref);
+  g_hash_table_insert (batch, g_strdup ("id"), raw);
+
+  result = _tp_contact_search_result_new ("id");
+  _tp_contact_search_result_set_raw_fields (result, batch, raw);
+
+  /* the result keeps the raw fields alive */
+  g_hash_table_unref (batch);
+
+  /* fields are in the reverse of the order they were received in */
+  fields = tp_contact_search_result_dup_fields (result);
+  g_assert_cmpuint (g_list_length (fields), ==, 3);
+  field = fields->data;
+  g_assert_cmpstr (field->field_name, ==, "tel");
+  g_assert_cmpstr (field->field_value[0], ==, "456");
+  field = fields->next->next->data;
+  g_assert_cmpstr (field->field_name, ==, "fn");
+  g_assert_cmpstr (field->field_value[0], ==, "Joe");
+  tp_contact_info_list_free (fields);
+
+  field = tp_contact_search_result_get_field (result, "fn");
+  g_assert (field != NULL);
+  g_assert_cmpstr (field->field_value[0], ==, "Joe");
+  g_assert (field->field_value[1] == NULL);
+
+  g_object_unref (result);
+}
+
 int
 main (int argc,
     char **argv)
@@ -70,6 +128,7 @@ main (int argc,
 
   g_test_add_func ("/contact-search/contact-search-result",
       test_contact_search_result);
+  g_test_add_func ("/contact-search/raw-fields", test_raw_fields);
 
   return g_test_run ();
 }
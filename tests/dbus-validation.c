@@ -0,0 +1,369 @@
+/* Cross-check the D-Bus name validators and tp_escape_as_identifier()
+ * against straightforward reference implementations.
+ *
+ * Copyright © 2014 Collabora Ltd. <http://www.collabora.co.uk/>
+ *
+ * Copying and distribution of this file, with or without modification,
+ * are permitted in any medium without royalty provided the copyright
+ * notice and this notice are preserved.
+ */
+
+#include "config.h"
+
+#include <string.h>
+
+#include <telepathy-glib/telepathy-glib.h>
+
+/* Reference implementations: these are the per-character versions that
+ * telepathy-glib used before the validators became table-driven. */
+
+static gboolean
+ref_check_bus_name (const gchar *name,
+    TpDBusNameType allow_types)
+{
+  gboolean dot = FALSE;
+  gboolean unique;
+  gchar last;
+  const gchar *ptr;
+
+  if (name[0] == '\0')
+    return FALSE;
+
+  if (!tp_strdiff (name, "org.freedesktop.DBus"))
+    return ((allow_types & TP_DBUS_NAME_TYPE_BUS_DAEMON) != 0);
+
+  unique = (name[0] == ':');
+
+  if (unique && (allow_types & TP_DBUS_NAME_TYPE_UNIQUE) == 0)
+    return FALSE;
+
+  if (!unique && (allow_types & TP_DBUS_NAME_TYPE_WELL_KNOWN) == 0)
+    return FALSE;
+
+  if (strlen (name) > 255)
+    return FALSE;
+
+  last = '\0';
+
+  for (ptr = name + (unique ? 1 : 0); *ptr != '\0'; ptr++)
+    {
+      if (*ptr == '.')
+        {
+          dot = TRUE;
+
+          if (last == '.' || last == '\0')
+            return FALSE;
+        }
+      else if (g_ascii_isdigit (*ptr))
+        {
+          if (!unique && (last == '.' || last == '\0'))
+            return FALSE;
+        }
+      else if (!g_ascii_isalpha (*ptr) && *ptr != '_' && *ptr != '-')
+        {
+          return FALSE;
+        }
+
+      last = *ptr;
+    }
+
+  return (last != '.' && dot);
+}
+
+static gboolean
+ref_check_interface_name (const gchar *name)
+{
+  gboolean dot = FALSE;
+  gchar last;
+  const gchar *ptr;
+
+  if (name[0] == '\0' || strlen (name) > 255)
+    return FALSE;
+
+  last = '\0';
+
+  for (ptr = name; *ptr != '\0'; ptr++)
+    {
+      if (*ptr == '.')
+        {
+          dot = TRUE;
+
+          if (last == '.' || last == '\0')
+            return FALSE;
+        }
+      else if (g_ascii_isdigit (*ptr))
+        {
+          if (last == '\0' || last == '.')
+            return FALSE;
+        }
+      else if (!g_ascii_isalpha (*ptr) && *ptr != '_')
+        {
+          return FALSE;
+        }
+
+      last = *ptr;
+    }
+
+  return (last != '.' && dot);
+}
+
+static gboolean
+ref_check_member_name (const gchar *name)
+{
+  const gchar *ptr;
+
+  if (name[0] == '\0' || strlen (name) > 255)
+    return FALSE;
+
+  for (ptr = name; *ptr != '\0'; ptr++)
+    {
+      if (g_ascii_isdigit (*ptr))
+        {
+          if (ptr == name)
+            return FALSE;
+        }
+      else if (!g_ascii_isalpha (*ptr) && *ptr != '_')
+        {
+          return FALSE;
+        }
+    }
+
+  return TRUE;
+}
+
+static gboolean
+ref_check_object_path (const gchar *path)
+{
+  const gchar *ptr;
+
+  if (path[0] != '/')
+    return FALSE;
+
+  if (path[1] == '\0')
+    return TRUE;
+
+  for (ptr = path + 1; *ptr != '\0'; ptr++)
+    {
+      if (*ptr == '/')
+        {
+          if (ptr[-1] == '/')
+            return FALSE;
+        }
+      else if (!g_ascii_isalnum (*ptr) && *ptr != '_')
+        {
+          return FALSE;
+        }
+    }
+
+  return (ptr[-1] != '/');
+}
+
+static gchar *
+ref_escape_as_identifier (const gchar *name)
+{
+  GString *op;
+  const gchar *ptr;
+
+  if (name[0] == '\0')
+    return g_strdup ("_");
+
+  op = g_string_new ("");
+
+  for (ptr = name; *ptr != '\0'; ptr++)
+    {
+      gchar c = *ptr;
+
+      if ((c < 'a' || c > 'z') &&
+          (c < 'A' || c > 'Z') &&
+          (c < '0' || c > '9' || ptr == name))
+        g_string_append_printf (op, "_%02x", (unsigned char) c);
+      else
+        g_string_append_c (op, c);
+    }
+
+  return g_string_free (op, FALSE);
+}
+
+static const TpDBusNameType name_types[] = {
+    TP_DBUS_NAME_TYPE_UNIQUE,
+    TP_DBUS_NAME_TYPE_WELL_KNOWN,
+    TP_DBUS_NAME_TYPE_BUS_DAEMON,
+    TP_DBUS_NAME_TYPE_NOT_BUS_DAEMON,
+    TP_DBUS_NAME_TYPE_WELL_KNOWN | TP_DBUS_NAME_TYPE_BUS_DAEMON,
+    TP_DBUS_NAME_TYPE_ANY
+};
+
+static void
+check_one (const gchar *s)
+{
+  GError *error = NULL;
+  gchar *escaped, *ref_escaped;
+  gboolean ok;
+  guint i;
+
+  for (i = 0; i < G_N_ELEMENTS (name_types); i++)
+    {
+      ok = tp_dbus_check_valid_bus_name (s, name_types[i], &error);
+
+      if (ok != ref_check_bus_name (s, name_types[i]))
+        g_error ("bus name \"%s\", types %u: got %d", s, name_types[i], ok);
+
+      if (ok)
+        g_assert_no_error (error);
+      else
+        g_assert_error (error, TP_DBUS_ERRORS,
+            TP_DBUS_ERROR_INVALID_BUS_NAME);
+
+      g_clear_error (&error);
+    }
+
+  ok = tp_dbus_check_valid_interface_name (s, &error);
+
+  if (ok != ref_check_interface_name (s))
+    g_error ("interface name \"%s\": got %d", s, ok);
+
+  if (ok)
+    g_assert_no_error (error);
+  else
+    g_assert_error (error, TP_DBUS_ERRORS,
+        TP_DBUS_ERROR_INVALID_INTERFACE_NAME);
+
+  g_clear_error (&error);
+
+  ok = tp_dbus_check_valid_member_name (s, &error);
+
+  if (ok != ref_check_member_name (s))
+    g_error ("member name \"%s\": got %d", s, ok);
+
+  if (ok)
+    g_assert_no_error (error);
+  else
+    g_assert_error (error, TP_DBUS_ERRORS,
+        TP_DBUS_ERROR_INVALID_MEMBER_NAME);
+
+  g_clear_error (&error);
+
+  ok = tp_dbus_check_valid_object_path (s, &error);
+
+  if (ok != ref_check_object_path (s))
+    g_error ("object path \"%s\": got %d", s, ok);
+
+  if (ok)
+    g_assert_no_error (error);
+  else
+    g_assert_error (error, TP_DBUS_ERRORS,
+        TP_DBUS_ERROR_INVALID_OBJECT_PATH);
+
+  g_clear_error (&error);
+
+  escaped = tp_escape_as_identifier (s);
+  ref_escaped = ref_escape_as_identifier (s);
+  g_assert_cmpstr (escaped, ==, ref_escaped);
+  g_free (escaped);
+  g_free (ref_escaped);
+}
+
+/* Characters with interesting meanings to at least one validator, plus
+ * one each of "boring" valid and invalid characters. */
+static const gchar alphabet[] = "aZ_0-./:\xe9";
+
+static void
+test_exhaustive (void)
+{
+  const guint n = sizeof (alphabet) - 1;
+  gchar buf[6];
+  guint len;
+
+  /* every string over @alphabet of length 0 to 5 */
+  for (len = 0; len < sizeof (buf); len++)
+    {
+      guint total = 1;
+      guint i, j;
+
+      for (j = 0; j < len; j++)
+        total *= n;
+
+      for (i = 0; i < total; i++)
+        {
+          guint k = i;
+
+          for (j = 0; j < len; j++)
+            {
+              buf[j] = alphabet[k % n];
+              k /= n;
+            }
+
+          buf[len] = '\0';
+          check_one (buf);
+        }
+    }
+
+  check_one ("org.freedesktop.DBus");
+  check_one (":org.freedesktop.DBus");
+  check_one ("org.freedesktop.DBus.Foo");
+}
+
+static void
+test_random (void)
+{
+  GString *s = g_string_new ("");
+  guint i;
+
+  for (i = 0; i < 20000; i++)
+    {
+      gint len;
+      gint j;
+
+      g_string_truncate (s, 0);
+
+      if (g_test_rand_int_range (0, 10) == 0)
+        {
+          /* Something around the length limit, made of elements that are
+           * usually valid, so that the length check itself gets tested */
+          gchar separator = (g_test_rand_bit () ? '.' : '/');
+
+          len = g_test_rand_int_range (250, 260);
+
+          for (j = 0; j < len; j++)
+            {
+              if (j % 8 == 7)
+                g_string_append_c (s, separator);
+              else
+                g_string_append_c (s, "aZ_0"[g_test_rand_int_range (0, 4)]);
+            }
+        }
+      else
+        {
+          len = g_test_rand_int_range (0, 40);
+
+          for (j = 0; j < len; j++)
+            {
+              gchar c;
+
+              if (g_test_rand_int_range (0, 20) == 0)
+                c = (gchar) g_test_rand_int_range (1, 256);
+              else
+                c = alphabet[g_test_rand_int_range (0,
+                    sizeof (alphabet) - 1)];
+
+              g_string_append_c (s, c);
+            }
+        }
+
+      check_one (s->str);
+    }
+
+  g_string_free (s, TRUE);
+}
+
+int
+main (int argc,
+    char **argv)
+{
+  g_test_init (&argc, &argv, NULL);
+
+  g_test_add_func ("/dbus-validation/exhaustive", test_exhaustive);
+  g_test_add_func ("/dbus-validation/random", test_random);
+
+  return g_test_run ();
+}
@@ -926,6 +926,78 @@ test_connection (Test *test,
   g_hash_table_unref (change);
 }
 
+static void
+test_coalesce (Test *test,
+    gconstpointer data G_GNUC_UNUSED)
+{
+  GQuark account_features[] = { TP_ACCOUNT_FEATURE_CORE, 0 };
+  GHashTable *change = tp_asv_new (NULL, NULL);
+
+  test->account = tp_account_new (test->dbus, ACCOUNT_PATH, NULL);
+  g_assert (test->account != NULL);
+
+  tp_proxy_prepare_async (test->account, account_features,
+      account_prepare_cb, test);
+  g_main_loop_run (test->mainloop);
+
+  g_assert_cmpuint (tp_account_get_change_coalescing (test->account), ==, 0);
+
+  /* re-stating the current value is not a change */
+
+  test_set_up_account_notify (test);
+  tp_asv_set_string (change, "Nickname",
+      tp_account_get_nickname (test->account));
+  tp_svc_account_emit_account_property_changed (test->account_service, change);
+  g_hash_table_remove_all (change);
+
+  tp_tests_proxy_run_until_dbus_queue_processed (test->account);
+  g_assert_cmpuint (test_get_times_notified (test, "nickname"), ==, 0);
+
+  /* several changes within the interval are notified once */
+
+  tp_account_set_change_coalescing (test->account, 100);
+  g_assert_cmpuint (tp_account_get_change_coalescing (test->account), ==,
+      100);
+
+  test_set_up_account_notify (test);
+  tp_asv_set_string (change, "Nickname", "Badger");
+  tp_svc_account_emit_account_property_changed (test->account_service, change);
+  tp_asv_set_string (change, "Nickname", "Mushroom");
+  tp_asv_set_string (change, "DisplayName", "Snake");
+  tp_svc_account_emit_account_property_changed (test->account_service, change);
+  g_hash_table_remove_all (change);
+
+  tp_tests_proxy_run_until_dbus_queue_processed (test->account);
+
+  /* the new values are visible straight away... */
+  g_assert_cmpstr (tp_account_get_nickname (test->account), ==, "Mushroom");
+  g_assert_cmpstr (tp_account_get_display_name (test->account), ==, "Snake");
+  /* ... but not notified yet */
+  g_assert_cmpuint (test_get_times_notified (test, "nickname"), ==, 0);
+
+  while (test_get_times_notified (test, "nickname") < 1)
+    g_main_context_iteration (NULL, TRUE);
+
+  g_assert_cmpuint (test_get_times_notified (test, "nickname"), ==, 1);
+  g_assert_cmpuint (test_get_times_notified (test, "display-name"), ==, 1);
+
+  /* turning coalescing off flushes anything pending */
+
+  test_set_up_account_notify (test);
+  tp_asv_set_string (change, "Nickname", "Badger");
+  tp_svc_account_emit_account_property_changed (test->account_service, change);
+  g_hash_table_remove_all (change);
+
+  tp_tests_proxy_run_until_dbus_queue_processed (test->account);
+  g_assert_cmpuint (test_get_times_notified (test, "nickname"), ==, 0);
+
+  tp_account_set_change_coalescing (test->account, 0);
+  g_assert_cmpuint (test_get_times_notified (test, "nickname"), ==, 1);
+  g_assert_cmpstr (tp_account_get_nickname (test->account), ==, "Badger");
+
+  g_hash_table_unref (change);
+}
+
 int
 main (int argc,
       char **argv)
@@ -988,6 +1060,8 @@ main (int argc,
 
   g_test_add ("/account/connection", Test, NULL, setup_service,
               test_connection, teardown_service);
+  g_test_add ("/account/coalesce", Test, NULL, setup_service,
+              test_coalesce, teardown_service);
 
   g_test_add ("/account/storage", Test, "first", setup_service, test_storage,
       teardown_service);
@@ -832,6 +832,15 @@ channel_invalidated_cb (TpChannel *channel,
   g_main_loop_quit (test->mainloop);
 }
 
+static void
+count_handled_channel_cb (TpBaseClient *client,
+    TpChannel *channel,
+    guint *count)
+{
+  g_assert (TP_IS_CHANNEL (channel));
+  (*count)++;
+}
+
 static void
 test_handler (Test *test,
     gconstpointer data G_GNUC_UNUSED)
@@ -843,6 +852,7 @@ test_handler (Test *test,
   GHashTable *info;
   GList *chans;
   TpTestsSimpleClient *client_2;
+  guint added = 0, removed = 0, added_2 = 0, removed_2 = 0;
 
   filter = tp_asv_new (
       TP_PROP_CHANNEL_CHANNEL_TYPE, G_TYPE_STRING, TP_IFACE_CHANNEL_TYPE_TEXT,
@@ -889,6 +899,11 @@ test_handler (Test *test,
   g_assert (!tp_base_client_is_handling_channel (test->base_client,
         test->text_chan_2));
 
+  g_signal_connect (test->base_client, "handled-channel-added",
+      G_CALLBACK (count_handled_channel_cb), &added);
+  g_signal_connect (test->base_client, "handled-channel-removed",
+      G_CALLBACK (count_handled_channel_cb), &removed);
+
   /* Call HandleChannels */
   channels = g_ptr_array_sized_new (2);
   add_channel_to_ptr_array (channels, test->text_chan);
@@ -916,6 +931,8 @@ test_handler (Test *test,
   chans = tp_base_client_get_handled_channels (test->base_client);
   g_assert_cmpuint (g_list_length (chans), ==, 2);
   g_list_free (chans);
+  g_assert_cmpuint (added, ==, 2);
+  g_assert_cmpuint (removed, ==, 0);
 
   g_assert (tp_base_client_is_handling_channel (test->base_client,
         test->text_chan));
@@ -931,6 +948,8 @@ test_handler (Test *test,
   chans = tp_base_client_get_handled_channels (test->base_client);
   g_assert_cmpuint (g_list_length (chans), ==, 1);
   g_list_free (chans);
+  g_assert_cmpuint (added, ==, 2);
+  g_assert_cmpuint (removed, ==, 1);
 
   g_assert (!tp_base_client_is_handling_channel (test->base_client,
         test->text_chan));
@@ -940,6 +959,10 @@ test_handler (Test *test,
   /* Create another client sharing the same unique name */
   client_2 = tp_tests_simple_client_new (test->dbus, "Test", TRUE);
   tp_base_client_be_a_handler (TP_BASE_CLIENT (client_2));
+  g_signal_connect (client_2, "handled-channel-added",
+      G_CALLBACK (count_handled_channel_cb), &added_2);
+  g_signal_connect (client_2, "handled-channel-removed",
+      G_CALLBACK (count_handled_channel_cb), &removed_2);
   tp_base_client_register (TP_BASE_CLIENT (client_2), &test->error);
   g_assert_no_error (test->error);
 
@@ -952,6 +975,18 @@ test_handler (Test *test,
   g_assert (tp_base_client_is_handling_channel (TP_BASE_CLIENT (client_2),
         test->text_chan_2));
 
+  /* client_2 is told when the channels handled by the first client go
+   * away */
+  tp_base_client_unregister (test->base_client);
+  g_assert_cmpuint (added_2, ==, 0);
+  g_assert_cmpuint (removed_2, ==, 1);
+  g_assert_cmpuint (removed, ==, 1);
+
+  chans = tp_base_client_get_handled_channels (TP_BASE_CLIENT (client_2));
+  g_assert (chans == NULL);
+  g_assert (!tp_base_client_is_handling_channel (TP_BASE_CLIENT (client_2),
+        test->text_chan_2));
+
   g_object_unref (client_2);
 
   g_ptr_array_foreach (channels, free_channel_details, NULL);
@@ -1575,6 +1610,109 @@ test_delegate_to_preferred_handler_supported (Test *test,
   delegate_to_preferred_handler (test, TRUE);
 }
 
+static void
+test_filters_match (Test *test,
+    gconstpointer data G_GNUC_UNUSED)
+{
+  TpBaseClient *client = test->base_client;
+
+  tp_base_client_take_observer_filter (client, tp_asv_new (
+        TP_PROP_CHANNEL_CHANNEL_TYPE, G_TYPE_STRING,
+          TP_IFACE_CHANNEL_TYPE_TEXT,
+        NULL));
+  tp_base_client_take_observer_filter (client, tp_asv_new (
+        TP_PROP_CHANNEL_CHANNEL_TYPE, G_TYPE_STRING,
+          TP_IFACE_CHANNEL_TYPE_STREAM_TUBE,
+        TP_PROP_CHANNEL_TARGET_HANDLE_TYPE, G_TYPE_UINT,
+          TP_HANDLE_TYPE_CONTACT,
+        NULL));
+  tp_base_client_take_observer_filter (client, tp_asv_new (
+        TP_PROP_CHANNEL_CHANNEL_TYPE, G_TYPE_STRING,
+          TP_IFACE_CHANNEL_TYPE_CALL,
+        TP_PROP_CHANNEL_REQUESTED, G_TYPE_BOOLEAN, FALSE,
+        TP_PROP_CHANNEL_TYPE_CALL_INITIAL_AUDIO, G_TYPE_BOOLEAN, TRUE,
+        NULL));
+
+  /* a filter which doesn't mention the channel type at all */
+  tp_base_client_take_handler_filter (client, tp_asv_new (
+        TP_PROP_CHANNEL_TARGET_HANDLE_TYPE, G_TYPE_UINT, TP_HANDLE_TYPE_ROOM,
+        NULL));
+
+  /* Text matches whatever the handle type is */
+  g_assert (tp_base_client_observer_filters_match (client,
+        g_variant_new_parsed ("{ %s: <%s>, %s: <%u> }",
+          TP_PROP_CHANNEL_CHANNEL_TYPE, TP_IFACE_CHANNEL_TYPE_TEXT,
+          TP_PROP_CHANNEL_TARGET_HANDLE_TYPE,
+          (guint32) TP_HANDLE_TYPE_ROOM)));
+  g_assert (tp_base_client_observer_filters_match (client,
+        g_variant_new_parsed ("{ %s: <%s> }",
+          TP_PROP_CHANNEL_CHANNEL_TYPE, TP_IFACE_CHANNEL_TYPE_TEXT)));
+
+  /* the handle type must match exactly, but any integer type will do */
+  g_assert (tp_base_client_observer_filters_match (client,
+        g_variant_new_parsed ("{ %s: <%s>, %s: <%u> }",
+          TP_PROP_CHANNEL_CHANNEL_TYPE, TP_IFACE_CHANNEL_TYPE_STREAM_TUBE,
+          TP_PROP_CHANNEL_TARGET_HANDLE_TYPE,
+          (guint32) TP_HANDLE_TYPE_CONTACT)));
+  g_assert (tp_base_client_observer_filters_match (client,
+        g_variant_new_parsed ("{ %s: <%s>, %s: <%x> }",
+          TP_PROP_CHANNEL_CHANNEL_TYPE, TP_IFACE_CHANNEL_TYPE_STREAM_TUBE,
+          TP_PROP_CHANNEL_TARGET_HANDLE_TYPE,
+          (gint64) TP_HANDLE_TYPE_CONTACT)));
+  g_assert (!tp_base_client_observer_filters_match (client,
+        g_variant_new_parsed ("{ %s: <%s>, %s: <%u> }",
+          TP_PROP_CHANNEL_CHANNEL_TYPE, TP_IFACE_CHANNEL_TYPE_STREAM_TUBE,
+          TP_PROP_CHANNEL_TARGET_HANDLE_TYPE,
+          (guint32) TP_HANDLE_TYPE_ROOM)));
+  g_assert (!tp_base_client_observer_filters_match (client,
+        g_variant_new_parsed ("{ %s: <%s> }",
+          TP_PROP_CHANNEL_CHANNEL_TYPE, TP_IFACE_CHANNEL_TYPE_STREAM_TUBE)));
+
+  /* every other property in the filter must be present and equal */
+  g_assert (tp_base_client_observer_filters_match (client,
+        g_variant_new_parsed ("{ %s: <%s>, %s: <%b>, %s: <%b>, %s: <%b> }",
+          TP_PROP_CHANNEL_CHANNEL_TYPE, TP_IFACE_CHANNEL_TYPE_CALL,
+          TP_PROP_CHANNEL_REQUESTED, FALSE,
+          TP_PROP_CHANNEL_TYPE_CALL_INITIAL_AUDIO, TRUE,
+          TP_PROP_CHANNEL_TYPE_CALL_INITIAL_VIDEO, TRUE)));
+  g_assert (!tp_base_client_observer_filters_match (client,
+        g_variant_new_parsed ("{ %s: <%s>, %s: <%b>, %s: <%b> }",
+          TP_PROP_CHANNEL_CHANNEL_TYPE, TP_IFACE_CHANNEL_TYPE_CALL,
+          TP_PROP_CHANNEL_REQUESTED, TRUE,
+          TP_PROP_CHANNEL_TYPE_CALL_INITIAL_AUDIO, TRUE)));
+  g_assert (!tp_base_client_observer_filters_match (client,
+        g_variant_new_parsed ("{ %s: <%s>, %s: <%b> }",
+          TP_PROP_CHANNEL_CHANNEL_TYPE, TP_IFACE_CHANNEL_TYPE_CALL,
+          TP_PROP_CHANNEL_REQUESTED, FALSE)));
+  g_assert (!tp_base_client_observer_filters_match (client,
+        g_variant_new_parsed ("{ %s: <%s>, %s: <%b>, %s: <%u> }",
+          TP_PROP_CHANNEL_CHANNEL_TYPE, TP_IFACE_CHANNEL_TYPE_CALL,
+          TP_PROP_CHANNEL_REQUESTED, FALSE,
+          TP_PROP_CHANNEL_TYPE_CALL_INITIAL_AUDIO, (guint32) 1)));
+
+  g_assert (!tp_base_client_observer_filters_match (client,
+        g_variant_new_parsed ("{ %s: <%s> }",
+          TP_PROP_CHANNEL_CHANNEL_TYPE, "org.example.NoSuchChannelType")));
+  g_assert (!tp_base_client_observer_filters_match (client,
+        g_variant_new ("a{sv}", NULL)));
+
+  /* no approver filters at all */
+  g_assert (!tp_base_client_approver_filters_match (client,
+        g_variant_new_parsed ("{ %s: <%s> }",
+          TP_PROP_CHANNEL_CHANNEL_TYPE, TP_IFACE_CHANNEL_TYPE_TEXT)));
+
+  g_assert (tp_base_client_handler_filters_match (client,
+        g_variant_new_parsed ("{ %s: <%s>, %s: <%u> }",
+          TP_PROP_CHANNEL_CHANNEL_TYPE, "org.example.NoSuchChannelType",
+          TP_PROP_CHANNEL_TARGET_HANDLE_TYPE,
+          (guint32) TP_HANDLE_TYPE_ROOM)));
+  g_assert (!tp_base_client_handler_filters_match (client,
+        g_variant_new_parsed ("{ %s: <%s>, %s: <%u> }",
+          TP_PROP_CHANNEL_CHANNEL_TYPE, TP_IFACE_CHANNEL_TYPE_TEXT,
+          TP_PROP_CHANNEL_TARGET_HANDLE_TYPE,
+          (guint32) TP_HANDLE_TYPE_CONTACT)));
+}
+
 int
 main (int argc,
       char **argv)
@@ -1594,6 +1732,8 @@ main (int argc,
       teardown);
   g_test_add ("/base-client/handler-requests", Test, NULL, setup,
       test_handler_requests, teardown);
+  g_test_add ("/base-client/filters-match", Test, NULL, setup,
+      test_filters_match, teardown);
   g_test_add ("/cdo/claim_with", Test, NULL, setup,
       test_channel_dispatch_operation_claim_with_async, teardown);
   g_test_add ("/base-client/delegate-channels", Test, NULL, setup,
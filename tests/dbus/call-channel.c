@@ -1043,6 +1043,139 @@ test_dtmf (Test *test,
   g_assert_no_error (test->error);
 }
 
+typedef struct
+{
+  guint n_signals;
+  guint n_candidates;
+  gchar *first_username;
+} CandidatesAdded;
+
+static gchar *
+candidate_dup_username (GValueArray *candidate)
+{
+  guint component, port;
+  const gchar *address;
+  GHashTable *info;
+
+  tp_value_array_unpack (candidate, 4, &component, &address, &port, &info);
+  return g_strdup (tp_asv_get_string (info, "username"));
+}
+
+static void
+remote_candidates_added_cb (TpCallStreamEndpoint *endpoint,
+    const GPtrArray *candidates,
+    CandidatesAdded *added)
+{
+  added->n_signals++;
+  added->n_candidates = candidates->len;
+  g_free (added->first_username);
+  added->first_username = candidate_dup_username (
+      g_ptr_array_index (candidates, 0));
+}
+
+static guint
+count_remote_candidates (TpCallStreamEndpoint *endpoint)
+{
+  GPtrArray *candidates;
+  guint len;
+
+  g_object_get (endpoint,
+      "remote-candidates", &candidates,
+      NULL);
+  len = candidates->len;
+  g_boxed_free (TP_ARRAY_TYPE_CANDIDATE_LIST, candidates);
+
+  return len;
+}
+
+static void
+test_endpoint_candidates (Test *test,
+    gconstpointer data G_GNUC_UNUSED)
+{
+  TpCallStreamEndpoint *endpoint;
+  CandidatesAdded added = { 0, 0, NULL };
+  GHashTable *info;
+  GHashTable *new_info;
+  GPtrArray *candidates;
+  gchar *username;
+
+  endpoint = tp_call_stream_endpoint_new (test->dbus,
+      "/org/freedesktop/Telepathy/Tests/CallChannel/Endpoint",
+      TP_STREAM_TRANSPORT_TYPE_RAW_UDP, FALSE);
+  g_signal_connect (endpoint, "remote-candidates-added",
+      G_CALLBACK (remote_candidates_added_cb), &added);
+
+  info = tp_asv_new ("protocol", G_TYPE_STRING, "udp", NULL);
+
+  tp_call_stream_endpoint_add_new_candidate (endpoint,
+      TP_STREAM_COMPONENT_DATA, "192.0.2.1", 5000, info);
+  g_assert_cmpuint (added.n_signals, ==, 1);
+  g_assert_cmpuint (added.n_candidates, ==, 1);
+  g_assert_cmpuint (count_remote_candidates (endpoint), ==, 1);
+
+  /* The same candidate again is signalled, but not stored twice */
+  tp_call_stream_endpoint_add_new_candidate (endpoint,
+      TP_STREAM_COMPONENT_DATA, "192.0.2.1", 5000, info);
+  g_assert_cmpuint (added.n_signals, ==, 2);
+  g_assert_cmpuint (added.n_candidates, ==, 1);
+  g_assert_cmpuint (count_remote_candidates (endpoint), ==, 1);
+
+  /* A batch with a redundant candidate and a new one */
+  candidates = g_ptr_array_new_with_free_func (
+      (GDestroyNotify) tp_value_array_free);
+  g_ptr_array_add (candidates, tp_value_array_build (4,
+      G_TYPE_UINT, TP_STREAM_COMPONENT_DATA,
+      G_TYPE_STRING, "192.0.2.1",
+      G_TYPE_UINT, 5000,
+      TP_HASH_TYPE_CANDIDATE_INFO, info,
+      G_TYPE_INVALID));
+  g_ptr_array_add (candidates, tp_value_array_build (4,
+      G_TYPE_UINT, TP_STREAM_COMPONENT_DATA,
+      G_TYPE_STRING, "192.0.2.2",
+      G_TYPE_UINT, 5000,
+      TP_HASH_TYPE_CANDIDATE_INFO, info,
+      G_TYPE_INVALID));
+
+  tp_call_stream_endpoint_add_new_candidates (endpoint, candidates);
+  g_assert_cmpuint (added.n_signals, ==, 3);
+  g_assert_cmpuint (added.n_candidates, ==, 2);
+  g_assert_cmpuint (count_remote_candidates (endpoint), ==, 2);
+
+  /* A batch in which every candidate is redundant is still signalled */
+  tp_call_stream_endpoint_add_new_candidates (endpoint, candidates);
+  g_assert_cmpuint (added.n_signals, ==, 4);
+  g_assert_cmpuint (added.n_candidates, ==, 2);
+  g_assert_cmpuint (count_remote_candidates (endpoint), ==, 2);
+
+  /* The same candidate with new credentials replaces the old one, and it
+   * is the new one that is signalled */
+  new_info = tp_asv_new (
+      "protocol", G_TYPE_STRING, "udp",
+      "username", G_TYPE_STRING, "alice",
+      "password", G_TYPE_STRING, "s3cr3t",
+      NULL);
+  tp_call_stream_endpoint_add_new_candidate (endpoint,
+      TP_STREAM_COMPONENT_DATA, "192.0.2.1", 5000, new_info);
+  g_assert_cmpuint (added.n_signals, ==, 5);
+  g_assert_cmpuint (added.n_candidates, ==, 1);
+  g_assert_cmpstr (added.first_username, ==, "alice");
+  g_assert_cmpuint (count_remote_candidates (endpoint), ==, 2);
+
+  g_ptr_array_unref (candidates);
+  g_object_get (endpoint,
+      "remote-candidates", &candidates,
+      NULL);
+  username = candidate_dup_username (g_ptr_array_index (candidates, 0));
+  g_assert_cmpstr (username, ==, "alice");
+  g_free (username);
+  g_boxed_free (TP_ARRAY_TYPE_CANDIDATE_LIST, candidates);
+
+  g_free (added.first_username);
+  g_hash_table_unref (new_info);
+  g_hash_table_unref (info);
+  g_object_unref (endpoint);
+}
+
 static void
 teardown (Test *test,
           gconstpointer data G_GNUC_UNUSED)
@@ -1090,6 +1223,8 @@ main (int argc,
       teardown);
   g_test_add ("/call/dtmf", Test, NULL, setup, test_dtmf,
       teardown);
+  g_test_add ("/call/endpoint-candidates", Test, NULL, setup,
+      test_endpoint_candidates, teardown);
 
   return tp_tests_run_with_bus ();
 }
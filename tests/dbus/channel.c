@@ -663,6 +663,82 @@ test_contacts (Test *test,
   g_assert_cmpstr (tp_contact_get_alias (contact), ==, alias2);
 }
 
+#define N_BURST 20
+
+static void
+burst_contacts_changed_cb (TpChannel *self,
+    GPtrArray *added,
+    GPtrArray *removed,
+    GPtrArray *local_pending,
+    GPtrArray *remote_pending,
+    TpContact *actor,
+    GHashTable *details,
+    GPtrArray *seen)
+{
+  guint i;
+
+  for (i = 0; i < added->len; i++)
+    {
+      TpContact *contact = g_ptr_array_index (added, i);
+
+      /* the contact has been prepared before being signalled, even though
+       * the contacts for several signals were prepared together */
+      g_assert (tp_contact_has_feature (contact, TP_CONTACT_FEATURE_ALIAS));
+      g_ptr_array_add (seen, g_strdup (tp_contact_get_identifier (contact)));
+    }
+}
+
+static void
+test_contacts_burst (Test *test,
+    gconstpointer data G_GNUC_UNUSED)
+{
+  GQuark channel_features[] = { TP_CHANNEL_FEATURE_CONTACTS, 0 };
+  GPtrArray *seen = g_ptr_array_new_with_free_func (g_free);
+  guint i;
+
+  tp_simple_client_factory_add_contact_features_varargs (
+      tp_proxy_get_factory (test->connection),
+      TP_CONTACT_FEATURE_ALIAS,
+      TP_CONTACT_FEATURE_INVALID);
+
+  tp_tests_proxy_run_until_prepared (test->channel_room, channel_features);
+
+  g_signal_connect (test->channel_room, "group-contacts-changed",
+      G_CALLBACK (burst_contacts_changed_cb), seen);
+  g_signal_connect (test->channel_room, "group-contacts-changed",
+      G_CALLBACK (group_contacts_changed_cb), test);
+
+  /* One MembersChanged per contact, all in flight at once */
+  for (i = 0; i < N_BURST; i++)
+    {
+      gchar *id = g_strdup_printf ("member%02u", i);
+      TpHandle handle = tp_handle_ensure (test->contact_repo, id, NULL, NULL);
+      GArray *handles = g_array_new (FALSE, FALSE, sizeof (TpHandle));
+
+      g_array_append_val (handles, handle);
+      tp_cli_channel_interface_group_call_add_members (test->channel_room,
+          -1, handles, "", NULL, NULL, NULL, NULL);
+      g_array_unref (handles);
+      g_free (id);
+    }
+
+  test->wait = N_BURST;
+  g_main_loop_run (test->mainloop);
+
+  /* each signal arrived separately and in order */
+  g_assert_cmpuint (seen->len, ==, N_BURST);
+
+  for (i = 0; i < N_BURST; i++)
+    {
+      gchar *id = g_strdup_printf ("member%02u", i);
+
+      g_assert_cmpstr (g_ptr_array_index (seen, i), ==, id);
+      g_free (id);
+    }
+
+  g_ptr_array_unref (seen);
+}
+
 int
 main (int argc,
       char **argv)
@@ -706,6 +782,8 @@ main (int argc,
 
   g_test_add ("/channel/contacts", Test, NULL, setup,
       test_contacts, teardown);
+  g_test_add ("/channel/contacts/burst", Test, NULL, setup,
+      test_contacts_burst, teardown);
 
   return tp_tests_run_with_bus ();
 }
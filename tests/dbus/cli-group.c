@@ -486,6 +486,107 @@ check_removed_known_error_in_invalidated (void)
   tp_intset_destroy (self_handle_singleton);
 }
 
+static void
+assert_local_pending_info (TpChannel *chan,
+    TpHandle handle,
+    gboolean expected_ret,
+    TpHandle expected_actor,
+    TpChannelGroupChangeReason expected_reason,
+    const gchar *expected_message)
+{
+  TpHandle actor;
+  TpChannelGroupChangeReason reason;
+  const gchar *message;
+  gboolean ret;
+
+  ret = tp_channel_group_get_local_pending_info (chan, handle, &actor,
+      &reason, &message);
+
+  g_assert_cmpint (ret, ==, expected_ret);
+  g_assert_cmpuint (actor, ==, expected_actor);
+  g_assert_cmpuint (reason, ==, expected_reason);
+  g_assert_cmpstr (message, ==, expected_message);
+}
+
+static void
+check_local_pending_info_transitions (void)
+{
+  gchar *chan_path;
+  TpTestsTextChannelGroup *service_chan;
+  TpChannel *chan;
+  TpIntset *h1_set = tp_intset_new ();
+  TpIntset *h2_set = tp_intset_new ();
+  TpIntset *both = tp_intset_new ();
+  GError *error = NULL;
+
+  chan_path = g_strdup_printf ("%s/ChannelLocalPending", conn_path);
+  service_chan = TP_TESTS_TEXT_CHANNEL_GROUP (
+      tp_tests_object_new_static_class (
+      TP_TESTS_TYPE_TEXT_CHANNEL_GROUP,
+      "connection", service_conn,
+      "object-path", chan_path,
+      "detailed", TRUE,
+      "properties", TRUE,
+      NULL));
+  chan = tp_channel_new (conn, chan_path, NULL, TP_UNKNOWN_HANDLE_TYPE, 0,
+      &error);
+
+  g_assert_no_error (error);
+
+  MYASSERT (tp_channel_run_until_ready (chan, &error, NULL), "");
+  g_assert_no_error (error);
+
+  tp_intset_add (h1_set, h1);
+  tp_intset_add (h2_set, h2);
+  tp_intset_add (both, h1);
+  tp_intset_add (both, h2);
+
+  /* h3 invites h1 and h2 */
+  tp_group_mixin_change_members ((GObject *) service_chan, "come in",
+      NULL, NULL, both, NULL, h3, TP_CHANNEL_GROUP_CHANGE_REASON_INVITED);
+  tp_tests_proxy_run_until_dbus_queue_processed (conn);
+
+  assert_local_pending_info (chan, h1, TRUE, h3,
+      TP_CHANNEL_GROUP_CHANGE_REASON_INVITED, "come in");
+  assert_local_pending_info (chan, h2, TRUE, h3,
+      TP_CHANNEL_GROUP_CHANGE_REASON_INVITED, "come in");
+
+  /* in a single change, h1 becomes a member and h2 becomes remote-pending;
+   * neither is local-pending any more, so neither has any info */
+  tp_group_mixin_change_members ((GObject *) service_chan, "",
+      h1_set, NULL, NULL, h2_set, 0, TP_CHANNEL_GROUP_CHANGE_REASON_NONE);
+  tp_tests_proxy_run_until_dbus_queue_processed (conn);
+
+  g_assert (tp_intset_is_member (tp_channel_group_get_members (chan), h1));
+  g_assert (tp_intset_is_member (tp_channel_group_get_remote_pending (chan),
+        h2));
+  g_assert (tp_intset_size (tp_channel_group_get_local_pending (chan)) == 0);
+  assert_local_pending_info (chan, h1, FALSE, 0,
+      TP_CHANNEL_GROUP_CHANGE_REASON_NONE, "");
+  assert_local_pending_info (chan, h2, FALSE, 0,
+      TP_CHANNEL_GROUP_CHANGE_REASON_NONE, "");
+
+  /* if they become local-pending again with no details, the details of the
+   * earlier invitation must not come back */
+  tp_group_mixin_change_members ((GObject *) service_chan, "",
+      NULL, NULL, both, NULL, 0, TP_CHANNEL_GROUP_CHANGE_REASON_NONE);
+  tp_tests_proxy_run_until_dbus_queue_processed (conn);
+
+  g_assert (tp_intset_is_equal (tp_channel_group_get_local_pending (chan),
+        both));
+  assert_local_pending_info (chan, h1, TRUE, 0,
+      TP_CHANNEL_GROUP_CHANGE_REASON_NONE, "");
+  assert_local_pending_info (chan, h2, TRUE, 0,
+      TP_CHANNEL_GROUP_CHANGE_REASON_NONE, "");
+
+  g_object_unref (chan);
+  g_object_unref (service_chan);
+  g_free (chan_path);
+  tp_intset_destroy (h1_set);
+  tp_intset_destroy (h2_set);
+  tp_intset_destroy (both);
+}
+
 int
 main (int argc,
       char **argv)
@@ -536,6 +637,7 @@ main (int argc,
   run_membership_tests ();
   check_removed_unknown_error_in_invalidated ();
   check_removed_known_error_in_invalidated ();
+  check_local_pending_info_transitions ();
 
   tp_tests_connection_assert_disconnect_succeeds (conn);
 
@@ -167,6 +167,108 @@ test_new_text (Test *test,
   g_object_unref (msg);
 }
 
+static void
+test_header_changes (Test *test,
+    gconstpointer data G_GNUC_UNUSED)
+{
+  TpHandle sender;
+  TpMessage *msg;
+  gboolean valid;
+
+  sender = tp_handle_ensure (test->contact_repo, "bob", NULL, &test->error);
+  g_assert_no_error (test->error);
+
+  msg = tp_cm_message_new_text (test->base_connection, sender,
+      TP_CHANNEL_TEXT_MESSAGE_TYPE_NORMAL, "hello");
+
+  /* read the headers, then change them: the accessors must not return
+   * stale values */
+  g_assert_cmpstr (tp_message_get_token (msg), ==, NULL);
+  g_assert_cmpint ((gint) tp_message_get_sent_timestamp (msg), ==, 0);
+  g_assert_cmpint (tp_message_is_delivery_report (msg), ==, FALSE);
+  g_assert_cmpuint (tp_message_get_pending_message_id (msg, &valid), ==, 0);
+  g_assert (!valid);
+
+  tp_message_set_string (msg, 0, "message-token", "abc");
+  tp_message_set_int64 (msg, 0, "message-sent", 1234);
+  tp_message_set_uint32 (msg, 0, "message-type",
+      TP_CHANNEL_TEXT_MESSAGE_TYPE_DELIVERY_REPORT);
+  tp_message_set_uint32 (msg, 0, "delivery-status",
+      TP_DELIVERY_STATUS_DELIVERED);
+  tp_message_set_uint32 (msg, 0, "pending-message-id", 7);
+  /* a body part with the same keys makes no difference */
+  tp_message_set_string (msg, 1, "message-token", "not-the-header");
+
+  g_assert_cmpstr (tp_message_get_token (msg), ==, "abc");
+  g_assert_cmpint ((gint) tp_message_get_sent_timestamp (msg), ==, 1234);
+  g_assert_cmpuint (tp_message_get_message_type (msg), ==,
+      TP_CHANNEL_TEXT_MESSAGE_TYPE_DELIVERY_REPORT);
+  g_assert_cmpint (tp_message_is_delivery_report (msg), ==, TRUE);
+  g_assert_cmpuint (tp_message_get_pending_message_id (msg, &valid), ==, 7);
+  g_assert (valid);
+
+  /* an empty token is the same as none */
+  tp_message_set_string (msg, 0, "message-token", "");
+  g_assert_cmpstr (tp_message_get_token (msg), ==, NULL);
+
+  g_assert (tp_message_delete_key (msg, 0, "delivery-status"));
+  g_assert (tp_message_delete_key (msg, 0, "message-sent"));
+  g_assert_cmpint (tp_message_is_delivery_report (msg), ==, FALSE);
+  g_assert_cmpint ((gint) tp_message_get_sent_timestamp (msg), ==, 0);
+
+  g_object_unref (msg);
+}
+
+static void
+test_text_changes (Test *test,
+    gconstpointer data G_GNUC_UNUSED)
+{
+  TpHandle sender;
+  TpMessage *msg;
+  TpChannelTextMessageFlags flags;
+  gchar *text;
+  guint part;
+
+  sender = tp_handle_ensure (test->contact_repo, "bob", NULL, &test->error);
+  g_assert_no_error (test->error);
+
+  msg = tp_cm_message_new_text (test->base_connection, sender,
+      TP_CHANNEL_TEXT_MESSAGE_TYPE_NORMAL, "hello");
+
+  text = tp_message_to_text (msg, &flags);
+  g_assert_cmpstr (text, ==, "hello");
+  g_assert_cmpuint (flags, ==, 0);
+  g_free (text);
+
+  /* the flattened text must follow changes to any part */
+  part = tp_message_append_part (msg);
+  tp_message_set_string (msg, part, "content-type", "text/plain");
+  tp_message_set_string (msg, part, "content", " world");
+
+  text = tp_message_to_text (msg, &flags);
+  g_assert_cmpstr (text, ==, "hello world");
+  g_assert_cmpuint (flags, ==, 0);
+  g_free (text);
+
+  tp_message_set_boolean (msg, 0, "rescued", TRUE);
+  tp_message_set_boolean (msg, part, "truncated", TRUE);
+
+  text = tp_message_to_text (msg, &flags);
+  g_assert_cmpstr (text, ==, "hello world");
+  g_assert_cmpuint (flags, ==, TP_CHANNEL_TEXT_MESSAGE_FLAG_RESCUED |
+      TP_CHANNEL_TEXT_MESSAGE_FLAG_TRUNCATED);
+  g_free (text);
+
+  tp_message_delete_part (msg, part);
+
+  text = tp_message_to_text (msg, &flags);
+  g_assert_cmpstr (text, ==, "hello");
+  g_assert_cmpuint (flags, ==, TP_CHANNEL_TEXT_MESSAGE_FLAG_RESCUED);
+  g_free (text);
+
+  g_object_unref (msg);
+}
+
 static void
 test_set_message (Test *test,
     gconstpointer data G_GNUC_UNUSED)
@@ -333,6 +435,10 @@ main (int argc,
       test_new_from_parts, teardown);
   g_test_add (TEST_PREFIX "new_text", Test, NULL, setup,
       test_new_text, teardown);
+  g_test_add (TEST_PREFIX "header_changes", Test, NULL, setup,
+      test_header_changes, teardown);
+  g_test_add (TEST_PREFIX "text_changes", Test, NULL, setup,
+      test_text_changes, teardown);
   g_test_add (TEST_PREFIX "set_message", Test, NULL, setup,
       test_set_message, teardown);
   g_test_add (TEST_PREFIX "set_message_2", Test, NULL, setup,
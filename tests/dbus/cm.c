@@ -10,8 +10,15 @@
 
 #include "config.h"
 
+#include <string.h>
+#include <utime.h>
+
+#include <glib/gstdio.h>
+
 #include <telepathy-glib/telepathy-glib.h>
 
+#include "telepathy-glib/connection-manager-internal.h"
+
 #include "tests/lib/echo-cm.h"
 #include "tests/lib/util.h"
 
@@ -1120,6 +1127,175 @@ test_list (Test *test,
   g_assert (tp_connection_manager_has_protocol (test->spurious, "normal"));
 }
 
+static void
+read_manager_file (Test *test,
+    const gchar *filename)
+{
+  GError *error = NULL;
+  gulong id;
+
+  g_clear_object (&test->cm);
+  test->cm = tp_connection_manager_new (test->dbus, "test_manager_file",
+      filename, &error);
+  g_assert_no_error (error);
+
+  id = g_signal_connect (test->cm, "got-info",
+      G_CALLBACK (on_got_info_expect_file), test);
+  g_main_loop_run (test->mainloop);
+  g_signal_handler_disconnect (test->cm, id);
+}
+
+static void
+test_file_cache (Test *test,
+    gconstpointer data)
+{
+  TpManagerFileCacheStats before, after;
+  GError *error = NULL;
+  gchar *source, *dir, *filename, *contents, *changed, *same_size;
+  gchar *account;
+  gsize len;
+  struct utimbuf times = { 1000000000, 1000000000 };
+  GStatBuf st_before, st_after;
+  TpProtocol *protocol;
+  const TpConnectionManagerParam *param;
+  TpAvatarRequirements *req;
+
+  /* copy the fixture somewhere new, so the first read can't be cached */
+  test->cm = tp_connection_manager_new (test->dbus, "test_manager_file",
+      NULL, &error);
+  g_assert_no_error (error);
+  g_object_get (test->cm, "manager-file", &source, NULL);
+  g_assert (source != NULL);
+
+  dir = g_dir_make_tmp ("tp-glib-tests.XXXXXX", &error);
+  g_assert_no_error (error);
+  filename = g_build_filename (dir, "test_manager_file.manager", NULL);
+  g_file_get_contents (source, &contents, &len, &error);
+  g_assert_no_error (error);
+  g_file_set_contents (filename, contents, len, &error);
+  g_assert_no_error (error);
+
+  _tp_connection_manager_get_file_cache_stats (&before);
+  read_manager_file (test, filename);
+  _tp_connection_manager_get_file_cache_stats (&after);
+  g_assert_cmpuint (after.misses, ==, before.misses + 1);
+  g_assert_cmpuint (after.hits, ==, before.hits);
+  g_test_message ("parsing took %" G_GINT64_FORMAT " us",
+      after.parse_time - before.parse_time);
+
+  /* the entry is written in the background */
+  while (after.writes == before.writes)
+    {
+      g_main_context_iteration (NULL, TRUE);
+      _tp_connection_manager_get_file_cache_stats (&after);
+    }
+
+  /* unchanged file: answered from the cache, with the same contents */
+  before = after;
+  read_manager_file (test, filename);
+  _tp_connection_manager_get_file_cache_stats (&after);
+  g_assert_cmpuint (after.hits, ==, before.hits + 1);
+  g_assert_cmpuint (after.misses, ==, before.misses);
+  g_test_message ("loading took %" G_GINT64_FORMAT " us",
+      after.load_time - before.load_time);
+
+  g_assert_cmpuint (test->cm->info_source, ==, TP_CM_INFO_SOURCE_FILE);
+
+  protocol = tp_connection_manager_get_protocol_object (test->cm, "foo");
+  g_assert (protocol != NULL);
+  param = tp_protocol_get_param (protocol, "account");
+  g_assert (param != NULL);
+  g_assert_cmpuint (param->flags, ==,
+      TP_CONN_MGR_PARAM_FLAG_REQUIRED | TP_CONN_MGR_PARAM_FLAG_HAS_DEFAULT);
+  g_assert_cmpstr (g_value_get_string (&param->default_value), ==,
+      "foo@default");
+  param = tp_protocol_get_param (protocol, "password");
+  g_assert (param != NULL);
+  g_assert_cmpuint (param->flags, ==,
+      TP_CONN_MGR_PARAM_FLAG_REQUIRED | TP_CONN_MGR_PARAM_FLAG_SECRET);
+  g_assert_cmpstr (tp_protocol_get_english_name (protocol), ==,
+      "Regression tests");
+  g_assert_cmpstr (tp_protocol_get_vcard_field (protocol), ==,
+      "x-telepathy-tests");
+  req = tp_protocol_get_avatar_requirements (protocol);
+  g_assert (req != NULL);
+  g_assert_cmpuint (req->minimum_height, ==, 32);
+  g_assert_cmpuint (req->maximum_bytes, ==, 37748736);
+  g_assert (tp_capabilities_supports_text_chats (
+        tp_protocol_get_capabilities (protocol)));
+
+  protocol = tp_connection_manager_get_protocol_object (test->cm, "bar");
+  g_assert (protocol != NULL);
+  param = tp_protocol_get_param (protocol, "port");
+  g_assert (param != NULL);
+  g_assert (G_VALUE_HOLDS_UINT (&param->default_value));
+  g_assert_cmpuint (g_value_get_uint (&param->default_value), ==, 4321);
+
+  /* changing the file invalidates the entry */
+  changed = g_strconcat (contents, "\n# changed\n", NULL);
+  g_file_set_contents (filename, changed, -1, &error);
+  g_assert_no_error (error);
+
+  /* pin the mtime, so the next rewrite can't be told apart by it */
+  g_assert_cmpint (g_utime (filename, &times), ==, 0);
+
+  before = after;
+  read_manager_file (test, filename);
+  _tp_connection_manager_get_file_cache_stats (&after);
+  g_assert_cmpuint (after.misses, ==, before.misses + 1);
+  g_assert_cmpuint (after.hits, ==, before.hits);
+
+  while (after.writes == before.writes)
+    {
+      g_main_context_iteration (NULL, TRUE);
+      _tp_connection_manager_get_file_cache_stats (&after);
+    }
+
+  /* rewriting the file with the same size and mtime but different contents
+   * also invalidates the entry */
+  same_size = g_strdup (changed);
+  account = strstr (same_size, "foo@default");
+  g_assert (account != NULL);
+  memcpy (account, "baz", 3);
+
+  g_assert_cmpint (g_stat (filename, &st_before), ==, 0);
+  g_file_set_contents (filename, same_size, -1, &error);
+  g_assert_no_error (error);
+  g_assert_cmpint (g_utime (filename, &times), ==, 0);
+  g_assert_cmpint (g_stat (filename, &st_after), ==, 0);
+  g_assert_cmpuint (st_after.st_size, ==, st_before.st_size);
+  g_assert_cmpint (st_after.st_mtime, ==, st_before.st_mtime);
+
+  before = after;
+  read_manager_file (test, filename);
+  _tp_connection_manager_get_file_cache_stats (&after);
+  g_assert_cmpuint (after.misses, ==, before.misses + 1);
+  g_assert_cmpuint (after.hits, ==, before.hits);
+
+  protocol = tp_connection_manager_get_protocol_object (test->cm, "foo");
+  g_assert (protocol != NULL);
+  param = tp_protocol_get_param (protocol, "account");
+  g_assert (param != NULL);
+  g_assert_cmpstr (g_value_get_string (&param->default_value), ==,
+      "baz@default");
+
+  /* let the replacement entry land before removing the fixture */
+  while (after.writes == before.writes)
+    {
+      g_main_context_iteration (NULL, TRUE);
+      _tp_connection_manager_get_file_cache_stats (&after);
+    }
+
+  g_unlink (filename);
+  g_rmdir (dir);
+  g_free (same_size);
+  g_free (changed);
+  g_free (contents);
+  g_free (filename);
+  g_free (dir);
+  g_free (source);
+}
+
 int
 main (int argc,
       char **argv)
@@ -1150,6 +1326,8 @@ main (int argc,
       test_complex_file_ready, teardown);
   g_test_add ("/cm/file/complex/cwr", Test, GINT_TO_POINTER (USE_CWR), setup,
       test_complex_file_ready, teardown);
+  g_test_add ("/cm/file/cache", Test, NULL, setup, test_file_cache,
+      teardown);
   g_test_add ("/cm/dbus", Test, GINT_TO_POINTER (0), setup,
       test_dbus_ready, teardown);
   g_test_add ("/cm/dbus/cwr", Test, GINT_TO_POINTER (USE_CWR), setup,
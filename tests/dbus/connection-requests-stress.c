@@ -0,0 +1,300 @@
+/* Stress test for outstanding channel requests in TpBaseConnection.
+ *
+ * Copyright © 2014 Collabora Ltd. <http://www.collabora.co.uk/>
+ *
+ * Copying and distribution of this file, with or without modification,
+ * are permitted in any medium without royalty provided the copyright
+ * notice and this notice are preserved.
+ */
+
+#include "config.h"
+
+#include <telepathy-glib/telepathy-glib.h>
+
+#include "tests/lib/echo-conn.h"
+#include "tests/lib/echo-im-manager.h"
+#include "tests/lib/util.h"
+
+#define N_CONTACTS 250
+#define N_REQUESTS_PER_CONTACT 8
+
+typedef struct {
+    GMainLoop *mainloop;
+
+    TpBaseConnection *service_conn;
+    TpConnection *conn;
+
+    /* object path => GUINT_TO_POINTER (number of replies) */
+    GHashTable *replies;
+    /* object path => itself, if some reply had Yours=TRUE */
+    GHashTable *yours;
+    /* target ID => object path of the first reply */
+    GHashTable *paths;
+    guint n_channels;
+    guint n_new_channels;
+
+    guint wait;
+} Test;
+
+static void
+new_channels_cb (TpConnection *conn,
+    const GPtrArray *channels,
+    gpointer user_data,
+    GObject *weak_object)
+{
+  Test *test = user_data;
+
+  test->n_new_channels += channels->len;
+}
+
+static void
+setup (Test *test,
+    gconstpointer data)
+{
+  TpChannelManagerIter iter;
+  TpChannelManager *manager;
+  GError *error = NULL;
+
+  test->mainloop = g_main_loop_new (NULL, FALSE);
+
+  tp_tests_create_and_connect_conn (TP_TESTS_TYPE_ECHO_CONNECTION,
+      "me@example.com", &test->service_conn, &test->conn);
+
+  /* Only create the channels once the main loop is idle, so that the
+   * connection has to queue the requests for each contact until then */
+  tp_base_connection_channel_manager_iter_init (&iter, test->service_conn);
+
+  while (tp_base_connection_channel_manager_iter_next (&iter, &manager))
+    {
+      if (TP_TESTS_IS_ECHO_IM_MANAGER (manager))
+        tp_tests_echo_im_manager_set_delay_new_channels (
+            TP_TESTS_ECHO_IM_MANAGER (manager), TRUE);
+    }
+
+  tp_cli_connection_interface_requests_connect_to_new_channels (test->conn,
+      new_channels_cb, test, NULL, NULL, &error);
+  g_assert_no_error (error);
+
+  test->replies = g_hash_table_new_full (g_str_hash, g_str_equal, g_free,
+      NULL);
+  test->yours = g_hash_table_new_full (g_str_hash, g_str_equal, g_free,
+      NULL);
+  test->paths = g_hash_table_new_full (g_str_hash, g_str_equal, g_free,
+      g_free);
+}
+
+static void
+teardown (Test *test,
+    gconstpointer data)
+{
+  tp_tests_connection_assert_disconnect_succeeds (test->conn);
+  g_object_unref (test->conn);
+  g_object_unref (test->service_conn);
+
+  g_hash_table_unref (test->replies);
+  g_hash_table_unref (test->yours);
+  g_hash_table_unref (test->paths);
+  g_main_loop_unref (test->mainloop);
+}
+
+static void
+ensure_channel_cb (TpConnection *conn,
+    gboolean yours,
+    const gchar *object_path,
+    GHashTable *properties,
+    const GError *error,
+    gpointer user_data,
+    GObject *weak_object)
+{
+  Test *test = user_data;
+  const gchar *id;
+  const gchar *first_path;
+  guint n;
+
+  g_assert_no_error (error);
+  g_assert_cmpstr (tp_asv_get_string (properties,
+        TP_PROP_CHANNEL_CHANNEL_TYPE), ==, TP_IFACE_CHANNEL_TYPE_TEXT);
+
+  /* every request for a contact gets the same channel */
+  id = tp_asv_get_string (properties, TP_PROP_CHANNEL_TARGET_ID);
+  g_assert (id != NULL);
+  first_path = g_hash_table_lookup (test->paths, id);
+
+  if (first_path == NULL)
+    g_hash_table_insert (test->paths, g_strdup (id), g_strdup (object_path));
+  else
+    g_assert_cmpstr (object_path, ==, first_path);
+
+  n = GPOINTER_TO_UINT (g_hash_table_lookup (test->replies, object_path));
+  g_hash_table_insert (test->replies, g_strdup (object_path),
+      GUINT_TO_POINTER (n + 1));
+
+  if (yours)
+    {
+      /* only one of the requests for each channel can get Yours=TRUE */
+      g_assert (!g_hash_table_contains (test->yours, object_path));
+      g_hash_table_add (test->yours, g_strdup (object_path));
+    }
+
+  test->wait--;
+
+  if (test->wait == 0)
+    g_main_loop_quit (test->mainloop);
+}
+
+static void
+get_channels_cb (TpProxy *proxy,
+    const GValue *value,
+    const GError *error,
+    gpointer user_data,
+    GObject *weak_object)
+{
+  Test *test = user_data;
+  GPtrArray *channels;
+
+  g_assert_no_error (error);
+  g_assert (G_VALUE_HOLDS (value, TP_ARRAY_TYPE_CHANNEL_DETAILS_LIST));
+
+  channels = g_value_get_boxed (value);
+  test->n_channels = channels->len;
+
+  test->wait--;
+
+  if (test->wait == 0)
+    g_main_loop_quit (test->mainloop);
+}
+
+static void
+get_channels (Test *test)
+{
+  tp_cli_dbus_properties_call_get (test->conn, -1,
+      TP_IFACE_CONNECTION_INTERFACE_REQUESTS, "Channels",
+      get_channels_cb, test, NULL, NULL);
+  test->wait++;
+  g_main_loop_run (test->mainloop);
+  g_assert_cmpuint (test->wait, ==, 0);
+}
+
+static void
+closed_cb (TpChannel *channel,
+    gpointer user_data,
+    GObject *weak_object)
+{
+  Test *test = user_data;
+
+  test->wait--;
+
+  if (test->wait == 0)
+    g_main_loop_quit (test->mainloop);
+}
+
+static void
+test_ensure_many (Test *test,
+    gconstpointer data G_GNUC_UNUSED)
+{
+  GHashTableIter iter;
+  gpointer k, v;
+  GPtrArray *closing;
+  gint64 start;
+  guint i, j;
+
+  /* Make sure the Channels property is being tracked before we start */
+  get_channels (test);
+  g_assert_cmpuint (test->n_channels, ==, 0);
+
+  start = g_get_monotonic_time ();
+
+  /* Interleave the requests. The channels are only created once the
+   * service's main loop is idle, so there are several outstanding requests
+   * for every contact at once, which are all satisfied by its channel */
+  for (j = 0; j < N_REQUESTS_PER_CONTACT; j++)
+    {
+      for (i = 0; i < N_CONTACTS; i++)
+        {
+          gchar *id = g_strdup_printf ("contact%u@example.com", i);
+          GHashTable *request = tp_asv_new (
+              TP_PROP_CHANNEL_CHANNEL_TYPE, G_TYPE_STRING,
+                  TP_IFACE_CHANNEL_TYPE_TEXT,
+              TP_PROP_CHANNEL_TARGET_HANDLE_TYPE, G_TYPE_UINT,
+                  TP_HANDLE_TYPE_CONTACT,
+              TP_PROP_CHANNEL_TARGET_ID, G_TYPE_STRING, id,
+              NULL);
+
+          tp_cli_connection_interface_requests_call_ensure_channel (
+              test->conn, -1, request, ensure_channel_cb, test, NULL, NULL);
+          test->wait++;
+
+          g_hash_table_unref (request);
+          g_free (id);
+        }
+    }
+
+  g_main_loop_run (test->mainloop);
+  g_assert_cmpuint (test->wait, ==, 0);
+
+  g_test_message ("%u EnsureChannel calls took %" G_GINT64_FORMAT " us",
+      N_CONTACTS * N_REQUESTS_PER_CONTACT,
+      g_get_monotonic_time () - start);
+
+  g_assert_cmpuint (g_hash_table_size (test->replies), ==, N_CONTACTS);
+  g_assert_cmpuint (g_hash_table_size (test->yours), ==, N_CONTACTS);
+  g_assert_cmpuint (g_hash_table_size (test->paths), ==, N_CONTACTS);
+
+  /* one channel was created per contact, not one per request */
+  tp_tests_proxy_run_until_dbus_queue_processed (test->conn);
+  g_assert_cmpuint (test->n_new_channels, ==, N_CONTACTS);
+
+  g_hash_table_iter_init (&iter, test->replies);
+
+  while (g_hash_table_iter_next (&iter, &k, &v))
+    g_assert_cmpuint (GPOINTER_TO_UINT (v), ==, N_REQUESTS_PER_CONTACT);
+
+  get_channels (test);
+  g_assert_cmpuint (test->n_channels, ==, N_CONTACTS);
+
+  /* Close half of the channels; the Channels property should follow */
+  closing = g_ptr_array_new_with_free_func (g_object_unref);
+  i = 0;
+  g_hash_table_iter_init (&iter, test->replies);
+
+  while (g_hash_table_iter_next (&iter, &k, NULL))
+    {
+      TpChannel *channel;
+      GError *error = NULL;
+
+      if (i++ % 2 != 0)
+        continue;
+
+      channel = tp_simple_client_factory_ensure_channel (
+          tp_proxy_get_factory (test->conn), test->conn, k, NULL, &error);
+      g_assert_no_error (error);
+      /* keep it alive until it has been closed */
+      g_ptr_array_add (closing, channel);
+
+      tp_cli_channel_connect_to_closed (channel, closed_cb, test, NULL, NULL,
+          &error);
+      g_assert_no_error (error);
+      tp_cli_channel_call_close (channel, -1, NULL, NULL, NULL, NULL);
+      test->wait++;
+    }
+
+  g_main_loop_run (test->mainloop);
+  g_assert_cmpuint (test->wait, ==, 0);
+  g_ptr_array_unref (closing);
+
+  get_channels (test);
+  g_assert_cmpuint (test->n_channels, ==, N_CONTACTS / 2);
+}
+
+int
+main (int argc,
+      char **argv)
+{
+  tp_tests_abort_after (60);
+  tp_tests_init (&argc, &argv);
+
+  g_test_add ("/connection/requests/ensure-many", Test, NULL, setup,
+      test_ensure_many, teardown);
+
+  return tp_tests_run_with_bus ();
+}
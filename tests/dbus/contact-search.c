@@ -0,0 +1,261 @@
+/* Tests of TpContactSearch
+ *
+ * Copyright © 2014 Collabora Ltd. <http://www.collabora.co.uk/>
+ *
+ * Copying and distribution of this file, with or without modification,
+ * are permitted in any medium without royalty provided the copyright
+ * notice and this notice are preserved.
+ */
+
+#include "config.h"
+
+#include <telepathy-glib/telepathy-glib.h>
+
+#include "tests/lib/contact-search-chan.h"
+#include "tests/lib/simple-channel-dispatcher.h"
+#include "tests/lib/simple-conn.h"
+#include "tests/lib/util.h"
+
+#define SERVER "TestServer"
+
+typedef struct {
+    GMainLoop *mainloop;
+    TpDBusDaemon *dbus;
+
+    /* Service side objects */
+    TpBaseConnection *base_connection;
+    TpTestsSimpleChannelDispatcher *cd_service;
+
+    /* Client side objects */
+    TpAccount *account;
+    TpConnection *connection;
+    TpContactSearch *search;
+
+    guint n_signals;
+    guint n_results;
+    GError *error /* initialized where needed */;
+    gint wait;
+} Test;
+
+#define ACCOUNT_PATH TP_ACCOUNT_OBJECT_PATH_BASE "what/ev/er"
+
+static void
+new_async_cb (GObject *source,
+    GAsyncResult *result,
+    gpointer user_data)
+{
+  Test *test = user_data;
+
+  test->search = tp_contact_search_new_finish (result, &test->error);
+
+  test->wait--;
+  if (test->wait <= 0)
+    g_main_loop_quit (test->mainloop);
+}
+
+static void
+create_search (Test *test,
+    guint limit)
+{
+  tp_clear_object (&test->search);
+
+  tp_contact_search_new_async (test->account, SERVER, limit,
+      new_async_cb, test);
+
+  test->wait = 1;
+  g_main_loop_run (test->mainloop);
+  g_assert_no_error (test->error);
+}
+
+static void
+reset_async_cb (GObject *source,
+    GAsyncResult *result,
+    gpointer user_data)
+{
+  Test *test = user_data;
+
+  tp_contact_search_reset_finish (TP_CONTACT_SEARCH (source), result,
+      &test->error);
+
+  test->wait--;
+  if (test->wait <= 0)
+    g_main_loop_quit (test->mainloop);
+}
+
+static void
+search_results_received_cb (TpContactSearch *search,
+    GList *results,
+    Test *test)
+{
+  test->n_signals++;
+  test->n_results += g_list_length (results);
+}
+
+static TpChannelContactSearchState
+get_state (TpContactSearch *search)
+{
+  guint state;
+
+  g_object_get (search, "state", &state, NULL);
+  return state;
+}
+
+static void
+notify_state_cb (GObject *object,
+    GParamSpec *spec,
+    Test *test)
+{
+  if (get_state (test->search) != TP_CHANNEL_CONTACT_SEARCH_STATE_COMPLETED)
+    return;
+
+  test->wait--;
+  if (test->wait <= 0)
+    g_main_loop_quit (test->mainloop);
+}
+
+/* Search, and wait until the service says it has finished */
+static void
+run_search (Test *test)
+{
+  GHashTable *criteria;
+  gulong results_id, state_id;
+
+  criteria = g_hash_table_new (g_str_hash, g_str_equal);
+  g_hash_table_insert (criteria, "fn", "Contact");
+
+  results_id = g_signal_connect (test->search, "search-results-received",
+      G_CALLBACK (search_results_received_cb), test);
+  state_id = g_signal_connect (test->search, "notify::state",
+      G_CALLBACK (notify_state_cb), test);
+
+  test->n_signals = 0;
+  test->n_results = 0;
+
+  tp_contact_search_start (test->search, criteria);
+
+  test->wait = 1;
+  g_main_loop_run (test->mainloop);
+
+  g_signal_handler_disconnect (test->search, results_id);
+  g_signal_handler_disconnect (test->search, state_id);
+  g_hash_table_unref (criteria);
+}
+
+static void
+setup (Test *test,
+       gconstpointer data)
+{
+  test->mainloop = g_main_loop_new (NULL, FALSE);
+  test->dbus = tp_tests_dbus_daemon_dup_or_die ();
+
+  test->error = NULL;
+
+  test->account = tp_account_new (test->dbus, ACCOUNT_PATH, NULL);
+  g_assert (test->account != NULL);
+
+  /* Create (service and client sides) connection objects */
+  tp_tests_create_and_connect_conn (TP_TESTS_TYPE_SIMPLE_CONNECTION,
+      "me@test.com", &test->base_connection, &test->connection);
+
+  /* Claim CD bus-name */
+  tp_dbus_daemon_request_name (test->dbus,
+          TP_CHANNEL_DISPATCHER_BUS_NAME, FALSE, &test->error);
+  g_assert_no_error (test->error);
+
+  /* Create and register CD */
+  test->cd_service = tp_tests_object_new_static_class (
+      TP_TESTS_TYPE_SIMPLE_CHANNEL_DISPATCHER,
+      "connection", test->base_connection,
+      NULL);
+
+  tp_dbus_daemon_register_object (test->dbus, TP_CHANNEL_DISPATCHER_OBJECT_PATH,
+      test->cd_service);
+}
+
+static void
+teardown (Test *test,
+          gconstpointer data)
+{
+  g_clear_error (&test->error);
+
+  tp_dbus_daemon_release_name (test->dbus, TP_CHANNEL_DISPATCHER_BUS_NAME,
+      &test->error);
+  g_assert_no_error (test->error);
+
+  tp_clear_object (&test->cd_service);
+
+  tp_clear_object (&test->dbus);
+  g_main_loop_unref (test->mainloop);
+  test->mainloop = NULL;
+
+  tp_tests_connection_assert_disconnect_succeeds (test->connection);
+  tp_clear_object (&test->account);
+  g_object_unref (test->connection);
+  g_object_unref (test->base_connection);
+
+  tp_clear_object (&test->search);
+}
+
+static void
+test_no_limit (Test *test,
+    gconstpointer data G_GNUC_UNUSED)
+{
+  create_search (test, 0);
+
+  g_assert_cmpuint (tp_contact_search_get_limit (test->search), ==, 0);
+  g_assert_cmpstr (tp_contact_search_get_server (test->search), ==, SERVER);
+
+  run_search (test);
+
+  g_assert_cmpuint (test->n_signals, ==, 2);
+  g_assert_cmpuint (test->n_results, ==,
+      TP_TESTS_CONTACT_SEARCH_CHAN_N_RESULTS);
+}
+
+static void
+test_limit (Test *test,
+    gconstpointer data G_GNUC_UNUSED)
+{
+  /* The service ignores the limit, and returns half of its results in each
+   * of two signals: the limit is reached during the second one */
+  const guint limit = TP_TESTS_CONTACT_SEARCH_CHAN_N_RESULTS / 2 + 1;
+
+  create_search (test, limit);
+  g_assert_cmpuint (tp_contact_search_get_limit (test->search), ==, limit);
+
+  run_search (test);
+
+  g_assert_cmpuint (test->n_signals, ==, 2);
+  g_assert_cmpuint (test->n_results, ==, limit);
+
+  /* Searching again on the same object reports up to the limit again */
+  tp_contact_search_reset_async (test->search, SERVER, limit,
+      reset_async_cb, test);
+
+  test->wait = 1;
+  g_main_loop_run (test->mainloop);
+  g_assert_no_error (test->error);
+
+  g_assert_cmpuint (get_state (test->search), ==,
+      TP_CHANNEL_CONTACT_SEARCH_STATE_NOT_STARTED);
+
+  run_search (test);
+
+  g_assert_cmpuint (test->n_signals, ==, 2);
+  g_assert_cmpuint (test->n_results, ==, limit);
+}
+
+int
+main (int argc,
+      char **argv)
+{
+  tp_tests_init (&argc, &argv);
+  g_test_bug_base ("http://bugs.freedesktop.org/show_bug.cgi?id=");
+
+  g_test_add ("/contact-search/no-limit", Test, NULL, setup,
+      test_no_limit, teardown);
+  g_test_add ("/contact-search/limit", Test, NULL, setup,
+      test_limit, teardown);
+
+  return tp_tests_run_with_bus ();
+}
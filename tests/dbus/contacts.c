@@ -205,6 +205,80 @@ contact_info_notify_cb (TpContact *contact,
   finish (result);
 }
 
+static void
+contact_info_count_notify_cb (TpContact *contact,
+    GParamSpec *pspec,
+    guint *n_notifies)
+{
+  (*n_notifies)++;
+}
+
+/* A vCard with several fields, the first of which is @name */
+static GPtrArray *
+contact_info_new_multi_field (const gchar *name)
+{
+  const gchar *fn[] = { name, NULL };
+  const gchar *tel_parameters[] = { "type=cell", NULL };
+  const gchar *tel[] = { "+1 555 0100", NULL };
+  const gchar *n[] = { "Doe", "John", "", "", "", NULL };
+  GPtrArray *info;
+
+  info = g_ptr_array_new_with_free_func ((GDestroyNotify) tp_value_array_free);
+  g_ptr_array_add (info, tp_value_array_build (3,
+      G_TYPE_STRING, "fn",
+      G_TYPE_STRV, NULL,
+      G_TYPE_STRV, fn,
+      G_TYPE_INVALID));
+  g_ptr_array_add (info, tp_value_array_build (3,
+      G_TYPE_STRING, "tel",
+      G_TYPE_STRV, tel_parameters,
+      G_TYPE_STRV, tel,
+      G_TYPE_INVALID));
+  g_ptr_array_add (info, tp_value_array_build (3,
+      G_TYPE_STRING, "n",
+      G_TYPE_STRV, NULL,
+      G_TYPE_STRV, n,
+      G_TYPE_INVALID));
+
+  return info;
+}
+
+static void
+contact_info_verify_multi_field (TpContact *contact,
+    const gchar *name)
+{
+  GList *info, *l;
+  TpContactInfoField *field;
+
+  g_assert (tp_contact_has_feature (contact, TP_CONTACT_FEATURE_CONTACT_INFO));
+
+  info = tp_contact_get_contact_info (contact);
+  g_assert_cmpuint (g_list_length (info), ==, 3);
+
+  l = info;
+  field = l->data;
+  g_assert_cmpstr (field->field_name, ==, "fn");
+  g_assert (field->parameters[0] == NULL);
+  g_assert_cmpstr (field->field_value[0], ==, name);
+  g_assert (field->field_value[1] == NULL);
+
+  l = l->next;
+  field = l->data;
+  g_assert_cmpstr (field->field_name, ==, "tel");
+  g_assert_cmpstr (field->parameters[0], ==, "type=cell");
+  g_assert (field->parameters[1] == NULL);
+  g_assert_cmpstr (field->field_value[0], ==, "+1 555 0100");
+
+  l = l->next;
+  field = l->data;
+  g_assert_cmpstr (field->field_name, ==, "n");
+  g_assert_cmpstr (field->field_value[0], ==, "Doe");
+  g_assert_cmpstr (field->field_value[1], ==, "John");
+  g_assert_cmpuint (g_strv_length (field->field_value), ==, 5);
+
+  g_list_free (info);
+}
+
 static void
 contact_info_prepare_cb (GObject *object,
     GAsyncResult *res,
@@ -324,6 +398,8 @@ test_contact_info (Fixture *f,
   GList *info_list = NULL;
   GQuark conn_features[] = { TP_CONNECTION_FEATURE_CONTACT_INFO, 0 };
   GCancellable *cancellable;
+  GPtrArray *multi_field_info;
+  guint n_notifies = 0;
 
   /* Create fake info fields */
   info = g_ptr_array_new_with_free_func ((GDestroyNotify) tp_value_array_free);
@@ -478,12 +554,354 @@ test_contact_info (Fixture *f,
   reset_result (&result);
   tp_handle_unref (service_repo, handle);
 
+  /* TEST7: Signal a vCard with several fields twice. The second, identical
+   * one must not be notified. */
+  handle = tp_handle_ensure (service_repo, "info-test-7", NULL, NULL);
+  tp_connection_get_contacts_by_handle (client_conn,
+      1, &handle,
+      G_N_ELEMENTS (features), features,
+      by_handle_cb,
+      &result, finish, NULL);
+  g_main_loop_run (result.loop);
+  g_assert_no_error (result.error);
+
+  contact = g_ptr_array_index (result.contacts, 0);
+  g_signal_connect (contact, "notify::contact-info",
+      G_CALLBACK (contact_info_count_notify_cb), &n_notifies);
+
+  multi_field_info = contact_info_new_multi_field ("Seven");
+  tp_tests_contacts_connection_change_contact_info (service_conn, handle,
+      multi_field_info);
+  g_ptr_array_unref (multi_field_info);
+  tp_tests_proxy_run_until_dbus_queue_processed (client_conn);
+  g_assert_cmpuint (n_notifies, ==, 1);
+  contact_info_verify_multi_field (contact, "Seven");
+
+  multi_field_info = contact_info_new_multi_field ("Seven");
+  tp_tests_contacts_connection_change_contact_info (service_conn, handle,
+      multi_field_info);
+  g_ptr_array_unref (multi_field_info);
+  tp_tests_proxy_run_until_dbus_queue_processed (client_conn);
+  g_assert_cmpuint (n_notifies, ==, 1);
+  contact_info_verify_multi_field (contact, "Seven");
+
+  reset_result (&result);
+  tp_handle_unref (service_repo, handle);
+
   /* Cleanup */
   g_main_loop_unref (result.loop);
   g_ptr_array_unref (info);
   tp_contact_info_list_free (info_list);
 }
 
+static guint n_shared_requests;
+
+static void
+contact_info_shared_request_cb (GObject *object,
+    GAsyncResult *res,
+    gpointer user_data)
+{
+  TpContact *contact = TP_CONTACT (object);
+  gboolean expect_cancelled = GPOINTER_TO_UINT (user_data);
+  GError *error = NULL;
+
+  tp_contact_request_contact_info_finish (contact, res, &error);
+
+  if (expect_cancelled)
+    {
+      g_assert_error (error, G_IO_ERROR, G_IO_ERROR_CANCELLED);
+      g_clear_error (&error);
+    }
+  else
+    {
+      g_assert_no_error (error);
+      contact_info_verify (contact);
+    }
+
+  n_shared_requests--;
+}
+
+static void
+contact_info_batch_cb (GObject *object,
+    GAsyncResult *res,
+    gpointer user_data)
+{
+  Result *result = user_data;
+
+  tp_connection_request_contact_info_finish (TP_CONNECTION (object), res,
+      &result->error);
+  finish (result);
+}
+
+static void
+test_contact_info_batch (Fixture *f,
+    gconstpointer unused G_GNUC_UNUSED)
+{
+  TpTestsContactsConnection *service_conn = f->service_conn;
+  TpConnection *client_conn = f->client_conn;
+  Result result = { g_main_loop_new (NULL, FALSE), NULL, NULL, NULL };
+  const gchar *field_value[] = { "Foo", NULL };
+  const gchar *ids[] = { "batch-1", "batch-2", "batch-3" };
+  TpHandle handles[G_N_ELEMENTS (ids)];
+  TpContact *contacts[G_N_ELEMENTS (ids)];
+  GCancellable *cancellable;
+  GPtrArray *info;
+  guint i;
+
+  info = g_ptr_array_new_with_free_func ((GDestroyNotify) tp_value_array_free);
+  g_ptr_array_add (info, tp_value_array_build (3,
+      G_TYPE_STRING, "n",
+      G_TYPE_STRV, NULL,
+      G_TYPE_STRV, field_value,
+      G_TYPE_INVALID));
+
+  tp_tests_contacts_connection_set_default_contact_info (service_conn, info);
+
+  for (i = 0; i < G_N_ELEMENTS (ids); i++)
+    handles[i] = tp_handle_ensure (f->service_repo, ids[i], NULL, NULL);
+
+  /* the CM already knows the first contact's vCard; the others will have
+   * to be requested */
+  tp_tests_contacts_connection_change_contact_info (service_conn,
+      handles[0], info);
+
+  tp_connection_get_contacts_by_handle (client_conn,
+      G_N_ELEMENTS (handles), handles,
+      0, NULL,
+      by_handle_cb,
+      &result, finish, NULL);
+  g_main_loop_run (result.loop);
+  g_assert_no_error (result.error);
+
+  for (i = 0; i < G_N_ELEMENTS (ids); i++)
+    {
+      contacts[i] = g_object_ref (g_ptr_array_index (result.contacts, i));
+      g_assert (tp_contact_get_contact_info (contacts[i]) == NULL);
+    }
+
+  reset_result (&result);
+
+  /* Two requests for the same contact share a call: cancelling the first
+   * does not affect the second */
+  cancellable = g_cancellable_new ();
+  n_shared_requests = 2;
+  tp_contact_request_contact_info_async (contacts[1], cancellable,
+      contact_info_shared_request_cb, GUINT_TO_POINTER (TRUE));
+  tp_contact_request_contact_info_async (contacts[1], NULL,
+      contact_info_shared_request_cb, GUINT_TO_POINTER (FALSE));
+  g_cancellable_cancel (cancellable);
+
+  while (n_shared_requests > 0)
+    g_main_context_iteration (NULL, TRUE);
+
+  g_object_unref (cancellable);
+  g_assert_cmpuint (tp_tests_contacts_connection_get_n_contact_info_requests (
+        service_conn, handles[1]), ==, 1);
+
+  /* Requesting all of them at once */
+  tp_connection_request_contact_info_async (client_conn,
+      G_N_ELEMENTS (contacts), contacts, NULL, contact_info_batch_cb,
+      &result);
+  g_main_loop_run (result.loop);
+  g_assert_no_error (result.error);
+
+  /* The CM gave the vCards it had with their attributes: only the third
+   * one was requested from the network */
+  g_assert_cmpuint (tp_tests_contacts_connection_get_n_contact_info_requests (
+        service_conn, handles[0]), ==, 0);
+  g_assert_cmpuint (tp_tests_contacts_connection_get_n_contact_info_requests (
+        service_conn, handles[1]), ==, 1);
+  g_assert_cmpuint (tp_tests_contacts_connection_get_n_contact_info_requests (
+        service_conn, handles[2]), ==, 1);
+
+  for (i = 0; i < G_N_ELEMENTS (ids); i++)
+    {
+      contact_info_verify (contacts[i]);
+      g_object_unref (contacts[i]);
+      tp_handle_unref (f->service_repo, handles[i]);
+    }
+
+  reset_result (&result);
+  g_main_loop_unref (result.loop);
+  g_ptr_array_unref (info);
+}
+
+/* Returns the number of vCards saved in the on-disk cache, for any
+ * account */
+static guint
+count_cached_vcards (void)
+{
+  gchar *path = g_build_filename (g_get_user_cache_dir (), "telepathy",
+      "contact-info", NULL);
+  GDir *dir = g_dir_open (path, 0, NULL);
+  const gchar *name;
+  guint n = 0;
+
+  if (dir == NULL)
+    {
+      g_free (path);
+      return 0;
+    }
+
+  while ((name = g_dir_read_name (dir)) != NULL)
+    {
+      gchar *account_path = g_build_filename (path, name, NULL);
+      GDir *account_dir = g_dir_open (account_path, 0, NULL);
+
+      if (account_dir != NULL)
+        {
+          while (g_dir_read_name (account_dir) != NULL)
+            n++;
+
+          g_dir_close (account_dir);
+        }
+
+      g_free (account_path);
+    }
+
+  g_dir_close (dir);
+  g_free (path);
+  return n;
+}
+
+static void
+test_contact_info_cache (Fixture *f,
+    gconstpointer unused G_GNUC_UNUSED)
+{
+  Result result = { g_main_loop_new (NULL, FALSE), NULL, NULL, NULL };
+  TpContactFeature features[] = { TP_CONTACT_FEATURE_CONTACT_INFO };
+  const gchar *ids[] = { "cache-attributes", "cache-request" };
+  TpHandle handles[G_N_ELEMENTS (ids)];
+  TpContact *contacts[G_N_ELEMENTS (ids)];
+  GPtrArray *info;
+  TpConnection *conn;
+  guint i;
+
+  g_assert_cmpuint (count_cached_vcards (), ==, 0);
+
+  tp_connection_set_contact_info_cache_enabled (f->client_conn, TRUE);
+
+  /* The CM already has the first contact's vCard; the second one's has to
+   * be requested */
+  info = contact_info_new_multi_field ("Cached");
+
+  for (i = 0; i < G_N_ELEMENTS (ids); i++)
+    handles[i] = tp_handle_ensure (f->service_repo, ids[i], NULL, NULL);
+
+  tp_tests_contacts_connection_change_contact_info (f->service_conn,
+      handles[0], info);
+  tp_tests_contacts_connection_set_default_contact_info (f->service_conn,
+      info);
+  g_ptr_array_unref (info);
+
+  tp_connection_get_contacts_by_handle (f->client_conn,
+      G_N_ELEMENTS (handles), handles,
+      G_N_ELEMENTS (features), features,
+      by_handle_cb,
+      &result, finish, NULL);
+  g_main_loop_run (result.loop);
+  g_assert_no_error (result.error);
+
+  for (i = 0; i < G_N_ELEMENTS (ids); i++)
+    contacts[i] = g_object_ref (g_ptr_array_index (result.contacts, i));
+
+  contact_info_verify_multi_field (contacts[0], "Cached");
+  g_assert (tp_contact_has_feature (contacts[1],
+        TP_CONTACT_FEATURE_CONTACT_INFO));
+  g_assert (tp_contact_get_contact_info (contacts[1]) == NULL);
+  reset_result (&result);
+
+  tp_connection_request_contact_info_async (f->client_conn, 1, &contacts[1],
+      NULL, contact_info_batch_cb, &result);
+  g_main_loop_run (result.loop);
+  g_assert_no_error (result.error);
+  contact_info_verify_multi_field (contacts[1], "Cached");
+  reset_result (&result);
+
+  /* both vCards are saved, in the background */
+  while (count_cached_vcards () < 2)
+    g_main_context_iteration (NULL, TRUE);
+
+  g_assert_cmpuint (count_cached_vcards (), ==, 2);
+
+  for (i = 0; i < G_N_ELEMENTS (ids); i++)
+    {
+      g_object_unref (contacts[i]);
+      tp_handle_unref (f->service_repo, handles[i]);
+    }
+
+  /* Connect again to the same account. The new CM does not know anyone's
+   * vCard, so they come from the cache. */
+  conn = f->client_conn;
+  g_object_add_weak_pointer ((GObject *) conn, (gpointer *) &conn);
+  tp_tests_connection_assert_disconnect_succeeds (conn);
+  g_object_unref (conn);
+  g_assert (conn == NULL);
+  f->client_conn = NULL;
+  f->service_repo = NULL;
+  tp_clear_object (&f->service_conn);
+  tp_clear_object (&f->base_connection);
+
+  tp_tests_create_conn (TP_TESTS_TYPE_CONTACTS_CONNECTION,
+      "me@test.com", TRUE, &f->base_connection, &f->client_conn);
+  f->service_conn = g_object_ref (f->base_connection);
+  f->service_repo = tp_base_connection_get_handles (f->base_connection,
+      TP_HANDLE_TYPE_CONTACT);
+
+  tp_connection_set_contact_info_cache_enabled (f->client_conn, TRUE);
+
+  for (i = 0; i < G_N_ELEMENTS (ids); i++)
+    handles[i] = tp_handle_ensure (f->service_repo, ids[i], NULL, NULL);
+
+  tp_connection_get_contacts_by_handle (f->client_conn,
+      G_N_ELEMENTS (handles), handles,
+      G_N_ELEMENTS (features), features,
+      by_handle_cb,
+      &result, finish, NULL);
+  g_main_loop_run (result.loop);
+  g_assert_no_error (result.error);
+
+  for (i = 0; i < G_N_ELEMENTS (ids); i++)
+    {
+      contacts[i] = g_object_ref (g_ptr_array_index (result.contacts, i));
+      contact_info_verify_multi_field (contacts[i], "Cached");
+    }
+
+  reset_result (&result);
+
+  /* The CM would now reply with a different vCard, but the saved ones are
+   * recent enough not to ask it */
+  info = contact_info_new_multi_field ("Changed");
+  tp_tests_contacts_connection_set_default_contact_info (f->service_conn,
+      info);
+  g_ptr_array_unref (info);
+
+  tp_connection_request_contact_info_async (f->client_conn,
+      G_N_ELEMENTS (contacts), contacts, NULL, contact_info_batch_cb,
+      &result);
+  g_main_loop_run (result.loop);
+  g_assert_no_error (result.error);
+
+  for (i = 0; i < G_N_ELEMENTS (ids); i++)
+    contact_info_verify_multi_field (contacts[i], "Cached");
+
+  reset_result (&result);
+
+  /* Disabling the cache deletes the saved vCards, in the background */
+  tp_connection_set_contact_info_cache_enabled (f->client_conn, FALSE);
+
+  while (count_cached_vcards () > 0)
+    g_main_context_iteration (NULL, TRUE);
+
+  for (i = 0; i < G_N_ELEMENTS (ids); i++)
+    {
+      g_object_unref (contacts[i]);
+      tp_handle_unref (f->service_repo, handles[i]);
+    }
+
+  g_main_loop_unref (result.loop);
+}
+
 static void
 prepare_avatar_requirements_cb (GObject *object,
     GAsyncResult *res,
@@ -2761,6 +3179,90 @@ test_contact_list (Fixture *f,
   g_ptr_array_unref (contacts);
 }
 
+static void
+contact_list_state_assert_contact_info_cb (TpConnection *connection,
+    GParamSpec *pspec,
+    gpointer user_data)
+{
+  gboolean *checked = user_data;
+  GPtrArray *contacts;
+  guint i;
+
+  if (tp_connection_get_contact_list_state (connection) !=
+      TP_CONTACT_LIST_STATE_SUCCESS)
+    return;
+
+  /* The vCards missing from the roster's attributes have been looked up
+   * in the cache by now */
+  contacts = tp_connection_dup_contact_list (connection);
+  g_assert_cmpuint (contacts->len, ==, 2);
+
+  for (i = 0; i < contacts->len; i++)
+    {
+      TpContact *contact = g_ptr_array_index (contacts, i);
+
+      g_assert (tp_contact_has_feature (contact,
+            TP_CONTACT_FEATURE_CONTACT_INFO));
+    }
+
+  g_ptr_array_unref (contacts);
+  *checked = TRUE;
+}
+
+static void
+test_contact_list_contact_info (Fixture *f,
+    gconstpointer unused G_GNUC_UNUSED)
+{
+  const GQuark conn_features[] = { TP_CONNECTION_FEATURE_CONTACT_LIST, 0 };
+  const GQuark feature_connected[] = { TP_CONNECTION_FEATURE_CONNECTED, 0 };
+  TpTestsContactListManager *manager;
+  TpSimpleClientFactory *factory;
+  const gchar *ids[] = { "roster-info-known", "roster-info-unknown" };
+  TpHandle handles[G_N_ELEMENTS (ids)];
+  GPtrArray *info;
+  gboolean checked = FALSE;
+  guint i;
+
+  manager = tp_tests_contacts_connection_get_contact_list_manager (
+      f->service_conn);
+
+  tp_connection_set_contact_info_cache_enabled (f->client_conn, TRUE);
+
+  factory = tp_proxy_get_factory (f->client_conn);
+  tp_simple_client_factory_add_contact_features_varargs (factory,
+      TP_CONTACT_FEATURE_CONTACT_INFO,
+      TP_CONTACT_FEATURE_INVALID);
+
+  /* The CM only has the first contact's vCard: the second one's is
+   * looked up in the cache, asynchronously */
+  for (i = 0; i < G_N_ELEMENTS (ids); i++)
+    handles[i] = tp_handle_ensure (f->service_repo, ids[i], NULL, NULL);
+
+  info = contact_info_new_multi_field ("Roster");
+  tp_tests_contacts_connection_change_contact_info (f->service_conn,
+      handles[0], info);
+  g_ptr_array_unref (info);
+
+  tp_tests_contact_list_manager_add_initial_contacts (manager,
+      G_N_ELEMENTS (handles), handles);
+
+  g_signal_connect (f->client_conn, "notify::contact-list-state",
+      G_CALLBACK (contact_list_state_assert_contact_info_cb), &checked);
+
+  tp_cli_connection_call_connect (f->client_conn, -1, NULL, NULL, NULL, NULL);
+  tp_tests_proxy_run_until_prepared (f->client_conn, feature_connected);
+  tp_tests_proxy_run_until_prepared (f->client_conn, conn_features);
+
+  while (tp_connection_get_contact_list_state (f->client_conn) !=
+      TP_CONTACT_LIST_STATE_SUCCESS)
+    g_main_context_iteration (NULL, TRUE);
+
+  g_assert (checked);
+
+  for (i = 0; i < G_N_ELEMENTS (ids); i++)
+    tp_handle_unref (f->service_repo, handles[i]);
+}
+
 typedef struct
 {
   Fixture *f;
@@ -3042,6 +3544,8 @@ main (int argc,
   ADD (avatar_data);
   ADD (avatar_data_after_token);
   ADD (contact_info);
+  ADD (contact_info_batch);
+  ADD (contact_info_cache);
   ADD (dup_if_possible);
   ADD (subscription_states);
   ADD (contact_groups);
@@ -3067,6 +3571,9 @@ main (int argc,
   g_test_add ("/contacts/initial-contact-list", Fixture, NULL,
       setup_no_connect, test_initial_contact_list, teardown);
 
+  g_test_add ("/contacts/contact-list-contact-info", Fixture, NULL,
+      setup_no_connect, test_contact_list_contact_info, teardown);
+
   g_test_add ("/contacts/self-contact", Fixture, NULL,
       setup_no_connect, test_self_contact, teardown);
 
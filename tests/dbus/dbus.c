@@ -1,9 +1,11 @@
 #include "config.h"
 
-#include <dbus/dbus-shared.h>
+#include <dbus/dbus.h>
+#include <dbus/dbus-glib-lowlevel.h>
 #include <glib.h>
 #include <telepathy-glib/dbus.h>
 #include <telepathy-glib/debug.h>
+#include <telepathy-glib/proxy.h>
 #include <telepathy-glib/util.h>
 
 #include "tests/lib/util.h"
@@ -330,6 +332,157 @@ cancel_watch_during_dispatch (void)
   g_assert_cmpstr (user_data_flags, ==, "..........");
 }
 
+static void
+namespace_noc (TpDBusDaemon *bus,
+    const gchar *name,
+    const gchar *new_owner,
+    gpointer user_data)
+{
+  g_ptr_array_add (events, g_strdup_printf ("%s %d", name, new_owner[0]));
+
+  if (!tp_strdiff (name, "com.example.Ns.A") && new_owner[0] != '\0')
+    {
+      g_assert (tp_dbus_daemon_request_name (bus, "com.example.NsOther",
+            FALSE, NULL));
+      g_assert (tp_dbus_daemon_request_name (bus, "com.example.Ns.B",
+            FALSE, NULL));
+      g_assert (tp_dbus_daemon_release_name (bus, "com.example.Ns.A", NULL));
+    }
+
+  if (events->len == 3)
+    g_main_loop_quit (mainloop);
+}
+
+static void
+test_watch_name_owner_namespace (void)
+{
+  TpDBusDaemon *bus = tp_dbus_daemon_dup (NULL);
+
+  events = g_ptr_array_new_with_free_func (g_free);
+
+  tp_dbus_daemon_watch_name_owner_namespace (bus, "com.example.Ns",
+      namespace_noc, NULL, NULL);
+  /* a second namespace, which is cancelled before anything happens */
+  tp_dbus_daemon_watch_name_owner_namespace (bus, "com.example",
+      namespace_noc, NULL, NULL);
+  g_assert (tp_dbus_daemon_cancel_name_owner_namespace_watch (bus,
+        "com.example", namespace_noc, NULL));
+  g_assert (!tp_dbus_daemon_cancel_name_owner_namespace_watch (bus,
+        "com.example", namespace_noc, NULL));
+
+  g_assert (tp_dbus_daemon_request_name (bus, "com.example.Ns.A", FALSE,
+        NULL));
+
+  mainloop = g_main_loop_new (NULL, FALSE);
+  g_main_loop_run (mainloop);
+
+  /* 58 == ':' - i.e. the beginning of a unique name. com.example.NsOther is
+   * not in the namespace, so it isn't reported. */
+  g_assert_cmpuint (events->len, ==, 3);
+  g_assert_cmpstr (g_ptr_array_index (events, 0), ==, "com.example.Ns.A 58");
+  g_assert_cmpstr (g_ptr_array_index (events, 1), ==, "com.example.Ns.B 58");
+  g_assert_cmpstr (g_ptr_array_index (events, 2), ==, "com.example.Ns.A 0");
+
+  g_assert (tp_dbus_daemon_cancel_name_owner_namespace_watch (bus,
+        "com.example.Ns", namespace_noc, NULL));
+
+  g_assert (tp_dbus_daemon_release_name (bus, "com.example.Ns.B", NULL));
+  g_assert (tp_dbus_daemon_release_name (bus, "com.example.NsOther", NULL));
+
+  g_ptr_array_unref (events);
+  events = NULL;
+  g_main_loop_unref (mainloop);
+  mainloop = NULL;
+  g_object_unref (bus);
+}
+
+static void
+record_noc (TpDBusDaemon *bus,
+    const gchar *name,
+    const gchar *new_owner,
+    gpointer user_data)
+{
+  g_ptr_array_add (events, g_strdup_printf ("[%s] %s %d",
+        (const gchar *) user_data, name, new_owner[0]));
+}
+
+/* Dispatch every message that has already arrived on @bus's connection
+ * without returning to the main loop in between, as happens when several
+ * signals arrive at once */
+static void
+dispatch_queued_messages (TpDBusDaemon *bus)
+{
+  DBusConnection *libdbus = dbus_g_connection_get_connection (
+      tp_proxy_get_dbus_connection (bus));
+
+  while (dbus_connection_get_dispatch_status (libdbus) ==
+      DBUS_DISPATCH_DATA_REMAINS)
+    dbus_connection_dispatch (libdbus);
+}
+
+static void
+test_coalesce_name_owner_changes (void)
+{
+  TpDBusDaemon *bus = tp_dbus_daemon_dup (NULL);
+
+  events = g_ptr_array_new_with_free_func (g_free);
+
+  tp_dbus_daemon_watch_name_owner (bus, "com.example.Coalesce.A",
+      record_noc, "A", NULL);
+  tp_dbus_daemon_watch_name_owner (bus, "com.example.Coalesce.B",
+      record_noc, "B", NULL);
+
+  while (events->len < 2)
+    g_main_context_iteration (NULL, TRUE);
+
+  g_assert_cmpstr (g_ptr_array_index (events, 0), ==,
+      "[A] com.example.Coalesce.A 0");
+  g_assert_cmpstr (g_ptr_array_index (events, 1), ==,
+      "[B] com.example.Coalesce.B 0");
+  g_ptr_array_set_size (events, 0);
+
+  /* The signals for these four changes are all received before any of
+   * them is dispatched. Both changes to A are reported as a single
+   * callback with its final owner; as A changed last, that callback comes
+   * after B's. */
+  g_assert (tp_dbus_daemon_request_name (bus, "com.example.Coalesce.A",
+        FALSE, NULL));
+  g_assert (tp_dbus_daemon_request_name (bus, "com.example.Coalesce.B",
+        FALSE, NULL));
+  g_assert (tp_dbus_daemon_release_name (bus, "com.example.Coalesce.A",
+        NULL));
+  g_assert (tp_dbus_daemon_request_name (bus, "com.example.Coalesce.A",
+        FALSE, NULL));
+
+  dispatch_queued_messages (bus);
+
+  while (events->len < 2)
+    g_main_context_iteration (NULL, TRUE);
+
+  while (g_main_context_iteration (NULL, FALSE))
+    ;
+
+  /* 58 == ':' - i.e. the beginning of a unique name */
+  g_assert_cmpuint (events->len, ==, 2);
+  g_assert_cmpstr (g_ptr_array_index (events, 0), ==,
+      "[B] com.example.Coalesce.B 58");
+  g_assert_cmpstr (g_ptr_array_index (events, 1), ==,
+      "[A] com.example.Coalesce.A 58");
+
+  g_assert (tp_dbus_daemon_cancel_name_owner_watch (bus,
+        "com.example.Coalesce.A", record_noc, "A"));
+  g_assert (tp_dbus_daemon_cancel_name_owner_watch (bus,
+        "com.example.Coalesce.B", record_noc, "B"));
+  g_assert (tp_dbus_daemon_release_name (bus, "com.example.Coalesce.A",
+        NULL));
+  g_assert (tp_dbus_daemon_release_name (bus, "com.example.Coalesce.B",
+        NULL));
+
+  g_ptr_array_unref (events);
+  events = NULL;
+  g_object_unref (bus);
+}
+
 int
 main (int argc,
       char **argv)
@@ -341,6 +494,10 @@ main (int argc,
   g_test_add_func ("/dbus-daemon/watch-name-owner", test_watch_name_owner);
   g_test_add_func ("/dbus-daemon/cancel-watch-during-dispatch",
       cancel_watch_during_dispatch);
+  g_test_add_func ("/dbus-daemon/watch-name-owner-namespace",
+      test_watch_name_owner_namespace);
+  g_test_add_func ("/dbus-daemon/coalesce-name-owner-changes",
+      test_coalesce_name_owner_changes);
 
   return tp_tests_run_with_bus ();
 }
@@ -254,6 +254,114 @@ test_get_messages (Test *test,
   g_assert_cmpstr (tp_debug_message_get_message (msg), ==, "message2");
 }
 
+static void
+get_messages_since_cb (GObject *source,
+    GAsyncResult *result,
+    gpointer user_data)
+{
+  Test *test = user_data;
+
+  tp_clear_pointer (&test->messages, g_ptr_array_unref);
+
+  test->messages = tp_debug_client_get_messages_since_finish (
+      TP_DEBUG_CLIENT (source), result, &test->error);
+
+  test->wait--;
+  if (test->wait <= 0)
+    g_main_loop_quit (test->mainloop);
+}
+
+static void
+test_get_messages_since (Test *test,
+    gconstpointer data G_GNUC_UNUSED)
+{
+  GTimeVal time_val = { 1000, 0 };
+  TpDebugMessage *msg;
+
+  tp_debug_sender_add_message (test->sender, &time_val, "domain1",
+      G_LOG_LEVEL_MESSAGE, "message1");
+  time_val.tv_sec = 2000;
+  tp_debug_sender_add_message (test->sender, &time_val, "domain2/category",
+      G_LOG_LEVEL_DEBUG, "message2");
+  time_val.tv_sec = 3000;
+  tp_debug_sender_add_message (test->sender, &time_val, "domain2",
+      G_LOG_LEVEL_WARNING, "message3");
+
+  tp_debug_client_get_messages_since_async (test->client, 1000, "domain2",
+      G_LOG_LEVEL_MASK, get_messages_since_cb, test);
+
+  test->wait = 1;
+  g_main_loop_run (test->mainloop);
+  g_assert_no_error (test->error);
+
+  g_assert_cmpuint (test->messages->len, ==, 2);
+  msg = g_ptr_array_index (test->messages, 0);
+  g_assert_cmpstr (tp_debug_message_get_message (msg), ==, "message2");
+  msg = g_ptr_array_index (test->messages, 1);
+  g_assert_cmpstr (tp_debug_message_get_message (msg), ==, "message3");
+
+  tp_debug_client_get_messages_since_async (test->client, 0, NULL,
+      G_LOG_LEVEL_WARNING | G_LOG_LEVEL_MESSAGE, get_messages_since_cb,
+      test);
+
+  test->wait = 1;
+  g_main_loop_run (test->mainloop);
+  g_assert_no_error (test->error);
+
+  g_assert_cmpuint (test->messages->len, ==, 2);
+  msg = g_ptr_array_index (test->messages, 0);
+  g_assert_cmpstr (tp_debug_message_get_message (msg), ==, "message1");
+  msg = g_ptr_array_index (test->messages, 1);
+  g_assert_cmpstr (tp_debug_message_get_message (msg), ==, "message3");
+
+  /* a domain only matches whole words */
+  tp_debug_client_get_messages_since_async (test->client, 0, "domain",
+      G_LOG_LEVEL_MASK, get_messages_since_cb, test);
+
+  test->wait = 1;
+  g_main_loop_run (test->mainloop);
+  g_assert_no_error (test->error);
+
+  g_assert_cmpuint (test->messages->len, ==, 0);
+
+  /* messages logged at exactly @since are included */
+  tp_debug_client_get_messages_since_async (test->client, 2000, NULL,
+      G_LOG_LEVEL_MASK, get_messages_since_cb, test);
+
+  test->wait = 1;
+  g_main_loop_run (test->mainloop);
+  g_assert_no_error (test->error);
+
+  g_assert_cmpuint (test->messages->len, ==, 2);
+  msg = g_ptr_array_index (test->messages, 0);
+  g_assert_cmpstr (tp_debug_message_get_message (msg), ==, "message2");
+  msg = g_ptr_array_index (test->messages, 1);
+  g_assert_cmpstr (tp_debug_message_get_message (msg), ==, "message3");
+}
+
+static void
+test_get_messages_unfiltered (Test *test,
+    gconstpointer data G_GNUC_UNUSED)
+{
+  GTimeVal time_val = { 0, 0 };
+  TpDebugMessage *msg;
+
+  /* tp_debug_client_get_messages_async() returns everything, even messages
+   * without a meaningful timestamp */
+  tp_debug_sender_add_message (test->sender, &time_val, "domain1",
+      G_LOG_LEVEL_MESSAGE, "message1");
+
+  tp_debug_client_get_messages_async (test->client, get_messages_cb, test);
+
+  test->wait = 1;
+  g_main_loop_run (test->mainloop);
+  g_assert_no_error (test->error);
+
+  g_assert_cmpuint (test->messages->len, ==, 1);
+  msg = g_ptr_array_index (test->messages, 0);
+  g_assert_cmpstr (tp_debug_message_get_message (msg), ==, "message1");
+}
+
 static void
 new_debug_message_cb (TpDebugClient *client,
     TpDebugMessage *message,
@@ -327,6 +435,10 @@ main (int argc,
       test_set_enabled, teardown);
   g_test_add ("/debug-client/get-messages", Test, NULL, setup,
       test_get_messages, teardown);
+  g_test_add ("/debug-client/get-messages-since", Test, NULL, setup,
+      test_get_messages_since, teardown);
+  g_test_add ("/debug-client/get-messages-unfiltered", Test, NULL, setup,
+      test_get_messages_unfiltered, teardown);
   g_test_add ("/debug-client/new-debug-message", Test, NULL, setup,
       test_new_debug_message, teardown);
   g_test_add ("/debug-client/get-messages-failed", Test, NULL, setup,
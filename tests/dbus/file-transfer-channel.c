@@ -11,6 +11,7 @@
 #include "config.h"
 
 #include <glib.h>
+#include <glib/gstdio.h>
 #include <string.h>
 
 #include <telepathy-glib/file-transfer-channel.h>
@@ -18,6 +19,8 @@
 #include <telepathy-glib/defs.h>
 #include <telepathy-glib/dbus.h>
 
+#include "telepathy-glib/file-transfer-channel-internal.h"
+
 #include "tests/lib/util.h"
 #include "tests/lib/debug.h"
 #include "tests/lib/simple-conn.h"
@@ -57,6 +60,9 @@ typedef struct {
 
     GError *error /* initialized where needed */;
     gint wait;
+
+    /* last notified value of local-transferred-bytes */
+    guint64 notified_bytes;
 } Test;
 
 
@@ -74,6 +80,15 @@ state_notify_cb (GObject *source,
     g_main_loop_quit (test->mainloop);
 }
 
+static void
+local_transferred_bytes_notify_cb (GObject *source,
+    GParamSpec *pspec,
+    Test *test)
+{
+  test->notified_bytes = tp_file_transfer_channel_get_local_transferred_bytes (
+      test->channel);
+}
+
 static void
 channel_prepared_cb (GObject *source,
     GAsyncResult *result,
@@ -412,6 +427,10 @@ test_properties (Test *test,
   g_assert_cmpuint (tp_file_transfer_channel_get_transferred_bytes
       (test->channel), ==, 42);
 
+  /* nothing has been moved locally yet, whatever the CM says */
+  g_assert_cmpuint (tp_file_transfer_channel_get_local_transferred_bytes
+      (test->channel), ==, 0);
+
   g_assert_cmpstr (tp_file_transfer_channel_get_service_name (test->channel),
       ==, "fit.service.name");
 
@@ -498,6 +517,87 @@ test_cancel_transfer (Test *test,
       ==, TP_FILE_TRANSFER_STATE_PENDING);
 }
 
+/* 300 KiB, so that the file is moved in several chunks */
+static GBytes *
+create_content (void)
+{
+  gsize len = 300 * 1024;
+  guchar *data = g_malloc (len);
+  gsize i;
+
+  for (i = 0; i < len; i++)
+    data[i] = i % 251;
+
+  return g_bytes_new_take (data, len);
+}
+
+static void
+test_provide_data (Test *test,
+    gboolean zero_copy)
+{
+  GBytes *content = create_content ();
+  gchar *dir, *path;
+  GFile *file;
+
+  dir = g_dir_make_tmp ("tp-glib-tests.XXXXXX", &test->error);
+  g_assert_no_error (test->error);
+  path = g_build_filename (dir, "provide", NULL);
+  g_file_set_contents (path, g_bytes_get_data (content, NULL),
+      g_bytes_get_size (content), &test->error);
+  g_assert_no_error (test->error);
+
+  create_file_transfer_channel (test, TRUE, TP_SOCKET_ADDRESS_TYPE_UNIX,
+      TP_SOCKET_ACCESS_CONTROL_LOCALHOST);
+
+  _tp_file_transfer_channel_set_zero_copy_enabled (test->channel, zero_copy);
+  g_object_set (test->channel, "chunk-size", 16 * 1024, NULL);
+  g_signal_connect (test->channel, "notify::local-transferred-bytes",
+      G_CALLBACK (local_transferred_bytes_notify_cb), test);
+
+  file = g_file_new_for_path (path);
+  tp_file_transfer_channel_provide_file_async (test->channel,
+      file, file_provide_cb, test);
+  g_object_unref (file);
+
+  test->wait = 1;
+  g_main_loop_run (test->mainloop);
+  g_assert_no_error (test->error);
+
+  /* the CM has read everything, and we've told the world about it */
+  while (tp_tests_file_transfer_channel_get_received (test->chan_service)
+      == NULL || test->notified_bytes < g_bytes_get_size (content))
+    g_main_context_iteration (NULL, TRUE);
+
+  g_assert (g_bytes_equal (content,
+        tp_tests_file_transfer_channel_get_received (test->chan_service)));
+  g_assert_cmpuint (test->notified_bytes, ==, g_bytes_get_size (content));
+  g_assert_cmpuint (
+      tp_file_transfer_channel_get_local_transferred_bytes (test->channel),
+      ==, g_bytes_get_size (content));
+  g_assert_cmpuint (
+      tp_file_transfer_channel_get_local_throughput (test->channel), >, 0);
+
+  g_unlink (path);
+  g_rmdir (dir);
+  g_free (path);
+  g_free (dir);
+  g_bytes_unref (content);
+}
+
+static void
+test_provide_zero_copy (Test *test,
+    gconstpointer data G_GNUC_UNUSED)
+{
+  test_provide_data (test, TRUE);
+}
+
+static void
+test_provide_copy (Test *test,
+    gconstpointer data G_GNUC_UNUSED)
+{
+  test_provide_data (test, FALSE);
+}
+
 /* Test receiving files */
 static void
 test_accept_success (Test *test, gconstpointer data G_GNUC_UNUSED)
@@ -537,6 +637,72 @@ test_accept_success (Test *test, gconstpointer data G_GNUC_UNUSED)
   g_object_unref (file);
 }
 
+static void
+test_accept_data (Test *test,
+    gboolean zero_copy)
+{
+  GBytes *content = create_content ();
+  gchar *dir, *path, *received;
+  gsize len;
+  GFile *file;
+
+  dir = g_dir_make_tmp ("tp-glib-tests.XXXXXX", &test->error);
+  g_assert_no_error (test->error);
+  path = g_build_filename (dir, "accept", NULL);
+
+  create_file_transfer_channel (test, FALSE, TP_SOCKET_ADDRESS_TYPE_UNIX,
+      TP_SOCKET_ACCESS_CONTROL_LOCALHOST);
+  tp_tests_file_transfer_channel_set_content (test->chan_service, content);
+
+  _tp_file_transfer_channel_set_zero_copy_enabled (test->channel, zero_copy);
+  g_object_set (test->channel, "chunk-size", 16 * 1024, NULL);
+  g_signal_connect (test->channel, "notify::local-transferred-bytes",
+      G_CALLBACK (local_transferred_bytes_notify_cb), test);
+
+  file = g_file_new_for_path (path);
+  tp_file_transfer_channel_accept_file_async (test->channel,
+      file, 0, file_accept_cb, test);
+  g_object_unref (file);
+
+  test->wait = 1;
+  g_main_loop_run (test->mainloop);
+  g_assert_no_error (test->error);
+
+  /* the final notification is only emitted once everything was written */
+  while (test->notified_bytes < g_bytes_get_size (content))
+    g_main_context_iteration (NULL, TRUE);
+
+  g_assert_cmpuint (test->notified_bytes, ==, g_bytes_get_size (content));
+  g_assert_cmpuint (
+      tp_file_transfer_channel_get_local_throughput (test->channel), >, 0);
+
+  g_file_get_contents (path, &received, &len, &test->error);
+  g_assert_no_error (test->error);
+  g_assert_cmpuint (len, ==, g_bytes_get_size (content));
+  g_assert (memcmp (received, g_bytes_get_data (content, NULL), len) == 0);
+
+  g_unlink (path);
+  g_rmdir (dir);
+  g_free (received);
+  g_free (path);
+  g_free (dir);
+  g_bytes_unref (content);
+}
+
+static void
+test_accept_zero_copy (Test *test,
+    gconstpointer data G_GNUC_UNUSED)
+{
+  test_accept_data (test, TRUE);
+}
+
+static void
+test_accept_copy (Test *test,
+    gconstpointer data G_GNUC_UNUSED)
+{
+  test_accept_data (test, FALSE);
+}
+
 static void
 test_accept_twice (Test *test, gconstpointer data G_GNUC_UNUSED)
 {
@@ -613,5 +779,15 @@ main (int argc,
   g_test_add ("/file-transfer-channel/provide/cancel", Test, NULL, setup,
       test_cancel_transfer, teardown);
 
+  /* Move some data, with and without the zero-copy path */
+  g_test_add ("/file-transfer-channel/accept/zero-copy", Test, NULL, setup,
+      test_accept_zero_copy, teardown);
+  g_test_add ("/file-transfer-channel/accept/copy", Test, NULL, setup,
+      test_accept_copy, teardown);
+  g_test_add ("/file-transfer-channel/provide/zero-copy", Test, NULL, setup,
+      test_provide_zero_copy, teardown);
+  g_test_add ("/file-transfer-channel/provide/copy", Test, NULL, setup,
+      test_provide_copy, teardown);
+
   return tp_tests_run_with_bus ();
 }
@@ -10,6 +10,7 @@
 #include "config.h"
 
 #include <telepathy-glib/telepathy-glib.h>
+#include <telepathy-glib/proxy-internal.h>
 
 #include "tests/lib/util.h"
 #include "tests/lib/simple-account.h"
@@ -405,6 +406,47 @@ test_interface_later (Test *test,
         TP_TESTS_MY_CONN_PROXY_FEATURE_INTERFACE_LATER));
 }
 
+static void
+test_shared (Test *test,
+    gconstpointer data G_GNUC_UNUSED)
+{
+  GQuark features[] = { TP_CONNECTION_FEATURE_CAPABILITIES,
+      TP_TESTS_MY_CONN_PROXY_FEATURE_CORE, 0 };
+  GQuark same_features[] = { TP_TESTS_MY_CONN_PROXY_FEATURE_CORE,
+      TP_CONNECTION_FEATURE_CAPABILITIES, TP_TESTS_MY_CONN_PROXY_FEATURE_CORE,
+      0 };
+  guint i;
+
+  /* A burst of identical preparations: each one is completed once, whether
+   * or not it shares the underlying request */
+  for (i = 0; i < 100; i++)
+    {
+      _tp_proxy_prepare_shared_async (test->my_conn,
+          (i % 2 == 0 ? features : same_features), prepare_cb, test);
+      test->wait++;
+    }
+
+  tp_proxy_prepare_async (test->my_conn, features, prepare_cb, test);
+  test->wait++;
+
+  g_main_loop_run (test->mainloop);
+  g_assert_no_error (test->error);
+  g_assert_cmpint (test->wait, ==, 0);
+
+  g_assert (tp_proxy_is_prepared (test->my_conn,
+        TP_TESTS_MY_CONN_PROXY_FEATURE_CORE));
+  g_assert (tp_proxy_is_prepared (test->my_conn,
+        TP_CONNECTION_FEATURE_CAPABILITIES));
+
+  /* Once it has finished, asking again starts (and finishes) a new one */
+  _tp_proxy_prepare_shared_async (test->my_conn, features, prepare_cb, test);
+  test->wait++;
+
+  g_main_loop_run (test->mainloop);
+  g_assert_no_error (test->error);
+  g_assert_cmpint (test->wait, ==, 0);
+}
+
 int
 main (int argc,
       char **argv)
@@ -434,6 +476,8 @@ main (int argc,
       test_before_connected, teardown);
   g_test_add ("/proxy-preparation/interface-later", Test, NULL, setup,
       test_interface_later, teardown);
+  g_test_add ("/proxy-preparation/shared", Test, NULL, setup,
+      test_shared, teardown);
 
   return tp_tests_run_with_bus ();
 }
@@ -33,6 +33,8 @@ typedef struct {
     TpRoomList *room_list;
 
     GPtrArray *rooms; /* reffed TpRoomInfo */
+    guint n_batches;
+    guint n_batched_rooms;
     GError *error /* initialized where needed */;
     gint wait;
 } Test;
@@ -230,6 +232,92 @@ test_listing (Test *test,
   g_assert_cmpstr (tp_room_info_get_server (room), ==, "the server");
 }
 
+static void
+got_rooms_cb (TpRoomList *channel,
+    GPtrArray *rooms,
+    Test *test)
+{
+  test->n_batches++;
+  test->n_batched_rooms += rooms->len;
+
+  test->wait--;
+  if (test->wait <= 0)
+    g_main_loop_quit (test->mainloop);
+}
+
+static void
+test_filter (Test *test,
+    gconstpointer data G_GNUC_UNUSED)
+{
+  guint i;
+
+  create_room_list (test, "ManyRooms");
+  g_assert_no_error (test->error);
+
+  g_signal_connect (test->room_list, "got-room",
+      G_CALLBACK (got_room_cb), test);
+  g_signal_connect (test->room_list, "got-rooms",
+      G_CALLBACK (got_rooms_cb), test);
+
+  /* "Room 1" and "Room 10" to "Room 19" match the name, but "Room 1" is
+   * too small, and "Room 18" and "Room 19" are too big */
+  tp_room_list_set_filter (test->room_list, "room 1", 5, 17);
+  tp_room_list_start (test->room_list);
+
+  /* 8 got-room, and one got-rooms for the second batch only */
+  test->wait = 9;
+  g_main_loop_run (test->mainloop);
+  g_assert_no_error (test->error);
+
+  g_assert_cmpuint (test->n_batches, ==, 1);
+  g_assert_cmpuint (test->n_batched_rooms, ==, 8);
+  g_assert_cmpuint (test->rooms->len, ==, 8);
+
+  for (i = 0; i < test->rooms->len; i++)
+    {
+      TpRoomInfo *room = g_ptr_array_index (test->rooms, i);
+      gchar *name = g_strdup_printf ("Room %u", i + 10);
+
+      g_assert_cmpstr (tp_room_info_get_name (room), ==, name);
+      g_free (name);
+    }
+}
+
+static void
+test_max_rooms (Test *test,
+    gconstpointer data G_GNUC_UNUSED)
+{
+  TpRoomInfo *room;
+
+  create_room_list (test, "ManyRooms");
+  g_assert_no_error (test->error);
+
+  g_signal_connect (test->room_list, "got-room",
+      G_CALLBACK (got_room_cb), test);
+  g_signal_connect (test->room_list, "got-rooms",
+      G_CALLBACK (got_rooms_cb), test);
+
+  tp_room_list_set_filter (test->room_list, NULL, 0, 18);
+  tp_room_list_set_max_rooms (test->room_list, 3);
+  tp_room_list_start (test->room_list);
+
+  /* the 3 largest rooms are only reported when listing finishes */
+  test->wait = 4;
+  g_main_loop_run (test->mainloop);
+  g_assert_no_error (test->error);
+
+  g_assert (!tp_room_list_is_listing (test->room_list));
+  g_assert_cmpuint (test->n_batches, ==, 1);
+  g_assert_cmpuint (test->rooms->len, ==, 3);
+
+  room = g_ptr_array_index (test->rooms, 0);
+  g_assert_cmpstr (tp_room_info_get_name (room), ==, "Room 18");
+  room = g_ptr_array_index (test->rooms, 1);
+  g_assert_cmpstr (tp_room_info_get_name (room), ==, "Room 17");
+  room = g_ptr_array_index (test->rooms, 2);
+  g_assert_cmpstr (tp_room_info_get_name (room), ==, "Room 16");
+}
+
 static void
 room_list_failed_cb (TpRoomList *room_list,
     GError *error,
@@ -311,6 +399,10 @@ main (int argc,
       test_properties, teardown);
   g_test_add ("/room-list-channel/listing", Test, NULL, setup,
       test_listing, teardown);
+  g_test_add ("/room-list-channel/filter", Test, NULL, setup,
+      test_filter, teardown);
+  g_test_add ("/room-list-channel/max-rooms", Test, NULL, setup,
+      test_max_rooms, teardown);
   g_test_add ("/room-list-channel/list-rooms-fail", Test, NULL, setup,
       test_list_room_fails, teardown);
   g_test_add ("/room-list-channel/invalidated", Test, NULL, setup,
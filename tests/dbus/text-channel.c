@@ -42,6 +42,9 @@ typedef struct {
     gchar *sent_token;
     TpMessageSendingFlags sending_flags;
 
+    guint n_chat_state_changes;
+    TpChannelChatState last_chat_state;
+
     GError *error /* initialized where needed */;
     gint wait;
 } Test;
@@ -969,6 +972,99 @@ test_receive_muc_delivery (Test *test,
   g_ptr_array_unref (parts);
 }
 
+static void
+emit_message_with_id (Test *test,
+    guint id,
+    const gchar *text)
+{
+  GPtrArray *parts;
+  GHashTable *part;
+
+  parts = g_ptr_array_new_with_free_func ((GDestroyNotify) g_hash_table_unref);
+
+  part = tp_asv_new (NULL, NULL);
+  tp_asv_set_uint32 (part, "message-type", TP_CHANNEL_TEXT_MESSAGE_TYPE_NORMAL);
+  tp_asv_set_uint32 (part, "pending-message-id", id);
+  g_ptr_array_add (parts, part);
+
+  part = tp_asv_new (NULL, NULL);
+  tp_asv_set_string (part, "content-type", "text/plain");
+  tp_asv_set_string (part, "content", text);
+  g_ptr_array_add (parts, part);
+
+  tp_svc_channel_interface_messages_emit_message_received (test->chan_service,
+      parts);
+
+  g_ptr_array_unref (parts);
+}
+
+static void
+test_duplicate_pending_message_id (Test *test,
+    gconstpointer data G_GNUC_UNUSED)
+{
+  GQuark features[] = { TP_TEXT_CHANNEL_FEATURE_INCOMING_MESSAGES, 0 };
+  GArray *ids;
+  GList *messages;
+  TpMessage *first;
+  guint id = 42;
+
+  tp_proxy_prepare_async (test->channel, features,
+      proxy_prepare_cb, test);
+
+  g_main_loop_run (test->mainloop);
+  g_assert_no_error (test->error);
+
+  g_signal_connect (test->channel, "message-received",
+      G_CALLBACK (message_received_cb), test);
+  g_signal_connect (test->channel, "pending-message-removed",
+      G_CALLBACK (pending_message_removed_cb), test);
+
+  /* A broken CM gives two pending messages the same ID */
+  emit_message_with_id (test, id, "Badger");
+
+  test->wait = 1;
+  g_main_loop_run (test->mainloop);
+  first = g_object_ref (test->received_msg);
+
+  emit_message_with_id (test, id, "Mushroom");
+
+  test->wait = 1;
+  g_main_loop_run (test->mainloop);
+
+  messages = tp_text_channel_dup_pending_messages (test->channel);
+  g_assert_cmpuint (g_list_length (messages), ==, 2);
+  g_list_free_full (messages, g_object_unref);
+
+  ids = g_array_new (FALSE, FALSE, sizeof (guint));
+  g_array_append_val (ids, id);
+
+  /* Each removal of the ID removes one message, oldest first */
+  tp_svc_channel_interface_messages_emit_pending_messages_removed (
+      test->chan_service, ids);
+
+  test->wait = 1;
+  g_main_loop_run (test->mainloop);
+
+  g_assert (test->removed_msg == first);
+  messages = tp_text_channel_dup_pending_messages (test->channel);
+  g_assert_cmpuint (g_list_length (messages), ==, 1);
+  g_assert (messages->data == test->received_msg);
+  g_list_free_full (messages, g_object_unref);
+
+  tp_svc_channel_interface_messages_emit_pending_messages_removed (
+      test->chan_service, ids);
+
+  test->wait = 1;
+  g_main_loop_run (test->mainloop);
+
+  g_assert (test->removed_msg == test->received_msg);
+  messages = tp_text_channel_dup_pending_messages (test->channel);
+  g_assert_cmpuint (g_list_length (messages), ==, 0);
+
+  g_array_unref (ids);
+  g_object_unref (first);
+}
+
 static void
 set_chat_state_cb (GObject *source,
     GAsyncResult *result,
@@ -1044,6 +1140,142 @@ test_chat_state (Test *test,
   g_assert_cmpuint (state, ==, TP_CHANNEL_CHAT_STATE_COMPOSING);
 }
 
+static void
+count_chat_state_changed_cb (TpTextChannel *channel,
+    TpContact *contact,
+    TpChannelChatState state,
+    Test *test)
+{
+  test->n_chat_state_changes++;
+  test->last_chat_state = state;
+
+  test->wait--;
+  if (test->wait <= 0)
+    g_main_loop_quit (test->mainloop);
+}
+
+static gboolean
+quit_loop_cb (gpointer user_data)
+{
+  Test *test = user_data;
+
+  g_main_loop_quit (test->mainloop);
+  return FALSE;
+}
+
+static void
+test_chat_state_coalescing (Test *test,
+    gconstpointer data G_GNUC_UNUSED)
+{
+  GQuark features[] = {
+      TP_CHANNEL_FEATURE_CONTACTS,
+      TP_TEXT_CHANNEL_FEATURE_CHAT_STATES,
+      0 };
+  GObject *chan_service = G_OBJECT (test->chan_service);
+  TpContact *contact;
+
+  tp_tests_proxy_run_until_prepared (test->channel, features);
+  contact = tp_channel_get_target_contact ((TpChannel *) test->channel);
+
+  g_signal_connect (test->channel, "contact-chat-state-changed",
+      G_CALLBACK (count_chat_state_changed_cb), test);
+
+  tp_message_mixin_set_chat_state_coalescing (chan_service, 50, 0);
+
+  /* a burst of changes is signalled once, with the final state */
+  tp_message_mixin_change_chat_state (chan_service, test->bob,
+      TP_CHANNEL_CHAT_STATE_COMPOSING);
+  tp_message_mixin_change_chat_state (chan_service, test->bob,
+      TP_CHANNEL_CHAT_STATE_PAUSED);
+  tp_message_mixin_change_chat_state (chan_service, test->bob,
+      TP_CHANNEL_CHAT_STATE_ACTIVE);
+  tp_message_mixin_change_chat_state (chan_service, test->bob,
+      TP_CHANNEL_CHAT_STATE_COMPOSING);
+
+  test->wait = 1;
+  g_main_loop_run (test->mainloop);
+  g_assert_cmpuint (test->n_chat_state_changes, ==, 1);
+  g_assert_cmpuint (test->last_chat_state, ==,
+      TP_CHANNEL_CHAT_STATE_COMPOSING);
+  g_assert_cmpuint (tp_text_channel_get_chat_state (test->channel, contact),
+      ==, TP_CHANNEL_CHAT_STATE_COMPOSING);
+
+  /* a burst that ends where it started is not signalled at all */
+  tp_message_mixin_change_chat_state (chan_service, test->bob,
+      TP_CHANNEL_CHAT_STATE_PAUSED);
+  tp_message_mixin_change_chat_state (chan_service, test->bob,
+      TP_CHANNEL_CHAT_STATE_COMPOSING);
+
+  g_timeout_add (250, quit_loop_cb, test);
+  g_main_loop_run (test->mainloop);
+  g_assert_cmpuint (test->n_chat_state_changes, ==, 1);
+
+  /* without coalescing, changes are signalled straight away, and a stale
+   * Paused state expires */
+  tp_message_mixin_set_chat_state_coalescing (chan_service, 0, 100);
+  tp_message_mixin_change_chat_state (chan_service, test->bob,
+      TP_CHANNEL_CHAT_STATE_PAUSED);
+
+  test->wait = 2;
+  g_main_loop_run (test->mainloop);
+  g_assert_cmpuint (test->n_chat_state_changes, ==, 3);
+  g_assert_cmpuint (test->last_chat_state, ==, TP_CHANNEL_CHAT_STATE_ACTIVE);
+  g_assert_cmpuint (tp_text_channel_get_chat_state (test->channel, contact),
+      ==, TP_CHANNEL_CHAT_STATE_ACTIVE);
+}
+
+static guint
+count_chat_states_sent (Test *test)
+{
+  guint n;
+
+  g_object_get (test->chan_service,
+      "chat-states-sent", &n,
+      NULL);
+  return n;
+}
+
+static void
+test_chat_state_duplicates (Test *test,
+    gconstpointer data G_GNUC_UNUSED)
+{
+  GQuark features[] = { TP_TEXT_CHANNEL_FEATURE_CHAT_STATES, 0 };
+
+  tp_tests_proxy_run_until_prepared (test->channel, features);
+  tp_message_mixin_set_chat_state_coalescing (G_OBJECT (test->chan_service),
+      50, 0);
+
+  tp_text_channel_set_chat_state_async (test->channel,
+      TP_CHANNEL_CHAT_STATE_COMPOSING, set_chat_state_cb, test);
+  test->wait = 1;
+  g_main_loop_run (test->mainloop);
+  g_assert_no_error (test->error);
+  g_assert_cmpuint (count_chat_states_sent (test), ==, 1);
+
+  /* setting the state we already sent is not passed on to the CM, even
+   * once the coalescing interval is over */
+  tp_text_channel_set_chat_state_async (test->channel,
+      TP_CHANNEL_CHAT_STATE_COMPOSING, set_chat_state_cb, test);
+  test->wait = 1;
+  g_main_loop_run (test->mainloop);
+  g_assert_no_error (test->error);
+
+  g_timeout_add (250, quit_loop_cb, test);
+  g_main_loop_run (test->mainloop);
+  g_assert_cmpuint (count_chat_states_sent (test), ==, 1);
+
+  /* a different state is */
+  tp_text_channel_set_chat_state_async (test->channel,
+      TP_CHANNEL_CHAT_STATE_PAUSED, set_chat_state_cb, test);
+  test->wait = 1;
+  g_main_loop_run (test->mainloop);
+  g_assert_no_error (test->error);
+
+  g_timeout_add (250, quit_loop_cb, test);
+  g_main_loop_run (test->mainloop);
+  g_assert_cmpuint (count_chat_states_sent (test), ==, 2);
+}
+
 int
 main (int argc,
       char **argv)
@@ -1077,10 +1309,16 @@ main (int argc,
       test_sender_prepared, teardown);
   g_test_add ("/text-channel/sent-with-no-sender", Test, NULL, setup,
       test_sent_with_no_sender, teardown);
+  g_test_add ("/text-channel/duplicate-pending-message-id", Test, NULL,
+      setup, test_duplicate_pending_message_id, teardown);
   g_test_add ("/text-channel/receive-muc-delivery", Test, NULL, setup,
       test_receive_muc_delivery, teardown);
   g_test_add ("/text-channel/chat-state", Test, NULL, setup,
       test_chat_state, teardown);
+  g_test_add ("/text-channel/chat-state-coalescing", Test, NULL, setup,
+      test_chat_state_coalescing, teardown);
+  g_test_add ("/text-channel/chat-state-duplicates", Test, NULL, setup,
+      test_chat_state_duplicates, teardown);
 
   return tp_tests_run_with_bus ();
 }
@@ -14,6 +14,7 @@
 #include <telepathy-glib/telepathy-glib.h>
 
 #include "tests/lib/contacts-conn.h"
+#include "tests/lib/tls-backend.h"
 #include "tests/lib/tls-certificate.h"
 #include "tests/lib/util.h"
 
@@ -31,16 +32,41 @@ typedef struct {
 
     GError *error /* initialized where needed */;
     gint wait;
+    GTlsCertificateFlags flags;
 } Test;
 
 
+static TpTestsTLSCertificate *
+create_service_cert (Test *test,
+    const gchar *path,
+    const gchar *data)
+{
+  TpTestsTLSCertificate *service_cert;
+  GPtrArray *chain_data;
+  GArray *cert;
+
+  chain_data = g_ptr_array_new_with_free_func ((GDestroyNotify) g_array_unref);
+
+  cert = g_array_new (TRUE, TRUE, sizeof (guchar));
+  g_array_append_vals (cert, data, strlen (data));
+  g_ptr_array_add (chain_data, cert);
+
+  service_cert = g_object_new (TP_TESTS_TYPE_TLS_CERTIFICATE,
+      "object-path", path,
+      "certificate-type", "x509",
+      "certificate-chain-data", chain_data,
+      "dbus-daemon", test->dbus,
+      NULL);
+
+  g_ptr_array_unref (chain_data);
+  return service_cert;
+}
+
 static void
 setup (Test *test,
        gconstpointer data)
 {
   gchar *path;
-  GPtrArray *chain_data;
-  GArray *cert;
 
   test->mainloop = g_main_loop_new (NULL, FALSE);
   test->dbus = tp_tests_dbus_daemon_dup_or_die ();
@@ -54,20 +80,7 @@ setup (Test *test,
   path = g_strdup_printf ("%s/TlsCertificate",
       tp_proxy_get_object_path (test->connection));
 
-  chain_data = g_ptr_array_new_with_free_func ((GDestroyNotify) g_array_unref);
-
-  cert = g_array_new (TRUE, TRUE, sizeof (guchar));
-  g_array_append_vals (cert, "BADGER", 6);
-  g_ptr_array_add (chain_data, cert);
-
-  test->service_cert = g_object_new (TP_TESTS_TYPE_TLS_CERTIFICATE,
-      "object-path", path,
-      "certificate-type", "x509",
-      "certificate-chain-data", chain_data,
-      "dbus-daemon", test->dbus,
-      NULL);
-
-  g_ptr_array_unref (chain_data);
+  test->service_cert = create_service_cert (test, path, "BADGER");
 
   test->cert = tp_tls_certificate_new (TP_PROXY (test->connection), path,
       &test->error);
@@ -306,6 +319,229 @@ test_reject (Test *test,
   g_object_unref (cert);
 }
 
+static void
+verify_failed_cb (GObject *source,
+    GAsyncResult *result,
+    gpointer user_data)
+{
+  Test *test = user_data;
+  GTlsCertificateFlags flags = 0;
+
+  g_assert (!tp_tls_certificate_verify_finish (TP_TLS_CERTIFICATE (source),
+        result, &flags, &test->error));
+
+  test->wait--;
+  if (test->wait <= 0)
+    g_main_loop_quit (test->mainloop);
+}
+
+static void
+test_cache (Test *test,
+    gconstpointer data G_GNUC_UNUSED)
+{
+  TpTLSCertificate *cert;
+
+  prepare_cert (test, test->cert);
+
+  /* A second certificate with the same chain, through the same factory */
+  cert = tp_tls_certificate_new (TP_PROXY (test->connection),
+      tp_proxy_get_object_path (test->cert), &test->error);
+  g_assert_no_error (test->error);
+  prepare_cert (test, cert);
+
+  /* The chain's data is shared */
+  g_assert (tp_tls_certificate_get_cert_data (cert) ==
+      tp_tls_certificate_get_cert_data (test->cert));
+
+  g_assert_cmpuint (tp_tls_certificate_get_cached_decision (cert), ==,
+      TP_TLS_CERTIFICATE_STATE_PENDING);
+
+  tp_tls_certificate_accept_async (test->cert, accept_cb, test);
+
+  test->wait = 1;
+  g_main_loop_run (test->mainloop);
+  g_assert_no_error (test->error);
+
+  /* The parent is not a channel, so we don't know which server the
+   * certificate was for, and the decision is not shared */
+  g_assert_cmpuint (tp_tls_certificate_get_cached_decision (cert), ==,
+      TP_TLS_CERTIFICATE_STATE_PENDING);
+
+  /* "BADGER" is not a test certificate, so verification cannot happen */
+  tp_tls_certificate_verify_async (cert, "example.com", NULL,
+      verify_failed_cb, test);
+
+  test->wait = 1;
+  g_main_loop_run (test->mainloop);
+  g_assert (test->error != NULL);
+  g_clear_error (&test->error);
+
+  g_object_unref (cert);
+}
+
+static TpChannel *
+create_tls_channel (Test *test,
+    const gchar *name,
+    const gchar *hostname)
+{
+  TpChannel *channel;
+  GHashTable *props;
+  gchar *path;
+
+  path = g_strdup_printf ("%s/%s", tp_proxy_get_object_path (test->connection),
+      name);
+  props = tp_asv_new (
+      TP_PROP_CHANNEL_CHANNEL_TYPE, G_TYPE_STRING,
+        TP_IFACE_CHANNEL_TYPE_SERVER_TLS_CONNECTION,
+      TP_PROP_CHANNEL_TARGET_HANDLE_TYPE, G_TYPE_UINT, TP_HANDLE_TYPE_NONE,
+      TP_PROP_CHANNEL_TYPE_SERVER_TLS_CONNECTION_HOSTNAME, G_TYPE_STRING,
+        hostname,
+      NULL);
+
+  channel = tp_simple_client_factory_ensure_channel (
+      tp_proxy_get_factory (test->connection), test->connection, path, props,
+      &test->error);
+  g_assert_no_error (test->error);
+
+  g_hash_table_unref (props);
+  g_free (path);
+  return channel;
+}
+
+static TpTLSCertificate *
+create_cert (Test *test,
+    gpointer parent,
+    const gchar *path)
+{
+  TpTLSCertificate *cert;
+
+  cert = tp_tls_certificate_new (parent, path, &test->error);
+  g_assert_no_error (test->error);
+  prepare_cert (test, cert);
+
+  return cert;
+}
+
+static void
+test_cache_decision (Test *test,
+    gconstpointer data G_GNUC_UNUSED)
+{
+  const gchar *path = tp_proxy_get_object_path (test->cert);
+  TpChannel *chan_a, *chan_a2, *chan_b;
+  TpTLSCertificate *cert_a, *cert_a2, *cert_b;
+
+  /* Three servers presenting the same chain, two of them for the same
+   * host name */
+  chan_a = create_tls_channel (test, "TLSChannelA", "a.example.com");
+  chan_a2 = create_tls_channel (test, "TLSChannelA2", "a.example.com");
+  chan_b = create_tls_channel (test, "TLSChannelB", "b.example.com");
+
+  cert_a = create_cert (test, chan_a, path);
+  cert_a2 = create_cert (test, chan_a2, path);
+  cert_b = create_cert (test, chan_b, path);
+
+  g_assert_cmpuint (tp_tls_certificate_get_cached_decision (cert_a2), ==,
+      TP_TLS_CERTIFICATE_STATE_PENDING);
+
+  tp_tls_certificate_accept_async (cert_a, accept_cb, test);
+
+  test->wait = 1;
+  g_main_loop_run (test->mainloop);
+  g_assert_no_error (test->error);
+
+  /* The decision is remembered for the same host... */
+  g_assert_cmpuint (tp_tls_certificate_get_cached_decision (cert_a), ==,
+      TP_TLS_CERTIFICATE_STATE_ACCEPTED);
+  g_assert_cmpuint (tp_tls_certificate_get_cached_decision (cert_a2), ==,
+      TP_TLS_CERTIFICATE_STATE_ACCEPTED);
+
+  /* ... but accepting the chain for one host doesn't mean trusting it for
+   * another one */
+  g_assert_cmpuint (tp_tls_certificate_get_cached_decision (cert_b), ==,
+      TP_TLS_CERTIFICATE_STATE_PENDING);
+
+  g_object_unref (cert_a);
+  g_object_unref (cert_a2);
+  g_object_unref (cert_b);
+  g_object_unref (chan_a);
+  g_object_unref (chan_a2);
+  g_object_unref (chan_b);
+}
+
+static void
+verify_cb (GObject *source,
+    GAsyncResult *result,
+    gpointer user_data)
+{
+  Test *test = user_data;
+  GTlsCertificateFlags flags = 0;
+
+  if (tp_tls_certificate_verify_finish (TP_TLS_CERTIFICATE (source),
+        result, &flags, &test->error))
+    test->flags = flags;
+
+  test->wait--;
+  if (test->wait <= 0)
+    g_main_loop_quit (test->mainloop);
+}
+
+static void
+verify (Test *test,
+    TpTLSCertificate *cert,
+    const gchar *identity)
+{
+  test->flags = G_TLS_CERTIFICATE_VALIDATE_ALL;
+  tp_tls_certificate_verify_async (cert, identity, NULL, verify_cb, test);
+
+  test->wait = 1;
+  g_main_loop_run (test->mainloop);
+  g_assert_no_error (test->error);
+}
+
+static void
+test_cache_verification (Test *test,
+    gconstpointer data G_GNUC_UNUSED)
+{
+  TpTestsTLSCertificate *service_cert;
+  TpTLSCertificate *cert1, *cert2;
+  gchar *path;
+  guint n;
+
+  path = g_strdup_printf ("%s/TlsCertificate2",
+      tp_proxy_get_object_path (test->connection));
+  service_cert = create_service_cert (test, path,
+      TP_TESTS_TLS_BACKEND_CERT_PREFIX "example.com");
+
+  cert1 = create_cert (test, test->connection, path);
+  cert2 = create_cert (test, test->connection, path);
+
+  n = tp_tests_tls_backend_get_n_verifications ();
+
+  verify (test, cert1, "example.com");
+  g_assert_cmpuint (test->flags, ==, 0);
+  g_assert_cmpuint (tp_tests_tls_backend_get_n_verifications (), ==, n + 1);
+
+  /* The result is reused for a certificate with the same chain */
+  verify (test, cert2, "example.com");
+  g_assert_cmpuint (test->flags, ==, 0);
+  g_assert_cmpuint (tp_tests_tls_backend_get_n_verifications (), ==, n + 1);
+
+  /* but not for another identity */
+  verify (test, cert2, "example.org");
+  g_assert_cmpuint (test->flags, ==, G_TLS_CERTIFICATE_BAD_IDENTITY);
+  g_assert_cmpuint (tp_tests_tls_backend_get_n_verifications (), ==, n + 2);
+
+  /* and the first result hasn't been overwritten */
+  verify (test, cert1, "example.com");
+  g_assert_cmpuint (test->flags, ==, 0);
+  g_assert_cmpuint (tp_tests_tls_backend_get_n_verifications (), ==, n + 2);
+
+  g_object_unref (cert1);
+  g_object_unref (cert2);
+  g_object_unref (service_cert);
+  g_free (path);
+}
+
 static void
 invalidated_cb (TpProxy *cert,
     guint domain,
@@ -337,6 +573,9 @@ int
 main (int argc,
       char **argv)
 {
+  /* this has to happen before anything uses TLS */
+  tp_tests_tls_backend_install ();
+
   tp_tests_init (&argc, &argv);
   g_test_bug_base ("http://bugs.freedesktop.org/show_bug.cgi?id=");
 
@@ -348,6 +587,12 @@ main (int argc,
       test_accept, teardown);
   g_test_add ("/tls-certificate/reject", Test, NULL, setup,
       test_reject, teardown);
+  g_test_add ("/tls-certificate/cache", Test, NULL, setup,
+      test_cache, teardown);
+  g_test_add ("/tls-certificate/cache/decision", Test, NULL, setup,
+      test_cache_decision, teardown);
+  g_test_add ("/tls-certificate/cache/verification", Test, NULL, setup,
+      test_cache_verification, teardown);
   g_test_add ("/tls-certificate/invalidated", Test, NULL, setup,
       test_invalidated, teardown);
 
@@ -0,0 +1,276 @@
+/* Micro-benchmark for TpHeap: compares it against the plain binary heap it
+ * replaced, at sizes from 10^3 up to 10^6 elements (or the size given on
+ * the command line). Run it by hand with "make heap-benchmark". */
+
+#include "config.h"
+
+#include <stdlib.h>
+
+#include <telepathy-glib/heap.h>
+
+/* ---- the binary heap TpHeap used to be, for comparison ---- */
+
+typedef struct {
+    GPtrArray *data;
+    GCompareFunc comparator;
+} OldHeap;
+
+#define OLD_INDEX(heap, index) (g_ptr_array_index ((heap)->data, (index)-1))
+
+static OldHeap *
+old_heap_new (GCompareFunc comparator)
+{
+  OldHeap *ret = g_slice_new (OldHeap);
+
+  ret->data = g_ptr_array_sized_new (64);
+  ret->comparator = comparator;
+  return ret;
+}
+
+static void
+old_heap_destroy (OldHeap *heap)
+{
+  g_ptr_array_unref (heap->data);
+  g_slice_free (OldHeap, heap);
+}
+
+static void
+old_heap_add (OldHeap *heap, gpointer element)
+{
+  guint m;
+
+  g_ptr_array_add (heap->data, element);
+  m = heap->data->len;
+  while (m != 1)
+    {
+      gpointer parent = OLD_INDEX (heap, m / 2);
+
+      if (heap->comparator (element, parent) < 0)
+        {
+          OLD_INDEX (heap, m / 2) = element;
+          OLD_INDEX (heap, m) = parent;
+          m /= 2;
+        }
+      else
+        break;
+    }
+}
+
+static gpointer
+old_extract_element (OldHeap *heap, int index)
+{
+  guint m = heap->data->len;
+  guint i = 1, j;
+  gpointer ret = OLD_INDEX (heap, index);
+
+  OLD_INDEX (heap, index) = OLD_INDEX (heap, m);
+
+  while (i * 2 <= m)
+    {
+      if ((i * 2 + 1 <= m)
+          && (heap->comparator (OLD_INDEX (heap, i * 2),
+              OLD_INDEX (heap, i * 2 + 1)) > 0))
+        j = i * 2 + 1;
+      else
+        j = i * 2;
+
+      if (heap->comparator (OLD_INDEX (heap, i), OLD_INDEX (heap, j)) > 0)
+        {
+          gpointer tmp = OLD_INDEX (heap, i);
+          OLD_INDEX (heap, i) = OLD_INDEX (heap, j);
+          OLD_INDEX (heap, j) = tmp;
+          i = j;
+        }
+      else
+        break;
+    }
+
+  g_ptr_array_remove_index (heap->data, m - 1);
+  return ret;
+}
+
+static gpointer
+old_heap_extract_first (OldHeap *heap)
+{
+  if (heap->data->len == 0)
+    return NULL;
+
+  return old_extract_element (heap, 1);
+}
+
+static void
+old_heap_remove (OldHeap *heap, gpointer element)
+{
+  guint i;
+
+  for (i = 1; i <= heap->data->len; i++)
+    {
+      if (element == OLD_INDEX (heap, i))
+        {
+          old_extract_element (heap, i);
+          break;
+        }
+    }
+}
+
+/* ---- the benchmark ---- */
+
+/* how many elements to remove by identity in the "remove" rows */
+#define N_REMOVALS 1000
+
+typedef struct {
+    gint64 priority;
+    TpHeapHandle *handle;
+} Item;
+
+static gint
+item_cmp (gconstpointer a, gconstpointer b)
+{
+  const Item *ia = a, *ib = b;
+
+  return (ia->priority < ib->priority) ? -1 :
+    (ia->priority == ib->priority) ? 0 : 1;
+}
+
+static Item *
+make_items (guint n)
+{
+  Item *items = g_new (Item, n);
+  guint i;
+
+  for (i = 0; i < n; i++)
+    {
+      items[i].priority = ((gint64) rand () << 16) ^ rand ();
+      items[i].handle = NULL;
+    }
+
+  return items;
+}
+
+static void
+report (const gchar *what, guint n, gint64 start)
+{
+  gint64 elapsed = g_get_monotonic_time () - start;
+
+  g_print ("%-28s %8u %12" G_GINT64_FORMAT " us %10.1f ns/elem\n",
+      what, n, elapsed, elapsed * 1000.0 / n);
+}
+
+static void
+bench_size (guint n)
+{
+  Item *items = make_items (n);
+  gpointer *pointers = g_new (gpointer, n);
+  OldHeap *old;
+  TpHeap *heap;
+  gint64 start;
+  guint i, step = MAX (n / N_REMOVALS, 1);
+
+  for (i = 0; i < n; i++)
+    pointers[i] = items + i;
+
+  /* add everything, then drain */
+
+  start = g_get_monotonic_time ();
+  old = old_heap_new (item_cmp);
+
+  for (i = 0; i < n; i++)
+    old_heap_add (old, items + i);
+
+  while (old_heap_extract_first (old) != NULL);
+
+  old_heap_destroy (old);
+  report ("old: add + extract", n, start);
+
+  start = g_get_monotonic_time ();
+  heap = tp_heap_new (item_cmp, NULL);
+
+  for (i = 0; i < n; i++)
+    tp_heap_add (heap, items + i);
+
+  while (tp_heap_extract_first (heap) != NULL);
+
+  tp_heap_destroy (heap);
+  report ("new: add + extract", n, start);
+
+  start = g_get_monotonic_time ();
+  heap = tp_heap_new_from_array (item_cmp, NULL, pointers, n);
+
+  while (tp_heap_extract_first (heap) != NULL);
+
+  tp_heap_destroy (heap);
+  report ("new: heapify + extract", n, start);
+
+  start = g_get_monotonic_time ();
+  heap = tp_heap_new_with_keys (NULL);
+
+  for (i = 0; i < n; i++)
+    tp_heap_add_with_key (heap, items + i, items[i].priority);
+
+  while (tp_heap_extract_first (heap) != NULL);
+
+  tp_heap_destroy (heap);
+  report ("new, keyed: add + extract", n, start);
+
+  /* remove N_REMOVALS elements spread across the heap */
+
+  old = old_heap_new (item_cmp);
+
+  for (i = 0; i < n; i++)
+    old_heap_add (old, items + i);
+
+  start = g_get_monotonic_time ();
+
+  for (i = 0; i < n; i += step)
+    old_heap_remove (old, items + i);
+
+  report ("old: remove (linear)", n / step, start);
+  old_heap_destroy (old);
+
+  heap = tp_heap_new (item_cmp, NULL);
+
+  for (i = 0; i < n; i++)
+    items[i].handle = tp_heap_add_with_handle (heap, items + i);
+
+  start = g_get_monotonic_time ();
+
+  for (i = 0; i < n; i += step)
+    tp_heap_remove_handle (heap, items[i].handle);
+
+  report ("new: remove (handle)", n / step, start);
+
+  /* reschedule N_REMOVALS elements, as a timer queue would */
+
+  start = g_get_monotonic_time ();
+
+  for (i = 1; i < n; i += step)
+    {
+      items[i].priority = ((gint64) rand () << 16) ^ rand ();
+      tp_heap_update_handle (heap, items[i].handle);
+    }
+
+  report ("new: update (handle)", n / step, start);
+  tp_heap_destroy (heap);
+
+  g_print ("\n");
+  g_free (pointers);
+  g_free (items);
+}
+
+int
+main (int argc,
+      char **argv)
+{
+  guint max = 1000000;
+  guint n;
+
+  if (argc > 1)
+    max = strtoul (argv[1], NULL, 10);
+
+  srand (42);
+
+  for (n = 1000; n <= max; n *= 10)
+    bench_size (n);
+
+  return 0;
+}
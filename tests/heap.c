@@ -12,30 +12,192 @@ static gint comparator_fn (gconstpointer a, gconstpointer b)
     return (a < b) ? -1 : (a == b) ? 0 : 1;
 }
 
-int
-main (int argc,
-      char **argv)
+/* drain @heap, checking that elements come out in order */
+static void
+check_order (TpHeap *heap, guint expected_size)
 {
-  TpHeap *heap = tp_heap_new (comparator_fn, NULL);
   guint prev = 0;
-  guint i;
+  guint n = 0;
 
-  srand (time (NULL));
+  g_assert_cmpuint (tp_heap_size (heap), ==, expected_size);
+
+  while (tp_heap_size (heap))
+    {
+      guint elem = GPOINTER_TO_INT (tp_heap_peek_first (heap));
+      g_assert (elem == GPOINTER_TO_UINT (tp_heap_extract_first (heap)));
+      g_assert (prev <= elem);
+      prev = elem;
+      n++;
+    }
+
+  g_assert_cmpuint (n, ==, expected_size);
+}
+
+static void
+test_add (void)
+{
+  TpHeap *heap = tp_heap_new (comparator_fn, NULL);
+  guint i;
 
   for (i=0; i<10000; i++)
     {
       tp_heap_add (heap, GUINT_TO_POINTER (rand ()));
     }
 
+  check_order (heap, 10000);
+  tp_heap_destroy (heap);
+}
+
+static void
+test_remove (void)
+{
+  TpHeap *heap = tp_heap_new (comparator_fn, NULL);
+  gint i;
+
+  for (i = 1; i <= 1000; i++)
+    {
+      tp_heap_add (heap, GINT_TO_POINTER (i));
+    }
+
+  /* removing from the middle must keep the heap in order */
+  for (i = 1000; i > 0; i -= 3)
+    {
+      tp_heap_remove (heap, GINT_TO_POINTER (i));
+    }
+
+  tp_heap_remove (heap, GUINT_TO_POINTER (12345));
+
+  check_order (heap, 1000 - 334);
+  tp_heap_destroy (heap);
+}
+
+static void
+test_from_array (void)
+{
+  gpointer elements[1000];
+  TpHeap *heap;
+  guint i;
+
+  for (i = 0; i < G_N_ELEMENTS (elements); i++)
+    {
+      elements[i] = GUINT_TO_POINTER (rand ());
+    }
+
+  heap = tp_heap_new_from_array (comparator_fn, NULL, elements,
+      G_N_ELEMENTS (elements));
+  check_order (heap, G_N_ELEMENTS (elements));
+  tp_heap_destroy (heap);
+
+  heap = tp_heap_new_from_array (comparator_fn, NULL, NULL, 0);
+  check_order (heap, 0);
+  tp_heap_destroy (heap);
+}
+
+typedef struct {
+    guint priority;
+    TpHeapHandle *handle;
+} Item;
+
+static gint
+item_cmp (gconstpointer a, gconstpointer b)
+{
+  const Item *ia = a, *ib = b;
+
+  return (ia->priority < ib->priority) ? -1 :
+    (ia->priority == ib->priority) ? 0 : 1;
+}
+
+static void
+test_handles (void)
+{
+  TpHeap *heap = tp_heap_new (item_cmp, NULL);
+  Item items[1000];
+  guint prev = 0;
+  guint i;
+
+  for (i = 0; i < G_N_ELEMENTS (items); i++)
+    {
+      items[i].priority = rand ();
+      items[i].handle = tp_heap_add_with_handle (heap, &items[i]);
+    }
+
+  /* change the priority of every other item in place, and remove every
+   * fifth item */
+  for (i = 0; i < G_N_ELEMENTS (items); i += 2)
+    {
+      items[i].priority = rand ();
+      tp_heap_update_handle (heap, items[i].handle);
+    }
+
+  for (i = 0; i < G_N_ELEMENTS (items); i += 5)
+    {
+      g_assert (tp_heap_remove_handle (heap, items[i].handle) == &items[i]);
+      items[i].handle = NULL;
+    }
+
+  g_assert_cmpuint (tp_heap_size (heap), ==, 800);
+
   while (tp_heap_size (heap))
     {
-      guint elem = GPOINTER_TO_INT (tp_heap_peek_first (heap));
-      g_assert (elem == GPOINTER_TO_UINT (tp_heap_extract_first (heap)));
-      g_assert (prev <= elem);
-      prev = elem;
+      Item *item = tp_heap_extract_first (heap);
+
+      g_assert (item->handle != NULL);
+      g_assert (prev <= item->priority);
+      prev = item->priority;
+    }
+
+  tp_heap_destroy (heap);
+}
+
+static void
+test_keys (void)
+{
+  TpHeap *heap = tp_heap_new_with_keys (NULL);
+  TpHeapHandle *handles[1000];
+  gint64 prev = G_MININT64;
+  guint i;
+
+  g_assert_cmpint (tp_heap_peek_first_key (heap), ==, G_MAXINT64);
+
+  for (i = 0; i < G_N_ELEMENTS (handles); i++)
+    {
+      handles[i] = tp_heap_add_with_key (heap, GUINT_TO_POINTER (i + 1),
+          rand ());
+    }
+
+  for (i = 0; i < G_N_ELEMENTS (handles); i += 3)
+    {
+      tp_heap_set_key (heap, handles[i], -(gint64) rand ());
+    }
+
+  for (i = 1; i < G_N_ELEMENTS (handles); i += 7)
+    {
+      tp_heap_remove_handle (heap, handles[i]);
+    }
+
+  while (tp_heap_size (heap))
+    {
+      gint64 key = tp_heap_peek_first_key (heap);
+
+      g_assert (tp_heap_extract_first (heap) != NULL);
+      g_assert_cmpint (prev, <=, key);
+      prev = key;
     }
 
   tp_heap_destroy (heap);
+}
+
+int
+main (int argc,
+      char **argv)
+{
+  srand (time (NULL));
+
+  test_add ();
+  test_remove ();
+  test_from_array ();
+  test_handles ();
+  test_keys ();
 
   return 0;
 }
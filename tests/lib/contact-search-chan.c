@@ -0,0 +1,310 @@
+/*
+ * contact-search-chan.c - a simple contact search channel
+ *
+ * Copyright © 2014 Collabora Ltd. <http://www.collabora.co.uk/>
+ *
+ * Copying and distribution of this file, with or without modification,
+ * are permitted in any medium without royalty provided the copyright
+ * notice and this notice are preserved.
+ */
+
+#include "config.h"
+
+#include "contact-search-chan.h"
+
+#include <telepathy-glib/telepathy-glib.h>
+#include <telepathy-glib/telepathy-glib-dbus.h>
+
+static void contact_search_iface_init (gpointer iface,
+    gpointer data);
+
+G_DEFINE_TYPE_WITH_CODE (TpTestsContactSearchChan,
+    tp_tests_contact_search_chan, TP_TYPE_BASE_CHANNEL,
+    G_IMPLEMENT_INTERFACE (TP_TYPE_SVC_CHANNEL_TYPE_CONTACT_SEARCH,
+      contact_search_iface_init))
+
+static const gchar * const search_keys[] = { "fn", NULL };
+
+enum {
+  PROP_SERVER = 1,
+  PROP_LIMIT,
+  PROP_AVAILABLE_SEARCH_KEYS,
+  PROP_SEARCH_STATE,
+  LAST_PROPERTY,
+};
+
+struct _TpTestsContactSearchChanPriv {
+  gchar *server;
+  guint limit;
+  TpChannelContactSearchState state;
+};
+
+static void
+tp_tests_contact_search_chan_get_property (GObject *object,
+    guint property_id,
+    GValue *value,
+    GParamSpec *pspec)
+{
+  TpTestsContactSearchChan *self = TP_TESTS_CONTACT_SEARCH_CHAN (object);
+
+  switch (property_id)
+    {
+      case PROP_SERVER:
+        g_value_set_string (value, self->priv->server);
+        break;
+      case PROP_LIMIT:
+        g_value_set_uint (value, self->priv->limit);
+        break;
+      case PROP_AVAILABLE_SEARCH_KEYS:
+        g_value_set_boxed (value, search_keys);
+        break;
+      case PROP_SEARCH_STATE:
+        g_value_set_uint (value, self->priv->state);
+        break;
+      default:
+        G_OBJECT_WARN_INVALID_PROPERTY_ID (object, property_id, pspec);
+        break;
+    }
+}
+
+static void
+tp_tests_contact_search_chan_set_property (GObject *object,
+    guint property_id,
+    const GValue *value,
+    GParamSpec *pspec)
+{
+  TpTestsContactSearchChan *self = TP_TESTS_CONTACT_SEARCH_CHAN (object);
+
+  switch (property_id)
+    {
+      case PROP_SERVER:
+        g_assert (self->priv->server == NULL); /* construct only */
+        self->priv->server = g_value_dup_string (value);
+        break;
+      case PROP_LIMIT:
+        self->priv->limit = g_value_get_uint (value);
+        break;
+      default:
+        G_OBJECT_WARN_INVALID_PROPERTY_ID (object, property_id, pspec);
+        break;
+    }
+}
+
+static void
+tp_tests_contact_search_chan_constructed (GObject *object)
+{
+  TpTestsContactSearchChan *self = TP_TESTS_CONTACT_SEARCH_CHAN (object);
+  void (*chain_up) (GObject *) =
+      ((GObjectClass *) tp_tests_contact_search_chan_parent_class)->constructed;
+
+  if (chain_up != NULL)
+    chain_up (object);
+
+  tp_base_channel_register (TP_BASE_CHANNEL (self));
+}
+
+static void
+tp_tests_contact_search_chan_finalize (GObject *object)
+{
+  TpTestsContactSearchChan *self = TP_TESTS_CONTACT_SEARCH_CHAN (object);
+  void (*chain_up) (GObject *) =
+      ((GObjectClass *) tp_tests_contact_search_chan_parent_class)->finalize;
+
+  g_free (self->priv->server);
+
+  if (chain_up != NULL)
+    chain_up (object);
+}
+
+static void
+fill_immutable_properties (TpBaseChannel *chan,
+    GHashTable *properties)
+{
+  TpBaseChannelClass *klass = TP_BASE_CHANNEL_CLASS (
+      tp_tests_contact_search_chan_parent_class);
+
+  klass->fill_immutable_properties (chan, properties);
+
+  tp_dbus_properties_mixin_fill_properties_hash (
+      G_OBJECT (chan), properties,
+      TP_IFACE_CHANNEL_TYPE_CONTACT_SEARCH, "Server",
+      TP_IFACE_CHANNEL_TYPE_CONTACT_SEARCH, "Limit",
+      TP_IFACE_CHANNEL_TYPE_CONTACT_SEARCH, "AvailableSearchKeys",
+      NULL);
+}
+
+static void
+contact_search_chan_close (TpBaseChannel *channel)
+{
+  tp_base_channel_destroyed (channel);
+}
+
+static void
+tp_tests_contact_search_chan_class_init (
+    TpTestsContactSearchChanClass *klass)
+{
+  GObjectClass *oclass = G_OBJECT_CLASS (klass);
+  TpBaseChannelClass *base_class = TP_BASE_CHANNEL_CLASS (klass);
+  GParamSpec *spec;
+  static TpDBusPropertiesMixinPropImpl contact_search_props[] = {
+      { "SearchState", "search-state", NULL, },
+      { "Limit", "limit", NULL, },
+      { "AvailableSearchKeys", "available-search-keys", NULL, },
+      { "Server", "server", NULL, },
+      { NULL }
+  };
+
+  oclass->get_property = tp_tests_contact_search_chan_get_property;
+  oclass->set_property = tp_tests_contact_search_chan_set_property;
+  oclass->constructed = tp_tests_contact_search_chan_constructed;
+  oclass->finalize = tp_tests_contact_search_chan_finalize;
+
+  base_class->channel_type = TP_IFACE_CHANNEL_TYPE_CONTACT_SEARCH;
+  base_class->target_handle_type = TP_HANDLE_TYPE_NONE;
+  base_class->fill_immutable_properties = fill_immutable_properties;
+  base_class->close = contact_search_chan_close;
+
+  spec = g_param_spec_string ("server", "server",
+      "Server",
+      "",
+      G_PARAM_READWRITE | G_PARAM_CONSTRUCT_ONLY | G_PARAM_STATIC_STRINGS);
+  g_object_class_install_property (oclass, PROP_SERVER, spec);
+
+  spec = g_param_spec_uint ("limit", "limit",
+      "Limit",
+      0, G_MAXUINT32, 0,
+      G_PARAM_READWRITE | G_PARAM_CONSTRUCT_ONLY | G_PARAM_STATIC_STRINGS);
+  g_object_class_install_property (oclass, PROP_LIMIT, spec);
+
+  spec = g_param_spec_boxed ("available-search-keys", "available search keys",
+      "AvailableSearchKeys",
+      G_TYPE_STRV,
+      G_PARAM_READABLE | G_PARAM_STATIC_STRINGS);
+  g_object_class_install_property (oclass, PROP_AVAILABLE_SEARCH_KEYS, spec);
+
+  spec = g_param_spec_uint ("search-state", "search state",
+      "SearchState",
+      0, G_MAXUINT32, TP_CHANNEL_CONTACT_SEARCH_STATE_NOT_STARTED,
+      G_PARAM_READABLE | G_PARAM_STATIC_STRINGS);
+  g_object_class_install_property (oclass, PROP_SEARCH_STATE, spec);
+
+  tp_dbus_properties_mixin_implement_interface (oclass,
+      TP_IFACE_QUARK_CHANNEL_TYPE_CONTACT_SEARCH,
+      tp_dbus_properties_mixin_getter_gobject_properties, NULL,
+      contact_search_props);
+
+  g_type_class_add_private (klass, sizeof (TpTestsContactSearchChanPriv));
+}
+
+static void
+tp_tests_contact_search_chan_init (TpTestsContactSearchChan *self)
+{
+  self->priv = G_TYPE_INSTANCE_GET_PRIVATE (self,
+      TP_TESTS_TYPE_CONTACT_SEARCH_CHAN, TpTestsContactSearchChanPriv);
+}
+
+static void
+change_state (TpTestsContactSearchChan *self,
+    TpChannelContactSearchState state)
+{
+  GHashTable *details = tp_asv_new (NULL, NULL);
+
+  self->priv->state = state;
+  tp_svc_channel_type_contact_search_emit_search_state_changed (self,
+      state, "", details);
+
+  g_hash_table_unref (details);
+}
+
+static void
+add_numbered_result (GHashTable *results,
+    guint n)
+{
+  const gchar * const field_params[] = { NULL };
+  gchar *field_values[] = { NULL, NULL };
+  GPtrArray *info;
+
+  field_values[0] = g_strdup_printf ("Contact %u", n);
+
+  info = g_ptr_array_new_with_free_func (
+      (GDestroyNotify) tp_value_array_free);
+  g_ptr_array_add (info, tp_value_array_build (3,
+        G_TYPE_STRING, "fn",
+        G_TYPE_STRV, field_params,
+        G_TYPE_STRV, field_values,
+        G_TYPE_INVALID));
+
+  g_hash_table_insert (results, g_strdup_printf ("contact%u@example.com", n),
+      info);
+
+  g_free (field_values[0]);
+}
+
+/* Find TP_TESTS_CONTACT_SEARCH_CHAN_N_RESULTS contacts, in two batches,
+ * whatever the limit is, and finish searching */
+static gboolean
+find_contacts (gpointer data)
+{
+  TpTestsContactSearchChan *self = TP_TESTS_CONTACT_SEARCH_CHAN (data);
+  GHashTable *results;
+  guint i;
+
+  results = g_hash_table_new_full (g_str_hash, g_str_equal, g_free,
+      (GDestroyNotify) g_ptr_array_unref);
+
+  for (i = 0; i < TP_TESTS_CONTACT_SEARCH_CHAN_N_RESULTS; i++)
+    {
+      add_numbered_result (results, i);
+
+      if (g_hash_table_size (results) ==
+          TP_TESTS_CONTACT_SEARCH_CHAN_N_RESULTS / 2)
+        {
+          tp_svc_channel_type_contact_search_emit_search_result_received (
+              self, results);
+          g_hash_table_remove_all (results);
+        }
+    }
+
+  tp_svc_channel_type_contact_search_emit_search_result_received (self,
+      results);
+  g_hash_table_unref (results);
+
+  change_state (self, TP_CHANNEL_CONTACT_SEARCH_STATE_COMPLETED);
+  return FALSE;
+}
+
+static void
+contact_search_search (TpSvcChannelTypeContactSearch *chan,
+    GHashTable *terms,
+    DBusGMethodInvocation *context)
+{
+  TpTestsContactSearchChan *self = TP_TESTS_CONTACT_SEARCH_CHAN (chan);
+
+  if (self->priv->state != TP_CHANNEL_CONTACT_SEARCH_STATE_NOT_STARTED)
+    {
+      GError error = { TP_ERROR, TP_ERROR_NOT_AVAILABLE,
+          "Already searched" };
+
+      dbus_g_method_return_error (context, &error);
+      return;
+    }
+
+  change_state (self, TP_CHANNEL_CONTACT_SEARCH_STATE_IN_PROGRESS);
+
+  g_idle_add_full (G_PRIORITY_DEFAULT_IDLE, find_contacts,
+      g_object_ref (self), g_object_unref);
+
+  tp_svc_channel_type_contact_search_return_from_search (context);
+}
+
+static void
+contact_search_iface_init (gpointer iface,
+    gpointer data)
+{
+  TpSvcChannelTypeContactSearchClass *klass = iface;
+
+#define IMPLEMENT(x) \
+  tp_svc_channel_type_contact_search_implement_##x (klass, contact_search_##x)
+  IMPLEMENT(search);
+#undef IMPLEMENT
+}
@@ -94,6 +94,8 @@ struct _TpTestsContactsConnectionPrivate
   /* TpHandle => GPtrArray * */
   GHashTable *contact_info;
   GPtrArray *default_contact_info;
+  /* TpHandle => number of RequestContactInfo calls */
+  GHashTable *contact_info_requests;
 
   TpTestsContactListManager *list_manager;
 };
@@ -160,6 +162,8 @@ tp_tests_contacts_connection_init (TpTestsContactsConnection *self)
       g_direct_equal, NULL, (GDestroyNotify) free_rcc_list);
   self->priv->contact_info = g_hash_table_new_full (g_direct_hash,
       g_direct_equal, NULL, (GDestroyNotify) g_ptr_array_unref);
+  self->priv->contact_info_requests = g_hash_table_new (g_direct_hash,
+      g_direct_equal);
 }
 
 static void
@@ -175,6 +179,7 @@ finalize (GObject *object)
   g_hash_table_unref (self->priv->locations);
   g_hash_table_unref (self->priv->capabilities);
   g_hash_table_unref (self->priv->contact_info);
+  g_hash_table_unref (self->priv->contact_info_requests);
 
   if (self->priv->default_contact_info != NULL)
     g_ptr_array_unref (self->priv->default_contact_info);
@@ -796,6 +801,15 @@ tp_tests_contacts_connection_set_default_contact_info (
   self->priv->default_contact_info = g_ptr_array_ref (info);
 }
 
+guint
+tp_tests_contacts_connection_get_n_contact_info_requests (
+    TpTestsContactsConnection *self,
+    TpHandle handle)
+{
+  return GPOINTER_TO_UINT (g_hash_table_lookup (
+        self->priv->contact_info_requests, GUINT_TO_POINTER (handle)));
+}
+
 static void
 my_get_alias_flags (TpSvcConnectionInterfaceAliasing *aliasing,
                     DBusGMethodInvocation *context)
@@ -1308,6 +1322,11 @@ my_request_contact_info (TpSvcConnectionInterfaceContactInfo *obj,
       return;
     }
 
+  g_hash_table_insert (self->priv->contact_info_requests,
+      GUINT_TO_POINTER (handle), GUINT_TO_POINTER (
+        tp_tests_contacts_connection_get_n_contact_info_requests (self,
+          handle) + 1));
+
   ret = lookup_contact_info (self, handle);
 
   tp_svc_connection_interface_contact_info_return_from_request_contact_info (
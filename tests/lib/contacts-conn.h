@@ -111,6 +111,10 @@ void tp_tests_contacts_connection_set_default_contact_info (
     TpTestsContactsConnection *self,
     GPtrArray *info);
 
+guint tp_tests_contacts_connection_get_n_contact_info_requests (
+    TpTestsContactsConnection *self,
+    TpHandle handle);
+
 /* Legacy version (no Contacts interface, and no immortal handles) */
 
 typedef struct _TpTestsLegacyContactsConnection TpTestsLegacyContactsConnection;
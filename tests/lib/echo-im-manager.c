@@ -44,6 +44,11 @@ struct _TpTestsEchoImManagerPrivate
   /* GUINT_TO_POINTER (handle) => TpTestsEchoChannel */
   GHashTable *channels;
   gulong status_changed_id;
+
+  gboolean delay_new_channels;
+  /* GUINT_TO_POINTER (handle) => GUINT_TO_POINTER (idle source ID), for
+   * channels that will be created once the main loop is idle */
+  GHashTable *pending;
 };
 
 static void
@@ -54,6 +59,7 @@ tp_tests_echo_im_manager_init (TpTestsEchoImManager *self)
 
   self->priv->channels = g_hash_table_new_full (g_direct_hash, g_direct_equal,
       NULL, g_object_unref);
+  self->priv->pending = g_hash_table_new (g_direct_hash, g_direct_equal);
 }
 
 static void tp_tests_echo_im_manager_close_all (TpTestsEchoImManager *self);
@@ -157,6 +163,21 @@ tp_tests_echo_im_manager_class_init (TpTestsEchoImManagerClass *klass)
 static void
 tp_tests_echo_im_manager_close_all (TpTestsEchoImManager *self)
 {
+  if (self->priv->pending != NULL)
+    {
+      GHashTable *tmp = self->priv->pending;
+      GHashTableIter iter;
+      gpointer v;
+
+      self->priv->pending = NULL;
+      g_hash_table_iter_init (&iter, tmp);
+
+      while (g_hash_table_iter_next (&iter, NULL, &v))
+        g_source_remove (GPOINTER_TO_UINT (v));
+
+      g_hash_table_unref (tmp);
+    }
+
   if (self->priv->channels != NULL)
     {
       GHashTable *tmp = self->priv->channels;
@@ -257,6 +278,71 @@ new_channel (TpTestsEchoImManager *self,
   g_slist_free (requests);
 }
 
+typedef struct {
+    TpTestsEchoImManager *self;
+    TpHandle handle;
+    gpointer request_token;
+} DelayedChannel;
+
+static void
+delayed_channel_free (gpointer p)
+{
+  g_slice_free (DelayedChannel, p);
+}
+
+static gboolean
+delayed_channel_cb (gpointer p)
+{
+  DelayedChannel *delayed = p;
+  TpTestsEchoImManager *self = delayed->self;
+
+  g_hash_table_remove (self->priv->pending,
+      GUINT_TO_POINTER (delayed->handle));
+
+  /* the connection satisfies any requests for the same contact that it
+   * has queued meanwhile with this channel */
+  new_channel (self, delayed->handle,
+      tp_base_connection_get_self_handle (self->priv->conn),
+      delayed->request_token);
+  return FALSE;
+}
+
+/* Defer creating @handle's channel until the main loop is idle, so that
+ * more requests for it can arrive first. */
+static void
+delay_new_channel (TpTestsEchoImManager *self,
+    TpHandle handle,
+    gpointer request_token)
+{
+  DelayedChannel *delayed;
+  guint id;
+
+  /* the request stays outstanding in the connection until the channel is
+   * announced */
+  if (g_hash_table_contains (self->priv->pending, GUINT_TO_POINTER (handle)))
+    return;
+
+  delayed = g_slice_new (DelayedChannel);
+  delayed->self = self;
+  delayed->handle = handle;
+  delayed->request_token = request_token;
+
+  id = g_idle_add_full (G_PRIORITY_DEFAULT_IDLE, delayed_channel_cb,
+      delayed, delayed_channel_free);
+  g_hash_table_insert (self->priv->pending, GUINT_TO_POINTER (handle),
+      GUINT_TO_POINTER (id));
+}
+
+/* If @delay is TRUE, channels are only created when the main loop is idle,
+ * rather than straight away, so that several requests for the same contact
+ * can be outstanding at once. */
+void
+tp_tests_echo_im_manager_set_delay_new_channels (TpTestsEchoImManager *self,
+    gboolean delay)
+{
+  self->priv->delay_new_channels = delay;
+}
+
 static const gchar * const fixed_properties[] = {
     TP_PROP_CHANNEL_CHANNEL_TYPE,
     TP_PROP_CHANNEL_TARGET_HANDLE_TYPE,
@@ -321,7 +407,18 @@ tp_tests_echo_im_manager_request (TpTestsEchoImManager *self,
 
   chan = g_hash_table_lookup (self->priv->channels, GUINT_TO_POINTER (handle));
 
-  if (chan == NULL)
+  if (chan == NULL && require_new &&
+      g_hash_table_contains (self->priv->pending, GUINT_TO_POINTER (handle)))
+    {
+      g_set_error (&error, TP_ERROR, TP_ERROR_NOT_AVAILABLE,
+          "An echo channel to contact #%u is being created", handle);
+      goto error;
+    }
+  else if (chan == NULL && self->priv->delay_new_channels)
+    {
+      delay_new_channel (self, handle, request_token);
+    }
+  else if (chan == NULL)
     {
       new_channel (self, handle,
           tp_base_connection_get_self_handle (self->priv->conn),
@@ -32,6 +32,10 @@ struct _TpTestsEchoImManager {
 
 GType tp_tests_echo_im_manager_get_type (void);
 
+void tp_tests_echo_im_manager_set_delay_new_channels (
+    TpTestsEchoImManager *self,
+    gboolean delay);
+
 /* TYPE MACROS */
 #define TP_TESTS_TYPE_ECHO_IM_MANAGER \
   (tp_tests_echo_im_manager_get_type ())
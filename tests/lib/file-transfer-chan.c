@@ -80,6 +80,12 @@ struct _TpTestsFileTransferChannelPrivate {
     guint connection_id;
     TpSocketAccessControl access_control;
 
+    /* Data sent to the client when it connects to accept the file, and
+     * the data it sent when it connected to provide it */
+    GBytes *content;
+    GBytes *received;
+    gboolean serving;
+
     guint timer_id;
 };
 
@@ -152,6 +158,8 @@ dispose (GObject *object)
   tp_clear_pointer (&self->priv->available_socket_types, g_hash_table_unref);
   tp_clear_pointer (&self->priv->access_control_param, tp_g_value_slice_free);
   tp_clear_pointer (&self->priv->metadata, g_hash_table_unref);
+  tp_clear_pointer (&self->priv->content, g_bytes_unref);
+  tp_clear_pointer (&self->priv->received, g_bytes_unref);
 
   if (self->priv->unix_address != NULL)
     g_unlink (self->priv->unix_address);
@@ -402,6 +410,34 @@ check_address_type (TpTestsFileTransferChannel *self,
 }
 
 static void
+content_sent_cb (GObject *source,
+    GAsyncResult *result,
+    gpointer user_data)
+{
+  GError *error = NULL;
+
+  g_output_stream_splice_finish (G_OUTPUT_STREAM (source), result, &error);
+  g_assert_no_error (error);
+}
+
+static void
+content_received_cb (GObject *source,
+    GAsyncResult *result,
+    gpointer user_data)
+{
+  TpTestsFileTransferChannel *self = user_data;
+  GError *error = NULL;
+
+  g_output_stream_splice_finish (G_OUTPUT_STREAM (source), result, &error);
+  g_assert_no_error (error);
+
+  self->priv->received = g_memory_output_stream_steal_as_bytes (
+      G_MEMORY_OUTPUT_STREAM (source));
+
+  g_object_unref (self);
+}
+
+static gboolean
 service_incoming_cb (GSocketService *service,
     GSocketConnection *connection,
     GObject *source_object,
@@ -440,6 +476,41 @@ service_incoming_cb (GSocketService *service,
 
       g_object_unref (addr);
     }
+
+  /* only the first connection is the one moving the file */
+  if (self->priv->serving)
+    return FALSE;
+
+  self->priv->serving = TRUE;
+
+  if (tp_base_channel_is_requested ((TpBaseChannel *) self))
+    {
+      GOutputStream *received;
+
+      received = g_memory_output_stream_new (NULL, 0, g_realloc, g_free);
+      g_output_stream_splice_async (received,
+          g_io_stream_get_input_stream ((GIOStream *) connection),
+          G_OUTPUT_STREAM_SPLICE_CLOSE_SOURCE |
+          G_OUTPUT_STREAM_SPLICE_CLOSE_TARGET,
+          G_PRIORITY_DEFAULT, NULL, content_received_cb,
+          g_object_ref (self));
+      g_object_unref (received);
+    }
+  else if (self->priv->content != NULL)
+    {
+      GInputStream *content;
+
+      content = g_memory_input_stream_new_from_bytes (self->priv->content);
+      g_output_stream_splice_async (
+          g_io_stream_get_output_stream ((GIOStream *) connection),
+          content,
+          G_OUTPUT_STREAM_SPLICE_CLOSE_SOURCE |
+          G_OUTPUT_STREAM_SPLICE_CLOSE_TARGET,
+          G_PRIORITY_DEFAULT, NULL, content_sent_cb, NULL);
+      g_object_unref (content);
+    }
+
+  return TRUE;
 }
 
 static void
@@ -497,6 +568,9 @@ file_transfer_provide_file (TpSvcChannelTypeFileTransfer *iface,
   self->priv->address_type = address_type;
   self->priv->access_control = access_control;
 
+  tp_g_signal_connect_object (self->priv->service, "incoming",
+      G_CALLBACK (service_incoming_cb), self, 0);
+
   DEBUG ("Waiting 500ms and setting state to OPEN");
   self->priv->timer_id = g_timeout_add (500, start_file_transfer, self);
 
@@ -760,3 +834,20 @@ tp_tests_file_transfer_channel_get_server_address (
 
   return address;
 }
+
+/* Set the data sent when the file is accepted */
+void
+tp_tests_file_transfer_channel_set_content (TpTestsFileTransferChannel *self,
+    GBytes *content)
+{
+  tp_clear_pointer (&self->priv->content, g_bytes_unref);
+  self->priv->content = g_bytes_ref (content);
+}
+
+/* Return the data received after the file was provided, or %NULL if the
+ * client hasn't finished sending it yet */
+GBytes *
+tp_tests_file_transfer_channel_get_received (TpTestsFileTransferChannel *self)
+{
+  return self->priv->received;
+}
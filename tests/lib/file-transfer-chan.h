@@ -58,6 +58,13 @@ GHashTable * tp_tests_file_transfer_channel_get_props (
 GSocketAddress * tp_tests_file_transfer_channel_get_server_address (
         TpTestsFileTransferChannel *self);
 
+void tp_tests_file_transfer_channel_set_content (
+        TpTestsFileTransferChannel *self,
+        GBytes *content);
+
+GBytes * tp_tests_file_transfer_channel_get_received (
+        TpTestsFileTransferChannel *self);
+
 G_END_DECLS
 
 #endif
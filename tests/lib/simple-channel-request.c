@@ -108,6 +108,14 @@ add_channel (TpTestsSimpleChannelRequest *self,
           self->priv->conn, tp_asv_get_string (request,
             TP_PROP_CHANNEL_TYPE_ROOM_LIST_SERVER), &props);
     }
+  else if (!tp_strdiff (chan_type, TP_IFACE_CHANNEL_TYPE_CONTACT_SEARCH))
+    {
+      chan_path = tp_tests_simple_connection_ensure_contact_search_chan (
+          self->priv->conn, tp_asv_get_string (request,
+            TP_PROP_CHANNEL_TYPE_CONTACT_SEARCH_SERVER),
+          tp_asv_get_uint32 (request,
+            TP_PROP_CHANNEL_TYPE_CONTACT_SEARCH_LIMIT, NULL), &props);
+    }
   else
     {
       g_assert_not_reached ();
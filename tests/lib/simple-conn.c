@@ -22,6 +22,7 @@
 
 #include "textchan-null.h"
 #include "room-list-chan.h"
+#include "contact-search-chan.h"
 #include "util.h"
 
 static void props_iface_init (TpSvcDBusPropertiesClass *);
@@ -61,6 +62,7 @@ struct _TpTestsSimpleConnectionPrivate
   /* TpHandle => reffed TpTestsTextChannelNull */
   GHashTable *text_channels;
   TpTestsRoomListChan *room_list_chan;
+  TpTestsContactSearchChan *contact_search_chan;
 
   GError *get_self_handle_error /* initially NULL */ ;
 };
@@ -135,6 +137,7 @@ dispose (GObject *object)
 
   g_hash_table_unref (self->priv->text_channels);
   g_clear_object (&self->priv->room_list_chan);
+  g_clear_object (&self->priv->contact_search_chan);
 
   G_OBJECT_CLASS (tp_tests_simple_connection_parent_class)->dispose (object);
 }
@@ -264,6 +267,7 @@ pretend_disconnected (gpointer data)
   /* We are disconnected, all our channels are invalidated */
   g_hash_table_remove_all (self->priv->text_channels);
   g_clear_object (&self->priv->room_list_chan);
+  g_clear_object (&self->priv->contact_search_chan);
 
   tp_base_connection_finish_shutdown (TP_BASE_CONNECTION (data));
   self->priv->disconnect_source = 0;
@@ -472,6 +476,55 @@ tp_tests_simple_connection_ensure_room_list_chan (TpTestsSimpleConnection *self,
   return chan_path;
 }
 
+static void
+contact_search_chan_closed_cb (TpBaseChannel *channel,
+    TpTestsSimpleConnection *self)
+{
+  g_clear_object (&self->priv->contact_search_chan);
+}
+
+gchar *
+tp_tests_simple_connection_ensure_contact_search_chan (
+    TpTestsSimpleConnection *self,
+    const gchar *server,
+    guint limit,
+    GHashTable **props)
+{
+  gchar *chan_path;
+  TpBaseConnection *base_conn = (TpBaseConnection *) self;
+  static guint count = 0;
+
+  if (self->priv->contact_search_chan != NULL)
+    {
+      /* Channel already exist, reuse it */
+      g_object_get (self->priv->contact_search_chan,
+          "object-path", &chan_path, NULL);
+    }
+  else
+    {
+      chan_path = g_strdup_printf ("%s/ContactSearchChannel%u",
+          tp_base_connection_get_object_path (base_conn), count++);
+
+      self->priv->contact_search_chan = TP_TESTS_CONTACT_SEARCH_CHAN (
+          tp_tests_object_new_static_class (
+            TP_TESTS_TYPE_CONTACT_SEARCH_CHAN,
+            "connection", self,
+            "object-path", chan_path,
+            "server", server ? server : "",
+            "limit", limit,
+            NULL));
+
+      g_signal_connect (self->priv->contact_search_chan, "closed",
+          G_CALLBACK (contact_search_chan_closed_cb), self);
+    }
+
+  if (props != NULL)
+    g_object_get (self->priv->contact_search_chan,
+        "channel-properties", props, NULL);
+
+  return chan_path;
+}
+
 void
 tp_tests_simple_connection_set_get_self_handle_error (
     TpTestsSimpleConnection *self,
@@ -0,0 +1,320 @@
+/*
+ * tls-backend.c - a fake GTlsBackend for tests
+ *
+ * Copyright © 2014 Collabora Ltd. <http://www.collabora.co.uk/>
+ *
+ * Copying and distribution of this file, with or without modification,
+ * are permitted in any medium without royalty provided the copyright
+ * notice and this notice are preserved.
+ */
+
+#include "config.h"
+
+#include "tls-backend.h"
+
+#include <string.h>
+
+/* Certificates */
+
+typedef struct {
+    GTlsCertificate parent;
+    GByteArray *data;
+    GTlsCertificate *issuer;
+} TestCert;
+
+typedef struct {
+    GTlsCertificateClass parent_class;
+} TestCertClass;
+
+static GType test_cert_get_type (void);
+static void test_cert_initable_iface_init (GInitableIface *iface);
+
+G_DEFINE_TYPE_WITH_CODE (TestCert, test_cert, G_TYPE_TLS_CERTIFICATE,
+    G_IMPLEMENT_INTERFACE (G_TYPE_INITABLE, test_cert_initable_iface_init))
+
+enum {
+  PROP_CERTIFICATE = 1,
+  PROP_CERTIFICATE_PEM,
+  PROP_PRIVATE_KEY,
+  PROP_PRIVATE_KEY_PEM,
+  PROP_ISSUER
+};
+
+static void
+test_cert_init (TestCert *self)
+{
+}
+
+static void
+test_cert_get_property (GObject *object,
+    guint prop_id,
+    GValue *value,
+    GParamSpec *pspec)
+{
+  TestCert *self = (TestCert *) object;
+
+  switch (prop_id)
+    {
+      case PROP_CERTIFICATE:
+        g_value_set_boxed (value, self->data);
+        break;
+      case PROP_ISSUER:
+        g_value_set_object (value, self->issuer);
+        break;
+      case PROP_CERTIFICATE_PEM:
+        g_value_set_string (value, NULL);
+        break;
+      default:
+        G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
+    }
+}
+
+static void
+test_cert_set_property (GObject *object,
+    guint prop_id,
+    const GValue *value,
+    GParamSpec *pspec)
+{
+  TestCert *self = (TestCert *) object;
+  GByteArray *data;
+
+  switch (prop_id)
+    {
+      case PROP_CERTIFICATE:
+        data = g_value_get_boxed (value);
+        if (data != NULL)
+          self->data = g_byte_array_ref (data);
+        break;
+      case PROP_ISSUER:
+        self->issuer = g_value_dup_object (value);
+        break;
+      case PROP_CERTIFICATE_PEM:
+      case PROP_PRIVATE_KEY:
+      case PROP_PRIVATE_KEY_PEM:
+        /* not supported */
+        break;
+      default:
+        G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
+    }
+}
+
+static void
+test_cert_finalize (GObject *object)
+{
+  TestCert *self = (TestCert *) object;
+
+  if (self->data != NULL)
+    g_byte_array_unref (self->data);
+
+  g_clear_object (&self->issuer);
+
+  G_OBJECT_CLASS (test_cert_parent_class)->finalize (object);
+}
+
+static GTlsCertificateFlags
+test_cert_verify (GTlsCertificate *cert,
+    GSocketConnectable *identity,
+    GTlsCertificate *trusted_ca)
+{
+  return 0;
+}
+
+static void
+test_cert_class_init (TestCertClass *klass)
+{
+  GObjectClass *object_class = (GObjectClass *) klass;
+  GTlsCertificateClass *cert_class = (GTlsCertificateClass *) klass;
+
+  object_class->get_property = test_cert_get_property;
+  object_class->set_property = test_cert_set_property;
+  object_class->finalize = test_cert_finalize;
+  cert_class->verify = test_cert_verify;
+
+  g_object_class_override_property (object_class, PROP_CERTIFICATE,
+      "certificate");
+  g_object_class_override_property (object_class, PROP_CERTIFICATE_PEM,
+      "certificate-pem");
+  g_object_class_override_property (object_class, PROP_PRIVATE_KEY,
+      "private-key");
+  g_object_class_override_property (object_class, PROP_PRIVATE_KEY_PEM,
+      "private-key-pem");
+  g_object_class_override_property (object_class, PROP_ISSUER, "issuer");
+}
+
+static gboolean
+test_cert_initable_init (GInitable *initable,
+    GCancellable *cancellable,
+    GError **error)
+{
+  TestCert *self = (TestCert *) initable;
+  gsize prefix_len = strlen (TP_TESTS_TLS_BACKEND_CERT_PREFIX);
+
+  if (self->data == NULL || self->data->len < prefix_len ||
+      memcmp (self->data->data, TP_TESTS_TLS_BACKEND_CERT_PREFIX,
+          prefix_len) != 0)
+    {
+      g_set_error_literal (error, G_TLS_ERROR, G_TLS_ERROR_BAD_CERTIFICATE,
+          "Not a test certificate");
+      return FALSE;
+    }
+
+  return TRUE;
+}
+
+static void
+test_cert_initable_iface_init (GInitableIface *iface)
+{
+  iface->init = test_cert_initable_init;
+}
+
+/* Database */
+
+typedef struct {
+    GTlsDatabase parent;
+} TestDatabase;
+
+typedef struct {
+    GTlsDatabaseClass parent_class;
+} TestDatabaseClass;
+
+static GType test_database_get_type (void);
+
+G_DEFINE_TYPE (TestDatabase, test_database, G_TYPE_TLS_DATABASE)
+
+/* verify_chain() runs in worker threads */
+static volatile gint n_verifications = 0;
+
+static void
+test_database_init (TestDatabase *self)
+{
+}
+
+static GTlsCertificateFlags
+test_database_verify_chain (GTlsDatabase *database,
+    GTlsCertificate *chain,
+    const gchar *purpose,
+    GSocketConnectable *identity,
+    GTlsInteraction *interaction,
+    GTlsDatabaseVerifyFlags flags,
+    GCancellable *cancellable,
+    GError **error)
+{
+  TestCert *cert = (TestCert *) chain;
+  gsize prefix_len = strlen (TP_TESTS_TLS_BACKEND_CERT_PREFIX);
+  gchar *hostname;
+  GTlsCertificateFlags ret = 0;
+
+  g_atomic_int_inc (&n_verifications);
+
+  if (identity == NULL)
+    return 0;
+
+  g_assert (G_IS_NETWORK_ADDRESS (identity));
+
+  hostname = g_strndup ((const gchar *) cert->data->data + prefix_len,
+      cert->data->len - prefix_len);
+
+  if (g_strcmp0 (hostname,
+          g_network_address_get_hostname ((GNetworkAddress *) identity)))
+    ret = G_TLS_CERTIFICATE_BAD_IDENTITY;
+
+  g_free (hostname);
+  return ret;
+}
+
+static void
+test_database_class_init (TestDatabaseClass *klass)
+{
+  GTlsDatabaseClass *database_class = (GTlsDatabaseClass *) klass;
+
+  database_class->verify_chain = test_database_verify_chain;
+}
+
+/* Backend */
+
+typedef struct {
+    GObject parent;
+    GTlsDatabase *database;
+} TestBackend;
+
+typedef struct {
+    GObjectClass parent_class;
+} TestBackendClass;
+
+static GType test_backend_get_type (void);
+static void test_backend_iface_init (GTlsBackendInterface *iface);
+
+G_DEFINE_TYPE_WITH_CODE (TestBackend, test_backend, G_TYPE_OBJECT,
+    G_IMPLEMENT_INTERFACE (G_TYPE_TLS_BACKEND, test_backend_iface_init))
+
+static void
+test_backend_init (TestBackend *self)
+{
+  self->database = g_object_new (test_database_get_type (), NULL);
+}
+
+static void
+test_backend_finalize (GObject *object)
+{
+  TestBackend *self = (TestBackend *) object;
+
+  g_clear_object (&self->database);
+
+  G_OBJECT_CLASS (test_backend_parent_class)->finalize (object);
+}
+
+static void
+test_backend_class_init (TestBackendClass *klass)
+{
+  GObjectClass *object_class = (GObjectClass *) klass;
+
+  object_class->finalize = test_backend_finalize;
+}
+
+static gboolean
+test_backend_supports_tls (GTlsBackend *backend)
+{
+  return TRUE;
+}
+
+static GType
+test_backend_get_certificate_type (void)
+{
+  return test_cert_get_type ();
+}
+
+static GTlsDatabase *
+test_backend_get_default_database (GTlsBackend *backend)
+{
+  return g_object_ref (((TestBackend *) backend)->database);
+}
+
+static void
+test_backend_iface_init (GTlsBackendInterface *iface)
+{
+  iface->supports_tls = test_backend_supports_tls;
+  iface->get_certificate_type = test_backend_get_certificate_type;
+  iface->get_default_database = test_backend_get_default_database;
+}
+
+/* Make this the default GTlsBackend. This must be called before anything
+ * calls g_tls_backend_get_default(). */
+void
+tp_tests_tls_backend_install (void)
+{
+  GIOExtensionPoint *ep;
+
+  ep = g_io_extension_point_register (G_TLS_BACKEND_EXTENSION_POINT_NAME);
+  g_io_extension_point_set_required_type (ep, G_TYPE_TLS_BACKEND);
+  g_io_extension_point_implement (G_TLS_BACKEND_EXTENSION_POINT_NAME,
+      test_backend_get_type (), "tp-tests", 1000);
+
+  g_setenv ("GIO_USE_TLS", "tp-tests", TRUE);
+}
+
+/* Return the number of chains verified by the default database so far */
+guint
+tp_tests_tls_backend_get_n_verifications (void)
+{
+  return g_atomic_int_get (&n_verifications);
+}
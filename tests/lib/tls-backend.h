@@ -0,0 +1,29 @@
+/*
+ * tls-backend.h - a fake GTlsBackend for tests
+ *
+ * Copyright © 2014 Collabora Ltd. <http://www.collabora.co.uk/>
+ *
+ * Copying and distribution of this file, with or without modification,
+ * are permitted in any medium without royalty provided the copyright
+ * notice and this notice are preserved.
+ */
+
+#ifndef __TP_TESTS_TLS_BACKEND_H__
+#define __TP_TESTS_TLS_BACKEND_H__
+
+#include <gio/gio.h>
+
+G_BEGIN_DECLS
+
+/* Certificates handled by this backend are not DER: their data is
+ * "CERT:" followed by the only host name they are valid for. Anything else
+ * fails to parse. Every such certificate is trusted. */
+#define TP_TESTS_TLS_BACKEND_CERT_PREFIX "CERT:"
+
+void tp_tests_tls_backend_install (void);
+
+guint tp_tests_tls_backend_get_n_verifications (void);
+
+G_END_DECLS
+
+#endif
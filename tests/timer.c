@@ -0,0 +1,126 @@
+#include "config.h"
+
+#include <glib.h>
+
+#include "telepathy-glib/timer-internal.h"
+
+#include "tests/lib/util.h"
+
+typedef struct {
+    GMainLoop *loop;
+    GString *log;
+    TpTimer *victim;
+    guint pending;
+} Test;
+
+static void
+fired (Test *test,
+    gchar c)
+{
+  g_string_append_c (test->log, c);
+
+  if (--test->pending == 0)
+    g_main_loop_quit (test->loop);
+}
+
+static void
+fire_a (gpointer data)
+{
+  fired (data, 'a');
+}
+
+static void
+fire_b (gpointer data)
+{
+  fired (data, 'b');
+}
+
+static void
+fire_c (gpointer data)
+{
+  fired (data, 'c');
+}
+
+static void
+fire_and_cancel_victim (gpointer data)
+{
+  Test *test = data;
+
+  _tp_timer_cancel (test->victim);
+  test->victim = NULL;
+  /* the victim will never fire */
+  test->pending--;
+  fired (test, 'k');
+}
+
+static void
+setup (Test *test,
+    gconstpointer data)
+{
+  test->loop = g_main_loop_new (NULL, FALSE);
+  test->log = g_string_new ("");
+}
+
+static void
+teardown (Test *test,
+    gconstpointer data)
+{
+  g_string_free (test->log, TRUE);
+  g_main_loop_unref (test->loop);
+}
+
+static void
+test_order (Test *test,
+    gconstpointer data)
+{
+  _tp_timer_add (30, 0, fire_c, test);
+  _tp_timer_add (10, 0, fire_a, test);
+  _tp_timer_add (20, 0, fire_b, test);
+  test->pending = 3;
+
+  g_main_loop_run (test->loop);
+  g_assert_cmpstr (test->log->str, ==, "abc");
+}
+
+static void
+test_cancel (Test *test,
+    gconstpointer data)
+{
+  TpTimer *timer;
+
+  timer = _tp_timer_add (10, 0, fire_a, test);
+  _tp_timer_add (20, 0, fire_b, test);
+  _tp_timer_cancel (timer);
+  test->pending = 1;
+
+  g_main_loop_run (test->loop);
+  g_assert_cmpstr (test->log->str, ==, "b");
+}
+
+static void
+test_cancel_while_due (Test *test,
+    gconstpointer data)
+{
+  /* with a large slack, both timers expire in the same iteration; the
+   * first one to run cancels the other */
+  _tp_timer_add (0, 100, fire_and_cancel_victim, test);
+  test->victim = _tp_timer_add (0, 100, fire_a, test);
+  test->pending = 2;
+
+  g_main_loop_run (test->loop);
+  g_assert_cmpstr (test->log->str, ==, "k");
+}
+
+int
+main (int argc,
+    char **argv)
+{
+  tp_tests_init (&argc, &argv);
+
+  g_test_add ("/timer/order", Test, NULL, setup, test_order, teardown);
+  g_test_add ("/timer/cancel", Test, NULL, setup, test_cancel, teardown);
+  g_test_add ("/timer/cancel-while-due", Test, NULL, setup,
+      test_cancel_while_due, teardown);
+
+  return g_test_run ();
+}